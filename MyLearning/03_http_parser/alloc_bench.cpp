@@ -0,0 +1,169 @@
+// 🧱 分配器基准：模拟一个请求里的内存分配，比 malloc/free、mem_pool、request_arena 三种做法每个请求花多少纳秒
+// 用法: ./alloc_bench [请求数] [线程数]   (默认 2000000 个请求，1 个线程；多个线程时每个线程各跑这么多)
+// 一个“请求”：切 24 个 16~256 字节的零碎 (头部字符串、参数)，再要一个 2KB 的读缓冲区和一个 16KB 的响应缓冲区，
+// 全用完以后释放 (arena 是 reset，一次清空)。大小每个请求都不一样 (固定的伪随机序列)，免得全撞在同一档上。
+//   malloc     每一块都 malloc / free (用的是哪个分配器就测哪个)
+//   mem_pool   每一块都 mem_pool::alloc / free (本线程空闲链表)
+//   arena      零碎从 request_arena 切，两个缓冲区从 mem_pool 拿 (服务器里就是这么用的)
+// 和 jemalloc 比：同一个程序前面加 LD_PRELOAD，malloc 那一列就变成 jemalloc 的了
+//   LD_PRELOAD=/usr/lib/x86_64-linux-gnu/libjemalloc.so.2 ./alloc_bench
+// 编译: g++ -std=c++20 -O2 -DNDEBUG alloc_bench.cpp \
+//         http_conn.cpp config.cpp tls.cpp url.cpp out_chain.cpp mem_pool.cpp co_handler.cpp io_loop.cpp \
+//         micro_cache.cpp req_trace.cpp hpack.cpp http2.cpp busy_poll.cpp page_cache.cpp websocket.cpp form.cpp \
+//         sql_pool.cpp user_store.cpp fcgi.cpp prefork.cpp capture.cpp mem_budget.cpp asset_pack.cpp \
+//         -o alloc_bench -lpthread -lssl -lcrypto -lsqlite3
+//       (只列服务器的库文件：server.cpp 和其它工具 / 测试各有自己的 main，加进来就链接不上)
+//       (-DNDEBUG 去掉 mem_pool 的调试计数器，和线上编译一样)
+#include "mem_pool.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<string.h>
+#include<time.h>
+#include<pthread.h>
+#include<vector>
+
+// =================================================================
+// 1. 一个请求里要的内存
+// =================================================================
+
+static const int SMALL_COUNT=24;
+static const size_t READ_BUF=2048;
+static const size_t OUT_BUF=16384;
+static const int PATTERN=1024;          // 大小序列的长度 (请求之间轮着用)
+
+static size_t g_sizes[PATTERN][SMALL_COUNT];
+
+static void make_sizes(){
+    unsigned x=12345;
+    for(int i=0;i<PATTERN;i++){
+        for(int j=0;j<SMALL_COUNT;j++){
+            x=x*1103515245+12345;
+            g_sizes[i][j]=16+(x>>16)%241;
+        }
+    }
+}
+
+static long long now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+// 每块都写一个字节：不写的话有的分配器 (和编译器) 会把整个分配优化掉 / 根本不碰内存
+static void touch(void* p){
+    *(volatile char*)p=1;
+}
+
+static void run_malloc(int requests){
+    void* small[SMALL_COUNT];
+    for(int r=0;r<requests;r++){
+        const size_t* sizes=g_sizes[r%PATTERN];
+        void* rbuf=malloc(READ_BUF);
+        touch(rbuf);
+        for(int j=0;j<SMALL_COUNT;j++){
+            small[j]=malloc(sizes[j]);
+            touch(small[j]);
+        }
+        void* obuf=malloc(OUT_BUF);
+        touch(obuf);
+        for(int j=0;j<SMALL_COUNT;j++){
+            free(small[j]);
+        }
+        free(obuf);
+        free(rbuf);
+    }
+}
+
+static void run_pool(int requests){
+    void* small[SMALL_COUNT];
+    for(int r=0;r<requests;r++){
+        const size_t* sizes=g_sizes[r%PATTERN];
+        void* rbuf=mem_pool::alloc(READ_BUF,MEM_READ_BUF);
+        touch(rbuf);
+        for(int j=0;j<SMALL_COUNT;j++){
+            small[j]=mem_pool::alloc(sizes[j],MEM_ARENA);
+            touch(small[j]);
+        }
+        void* obuf=mem_pool::alloc(OUT_BUF,MEM_OUT);
+        touch(obuf);
+        for(int j=0;j<SMALL_COUNT;j++){
+            mem_pool::free(small[j],sizes[j],MEM_ARENA);
+        }
+        mem_pool::free(obuf,OUT_BUF,MEM_OUT);
+        mem_pool::free(rbuf,READ_BUF,MEM_READ_BUF);
+    }
+}
+
+static void run_arena(int requests){
+    request_arena arena;
+    for(int r=0;r<requests;r++){
+        const size_t* sizes=g_sizes[r%PATTERN];
+        void* rbuf=mem_pool::alloc(READ_BUF,MEM_READ_BUF);
+        touch(rbuf);
+        for(int j=0;j<SMALL_COUNT;j++){
+            touch(arena.alloc(sizes[j]));
+        }
+        void* obuf=mem_pool::alloc(OUT_BUF,MEM_OUT);
+        touch(obuf);
+        arena.reset();
+        mem_pool::free(obuf,OUT_BUF,MEM_OUT);
+        mem_pool::free(rbuf,READ_BUF,MEM_READ_BUF);
+    }
+    arena.release();
+}
+
+// =================================================================
+// 2. 多线程一起跑 (看全局分配器的锁 / 跨线程竞争)
+// =================================================================
+
+struct bench_job{
+    void (*fn)(int);
+    int requests;
+    pthread_t tid;
+};
+
+static void* job_main(void* arg){
+    bench_job* job=(bench_job*)arg;
+    job->fn(job->requests/10);     // 先热身：空闲链表 / 分配器的缓存都填起来
+    job->fn(job->requests);
+    mem_pool::trim();
+    return NULL;
+}
+
+// 返回墙钟时间 / 所有线程的请求总数 (含热身)：核数够的话线程越多应该越小，分配器有锁就降不下来
+static double run(void (*fn)(int),int requests,int threads){
+    std::vector<bench_job> jobs(threads);
+    long long start=now_ns();
+    for(int i=0;i<threads;i++){
+        jobs[i].fn=fn;
+        jobs[i].requests=requests;
+        pthread_create(&jobs[i].tid,NULL,job_main,&jobs[i]);
+    }
+    for(int i=0;i<threads;i++){
+        pthread_join(jobs[i].tid,NULL);
+    }
+    long long elapsed=now_ns()-start;
+    return (double)elapsed/((double)requests*1.1*threads);
+}
+
+// =================================================================
+// 3. 主函数
+// =================================================================
+
+int main(int argc,char* argv[]){
+    int requests=argc>1?atoi(argv[1]):2000000;
+    int threads=argc>2?atoi(argv[2]):1;
+    if(requests<=0||threads<=0){
+        printf("usage: %s [requests] [threads]\n",argv[0]);
+        return 1;
+    }
+    make_sizes();
+    const char* preload=getenv("LD_PRELOAD");
+    printf("每个请求: %d 块 16~256B + %zuB + %zuB，%d 个线程，每个线程 %d 个请求 (malloc = %s)\n",
+        SMALL_COUNT,READ_BUF,OUT_BUF,threads,requests,preload&&*preload?preload:"glibc");
+    printf("%-10s %12s\n","","ns / 请求");
+    printf("%-10s %12.1f\n","malloc",run(run_malloc,requests,threads));
+    printf("%-10s %12.1f\n","mem_pool",run(run_pool,requests,threads));
+    printf("%-10s %12.1f\n","arena",run(run_arena,requests,threads));
+    return 0;
+}
@@ -0,0 +1,138 @@
+#include "asset_pack.h"
+#include<stdio.h>
+#include<string.h>
+#include<strings.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<sys/stat.h>
+#include<sys/mman.h>
+
+asset_pack::asset_pack():m_base(0),m_size(0),m_entries(0),m_count(0){}
+
+asset_pack::~asset_pack(){
+    if(m_base){
+        munmap(m_base,m_size);
+    }
+}
+
+bool asset_pack::open_pack(const char* path,bool populate,bool hugepage){
+    int fd=open(path,O_RDONLY|O_CLOEXEC);
+    if(fd==-1){
+        perror("open_pack open");
+        return false;
+    }
+
+    struct stat st;
+    if(fstat(fd,&st)==-1||(size_t)st.st_size<sizeof(pack_header)){
+        printf("open_pack: %s is too small\n",path);
+        close(fd);
+        return false;
+    }
+
+    // MAP_SHARED：多个进程 / 新老进程映射同一个文件时共用同一份 page cache
+    int flags=MAP_SHARED;
+    if(populate){
+        flags|=MAP_POPULATE;
+    }
+    char* base=(char*)mmap(0,st.st_size,PROT_READ,flags,fd,0);
+    close(fd); // 映射建好了就可以关 fd
+    if(base==MAP_FAILED){
+        perror("open_pack mmap");
+        return false;
+    }
+
+    if(hugepage){
+        madvise(base,st.st_size,MADV_HUGEPAGE);
+    }
+
+    // 🔍 校验文件头和索引区，防止坏文件让后面的查找越界
+    const pack_header* head=(const pack_header*)base;
+    size_t index_end=sizeof(pack_header)+(size_t)head->count*sizeof(pack_entry);
+    if(memcmp(head->magic,PACK_MAGIC,4)!=0||head->version!=PACK_VERSION||index_end>(size_t)st.st_size){
+        printf("open_pack: %s is not a valid pack file\n",path);
+        munmap(base,st.st_size);
+        return false;
+    }
+
+    const pack_entry* entries=(const pack_entry*)(base+sizeof(pack_header));
+    for(uint32_t i=0;i<head->count;i++){
+        const pack_entry& e=entries[i];
+        if(e.path_off+e.path_len>(uint64_t)st.st_size
+            ||e.plain.head_off+e.plain.head_len>(uint64_t)st.st_size
+            ||e.plain.body_off+e.plain.body_len>(uint64_t)st.st_size
+            ||(e.has_gzip&&(e.gzip.head_off+e.gzip.head_len>(uint64_t)st.st_size
+                ||e.gzip.body_off+e.gzip.body_len>(uint64_t)st.st_size))){
+            printf("open_pack: entry %u of %s is out of range\n",i,path);
+            munmap(base,st.st_size);
+            return false;
+        }
+    }
+
+    m_base=base;
+    m_size=st.st_size;
+    m_entries=entries;
+    m_count=head->count;
+    return true;
+}
+
+// 路径比较：先比公共部分，再比长度 (和打包工具的排序规则一致)
+static int compare_path(const char* a,size_t alen,const char* b,size_t blen){
+    int ret=memcmp(a,b,alen<blen?alen:blen);
+    if(ret!=0){
+        return ret;
+    }
+    if(alen==blen){
+        return 0;
+    }
+    return alen<blen?-1:1;
+}
+
+const pack_entry* asset_pack::find(const char* url,size_t len) const{
+    // 🔎 二分查找：索引是按 path 排好序的
+    uint32_t lo=0,hi=m_count;
+    while(lo<hi){
+        uint32_t mid=lo+(hi-lo)/2;
+        const pack_entry& e=m_entries[mid];
+        int ret=compare_path(m_base+e.path_off,e.path_len,url,len);
+        if(ret==0){
+            return &e;
+        }
+        if(ret<0){
+            lo=mid+1;
+        }else{
+            hi=mid;
+        }
+    }
+    return NULL;
+}
+
+const char* content_type_of(const char* path){
+    const char* dot=strrchr(path,'.');
+    if(!dot){
+        return "application/octet-stream";
+    }
+    dot++;
+
+    static const char* table[][2]={
+        {"html","text/html"},
+        {"htm","text/html"},
+        {"css","text/css"},
+        {"js","application/javascript"},
+        {"json","application/json"},
+        {"txt","text/plain"},
+        {"png","image/png"},
+        {"jpg","image/jpeg"},
+        {"jpeg","image/jpeg"},
+        {"gif","image/gif"},
+        {"svg","image/svg+xml"},
+        {"ico","image/x-icon"},
+        {"mp4","video/mp4"},
+        {"woff2","font/woff2"},
+    };
+    for(size_t i=0;i<sizeof(table)/sizeof(table[0]);i++){
+        if(strcasecmp(dot,table[i][0])==0){
+            return table[i][1];
+        }
+    }
+    return "application/octet-stream";
+}
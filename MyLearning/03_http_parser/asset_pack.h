@@ -0,0 +1,70 @@
+#ifndef ASSETPACK_H
+#define ASSETPACK_H
+
+#include<stdint.h>
+#include<stddef.h>
+
+// 📦 静态资源打包文件 (.pack)
+// 思路：把整个 doc_root 在“编译期”用 pack_assets 工具打成一个文件，
+// 启动时 mmap 一次，之后每个请求只是在内存里二分查找 + writev，
+// 不再需要 open / stat / mmap / close 这一串系统调用。
+//
+// 文件布局 (所有整数都是本机字节序，打包和使用在同一种机器上)：
+// [pack_header][pack_entry x count (按 path 排好序)][路径字符串区][响应头 + 文件内容区]
+
+static const char PACK_MAGIC[4]={'T','S','P','K'};
+static const uint32_t PACK_VERSION=1;
+
+struct pack_header{
+    char magic[4];      // "TSPK"
+    uint32_t version;   // 格式版本
+    uint32_t count;     // 一共多少个文件
+    uint32_t reserved;
+};
+
+// 一个文件的一种“变体” (原始 / gzip 压缩)
+struct pack_variant{
+    uint64_t head_off;  // 预先生成好的响应头 (状态行 + Content-Type + Content-Length [+ Content-Encoding])
+    uint32_t head_len;
+    uint32_t reserved;
+    uint64_t body_off;  // 文件内容
+    uint64_t body_len;
+};
+
+struct pack_entry{
+    uint64_t path_off;      // URL 路径 (比如 "/index.html")，不带 \0
+    uint32_t path_len;
+    uint32_t has_gzip;      // 1 表示有 gzip 变体 (压缩后更小才会有)
+    pack_variant plain;     // 原始内容
+    pack_variant gzip;      // gzip 压缩后的内容
+};
+
+class asset_pack{
+public:
+    asset_pack();
+    ~asset_pack();
+
+    // 🗺️ 打开并 mmap 打包文件
+    // populate: 用 MAP_POPULATE 一次性把所有页读进内存，第一次请求也不会缺页
+    // hugepage: 建议内核用大页 (减少 TLB miss，内核不支持就忽略)
+    bool open_pack(const char* path,bool populate,bool hugepage);
+
+    // 🔎 按 URL 路径二分查找，找不到返回 NULL
+    const pack_entry* find(const char* url,size_t len) const;
+
+    // 拿到某个变体的响应头 / 内容的起始地址
+    const char* data_at(uint64_t off) const{return m_base+off;}
+
+    uint32_t count() const{return m_count;}
+
+private:
+    char* m_base;               // mmap 的起始地址
+    size_t m_size;              // 整个文件大小
+    const pack_entry* m_entries;// 索引区
+    uint32_t m_count;
+};
+
+// 🏷️ 根据文件扩展名猜 Content-Type (打包工具用)
+const char* content_type_of(const char* path);
+
+#endif
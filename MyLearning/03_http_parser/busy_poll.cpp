@@ -0,0 +1,149 @@
+#include "busy_poll.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdint.h>
+#include<errno.h>
+#include<time.h>
+#include<sys/ioctl.h>
+#include<sys/socket.h>
+#include<unistd.h>
+
+// 老的内核头文件里还没有 (6.9 才加的)，ABI 是固定的，自己定义一份
+#ifndef EPIOCSPARAMS
+struct epoll_params{
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A,0x01,struct epoll_params)
+#endif
+
+#ifndef SO_PREFER_BUSY_POLL
+#define SO_PREFER_BUSY_POLL 69
+#endif
+
+static long long poll_now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// =================================================================
+// 1. 配置 / 内核那一侧的 busy poll
+// =================================================================
+
+int parse_poll_mode(const char* name){
+    if(strcmp(name,"sleep")==0){
+        return POLL_SLEEP;
+    }
+    if(strcmp(name,"spin")==0){
+        return POLL_SPIN;
+    }
+    if(strcmp(name,"adaptive")==0){
+        return POLL_ADAPTIVE;
+    }
+    return -1;
+}
+
+void busy_poll_tune_socket(int fd,int busy_poll_us){
+    // SO_BUSY_POLL 比 net.core.busy_read 大的时候要 CAP_NET_ADMIN，设不上就算了
+    if(setsockopt(fd,SOL_SOCKET,SO_BUSY_POLL,&busy_poll_us,sizeof(busy_poll_us))<0){
+        perror("setsockopt SO_BUSY_POLL (忽略)");
+    }
+    int one=1;
+    setsockopt(fd,SOL_SOCKET,SO_PREFER_BUSY_POLL,&one,sizeof(one));
+}
+
+void event_waiter::init(int epollfd,int mode,int busy_poll_us){
+    m_mode=mode;
+    m_max_spin_us=busy_poll_us>0?busy_poll_us:0;
+    m_epollfd=epollfd;
+    if(m_mode==POLL_SLEEP||m_max_spin_us==0){
+        m_mode=POLL_SLEEP;
+        return;
+    }
+    if(sysconf(_SC_NPROCESSORS_ONLN)<=1){
+        printf("🏎️ 只有一个 CPU，空转没有意义，poll_mode 退回 sleep\n");
+        m_mode=POLL_SLEEP;
+        return;
+    }
+    // spin 一直开着；adaptive 等量出事件来得够密了再开
+    set_kernel_busy(m_mode==POLL_SPIN);
+}
+
+void event_waiter::set_kernel_busy(bool on){
+    struct epoll_params params;
+    memset(&params,0,sizeof(params));
+    params.busy_poll_usecs=on?m_max_spin_us:0;
+    params.busy_poll_budget=on?8:0;     // 每次最多从网卡队列里捞几个包 (不要 CAP_NET_ADMIN 的上限)
+    params.prefer_busy_poll=on?1:0;
+    ioctl(m_epollfd,EPIOCSPARAMS,&params);  // 老内核 ENOTTY，不影响用户态空转
+    m_kernel_busy=on;
+}
+
+// =================================================================
+// 2. 等事件
+// =================================================================
+
+int event_waiter::spin_budget_us() const{
+    if(m_mode==POLL_SPIN){
+        return m_max_spin_us;
+    }
+    // 🎚️ adaptive：事件平均隔多久来一批，就转它的两倍 (多半能接住下一批)；
+    // 隔得比上限还久，说明转了也白转，直接睡
+    if(m_avg_gap_us<0||m_avg_gap_us>m_max_spin_us){
+        return 0;
+    }
+    long long budget=m_avg_gap_us*2;
+    return budget>m_max_spin_us?m_max_spin_us:(int)budget;
+}
+
+int event_waiter::wait(int epollfd,struct epoll_event* events,int max,int timeout){
+    if(m_mode==POLL_SLEEP||timeout==0){
+        return epoll_wait(epollfd,events,max,timeout);
+    }
+
+    long long start=poll_now_us();
+    int budget=spin_budget_us();
+    if(m_mode==POLL_ADAPTIVE&&(budget>0)!=m_kernel_busy){
+        set_kernel_busy(budget>0);
+    }
+    if(timeout>0&&budget>timeout*1000){
+        budget=timeout*1000;
+    }
+
+    // 🌀 先空转：epoll_wait(0) 不睡，有事件马上拿走
+    int number=0;
+    long long now=start;
+    while(true){
+        number=epoll_wait(epollfd,events,max,0);
+        now=poll_now_us();
+        if(number!=0||now-start>=budget){
+            break;
+        }
+    }
+
+    // 😴 转完了还没有：老老实实睡 (超时要扣掉已经转掉的时间)
+    if(number==0){
+        int left=timeout;
+        if(timeout>0){
+            left=timeout-(int)((now-start)/1000);
+            if(left<0){
+                left=0;
+            }
+        }
+        number=epoll_wait(epollfd,events,max,left);
+        now=poll_now_us();
+    }
+
+    // 📈 记下这一批离上一批隔了多久 (滑动平均，新的占 1/8)
+    if(number>0){
+        if(m_last_event_us>0){
+            long long gap=now-m_last_event_us;
+            m_avg_gap_us=m_avg_gap_us<0?gap:m_avg_gap_us+(gap-m_avg_gap_us)/8;
+        }
+        m_last_event_us=now;
+    }
+    return number;
+}
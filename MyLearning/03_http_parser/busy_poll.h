@@ -0,0 +1,52 @@
+#ifndef BUSYPOLL_H
+#define BUSYPOLL_H
+
+#include<sys/epoll.h>
+
+// 🏎️ 低延迟轮询：epoll_wait(-1) 每次都要睡下去再被叫醒，轻负载时每个请求都白付一次唤醒 (几十微秒)
+// 三种模式 (配置 poll_mode，只在启动时读一次)：
+//   - sleep：原来的样子，一直睡到有事件 (默认)
+//   - spin：先用 epoll_wait(0) 空转最多 busy_poll_us 微秒，等不到再睡
+//   - adaptive：空转多久看最近的事件来得有多密：两批事件之间的间隔 (滑动平均) 比上限短，
+//     就转到它的两倍左右；来得稀稀拉拉的时候一点都不转，闲着的时候不烧 CPU
+// 另外在监听 socket 上打开 SO_BUSY_POLL / SO_PREFER_BUSY_POLL (新连接会继承)，
+// 在 epoll 上设 EPIOCSPARAMS (6.9+)：让内核在空转时直接去轮询网卡队列，而不是等中断。
+// 没权限 / 内核不支持就算了，用户态的空转照样有效。
+// 只有一个 CPU 的机器上空转只会抢走别人 (包括内核收包) 的时间，直接退回 sleep。
+
+enum POLL_MODE{
+    POLL_SLEEP=0,
+    POLL_SPIN,
+    POLL_ADAPTIVE
+};
+
+// "sleep" / "spin" / "adaptive" -> POLL_MODE，认不出来返回 -1
+int parse_poll_mode(const char* name);
+
+// 🔌 监听 socket 上打开内核的 busy poll
+void busy_poll_tune_socket(int fd,int busy_poll_us);
+
+// ⏳ 每个事件循环一个 (不跨线程用)
+class event_waiter{
+public:
+    event_waiter():m_mode(POLL_SLEEP),m_max_spin_us(0),m_epollfd(-1),m_kernel_busy(false),m_avg_gap_us(-1),m_last_event_us(0){}
+
+    // mode / 空转上限 (微秒)；epollfd 用来设 EPIOCSPARAMS
+    void init(int epollfd,int mode,int busy_poll_us);
+
+    // 和 epoll_wait 一样 (timeout 毫秒，-1 表示一直等)
+    int wait(int epollfd,struct epoll_event* events,int max,int timeout);
+
+private:
+    int spin_budget_us() const;
+    void set_kernel_busy(bool on);
+
+    int m_mode;
+    int m_max_spin_us;
+    int m_epollfd;
+    bool m_kernel_busy;         // epoll 上的内核 busy poll 现在开着 (adaptive 不转的时候要关掉)
+    long long m_avg_gap_us;     // 相邻两批事件的间隔 (滑动平均)，-1 表示还没量过
+    long long m_last_event_us;  // 上一批事件是什么时候来的
+};
+
+#endif
@@ -0,0 +1,158 @@
+#include "capture.h"
+#include<stdio.h>
+#include<string.h>
+#include<unistd.h>
+#include<time.h>
+#include<pthread.h>
+#include<atomic>
+#include<string>
+
+// =================================================================
+// 1. 全局状态
+// =================================================================
+
+static const size_t CAPTURE_FLUSH_BYTES=256*1024;       // 攒够这么多就叫后台线程来写
+static const size_t CAPTURE_MAX_BACKLOG=64*1024*1024;   // 积压超过这么多就开始丢
+static const int CAPTURE_FLUSH_MS=200;                  // 攒不够也最多隔这么久写一次
+
+static FILE* g_capture_fp=NULL;
+static int g_capture_sample=0;
+static long long g_capture_start=0;
+static std::atomic<uint32_t> g_next_conn(1);
+
+// 📮 I/O 线程往 g_pending 里追加，后台线程整块换走再写 (双缓冲，写文件时不拿锁)
+static pthread_mutex_t g_capture_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_capture_cond=PTHREAD_COND_INITIALIZER;
+static std::string g_pending;
+static bool g_capture_stop=false;
+static long long g_capture_dropped=0;   // 丢过数据、回放时整条不要的连接数 (拿着锁改)
+static long long g_capture_records=0;
+static pthread_t g_writer;
+
+static long long capture_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// =================================================================
+// 2. 后台写文件的线程
+// =================================================================
+
+static void* capture_writer(void*){
+    std::string batch;
+    pthread_mutex_lock(&g_capture_lock);
+    while(true){
+        if(g_pending.size()<CAPTURE_FLUSH_BYTES&&!g_capture_stop){
+            struct timespec deadline;
+            clock_gettime(CLOCK_REALTIME,&deadline);
+            deadline.tv_nsec+=CAPTURE_FLUSH_MS*1000000L;
+            if(deadline.tv_nsec>=1000000000L){
+                deadline.tv_sec++;
+                deadline.tv_nsec-=1000000000L;
+            }
+            pthread_cond_timedwait(&g_capture_cond,&g_capture_lock,&deadline);
+        }
+        batch.swap(g_pending);
+        bool stop=g_capture_stop;
+        pthread_mutex_unlock(&g_capture_lock);
+
+        if(!batch.empty()){
+            fwrite(batch.data(),1,batch.size(),g_capture_fp);
+            fflush(g_capture_fp);
+            batch.clear();
+        }
+        pthread_mutex_lock(&g_capture_lock);
+        if(stop&&g_pending.empty()){
+            break;
+        }
+    }
+    pthread_mutex_unlock(&g_capture_lock);
+    return NULL;
+}
+
+bool capture_open(const char* path,int sample){
+    if(sample<=0||!path||!path[0]){
+        return true;    // 没开
+    }
+    // 和 trace_file 一样带上 pid：平滑升级 / 多进程模式下好几个进程同时在抓
+    char name[512];
+    snprintf(name,sizeof(name),"%s.%d",path,getpid());
+    g_capture_fp=fopen(name,"wb");
+    if(!g_capture_fp){
+        perror("capture_open");
+        return false;
+    }
+    fwrite(CAPTURE_MAGIC,1,8,g_capture_fp);
+    g_capture_sample=sample;
+    g_capture_start=capture_now();
+    if(pthread_create(&g_writer,NULL,capture_writer,NULL)!=0){
+        perror("capture writer");
+        fclose(g_capture_fp);
+        g_capture_fp=NULL;
+        g_capture_sample=0;
+        return false;
+    }
+    printf("🎙️ 抓流量：每 %d 个连接抽一个，写到 %s\n",sample,name);
+    return true;
+}
+
+// =================================================================
+// 3. I/O 线程这边
+// =================================================================
+
+static thread_local unsigned t_conn_counter=0;
+
+uint32_t capture_sample_conn(){
+    if(g_capture_sample==0){
+        return 0;
+    }
+    if(++t_conn_counter<(unsigned)g_capture_sample){
+        return 0;
+    }
+    t_conn_counter=0;
+    return g_next_conn.fetch_add(1,std::memory_order_relaxed);
+}
+
+bool capture_write(uint32_t conn,const char* data,size_t len){
+    capture_record_head head;
+    head.ts_us=capture_now()-g_capture_start;
+    head.conn=conn;
+    head.len=(uint32_t)len;
+
+    pthread_mutex_lock(&g_capture_lock);
+    if(g_pending.size()+sizeof(head)+len>CAPTURE_MAX_BACKLOG){
+        // 磁盘跟不上：宁可丢也不能让 I/O 线程等。只记一个 16 字节的标记 (可以超过上限这一点)，
+        // 告诉回放工具这条连接不完整了
+        head.len=CAPTURE_DROPPED;
+        g_pending.append((const char*)&head,sizeof(head));
+        g_capture_dropped++;
+        pthread_mutex_unlock(&g_capture_lock);
+        return false;
+    }
+    g_pending.append((const char*)&head,sizeof(head));
+    g_pending.append(data,len);
+    g_capture_records++;
+    bool wake=g_pending.size()>=CAPTURE_FLUSH_BYTES;
+    pthread_mutex_unlock(&g_capture_lock);
+    if(wake){
+        pthread_cond_signal(&g_capture_cond);
+    }
+    return true;
+}
+
+void capture_close(){
+    if(!g_capture_fp){
+        return;
+    }
+    pthread_mutex_lock(&g_capture_lock);
+    g_capture_stop=true;
+    pthread_mutex_unlock(&g_capture_lock);
+    pthread_cond_signal(&g_capture_cond);
+    pthread_join(g_writer,NULL);
+
+    fclose(g_capture_fp);
+    g_capture_fp=NULL;
+    g_capture_sample=0;
+    printf("🎙️ 抓流量：记了 %lld 段数据，积压太多丢掉了 %lld 条连接\n",g_capture_records,g_capture_dropped);
+}
@@ -0,0 +1,46 @@
+#ifndef CAPTURE_H
+#define CAPTURE_H
+
+#include<stdint.h>
+#include<stddef.h>
+
+// 🎙️ 抓流量：把抽中的连接上收到的原始字节 (连同收到的时刻) 记进一个紧凑的二进制文件，
+// 以后用 replay 工具按原来的节奏 (或者加速 / 全速) 原样打回服务器，拿真实流量做性能回归测试。
+//   - 按连接抽样 (每 capture_sample 个连接抽一个)：一条连接上的字节流是完整的，
+//     keep-alive、pipelining、请求体分几次到，回放时都和当时一样
+//   - 在 read_once 里记：HTTPS 记的是解密之后的明文 (回放打到 HTTP 端口)；
+//     切到 HTTP/2、WebSocket 以后就不再记了 (回放工具只认 HTTP/1.x)
+//   - I/O 线程只把记录拷进一块共享的缓冲区，写文件是后台线程的事，不会卡在磁盘上；
+//     后台线程写不过来、积压超过上限的就丢掉 (退出时打印丢了多少)。
+//     丢不能只丢一段：字节流中间少一截，回放时后面的字节会接到前面去，拼出一堆乱七八糟的请求。
+//     所以一条连接丢过一段，就记一条“丢了”的标记 (len 是 CAPTURE_DROPPED，后面没有数据)，
+//     这条连接以后也不再记；回放工具看到标记就把整条连接扔掉，回放的连接都是完整的
+//
+// 文件格式 (主机字节序)：
+//   文件头 CAPTURE_MAGIC (8 字节)
+//   然后一条接一条：capture_record_head (16 字节) + len 字节的数据
+// 回放：./replay trace.cap.<pid> -s 1     (见 replay.cpp)
+
+#define CAPTURE_MAGIC "TSCAP001"
+#define CAPTURE_DROPPED 0xffffffffu     // capture_record_head.len 是它：这条连接丢过数据，整条都别用
+
+struct capture_record_head{
+    uint64_t ts_us;     // 从开始抓的那一刻算起 (单调时钟，微秒)
+    uint32_t conn;      // 连接编号 (从 1 开始，一个文件里不重复)
+    uint32_t len;       // 后面跟着多少字节
+};
+
+// 🎲 启动时调一次：sample=N 表示每 N 个连接抽一个 (0 关掉)，写到 path.<pid>
+bool capture_open(const char* path,int sample);
+
+// 新连接要不要抓：返回 0 不抓，否则是它的连接编号 (每个线程自己数，不用加锁)
+uint32_t capture_sample_conn();
+
+// 📥 记一段收到的数据 (拷进缓冲区就返回)
+// 返回 false：积压太多丢掉了 (已经记了丢弃标记)，这条连接以后别再记了
+bool capture_write(uint32_t conn,const char* data,size_t len);
+
+// 🔚 退出前调：等后台线程把剩下的写完，关文件
+void capture_close();
+
+#endif
@@ -0,0 +1,233 @@
+#include "co_handler.h"
+#include "http_conn.h"
+#include<string.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<stdint.h>
+#include<queue>
+#include<vector>
+
+// =================================================================
+// 1. 路由
+// =================================================================
+
+struct co_route_entry{
+    const char* prefix;
+    size_t len;
+    co_handler_fn fn;
+};
+
+static const int MAX_ROUTES=32;
+static co_route_entry g_routes[MAX_ROUTES];
+static int g_route_count=0;
+
+bool co_route(const char* prefix,co_handler_fn fn){
+    if(g_route_count>=MAX_ROUTES){
+        return false;
+    }
+    g_routes[g_route_count].prefix=prefix;
+    g_routes[g_route_count].len=strlen(prefix);
+    g_routes[g_route_count].fn=fn;
+    g_route_count++;
+    return true;
+}
+
+co_handler_fn co_find_route(const char* url){
+    if(!url){
+        return 0;
+    }
+    for(int i=0;i<g_route_count;i++){
+        if(strncmp(url,g_routes[i].prefix,g_routes[i].len)==0){
+            return g_routes[i].fn;
+        }
+    }
+    return 0;
+}
+
+// =================================================================
+// 2. 定时器 (小根堆，按到期时间排)
+// =================================================================
+
+struct co_timer{
+    long long deadline;
+    http_conn* conn;
+    unsigned seq;       // 注册时协程的编号，对不上就说明协程已经没了
+    bool operator>(const co_timer& other) const{return deadline>other.deadline;}
+};
+
+// 每个 I/O 线程一个堆：协程在哪个线程挂起，就在哪个线程被叫醒
+static thread_local std::priority_queue<co_timer,std::vector<co_timer>,std::greater<co_timer> > g_timers;
+
+void co_timer_add(long long deadline_us,http_conn* conn,unsigned seq){
+    co_timer t;
+    t.deadline=deadline_us;
+    t.conn=conn;
+    t.seq=seq;
+    g_timers.push(t);
+}
+
+int co_timer_next_ms(long long now){
+    if(g_timers.empty()){
+        return -1;
+    }
+    long long left=g_timers.top().deadline-now;
+    if(left<=0){
+        return 0;
+    }
+    return (int)((left+999)/1000); // 向上取整，别提前醒
+}
+
+void co_timer_run(long long now){
+    while(!g_timers.empty()&&g_timers.top().deadline<=now){
+        co_timer t=g_timers.top();
+        g_timers.pop();
+        t.conn->co_on_timer(t.seq);
+    }
+}
+
+// =================================================================
+// 3. 跨线程叫醒
+// =================================================================
+
+struct co_wakeup{
+    http_conn* conn;
+    unsigned seq;
+};
+
+struct co_waker{
+    int notify_fd;
+    pthread_mutex_t lock;
+    std::vector<co_wakeup> ready;   // 等着被叫醒的协程
+};
+
+static thread_local co_waker* t_waker=NULL;
+
+void co_waker_bind(int notify_fd){
+    // 每个 I/O 循环一个，跟进程同生共死，不用释放
+    co_waker* w=new co_waker;
+    w->notify_fd=notify_fd;
+    pthread_mutex_init(&w->lock,NULL);
+    t_waker=w;
+}
+
+co_waker* co_current_waker(){
+    return t_waker;
+}
+
+void co_wake(co_waker* waker,http_conn* conn,unsigned seq){
+    co_wakeup w;
+    w.conn=conn;
+    w.seq=seq;
+    pthread_mutex_lock(&waker->lock);
+    waker->ready.push_back(w);
+    pthread_mutex_unlock(&waker->lock);
+
+    uint64_t one=1;
+    ssize_t ret=write(waker->notify_fd,&one,sizeof(one));
+    (void)ret;
+}
+
+void co_waker_run(){
+    if(!t_waker){
+        return;
+    }
+    std::vector<co_wakeup> batch;
+    pthread_mutex_lock(&t_waker->lock);
+    batch.swap(t_waker->ready);
+    pthread_mutex_unlock(&t_waker->lock);
+
+    for(size_t i=0;i<batch.size();i++){
+        batch[i].conn->co_on_wakeup(batch[i].seq);
+    }
+}
+
+// =================================================================
+// 4. 各种 awaitable
+// =================================================================
+
+// 📨 请求头：process_read 读到请求头的空行才会去查路由、填上 m_co_fn，
+// 所以 m_co_fn 有值就说明头已经读完了 (一般协程一开始跑就是这样)
+bool co_read_headers::await_ready(){
+    return conn->m_co_fn!=0;
+}
+
+void co_read_headers::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_wait=CO_WAIT_HEADERS;
+}
+
+bool co_read_headers::await_resume(){
+    return await_ready();
+}
+
+// 📦 请求体：缓冲区里有就直接拿，没有就挂起等 EPOLLIN
+bool co_read_body::await_ready(){
+    return conn->m_co_body_left==0||conn->m_read_idx>conn->m_checked_idx;
+}
+
+void co_read_body::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_wait=CO_WAIT_BODY;
+}
+
+ssize_t co_read_body::await_resume(){
+    size_t n=conn->m_read_idx-conn->m_checked_idx;
+    if(n>len) n=len;
+    if(n>(size_t)conn->m_co_body_left) n=conn->m_co_body_left;
+
+    memcpy(buf,conn->m_read_buf+conn->m_checked_idx,n);
+    conn->m_checked_idx+=n;
+    conn->m_co_body_left-=n;
+
+    // 缓冲区里的请求体都拿走了：把游标退回请求体开头，后面的数据接着往这里读
+    // 这样请求体再大也不会把缓冲区撑满
+    if(conn->m_checked_idx==conn->m_read_idx){
+        conn->m_read_idx=conn->m_co_body_start;
+        conn->m_checked_idx=conn->m_co_body_start;
+        conn->m_start_line=conn->m_co_body_start;
+    }
+    return n;
+}
+
+// 📤 发送：先直接试着发，发不完再挂起等 EPOLLOUT
+bool co_write::await_ready(){
+    if(state==0){
+        state=conn->co_send(iov,count);
+    }
+    return state!=0;
+}
+
+void co_write::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_writer=this;
+    conn->m_co_wait=CO_WAIT_WRITE;
+}
+
+// 🚰 流式发送：每写一块都顺手发一下 (首字节早点出去)，堆积太多了才挂起
+bool co_drain::await_ready(){
+    if(conn->m_co_failed){
+        return true;
+    }
+    if(conn->flush_out()<0){
+        conn->m_co_failed=true;
+        return true;
+    }
+    return conn->m_out.size()<=limit;
+}
+
+void co_drain::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_drain_limit=limit;
+    conn->m_co_wait=CO_WAIT_DRAIN;
+}
+
+bool co_drain::await_resume(){
+    return !conn->m_co_failed;
+}
+
+// ⏳ 睡一会：挂到定时器上，到期了由主循环叫醒
+void co_sleep::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    co_timer_add(http_conn::now_us()+(long long)ms*1000,conn,conn->m_co_seq);
+    conn->m_co_wait=CO_WAIT_TIMER;
+}
@@ -0,0 +1,141 @@
+#ifndef CO_HANDLER_H
+#define CO_HANDLER_H
+
+#include<coroutine>
+#include<stddef.h>
+#include<sys/types.h>
+#include<sys/uio.h>
+#include "mem_pool.h"
+
+class http_conn;
+
+// 🧵 C++20 协程 handler
+// 以前想写点异步的逻辑，就得自己在 m_check_state / bytes_to_send / EPOLLONESHOT 之间倒腾状态。
+// 现在可以把一个请求的处理写成一条直线：
+//
+//     co_task echo(http_conn& conn){
+//         if(!co_await conn.read_headers()) co_return;
+//         char buf[4096];
+//         ssize_t n;
+//         while((n=co_await conn.read_body(buf,sizeof(buf)))>0){ ... }
+//         co_await conn.sleep(100);
+//         co_await conn.write(iov,2);
+//     }
+//
+// 响应体事先不知道多长的，用 chunked 边算边发：
+//
+//     conn.start_chunked(200,"OK","text/plain");
+//     while(...){ if(!co_await conn.write_chunk(buf,n)) co_return; }
+//     co_await conn.end_chunked();
+//
+// 遇到 EAGAIN 就挂起，epoll 通知了再由 http_conn 叫醒它。
+// 全程都在这个连接所在的 I/O 循环里跑，不用加锁。
+
+// 📜 协程 handler 的返回类型
+class co_task{
+public:
+    struct promise_type{
+        bool failed=false;  // handler 里抛了异常
+
+        co_task get_return_object(){
+            return co_task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+        // 创建出来先挂着，等 http_conn 绑定好再开始跑
+        std::suspend_always initial_suspend() noexcept{return {};}
+        // 跑完也挂着，由 http_conn 负责销毁 (它要知道什么时候结束的)
+        std::suspend_always final_suspend() noexcept{return {};}
+        void return_void(){}
+        void unhandled_exception(){failed=true;}
+
+        // 帧从内存池里拿：一个请求的帧用完挂回链表，下个请求直接拿，稳定之后不再 malloc
+        static void* operator new(size_t size){return mem_pool::alloc(size,MEM_CORO);}
+        static void operator delete(void* p,size_t size){mem_pool::free(p,size,MEM_CORO);}
+    };
+    typedef std::coroutine_handle<promise_type> handle;
+
+    explicit co_task(handle h):m_handle(h){}
+    co_task(co_task&& other):m_handle(other.m_handle){other.m_handle=nullptr;}
+    co_task(const co_task&)=delete;
+    co_task& operator=(const co_task&)=delete;
+    ~co_task(){
+        if(m_handle){
+            m_handle.destroy();
+        }
+    }
+
+    // 把帧的所有权交出去 (交给 http_conn)
+    handle release(){
+        handle h=m_handle;
+        m_handle=nullptr;
+        return h;
+    }
+
+private:
+    handle m_handle;
+};
+
+// 🗺️ 路由：URL 以 prefix 开头的请求交给协程 handler，其他的照旧走静态文件
+typedef co_task (*co_handler_fn)(http_conn& conn);
+bool co_route(const char* prefix,co_handler_fn fn);
+co_handler_fn co_find_route(const char* url);
+
+// ⏰ 定时器 (给 conn.sleep 用)，主循环负责驱动
+void co_timer_add(long long deadline_us,http_conn* conn,unsigned seq);
+int co_timer_next_ms(long long now);    // 离最近的定时器还有几毫秒，没有定时器返回 -1
+void co_timer_run(long long now);       // 叫醒所有到期的协程
+
+// 🔔 跨线程叫醒：别的线程 (比如填好了缓存的那个) 想叫醒某个协程时，
+// 不能直接 resume (协程只能在自己的 I/O 循环里跑)，而是排进它所在循环的队列，再写一下 eventfd
+struct co_waker;
+void co_waker_bind(int notify_fd);      // 当前线程的 I/O 循环用这个 eventfd 接收叫醒通知
+co_waker* co_current_waker();           // 当前线程的队列 (没绑过返回 NULL)
+void co_wake(co_waker* waker,http_conn* conn,unsigned seq);     // 任意线程都能调
+void co_waker_run();                    // I/O 循环收到 eventfd 通知后调：叫醒排队的协程
+
+// ⏳ 各种可以 co_await 的东西 (由 http_conn 的同名函数创建)
+struct co_read_headers{
+    http_conn* conn;
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    bool await_resume();                // false: 请求头有问题
+};
+
+struct co_read_body{
+    http_conn* conn;
+    char* buf;
+    size_t len;
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    ssize_t await_resume();             // 读到多少字节，0 表示请求体读完了
+};
+
+struct co_write{
+    static const int MAX_IOV=8;
+    http_conn* conn;
+    struct iovec iov[MAX_IOV];
+    int count;
+    int state;                          // 1: 发完了  0: 还没发完  -1: 出错了
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    bool await_resume(){return state==1;}
+};
+
+// 🚰 chunked 流式发送：数据已经接到 m_out 上了，这里先尽量发一下，
+// 没发出去的超过 limit 就挂起，等 EPOLLOUT 把它发到 limit 以下 (背压)
+struct co_drain{
+    http_conn* conn;
+    size_t limit;
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    bool await_resume();                // false: 发送出错了
+};
+
+struct co_sleep{
+    http_conn* conn;
+    int ms;
+    bool await_ready(){return ms<=0;}
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume(){}
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "config.h"
+#include "asset_pack.h"
+#include "busy_poll.h"
+#include "parser_policy.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<fcntl.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/socket.h>
+
+root_dir::~root_dir(){
+    close(fd);
+}
+
+// 📂 打开 doc_root 留着当 openat 的起点，打不开返回空
+static std::shared_ptr<const root_dir> open_root_dir(const char* path){
+    int fd=open(path,O_PATH|O_DIRECTORY|O_CLOEXEC);
+    if(fd<0){
+        return nullptr;
+    }
+    return std::make_shared<const root_dir>(fd);
+}
+
+// 默认配置 (没有配置文件时就用这个)
+static std::shared_ptr<const server_config> make_default_config(){
+    std::shared_ptr<server_config> conf=std::make_shared<server_config>();
+    conf->https_port=0;
+    conf->tls_cert[0]='\0';
+    conf->tls_key[0]='\0';
+    conf->listen_backlog=SOMAXCONN;
+    conf->io_loops=0;
+    conf->cpu_pinning=false;
+    conf->steer_incoming_cpu=false;
+    conf->workers=0;
+    conf->micro_cache_mb=64;
+    conf->mem_soft_mb=0;
+    conf->mem_hard_mb=0;
+    conf->trace_sample=0;
+    conf->capture_sample=0;
+    conf->zerocopy_min=0;
+    conf->large_file_mb=0;
+    conf->large_file_drop_behind=true;
+    conf->poll_mode=POLL_SLEEP;
+    conf->busy_poll_us=50;
+    conf->parser=PARSER_VERBOSE;
+    conf->ws_max_queue_kb=1024;
+    conf->user_db[0]='\0';
+    conf->db_pool_size=4;
+    conf->fcgi_pass[0]='\0';
+    conf->fcgi_root[0]='\0';
+    conf->fcgi_pool_size=8;
+    snprintf(conf->fcgi_prefix,sizeof(conf->fcgi_prefix),"%s","/cgi/");
+    snprintf(conf->trace_file,server_config::PATH_LEN,"%s","trace.json");
+    snprintf(conf->capture_file,server_config::PATH_LEN,"%s","traffic.cap");
+    snprintf(conf->doc_root,server_config::PATH_LEN,"%s","/Users/neroji/Desktop/MyTinyServer/resource file");
+    conf->root=open_root_dir(conf->doc_root);
+    return conf;
+}
+
+// 🌍 当前生效的配置 (只能通过 std::atomic_load / std::atomic_store 访问)
+static std::shared_ptr<const server_config> g_config=make_default_config();
+
+std::shared_ptr<const server_config> current_config(){
+    return std::atomic_load(&g_config);
+}
+
+bool reload_config(const char* path){
+    FILE* fp=fopen(path,"r");
+    if(!fp){
+        perror("reload_config fopen");
+        return false;
+    }
+
+    // 1. 先在“旁边”拷一份当前配置，在拷贝上改 (读者完全看不到半成品)
+    std::shared_ptr<server_config> conf=std::make_shared<server_config>(*current_config());
+
+    char line[512];
+    bool ok=true;
+    char pack_path[server_config::PATH_LEN]={0};
+    bool pack_populate=true;    // 启动时把整个包读进内存
+    bool pack_hugepage=false;   // 建议内核用大页
+    while(fgets(line,sizeof(line),fp)){
+        // 去掉行尾的换行
+        line[strcspn(line,"\r\n")]='\0';
+        if(line[0]=='\0'||line[0]=='#'){
+            continue;
+        }
+
+        char* value=strchr(line,'=');
+        if(!value){
+            ok=false;
+            break;
+        }
+        *value++='\0';
+
+        if(strcmp(line,"doc_root")==0){
+            if(strlen(value)>=(size_t)server_config::PATH_LEN){
+                ok=false;
+                break;
+            }
+            strcpy(conf->doc_root,value);
+        }else if(strcmp(line,"https_port")==0){
+            conf->https_port=atoi(value);
+        }else if(strcmp(line,"tls_cert")==0){
+            snprintf(conf->tls_cert,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"tls_key")==0){
+            snprintf(conf->tls_key,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"listen_backlog")==0){
+            conf->listen_backlog=atoi(value)>0?atoi(value):SOMAXCONN;
+        }else if(strcmp(line,"io_loops")==0){
+            conf->io_loops=atoi(value);
+        }else if(strcmp(line,"cpu_pinning")==0){
+            conf->cpu_pinning=(atoi(value)!=0);
+        }else if(strcmp(line,"steer_incoming_cpu")==0){
+            conf->steer_incoming_cpu=(atoi(value)!=0);
+        }else if(strcmp(line,"workers")==0){
+            conf->workers=atoi(value);
+        }else if(strcmp(line,"micro_cache_mb")==0){
+            conf->micro_cache_mb=atoi(value);
+        }else if(strcmp(line,"mem_soft_mb")==0){
+            conf->mem_soft_mb=atoi(value);
+        }else if(strcmp(line,"mem_hard_mb")==0){
+            conf->mem_hard_mb=atoi(value);
+        }else if(strcmp(line,"trace_sample")==0){
+            conf->trace_sample=atoi(value);
+        }else if(strcmp(line,"trace_file")==0){
+            snprintf(conf->trace_file,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"capture_sample")==0){
+            conf->capture_sample=atoi(value);
+        }else if(strcmp(line,"capture_file")==0){
+            snprintf(conf->capture_file,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"zerocopy_min")==0){
+            conf->zerocopy_min=atoi(value);
+        }else if(strcmp(line,"large_file_mb")==0){
+            conf->large_file_mb=atoi(value);
+        }else if(strcmp(line,"large_file_drop_behind")==0){
+            conf->large_file_drop_behind=(atoi(value)!=0);
+        }else if(strcmp(line,"poll_mode")==0){
+            conf->poll_mode=parse_poll_mode(value);
+            if(conf->poll_mode<0){
+                ok=false;
+                break;
+            }
+        }else if(strcmp(line,"busy_poll_us")==0){
+            conf->busy_poll_us=atoi(value);
+        }else if(strcmp(line,"parser")==0){
+            conf->parser=parse_parser_kind(value);
+            if(conf->parser<0){
+                ok=false;
+                break;
+            }
+        }else if(strcmp(line,"ws_max_queue_kb")==0){
+            conf->ws_max_queue_kb=atoi(value);
+        }else if(strcmp(line,"user_db")==0){
+            snprintf(conf->user_db,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"db_pool_size")==0){
+            conf->db_pool_size=atoi(value);
+        }else if(strcmp(line,"fcgi_pass")==0){
+            snprintf(conf->fcgi_pass,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"fcgi_prefix")==0){
+            snprintf(conf->fcgi_prefix,sizeof(conf->fcgi_prefix),"%s",value);
+        }else if(strcmp(line,"fcgi_root")==0){
+            snprintf(conf->fcgi_root,server_config::PATH_LEN,"%s",value);
+        }else if(strcmp(line,"fcgi_pool_size")==0){
+            conf->fcgi_pool_size=atoi(value);
+        }else if(strcmp(line,"asset_pack")==0){
+            snprintf(pack_path,sizeof(pack_path),"%s",value);
+        }else if(strcmp(line,"asset_pack_populate")==0){
+            pack_populate=(atoi(value)!=0);
+        }else if(strcmp(line,"asset_pack_hugepage")==0){
+            pack_hugepage=(atoi(value)!=0);
+        }else{
+            printf("reload_config: unknown key %s\n",line);
+        }
+    }
+    fclose(fp);
+
+    if(!ok){
+        printf("reload_config: bad config file %s, keep the old one\n",path);
+        return false;
+    }
+
+    // 📦 打包文件在所有配置项都读完之后再打开 (populate / hugepage 可能写在它后面)
+    if(pack_path[0]!='\0'){
+        std::shared_ptr<asset_pack> pack=std::make_shared<asset_pack>();
+        if(!pack->open_pack(pack_path,pack_populate,pack_hugepage)){
+            printf("reload_config: cannot load asset pack %s, keep the old one\n",pack_path);
+            return false;
+        }
+        printf("reload_config: asset pack %s loaded, %u files\n",pack_path,pack->count());
+        conf->pack=pack;
+    }else{
+        conf->pack=nullptr;     // 配置里去掉了 asset_pack：老的包别接着挡在 doc_root 前面
+    }
+
+    // 📂 每次都重新打开 doc_root：就算路径没变，目录也可能被换掉了 (比如发版时切软链接)
+    // 打不开 (比如 doc_root 写错了)，而老配置还能出静态文件：和其它出错一样保留老配置，别一次热更新把整个站弄挂
+    conf->root=open_root_dir(conf->doc_root);
+    if(!conf->root&&!conf->pack){
+        int err=errno;
+        std::shared_ptr<const server_config> old=current_config();
+        if(old->root||old->pack){
+            printf("reload_config: cannot open doc_root %s (%s), keep the old one\n",conf->doc_root,strerror(err));
+            return false;
+        }
+        printf("reload_config: cannot open doc_root %s (%s), static files will 404\n",conf->doc_root,strerror(err));
+    }
+
+    // 2. 一次性切换指针，之后新来的请求看到的就是新配置
+    std::atomic_store(&g_config,std::shared_ptr<const server_config>(conf));
+    return true;
+}
@@ -0,0 +1,103 @@
+#ifndef SERVERCONFIG_H
+#define SERVERCONFIG_H
+
+#include<memory>
+
+class asset_pack;
+
+// 📂 预先打开的网站根目录 (O_PATH)：静态文件都相对它打开，见 open_static_file
+// 和 pack 一样挂在配置上用 shared_ptr 管：热更新换掉以后，还在用老配置的请求照样能用，
+// 最后一个放手的时候才 close
+struct root_dir{
+    int fd;
+    explicit root_dir(int f):fd(f){}
+    ~root_dir();
+    root_dir(const root_dir&)=delete;
+    root_dir& operator=(const root_dir&)=delete;
+};
+
+// ⚙️ 运行时可以热更新的配置
+// SIGHUP 以后马上生效的：doc_root / asset_pack / 大文件模式 (每个请求打开文件时读配置快照)，
+// 微缓存容量、内存上限、WebSocket 积压上限、零拷贝门槛、FastCGI 池子大小 (server.cpp 的 apply_limits 推过去)
+// 标了“只在启动时读一次”的是建好就不动的东西 (线程、监听端口、连接池、文件)，改了要走“平滑升级”；
+// 缓冲区大小这种编译期常量也一样
+struct server_config{
+    static const int PATH_LEN=200;
+
+    char doc_root[PATH_LEN]; // 📂 网站根目录
+    std::shared_ptr<const root_dir> root;   // doc_root 打开失败就是空的 (静态文件一律 404)
+
+    // 📦 静态资源打包文件 (可选，配置了 asset_pack=xxx.pack 才有)
+    // 有它的时候静态文件全部从这里出，不再碰 doc_root
+    std::shared_ptr<const asset_pack> pack;
+
+    // 🔐 HTTPS 监听 (只在启动时读一次，热更新改了也不生效，要靠平滑升级)
+    int https_port;             // 0 表示不开 HTTPS
+    char tls_cert[PATH_LEN];    // 证书链 (PEM)
+    char tls_key[PATH_LEN];     // 私钥 (PEM)
+
+    // 🚪 监听 socket 的 backlog (只在启动时读一次)
+    int listen_backlog;         // 默认 SOMAXCONN
+
+    // 🧭 多个 I/O 循环 (只在启动时读一次)
+    int io_loops;               // 0: 主线程自己跑一个循环 (默认)；N: 开 N 个 I/O 线程，主线程只管 accept
+    bool cpu_pinning;           // 每个 I/O 线程绑一个核 (按 NUMA 节点轮流分)
+    bool steer_incoming_cpu;    // 按 SO_INCOMING_CPU 把连接交给绑在那个核上的 I/O 线程
+
+    // 👨‍👧‍👦 多进程模式 (只在启动时读一次，见 prefork.h)
+    int workers;                // 0: 不开 (默认)；N: fork N 个 worker 进程，每个一个单循环，io_loops 不再生效
+
+    // 🗄️ 动态响应微缓存的总大小 (MB，热更新马上生效，改小了马上踢到新容量以下)
+    int micro_cache_mb;
+
+    // 🧮 内存预算 (MB，热更新马上生效，见 mem_budget.h；多进程模式下是每个 worker 的)
+    int mem_soft_mb;            // 过了就瘦身：微缓存减半、闲连接和 mem_pool 的空闲块还回去，0 表示不设 (默认)
+    int mem_hard_mb;            // 过了就不再接新的读 (回 503) 并暂停 accept，0 表示不设 (默认)
+
+    // 🔬 请求分阶段计时 (只在启动时读一次)
+    int trace_sample;           // 每 N 个请求抽一个记下时间线，0 表示不记 (默认)
+    char trace_file[PATH_LEN];  // 抽中的写到 trace_file.<pid> (Chrome trace JSON)
+
+    // 🎙️ 抓流量给 replay 回放用 (只在启动时读一次，见 capture.h)
+    int capture_sample;         // 每 N 个连接抽一个记下收到的原始字节，0 表示不抓 (默认)
+    char capture_file[PATH_LEN];// 写到 capture_file.<pid>
+
+    // 📮 MSG_ZEROCOPY (热更新马上生效，只对明文连接有效)
+    int zerocopy_min;           // 一次发送不少于这么多字节才用零拷贝，0 表示不用 (默认)
+
+    // 💽 大文件模式 (每个请求打开文件时看一眼，热更新马上生效)
+    int large_file_mb;          // 不小于这么多 MB 的文件不 mmap，按窗口 sendfile，0 表示不用 (默认)
+    bool large_file_drop_behind;// 发过去的页从页缓存里丢掉 (一次性的大下载别把热门文件挤出去)
+
+    // 🏎️ 事件循环怎么等事件 (只在启动时读一次，见 busy_poll.h)
+    int poll_mode;              // POLL_SLEEP (默认) / POLL_SPIN / POLL_ADAPTIVE，配置里写 sleep / spin / adaptive
+    int busy_poll_us;           // 最多空转多少微秒
+
+    // 🧩 HTTP/1 请求用哪一份解析器 (只在启动时读一次，见 parser_policy.h)
+    int parser;                 // PARSER_VERBOSE (默认) / PARSER_GENERIC / PARSER_EDGE，配置里写 verbose / generic / edge
+
+    // 🔌 WebSocket (热更新马上生效，见 websocket.h)
+    int ws_max_queue_kb;        // 每个连接最多积压多少 KB 没发出去，超过了当成慢客户端踢掉
+
+    // 👤 登录 / 注册 (只在启动时读一次，见 user_store.h)
+    char user_db[PATH_LEN];     // SQLite 数据库文件，空表示不开 /user/login 和 /user/register (默认)
+    int db_pool_size;           // 数据库连接池 (也是数据库线程) 有几个
+
+    // 🐘 FastCGI 后端 (除了 fcgi_pool_size 都只在启动时读一次，见 fcgi.h)
+    char fcgi_pass[PATH_LEN];   // 后端的 Unix socket，空表示不开 (默认)
+    char fcgi_prefix[64];       // URL 以它开头的请求转给后端
+    char fcgi_root[PATH_LEN];   // 拼 SCRIPT_FILENAME 用的根目录，空表示就用 doc_root
+    int fcgi_pool_size;         // 每个 I/O 循环最多开几条到后端的长连接 (热更新马上生效)
+};
+
+// 🔄 RCU 风格的配置切换：
+// 读者 (工作线程) 每个请求开始时拿一份快照，整个请求都用这份，不用加锁等写者；
+// 写者 (收到 SIGHUP 的主线程) 先把新配置完整地造好，再一次性原子替换指针。
+// 老配置由 shared_ptr 引用计数兜底：最后一个还在用它的请求结束时才真正释放。
+std::shared_ptr<const server_config> current_config();
+
+// 📄 从配置文件重新加载 (格式：每行 key=value，# 开头是注释)
+// 返回 false 表示文件读不了或内容不对，此时旧配置保持不变
+bool reload_config(const char* path);
+
+#endif
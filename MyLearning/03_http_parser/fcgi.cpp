@@ -0,0 +1,742 @@
+#include "fcgi.h"
+#include "http_conn.h"
+#include "config.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<errno.h>
+#include<unistd.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<sys/epoll.h>
+#include<arpa/inet.h>
+#include<atomic>
+#include<deque>
+#include<string>
+#include<vector>
+
+// =================================================================
+// 1. 协议 (FastCGI 1.0)
+// =================================================================
+
+// 每条记录前面 8 字节：版本 / 类型 / 请求编号 / 内容长度 / 填充长度 / 保留
+enum FCGI_TYPE{
+    FCGI_BEGIN_REQUEST=1,
+    FCGI_ABORT_REQUEST=2,
+    FCGI_END_REQUEST=3,
+    FCGI_PARAMS=4,
+    FCGI_STDIN=5,
+    FCGI_STDOUT=6,
+    FCGI_STDERR=7
+};
+
+static const int FCGI_VERSION=1;
+static const int FCGI_HEADER_LEN=8;
+static const size_t FCGI_MAX_CONTENT=65535;
+static const int FCGI_RESPONDER=1;
+static const int FCGI_KEEP_CONN=1;
+static const int REQUEST_ID=1;      // 一条连接上同时只跑一个请求，编号固定用 1
+
+static const size_t STDIN_CHUNK=16384;      // 请求体一次读多少转给后端
+static const size_t MAX_CGI_HEADER=8192;    // 后端响应头 (Status / Content-Type ...) 最多这么长
+static const int MAX_UPSTREAM_FD=65536;     // 和 server.cpp 的 MAX_FD 一样
+
+static void put_header(char* p,int type,size_t len){
+    p[0]=FCGI_VERSION;
+    p[1]=(char)type;
+    p[2]=0;
+    p[3]=REQUEST_ID;
+    p[4]=(char)(len>>8);
+    p[5]=(char)len;
+    p[6]=0;     // 不填充
+    p[7]=0;
+}
+
+static void append_record(std::string& out,int type,const void* data,size_t len){
+    char head[FCGI_HEADER_LEN];
+    put_header(head,type,len);
+    out.append(head,FCGI_HEADER_LEN);
+    out.append((const char*)data,len);
+}
+
+// 名字 / 值的长度：小于 128 用 1 个字节，否则 4 个字节 (最高位置 1)
+static void append_length(std::string& out,size_t len){
+    if(len<128){
+        out+=(char)len;
+        return;
+    }
+    out+=(char)((len>>24)|0x80);
+    out+=(char)(len>>16);
+    out+=(char)(len>>8);
+    out+=(char)len;
+}
+
+static void add_param(std::string& out,const char* name,const char* value,size_t value_len){
+    size_t name_len=strlen(name);
+    append_length(out,name_len);
+    append_length(out,value_len);
+    out.append(name,name_len);
+    out.append(value,value_len);
+}
+
+static void add_param(std::string& out,const char* name,const char* value){
+    if(value){
+        add_param(out,name,value,strlen(value));
+    }
+}
+
+// =================================================================
+// 2. 后端连接 / 每个 I/O 循环一个连接池
+// =================================================================
+
+struct fcgi_upstream{
+    int fd;
+    int epollfd;                // 注册在哪个循环的 epoll 上
+    http_conn* owner;           // 正在等它的协程 (NULL 表示闲着)
+    unsigned seq;
+
+    std::string wbuf;           // 要发给后端的记录
+    size_t wpos;                // 前面发出去了多少
+
+    char rbuf[16384];           // 从后端读进来的
+    size_t rpos;
+    size_t rlen;
+
+    // 📥 记录解析到哪了 (一条记录可能分好几次收到)
+    unsigned char head[FCGI_HEADER_LEN];
+    size_t head_len;
+    int type;                   // 正在收的记录的类型
+    size_t content_left;        // 这条记录的内容还剩多少没收
+    size_t pad_left;            // 内容后面的填充还剩多少没跳过
+
+    void reset_io(){
+        wbuf.clear();
+        wpos=0;
+        rpos=rlen=0;
+        head_len=0;
+        type=0;
+        content_left=pad_left=0;
+    }
+};
+
+static char g_prefix[64];
+static char g_root[server_config::PATH_LEN];
+static struct sockaddr_un g_addr;
+static std::atomic<int> g_max_conns(8);     // 热更新会改 (fcgi_set_pool_size)，每个循环的池子随时在读
+
+// fd -> 后端连接 (I/O 循环分发事件的时候查)，fd 全进程唯一，所以一张表就够了
+static std::atomic<fcgi_upstream*> g_by_fd[MAX_UPSTREAM_FD];
+
+struct fcgi_pool{
+    std::vector<fcgi_upstream*> idle;               // 闲着的长连接
+    int open;                                       // 一共开着几条 (闲着的 + 借出去的)
+    std::deque<co_upstream_acquire*> waiters;       // 排队等连接的协程 (先来先得)
+};
+static thread_local fcgi_pool t_pool;
+
+bool fcgi_init(const char* prefix,const char* sock_path,const char* script_root,int max_conns){
+    if(strlen(sock_path)>=sizeof(g_addr.sun_path)||strlen(prefix)>=sizeof(g_prefix)){
+        return false;
+    }
+    memset(&g_addr,0,sizeof(g_addr));
+    g_addr.sun_family=AF_UNIX;
+    snprintf(g_addr.sun_path,sizeof(g_addr.sun_path),"%s",sock_path);
+    snprintf(g_prefix,sizeof(g_prefix),"%s",prefix);
+    snprintf(g_root,sizeof(g_root),"%s",script_root);
+    fcgi_set_pool_size(max_conns);
+    return true;
+}
+
+void fcgi_set_pool_size(int max_conns){
+    g_max_conns.store(max_conns>0?max_conns:1,std::memory_order_relaxed);
+}
+
+const char* fcgi_prefix(){
+    return g_prefix;
+}
+
+static fcgi_upstream* upstream_open(){
+    int fd=socket(AF_UNIX,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    if(fd<0){
+        perror("fcgi socket");
+        return 0;
+    }
+    if(fd>=MAX_UPSTREAM_FD){
+        close(fd);
+        return 0;
+    }
+    // Unix socket 的 connect 要么马上成功，要么失败 (后端没起来 / backlog 满了是 EAGAIN)，没有 EINPROGRESS
+    if(connect(fd,(struct sockaddr*)&g_addr,sizeof(g_addr))<0){
+        perror("fcgi connect");
+        close(fd);
+        return 0;
+    }
+
+    fcgi_upstream* up=new fcgi_upstream;
+    up->fd=fd;
+    up->epollfd=http_conn::m_epollfd;
+    up->owner=0;
+    up->seq=0;
+    up->reset_io();
+    g_by_fd[fd].store(up,std::memory_order_release);
+
+    // 先挂上但什么都不等 (EPOLLHUP / EPOLLERR 总会报：闲着的时候后端关了也能知道)
+    struct epoll_event event;
+    event.data.fd=fd;
+    event.events=EPOLLONESHOT;
+    epoll_ctl(up->epollfd,EPOLL_CTL_ADD,fd,&event);
+    t_pool.open++;
+    return up;
+}
+
+static void upstream_close(fcgi_upstream* up){
+    epoll_ctl(up->epollfd,EPOLL_CTL_DEL,up->fd,0);
+    g_by_fd[up->fd].store(0,std::memory_order_release);
+    close(up->fd);
+    delete up;
+    t_pool.open--;
+}
+
+static void upstream_arm(fcgi_upstream* up,uint32_t events){
+    struct epoll_event event;
+    event.data.fd=up->fd;
+    event.events=events|EPOLLRDHUP|EPOLLONESHOT;
+    epoll_ctl(up->epollfd,EPOLL_CTL_MOD,up->fd,&event);
+}
+
+// 🔑 拿一条能用的：1 拿到了 (up 为 NULL 表示连不上后端)，0 池子满了要排队
+static int pool_get(fcgi_upstream*& up){
+    while(!t_pool.idle.empty()){
+        up=t_pool.idle.back();
+        t_pool.idle.pop_back();
+        // 闲着的时候后端可能已经关了 (重启 / 空闲超时)：偷看一眼，既没数据也没关才是好的
+        char c;
+        if(recv(up->fd,&c,1,MSG_PEEK|MSG_DONTWAIT)<0&&errno==EAGAIN){
+            return 1;
+        }
+        upstream_close(up);
+    }
+    if(t_pool.open<g_max_conns.load(std::memory_order_relaxed)){
+        up=upstream_open();
+        return 1;
+    }
+    up=0;
+    return 0;
+}
+
+// 有空位了：交给排在最前面的协程，在它自己的循环里叫醒它 (不在这里直接 resume，还连接的可能正在析构)
+static void pool_kick(){
+    while(!t_pool.waiters.empty()){
+        fcgi_upstream* up;
+        if(pool_get(up)==0){
+            return;
+        }
+        co_upstream_acquire* w=t_pool.waiters.front();
+        t_pool.waiters.pop_front();
+        w->handed=up;
+        w->state=co_upstream_acquire::HANDED;
+        co_wake(co_current_waker(),w->conn,w->seq);
+        if(up){
+            return;
+        }
+        // 连不上后端：这个协程会回 502，接着看下一个 (池子里的名额还空着)
+    }
+}
+
+static void pool_put(fcgi_upstream* up,bool reusable){
+    up->owner=0;
+    // 热更新把池子改小了：多出来的连接还回来就关掉，慢慢降到新的上限
+    if(reusable&&t_pool.open<=g_max_conns.load(std::memory_order_relaxed)){
+        up->reset_io();
+        upstream_arm(up,EPOLLIN);   // 闲着的时候后端关了能马上知道
+        t_pool.idle.push_back(up);
+    }else{
+        upstream_close(up);
+    }
+    pool_kick();
+}
+
+void fcgi_lease::finish(){
+    if(m_up){
+        pool_put(m_up,true);
+        m_up=0;
+    }
+}
+
+void fcgi_lease::reset(){
+    if(m_up){
+        pool_put(m_up,false);
+        m_up=0;
+    }
+}
+
+bool fcgi_on_event(int fd,uint32_t events){
+    if(fd<0||fd>=MAX_UPSTREAM_FD){
+        return false;
+    }
+    fcgi_upstream* up=g_by_fd[fd].load(std::memory_order_acquire);
+    if(!up){
+        return false;
+    }
+    if(!up->owner){
+        // 闲着的连接上有动静：后端关了 (或者发来了不该发的东西)，不要了
+        if(events&(EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
+            for(size_t i=0;i<t_pool.idle.size();i++){
+                if(t_pool.idle[i]==up){
+                    t_pool.idle[i]=t_pool.idle.back();
+                    t_pool.idle.pop_back();
+                    upstream_close(up);
+                    pool_kick();
+                    break;
+                }
+            }
+        }
+        return true;
+    }
+    up->owner->co_on_wakeup(up->seq);
+    return true;
+}
+
+// =================================================================
+// 3. awaitable
+// =================================================================
+
+co_upstream_acquire::~co_upstream_acquire(){
+    if(state==QUEUED){
+        for(std::deque<co_upstream_acquire*>::iterator it=t_pool.waiters.begin();it!=t_pool.waiters.end();++it){
+            if(*it==this){
+                t_pool.waiters.erase(it);
+                break;
+            }
+        }
+    }else if(state==HANDED&&handed){
+        pool_put(handed,true);      // 交到手上了，还没来得及用协程就没了：原样还回去
+    }
+}
+
+bool co_upstream_acquire::await_ready(){
+    // 前面有人在排队就老实排在后面
+    if(!t_pool.waiters.empty()||pool_get(handed)==0){
+        return false;
+    }
+    state=HANDED;
+    return true;
+}
+
+void co_upstream_acquire::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    state=QUEUED;
+    seq=conn->m_co_seq;
+    conn->m_co_wait=CO_WAIT_UPSTREAM;
+    t_pool.waiters.push_back(this);
+}
+
+bool co_upstream_acquire::await_resume(){
+    if(state!=HANDED){
+        return false;
+    }
+    state=DONE;
+    lease->attach(handed);
+    return handed!=0;
+}
+
+void co_upstream_wait::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    up->owner=conn;
+    up->seq=conn->m_co_seq;
+    conn->m_co_wait=CO_WAIT_UPSTREAM;
+    upstream_arm(up,events);
+}
+
+// =================================================================
+// 4. 收发记录
+// =================================================================
+
+// 📤 把 wbuf 尽量发给后端：1 发完了 0 EAGAIN -1 出错
+static int upstream_flush(fcgi_upstream* up){
+    while(up->wpos<up->wbuf.size()){
+        ssize_t n=send(up->fd,up->wbuf.data()+up->wpos,up->wbuf.size()-up->wpos,MSG_NOSIGNAL);
+        if(n<0){
+            if(errno==EINTR){
+                continue;
+            }
+            return errno==EAGAIN?0:-1;
+        }
+        up->wpos+=n;
+    }
+    up->wbuf.clear();
+    up->wpos=0;
+    return 1;
+}
+
+// 📥 下一段记录内容：1 拿到一段 (type / data / len，data 在下一次调用之前有效)，
+// 0 EAGAIN，-1 出错 / 后端关了。空记录 (流的结尾) 也算一段，len 为 0
+static int upstream_next(fcgi_upstream* up,int& type,const char*& data,size_t& len){
+    while(true){
+        if(up->rpos==up->rlen){
+            ssize_t n=recv(up->fd,up->rbuf,sizeof(up->rbuf),0);
+            if(n<0){
+                if(errno==EINTR){
+                    continue;
+                }
+                return errno==EAGAIN?0:-1;
+            }
+            if(n==0){
+                return -1;
+            }
+            up->rpos=0;
+            up->rlen=n;
+        }
+        size_t avail=up->rlen-up->rpos;
+
+        // 内容：有多少给多少 (不等整条记录收全)
+        if(up->content_left>0){
+            size_t k=avail<up->content_left?avail:up->content_left;
+            type=up->type;
+            data=up->rbuf+up->rpos;
+            len=k;
+            up->rpos+=k;
+            up->content_left-=k;
+            return 1;
+        }
+
+        // 内容后面的填充
+        if(up->pad_left>0){
+            size_t k=avail<up->pad_left?avail:up->pad_left;
+            up->rpos+=k;
+            up->pad_left-=k;
+            continue;
+        }
+
+        // 记录头
+        size_t k=FCGI_HEADER_LEN-up->head_len;
+        if(k>avail){
+            k=avail;
+        }
+        memcpy(up->head+up->head_len,up->rbuf+up->rpos,k);
+        up->head_len+=k;
+        up->rpos+=k;
+        if(up->head_len<(size_t)FCGI_HEADER_LEN){
+            continue;
+        }
+        up->head_len=0;
+        if(up->head[0]!=FCGI_VERSION||((up->head[2]<<8)|up->head[3])!=REQUEST_ID){
+            return -1;
+        }
+        up->type=up->head[1];
+        up->content_left=(up->head[4]<<8)|up->head[5];
+        up->pad_left=up->head[6];
+        if(up->content_left==0){
+            type=up->type;
+            data=0;
+            len=0;
+            return 1;
+        }
+    }
+}
+
+// 📋 BEGIN_REQUEST + PARAMS：直接从 http_conn 解析时留下的指针编码
+static bool append_begin(http_conn& conn,fcgi_upstream* up){
+    unsigned char begin[8]={0,FCGI_RESPONDER,FCGI_KEEP_CONN,0,0,0,0,0};
+    append_record(up->wbuf,FCGI_BEGIN_REQUEST,begin,sizeof(begin));
+
+    // PARAMS 的内容先空出记录头的位置，写完再回头填长度
+    size_t at=up->wbuf.size();
+    up->wbuf.append(FCGI_HEADER_LEN,'\0');
+    std::string& p=up->wbuf;
+
+    // 路径在 parse_request_line 里已经解码 + 规范化过了 (不会有 ..)，查询串单独放着
+    const char* url=conn.get_url();
+    const char* query=conn.get_query();
+    size_t path_len=strlen(url);
+    size_t query_len=query?strlen(query):0;
+    char num[32];
+
+    add_param(p,"GATEWAY_INTERFACE","CGI/1.1");
+    add_param(p,"SERVER_SOFTWARE","MyTinyServer");
+    add_param(p,"SERVER_PROTOCOL","HTTP/1.1");
+    add_param(p,"REQUEST_METHOD",conn.get_method()==POST?"POST":"GET");
+    // REQUEST_URI = 路径 [+ '?' + 查询串]，也是分段拼
+    append_length(p,11);
+    append_length(p,path_len+(query?1+query_len:0));
+    p.append("REQUEST_URI");
+    p.append(url,path_len);
+    if(query){
+        p+='?';
+        p.append(query,query_len);
+    }
+    add_param(p,"SCRIPT_NAME",url,path_len);
+    add_param(p,"QUERY_STRING",query?query:"");
+    add_param(p,"DOCUMENT_ROOT",g_root);
+
+    // SCRIPT_FILENAME = 根目录 + 路径，分两段拼进去，不用另外拼字符串
+    size_t root_len=strlen(g_root);
+    append_length(p,15);
+    append_length(p,root_len+path_len);
+    p.append("SCRIPT_FILENAME");
+    p.append(g_root,root_len);
+    p.append(url,path_len);
+
+    if(conn.get_content_length()>0){
+        snprintf(num,sizeof(num),"%d",conn.get_content_length());
+        add_param(p,"CONTENT_LENGTH",num);
+    }
+    add_param(p,"CONTENT_TYPE",conn.get_content_type());
+    add_param(p,"HTTP_HOST",conn.get_host());
+    add_param(p,"HTTP_COOKIE",conn.get_cookie());
+
+    const sockaddr_in& peer=conn.get_peer();
+    char ip[INET_ADDRSTRLEN];
+    if(inet_ntop(AF_INET,&peer.sin_addr,ip,sizeof(ip))){
+        add_param(p,"REMOTE_ADDR",ip);
+    }
+    snprintf(num,sizeof(num),"%d",ntohs(peer.sin_port));
+    add_param(p,"REMOTE_PORT",num);
+    if(conn.is_tls()){
+        add_param(p,"HTTPS","on");
+    }
+
+    // 请求头最多也就读缓冲区那么大，一条 PARAMS 记录装得下
+    size_t len=p.size()-at-FCGI_HEADER_LEN;
+    if(len>FCGI_MAX_CONTENT){
+        return false;
+    }
+    put_header(&p[at],FCGI_PARAMS,len);
+    append_record(p,FCGI_PARAMS,0,0);   // 空的 PARAMS：参数发完了
+    return true;
+}
+
+// =================================================================
+// 5. 响应头 (CGI 格式：Status / Content-Type / Location / 其他照抄)
+// =================================================================
+
+struct cgi_head{
+    int status;
+    const char* title;
+    const char* content_type;
+    std::string extra;      // 其他响应头，一行一个 "Name: value\r\n"
+};
+
+// 把 head[0, len) 解析成 cgi_head (原地切，head 要活到 start_chunked 之后)
+static bool parse_cgi_head(char* head,size_t len,cgi_head& out){
+    out.status=200;
+    out.title="OK";
+    out.content_type="text/html";
+    bool has_location=false;
+    bool has_status=false;
+
+    char* p=head;
+    char* end=head+len;
+    while(p<end){
+        char* eol=(char*)memchr(p,'\n',end-p);
+        if(!eol){
+            eol=end;
+        }
+        char* line_end=eol;
+        if(line_end>p&&line_end[-1]=='\r'){
+            line_end--;
+        }
+        *line_end='\0';
+        char* line=p;
+        p=eol+1;
+        if(line[0]=='\0'){
+            continue;
+        }
+
+        char* colon=strchr(line,':');
+        if(!colon){
+            return false;
+        }
+        char* value=colon+1;
+        value+=strspn(value," \t");
+
+        if(strncasecmp(line,"Status:",7)==0){
+            out.status=atoi(value);
+            char* title=strchr(value,' ');
+            out.title=title?title+1:"";
+            has_status=true;
+            if(out.status<100||out.status>999){
+                return false;
+            }
+        }else if(strncasecmp(line,"Content-Type:",13)==0){
+            out.content_type=value;
+        }else if(strncasecmp(line,"Content-Length:",15)==0||strncasecmp(line,"Transfer-Encoding:",18)==0
+            ||strncasecmp(line,"Connection:",11)==0){
+            // 我们自己用 chunked 发，这几个由我们决定
+        }else{
+            if(strncasecmp(line,"Location:",9)==0){
+                has_location=true;
+            }
+            out.extra.append(line);
+            out.extra.append("\r\n");
+        }
+    }
+    // 只给了 Location 没给 Status：按 CGI 的规矩当成重定向
+    if(has_location&&!has_status){
+        out.status=302;
+        out.title="Found";
+    }
+    return true;
+}
+
+// 找响应头结尾的空行 ("\r\n\r\n" 或者 "\n\n")，返回响应体从哪开始，没找到返回 0
+static size_t find_head_end(const char* p,size_t len){
+    for(size_t i=0;i+1<len;i++){
+        if(p[i]!='\n'){
+            continue;
+        }
+        if(p[i+1]=='\n'){
+            return i+2;
+        }
+        if(i+2<len&&p[i+1]=='\r'&&p[i+2]=='\n'){
+            return i+3;
+        }
+    }
+    return 0;
+}
+
+// =================================================================
+// 6. handler
+// =================================================================
+
+static co_write reply_502(http_conn& conn){
+    static const char body[]="The FastCGI backend is not available.\n";
+    const size_t HEAD_SIZE=160;
+    char* head=(char*)conn.arena().alloc(HEAD_SIZE);
+    int head_len=snprintf(head,HEAD_SIZE,"HTTP/1.1 502 Bad Gateway\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+        sizeof(body)-1,conn.get_linger()?"keep-alive":"close");
+    struct iovec iov[2];
+    iov[0].iov_base=head;
+    iov[0].iov_len=head_len;
+    iov[1].iov_base=(void*)body;
+    iov[1].iov_len=sizeof(body)-1;
+    return conn.write(iov,2);
+}
+
+co_task fcgi_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+
+    fcgi_lease lease;
+    if(!co_await co_upstream_acquire{&conn,&lease,co_upstream_acquire::IDLE,0,0}){
+        co_await reply_502(conn);
+        co_return;
+    }
+    fcgi_upstream* up=lease.get();
+    if(!append_begin(conn,up)){
+        co_await reply_502(conn);
+        co_return;
+    }
+
+    // 1. 请求体：读一块，包成 STDIN 记录发一块 (第一块和 PARAMS 一起发)
+    size_t left=conn.get_content_length();
+    bool stdin_done=false;
+    while(!stdin_done){
+        if(left>0){
+            size_t want=left<STDIN_CHUNK?left:STDIN_CHUNK;
+            size_t at=up->wbuf.size();
+            up->wbuf.resize(at+FCGI_HEADER_LEN+want);
+            ssize_t n=co_await conn.read_body(&up->wbuf[at+FCGI_HEADER_LEN],want);
+            if(n<=0){
+                co_return;  // 客户端断了 (后端连接上只有半个请求，lease 析构时关掉)
+            }
+            up->wbuf.resize(at+FCGI_HEADER_LEN+n);
+            put_header(&up->wbuf[at],FCGI_STDIN,n);
+            left-=n;
+        }
+        if(left==0){
+            append_record(up->wbuf,FCGI_STDIN,0,0);     // 空的 STDIN：请求体发完了
+            stdin_done=true;
+        }
+
+        int ret;
+        while((ret=upstream_flush(up))==0){
+            co_await co_upstream_wait{&conn,up,EPOLLOUT};
+        }
+        if(ret<0){
+            co_await reply_502(conn);
+            co_return;
+        }
+    }
+
+    // 2. 收 STDOUT：先攒响应头，遇到空行以后的内容直接 chunked 转给客户端
+    char* head=(char*)conn.arena().alloc(MAX_CGI_HEADER);
+    size_t head_len=0;
+    bool head_done=false;
+    unsigned char end_body[8];
+    size_t end_len=0;
+    while(end_len<sizeof(end_body)){
+        int type;
+        const char* data;
+        size_t len;
+        int ret=upstream_next(up,type,data,len);
+        if(ret==0){
+            co_await co_upstream_wait{&conn,up,EPOLLIN};
+            continue;
+        }
+        if(ret<0){
+            if(!head_done){
+                co_await reply_502(conn);
+            }else{
+                conn.set_linger(false);     // 响应头已经发了，只能挂断 (客户端看到 chunked 没结尾就知道出错了)
+            }
+            co_return;
+        }
+
+        if(type==FCGI_STDOUT&&len>0){
+            if(head_done){
+                if(!co_await conn.write_chunk(data,len)){
+                    co_return;
+                }
+                continue;
+            }
+            size_t take=len<MAX_CGI_HEADER-head_len?len:MAX_CGI_HEADER-head_len;
+            memcpy(head+head_len,data,take);
+            head_len+=take;
+            size_t body_at=find_head_end(head,head_len);
+            if(body_at==0){
+                if(head_len==MAX_CGI_HEADER){
+                    co_await reply_502(conn);   // 响应头太长
+                    co_return;
+                }
+                continue;
+            }
+
+            cgi_head h;
+            if(!parse_cgi_head(head,body_at,h)){
+                co_await reply_502(conn);
+                co_return;
+            }
+            conn.start_chunked(h.status,h.title,h.content_type,h.extra.c_str());
+            head_done=true;
+            // 和响应头一起收到的那部分响应体 (head 里空行后面的，加上这一段没拷进 head 的)
+            size_t rest=head_len-body_at;
+            if(rest>0&&!co_await conn.write_chunk(head+body_at,rest)){
+                co_return;
+            }
+            if(take<len&&!co_await conn.write_chunk(data+take,len-take)){
+                co_return;
+            }
+        }else if(type==FCGI_STDERR&&len>0){
+            printf("fcgi stderr: %.*s\n",(int)len,data);
+        }else if(type==FCGI_END_REQUEST&&len>0){
+            size_t take=len<sizeof(end_body)-end_len?len:sizeof(end_body)-end_len;
+            memcpy(end_body+end_len,data,take);
+            end_len+=take;
+        }
+    }
+
+    // 3. END_REQUEST 收到了：后端连接干净了，先还回去 (不用陪着慢客户端把响应发完)
+    // 后面还跟着没收完的填充 / 多出来的数据就不干净了，关掉
+    if(up->pad_left==0&&up->rpos==up->rlen){
+        lease.finish();
+    }else{
+        lease.reset();
+    }
+    if(!head_done){
+        co_await reply_502(conn);   // 后端什么都没输出就结束了
+        co_return;
+    }
+    co_await conn.end_chunked();
+}
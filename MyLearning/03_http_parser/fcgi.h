@@ -0,0 +1,83 @@
+#ifndef FCGI_H
+#define FCGI_H
+
+#include<stdint.h>
+#include<coroutine>
+#include "co_handler.h"
+
+class http_conn;
+
+// 🐘 FastCGI 后端 (动态页面交给本机的 FastCGI 进程，比如 php-fpm)
+// URL 以 fcgi_prefix 开头的请求走协程 handler fcgi_handler：
+//   - 每个 I/O 循环自己一个连接池：到后端的 Unix socket 是非阻塞的长连接 (FCGI_KEEP_CONN)，
+//     和客户端连接一样注册在这个循环的 epoll 上，一个请求用完了还回池子给下一个请求
+//   - 池子满了 (每个循环最多 fcgi_pool_size 条)，后来的请求排队，有人还回来再按顺序叫醒
+//   - PARAMS 直接从解析请求头时留下的指针 (URL、Host、Content-Type……) 编码，不另外拷一份请求头
+//   - 请求体读一块发一块 (STDIN 记录)，不攒在内存里
+//   - 后端的 STDOUT 记录收一段就用 chunked 转给客户端 (write_chunk)，客户端收得慢就先不读后端，
+//     背压一路传回后端，整个响应不会堆在内存里
+//   - 请求体全部发完才开始收响应 (后端都是先读完请求体再输出的，php-fpm 也是)
+//   - 一个请求没正常走完 (客户端断了 / 后端出错)，那条后端连接上可能还有半截记录，直接关掉不再复用
+//
+// 自带一个测试用的后端 (fcgi_echo.cpp)：
+//     g++ -std=c++20 -O2 fcgi_echo.cpp -o fcgi_echo -lpthread && ./fcgi_echo /tmp/fcgi.sock
+//     配置里写 fcgi_pass=/tmp/fcgi.sock，然后 curl -d hello 'localhost:9090/cgi/echo?a=1'
+
+struct fcgi_upstream;   // 到后端的一条连接 (见 fcgi.cpp)
+
+// ⚙️ 启动时调一次 (I/O 线程启动之前)：prefix 是要转给后端的 URL 前缀，sock_path 是后端的 Unix socket，
+// script_root 拼成 SCRIPT_FILENAME，max_conns 是每个 I/O 循环最多开几条连接
+bool fcgi_init(const char* prefix,const char* sock_path,const char* script_root,int max_conns);
+const char* fcgi_prefix();      // 注册路由用 (fcgi_init 拷了一份，一直有效)
+// 🔄 热更新配置后调：改每个循环最多开几条 (改小了，多出来的连接还回来的时候关掉)
+void fcgi_set_pool_size(int max_conns);
+
+co_task fcgi_handler(http_conn& conn);
+
+// 🔁 I/O 循环收到一个 fd 上的事件先问一下：是后端连接的就在这里处理掉，返回 true
+bool fcgi_on_event(int fd,uint32_t events);
+
+// 🔑 借来的一条后端连接，出作用域自动处理：
+// 请求正常走完 (finish) 的还回池子，否则直接关掉
+class fcgi_lease{
+public:
+    fcgi_lease():m_up(0){}
+    ~fcgi_lease(){reset();}
+
+    fcgi_upstream* get() const{return m_up;}
+    void attach(fcgi_upstream* up){reset();m_up=up;}
+    void finish();      // 收到 END_REQUEST 了：连接干净，还回池子
+    void reset();       // 没走完就不要了：关掉
+
+private:
+    fcgi_lease(const fcgi_lease&)=delete;
+    fcgi_lease& operator=(const fcgi_lease&)=delete;
+
+    fcgi_upstream* m_up;
+};
+
+// ⏳ 借连接：池子里有空闲的 (或者还能再开一条) 就直接拿，否则排队，等别人还回来交到手上
+struct co_upstream_acquire{
+    enum STATE{IDLE,QUEUED,HANDED,DONE};
+    http_conn* conn;
+    fcgi_lease* lease;
+    STATE state;
+    fcgi_upstream* handed;      // 交到手上的连接 (NULL 表示连不上后端)
+    unsigned seq;
+    ~co_upstream_acquire();     // 还在排队 / 交到手上还没拿走时协程就被销毁了：摘掉 / 还回去
+    bool await_ready();
+    void await_suspend(std::coroutine_handle<> h);
+    bool await_resume();        // false: 连不上后端
+};
+
+// ⏳ 等后端连接可读 / 可写 (EPOLLIN / EPOLLOUT)
+struct co_upstream_wait{
+    http_conn* conn;
+    fcgi_upstream* up;
+    uint32_t events;
+    bool await_ready(){return false;}
+    void await_suspend(std::coroutine_handle<> h);
+    void await_resume(){}
+};
+
+#endif
@@ -0,0 +1,201 @@
+// 🐘 测试用的 FastCGI 后端：把收到的参数和请求体原样回过去
+// 用法: ./fcgi_echo <socket_path>
+// 每条连接一个线程，支持 FCGI_KEEP_CONN (一条连接上一个接一个地跑请求)。按 SCRIPT_NAME 结尾分几种：
+//   .../big?N      回 N 个字节的 'x' (测大响应 / 背压)
+//   .../slow?N     先睡 N 毫秒再回 (测排队)
+//   .../status     回 "Status: 404 Not Found" 和一个自定义响应头
+//   其他           回所有参数 + 请求体
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<signal.h>
+#include<sys/socket.h>
+#include<sys/un.h>
+#include<string>
+#include<vector>
+#include<thread>
+#include<utility>
+
+static bool read_full(int fd,void* buf,size_t len){
+    char* p=(char*)buf;
+    while(len>0){
+        ssize_t n=read(fd,p,len);
+        if(n<=0){
+            return false;
+        }
+        p+=n;
+        len-=n;
+    }
+    return true;
+}
+
+static bool write_full(int fd,const void* buf,size_t len){
+    const char* p=(const char*)buf;
+    while(len>0){
+        ssize_t n=write(fd,p,len);
+        if(n<=0){
+            return false;
+        }
+        p+=n;
+        len-=n;
+    }
+    return true;
+}
+
+// 📤 发一条记录 (内容按 8 字节对齐填充，和 php-fpm 一样)
+static bool send_record(int fd,int type,int id,const char* data,size_t len){
+    unsigned char head[8];
+    size_t pad=(8-len%8)%8;
+    head[0]=1;
+    head[1]=(unsigned char)type;
+    head[2]=(unsigned char)(id>>8);
+    head[3]=(unsigned char)id;
+    head[4]=(unsigned char)(len>>8);
+    head[5]=(unsigned char)len;
+    head[6]=(unsigned char)pad;
+    head[7]=0;
+    static const char zeros[8]={0};
+    return write_full(fd,head,8)&&write_full(fd,data,len)&&write_full(fd,zeros,pad);
+}
+
+static bool send_stdout(int fd,int id,const std::string& s){
+    for(size_t at=0;at<s.size();at+=32768){
+        size_t len=s.size()-at<32768?s.size()-at:32768;
+        if(!send_record(fd,6,id,s.data()+at,len)){
+            return false;
+        }
+    }
+    return true;
+}
+
+static size_t read_length(const unsigned char*& p){
+    if(p[0]<128){
+        return *p++;
+    }
+    size_t len=((size_t)(p[0]&0x7F)<<24)|((size_t)p[1]<<16)|((size_t)p[2]<<8)|p[3];
+    p+=4;
+    return len;
+}
+
+static std::string find_param(const std::vector<std::pair<std::string,std::string> >& params,const char* name){
+    for(size_t i=0;i<params.size();i++){
+        if(params[i].first==name){
+            return params[i].second;
+        }
+    }
+    return "";
+}
+
+static bool ends_with(const std::string& s,const char* tail){
+    size_t n=strlen(tail);
+    return s.size()>=n&&s.compare(s.size()-n,n,tail)==0;
+}
+
+// 一个请求：BEGIN_REQUEST -> PARAMS... 空 PARAMS -> STDIN... 空 STDIN，返回 false 表示要关连接
+static bool serve_one(int fd){
+    std::vector<std::pair<std::string,std::string> > params;
+    std::string params_raw,body;
+    bool keep=false,params_done=false,stdin_done=false;
+    int id=0;
+
+    while(!stdin_done){
+        unsigned char head[8];
+        if(!read_full(fd,head,8)){
+            return false;
+        }
+        int type=head[1];
+        size_t len=(head[4]<<8)|head[5];
+        std::string content(len+head[6],'\0');
+        if(!read_full(fd,&content[0],content.size())){
+            return false;
+        }
+        content.resize(len);
+
+        if(type==1){
+            id=(head[2]<<8)|head[3];
+            keep=(content[2]&1)!=0;
+        }else if(type==4){
+            if(len==0){
+                params_done=true;
+            }
+            params_raw+=content;
+        }else if(type==5){
+            if(len==0){
+                stdin_done=true;
+            }
+            body+=content;
+        }
+    }
+    if(!params_done){
+        return false;
+    }
+
+    const unsigned char* p=(const unsigned char*)params_raw.data();
+    const unsigned char* end=p+params_raw.size();
+    while(p<end){
+        size_t name_len=read_length(p);
+        size_t value_len=read_length(p);
+        params.push_back(std::make_pair(std::string((const char*)p,name_len),std::string((const char*)p+name_len,value_len)));
+        p+=name_len+value_len;
+    }
+
+    std::string script=find_param(params,"SCRIPT_NAME");
+    std::string query=find_param(params,"QUERY_STRING");
+    std::string out;
+    if(ends_with(script,"/big")){
+        out="Content-Type: application/octet-stream\r\n\r\n";
+        out.append(strtoul(query.c_str(),0,10),'x');
+    }else if(ends_with(script,"/status")){
+        out="Status: 404 Not Found\r\nContent-Type: text/plain\r\nX-Backend: fcgi_echo\r\n\r\nnot here\n";
+    }else{
+        if(ends_with(script,"/slow")){
+            usleep(atoi(query.c_str())*1000);
+        }
+        out="Content-Type: text/plain\r\n\r\n";
+        for(size_t i=0;i<params.size();i++){
+            out+=params[i].first+"="+params[i].second+"\n";
+        }
+        out+="body="+body+"\n";
+        send_record(fd,7,id,"hello from stderr",17);
+    }
+
+    unsigned char end_body[8]={0,0,0,0,0,0,0,0};    // appStatus=0, REQUEST_COMPLETE
+    if(!send_stdout(fd,id,out)||!send_record(fd,6,id,"",0)||!send_record(fd,3,id,(const char*)end_body,8)){
+        return false;
+    }
+    return keep;
+}
+
+static void serve(int fd){
+    while(serve_one(fd)){
+    }
+    close(fd);
+}
+
+int main(int argc,char* argv[]){
+    if(argc<2){
+        printf("usage: %s <socket_path>\n",argv[0]);
+        return 1;
+    }
+    signal(SIGPIPE,SIG_IGN);
+
+    int listenfd=socket(AF_UNIX,SOCK_STREAM,0);
+    struct sockaddr_un addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sun_family=AF_UNIX;
+    snprintf(addr.sun_path,sizeof(addr.sun_path),"%s",argv[1]);
+    unlink(argv[1]);
+    if(bind(listenfd,(struct sockaddr*)&addr,sizeof(addr))<0||listen(listenfd,128)<0){
+        perror("fcgi_echo");
+        return 1;
+    }
+    printf("fcgi_echo listening on %s\n",argv[1]);
+    while(true){
+        int fd=accept(listenfd,0,0);
+        if(fd<0){
+            continue;
+        }
+        std::thread(serve,fd).detach();
+    }
+}
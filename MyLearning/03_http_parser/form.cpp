@@ -0,0 +1,77 @@
+#include "form.h"
+#include<string.h>
+
+bool str_view::equals(const char* s) const{
+    return strlen(s)==len&&memcmp(data,s,len)==0;
+}
+
+static int hex_value(char c){
+    if(c>='0'&&c<='9'){
+        return c-'0';
+    }
+    if(c>='a'&&c<='f'){
+        return c-'a'+10;
+    }
+    if(c>='A'&&c<='F'){
+        return c-'A'+10;
+    }
+    return -1;
+}
+
+// 把 [p, p+len) 原地解码，返回解码后的长度
+// 不合法的 %XX 原样保留 (浏览器不会发这种东西，不值得为它拒绝整个请求)
+static size_t decode_in_place(char* p,size_t len){
+    size_t w=0;
+    for(size_t r=0;r<len;r++){
+        char c=p[r];
+        if(c=='+'){
+            c=' ';
+        }else if(c=='%'&&r+2<len){
+            int hi=hex_value(p[r+1]);
+            int lo=hex_value(p[r+2]);
+            if(hi>=0&&lo>=0){
+                c=(char)(hi<<4|lo);
+                r+=2;
+            }
+        }
+        p[w++]=c;
+    }
+    return w;
+}
+
+int form_parse(char* body,size_t len,form_field* fields,int max){
+    int count=0;
+    char* p=body;
+    char* end=body+len;
+    while(p<end&&count<max){
+        // 一个字段到下一个 '&' 为止
+        char* amp=(char*)memchr(p,'&',end-p);
+        char* field_end=amp?amp:end;
+        if(field_end>p){
+            char* eq=(char*)memchr(p,'=',field_end-p);
+            char* name_end=eq?eq:field_end;
+            form_field& f=fields[count++];
+            f.name.data=p;
+            f.name.len=decode_in_place(p,name_end-p);
+            if(eq){
+                f.value.data=eq+1;
+                f.value.len=decode_in_place(eq+1,field_end-eq-1);
+            }else{
+                f.value.data=field_end;
+                f.value.len=0;
+            }
+        }
+        p=field_end+1;
+    }
+    return count;
+}
+
+bool form_find(const form_field* fields,int count,const char* name,str_view& value){
+    for(int i=0;i<count;i++){
+        if(fields[i].name.equals(name)){
+            value=fields[i].value;
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,29 @@
+#ifndef FORM_H
+#define FORM_H
+
+#include<stddef.h>
+
+// 📝 application/x-www-form-urlencoded 请求体 (浏览器表单 POST 过来的)
+//     user=ne%20ro&passwd=a%2Bb  ->  {user: "ne ro"}, {passwd: "a+b"}
+// 在请求体上原地解码 (%XX 和 '+' 解出来只会变短)，字段都是指向请求体里面的视图，不拷贝、不分配。
+// 视图不带 '\0'，请求体 (一般在请求的 arena 里) 释放之前都有效
+
+// 👀 一段不归自己管的字符串
+struct str_view{
+    const char* data;
+    size_t len;
+    bool equals(const char* s) const;
+};
+
+struct form_field{
+    str_view name;
+    str_view value;
+};
+
+// 解析 body[0, len)，最多 max 个字段，返回解析出来的个数 (多出来的字段忽略)
+int form_parse(char* body,size_t len,form_field* fields,int max);
+
+// 按名字找 (同名的取第一个)，找到返回 true
+bool form_find(const form_field* fields,int count,const char* name,str_view& value);
+
+#endif
@@ -0,0 +1,389 @@
+#include "hpack.h"
+#include<string.h>
+#include<stdio.h>
+
+// 📋 静态表 (RFC 7541 附录 A)，下标从 1 开始
+static const char* STATIC_TABLE[][2]={
+    {":authority",""},
+    {":method","GET"},
+    {":method","POST"},
+    {":path","/"},
+    {":path","/index.html"},
+    {":scheme","http"},
+    {":scheme","https"},
+    {":status","200"},
+    {":status","204"},
+    {":status","206"},
+    {":status","304"},
+    {":status","400"},
+    {":status","404"},
+    {":status","500"},
+    {"accept-charset",""},
+    {"accept-encoding","gzip, deflate"},
+    {"accept-language",""},
+    {"accept-ranges",""},
+    {"accept",""},
+    {"access-control-allow-origin",""},
+    {"age",""},
+    {"allow",""},
+    {"authorization",""},
+    {"cache-control",""},
+    {"content-disposition",""},
+    {"content-encoding",""},
+    {"content-language",""},
+    {"content-length",""},
+    {"content-location",""},
+    {"content-range",""},
+    {"content-type",""},
+    {"cookie",""},
+    {"date",""},
+    {"etag",""},
+    {"expect",""},
+    {"expires",""},
+    {"from",""},
+    {"host",""},
+    {"if-match",""},
+    {"if-modified-since",""},
+    {"if-none-match",""},
+    {"if-range",""},
+    {"if-unmodified-since",""},
+    {"last-modified",""},
+    {"link",""},
+    {"location",""},
+    {"max-forwards",""},
+    {"proxy-authenticate",""},
+    {"proxy-authorization",""},
+    {"range",""},
+    {"referer",""},
+    {"refresh",""},
+    {"retry-after",""},
+    {"server",""},
+    {"set-cookie",""},
+    {"strict-transport-security",""},
+    {"transfer-encoding",""},
+    {"user-agent",""},
+    {"vary",""},
+    {"via",""},
+    {"www-authenticate",""},
+};
+static const uint32_t STATIC_COUNT=sizeof(STATIC_TABLE)/sizeof(STATIC_TABLE[0]);
+
+// 📋 Huffman 码表 (RFC 7541 附录 B)：{编码, 位数}，下标就是字节值，256 是 EOS
+static const struct{uint32_t code;uint8_t bits;} HUFFMAN_TABLE[257]={
+    {0x1ff8,13},{0x7fffd8,23},{0xfffffe2,28},{0xfffffe3,28},{0xfffffe4,28},{0xfffffe5,28},
+    {0xfffffe6,28},{0xfffffe7,28},{0xfffffe8,28},{0xffffea,24},{0x3ffffffc,30},{0xfffffe9,28},
+    {0xfffffea,28},{0x3ffffffd,30},{0xfffffeb,28},{0xfffffec,28},{0xfffffed,28},{0xfffffee,28},
+    {0xfffffef,28},{0xffffff0,28},{0xffffff1,28},{0xffffff2,28},{0x3ffffffe,30},{0xffffff3,28},
+    {0xffffff4,28},{0xffffff5,28},{0xffffff6,28},{0xffffff7,28},{0xffffff8,28},{0xffffff9,28},
+    {0xffffffa,28},{0xffffffb,28},{0x14,6},{0x3f8,10},{0x3f9,10},{0xffa,12},
+    {0x1ff9,13},{0x15,6},{0xf8,8},{0x7fa,11},{0x3fa,10},{0x3fb,10},
+    {0xf9,8},{0x7fb,11},{0xfa,8},{0x16,6},{0x17,6},{0x18,6},
+    {0x0,5},{0x1,5},{0x2,5},{0x19,6},{0x1a,6},{0x1b,6},
+    {0x1c,6},{0x1d,6},{0x1e,6},{0x1f,6},{0x5c,7},{0xfb,8},
+    {0x7ffc,15},{0x20,6},{0xffb,12},{0x3fc,10},{0x1ffa,13},{0x21,6},
+    {0x5d,7},{0x5e,7},{0x5f,7},{0x60,7},{0x61,7},{0x62,7},
+    {0x63,7},{0x64,7},{0x65,7},{0x66,7},{0x67,7},{0x68,7},
+    {0x69,7},{0x6a,7},{0x6b,7},{0x6c,7},{0x6d,7},{0x6e,7},
+    {0x6f,7},{0x70,7},{0x71,7},{0x72,7},{0xfc,8},{0x73,7},
+    {0xfd,8},{0x1ffb,13},{0x7fff0,19},{0x1ffc,13},{0x3ffc,14},{0x22,6},
+    {0x7ffd,15},{0x3,5},{0x23,6},{0x4,5},{0x24,6},{0x5,5},
+    {0x25,6},{0x26,6},{0x27,6},{0x6,5},{0x74,7},{0x75,7},
+    {0x28,6},{0x29,6},{0x2a,6},{0x7,5},{0x2b,6},{0x76,7},
+    {0x2c,6},{0x8,5},{0x9,5},{0x2d,6},{0x77,7},{0x78,7},
+    {0x79,7},{0x7a,7},{0x7b,7},{0x7ffe,15},{0x7fc,11},{0x3ffd,14},
+    {0x1ffd,13},{0xffffffc,28},{0xfffe6,20},{0x3fffd2,22},{0xfffe7,20},{0xfffe8,20},
+    {0x3fffd3,22},{0x3fffd4,22},{0x3fffd5,22},{0x7fffd9,23},{0x3fffd6,22},{0x7fffda,23},
+    {0x7fffdb,23},{0x7fffdc,23},{0x7fffdd,23},{0x7fffde,23},{0xffffeb,24},{0x7fffdf,23},
+    {0xffffec,24},{0xffffed,24},{0x3fffd7,22},{0x7fffe0,23},{0xffffee,24},{0x7fffe1,23},
+    {0x7fffe2,23},{0x7fffe3,23},{0x7fffe4,23},{0x1fffdc,21},{0x3fffd8,22},{0x7fffe5,23},
+    {0x3fffd9,22},{0x7fffe6,23},{0x7fffe7,23},{0xffffef,24},{0x3fffda,22},{0x1fffdd,21},
+    {0xfffe9,20},{0x3fffdb,22},{0x3fffdc,22},{0x7fffe8,23},{0x7fffe9,23},{0x1fffde,21},
+    {0x7fffea,23},{0x3fffdd,22},{0x3fffde,22},{0xfffff0,24},{0x1fffdf,21},{0x3fffdf,22},
+    {0x7fffeb,23},{0x7fffec,23},{0x1fffe0,21},{0x1fffe1,21},{0x3fffe0,22},{0x1fffe2,21},
+    {0x7fffed,23},{0x3fffe1,22},{0x7fffee,23},{0x7fffef,23},{0xfffea,20},{0x3fffe2,22},
+    {0x3fffe3,22},{0x3fffe4,22},{0x7ffff0,23},{0x3fffe5,22},{0x3fffe6,22},{0x7ffff1,23},
+    {0x3ffffe0,26},{0x3ffffe1,26},{0xfffeb,20},{0x7fff1,19},{0x3fffe7,22},{0x7ffff2,23},
+    {0x3fffe8,22},{0x1ffffec,25},{0x3ffffe2,26},{0x3ffffe3,26},{0x3ffffe4,26},{0x7ffffde,27},
+    {0x7ffffdf,27},{0x3ffffe5,26},{0xfffff1,24},{0x1ffffed,25},{0x7fff2,19},{0x1fffe3,21},
+    {0x3ffffe6,26},{0x7ffffe0,27},{0x7ffffe1,27},{0x3ffffe7,26},{0x7ffffe2,27},{0xfffff2,24},
+    {0x1fffe4,21},{0x1fffe5,21},{0x3ffffe8,26},{0x3ffffe9,26},{0xffffffd,28},{0x7ffffe3,27},
+    {0x7ffffe4,27},{0x7ffffe5,27},{0xfffec,20},{0xfffff3,24},{0xfffed,20},{0x1fffe6,21},
+    {0x3fffe9,22},{0x1fffe7,21},{0x1fffe8,21},{0x7ffff3,23},{0x3fffea,22},{0x3fffeb,22},
+    {0x1ffffee,25},{0x1ffffef,25},{0xfffff4,24},{0xfffff5,24},{0x3ffffea,26},{0x7ffff4,23},
+    {0x3ffffeb,26},{0x7ffffe6,27},{0x3ffffec,26},{0x3ffffed,26},{0x7ffffe7,27},{0x7ffffe8,27},
+    {0x7ffffe9,27},{0x7ffffea,27},{0x7ffffeb,27},{0xffffffe,28},{0x7ffffec,27},{0x7ffffed,27},
+    {0x7ffffee,27},{0x7ffffef,27},{0x7fffff0,27},{0x3ffffee,26},{0x3fffffff,30},
+};
+
+// =================================================================
+// 1. 整数 (带前缀)
+// =================================================================
+
+// 前缀放得下就直接放；放不下就前缀全 1，剩下的每 7 位一个字节往后接
+bool hpack_decode_int(const unsigned char*& p,const unsigned char* end,int prefix,uint32_t& value){
+    if(p>=end){
+        return false;
+    }
+    uint32_t mask=(1u<<prefix)-1;
+    value=*p++&mask;
+    if(value<mask){
+        return true;
+    }
+
+    int shift=0;
+    while(p<end){
+        unsigned char b=*p++;
+        if(shift>28){
+            return false; // 太大了，肯定是坏数据
+        }
+        value+=(uint32_t)(b&0x7f)<<shift;
+        shift+=7;
+        if(!(b&0x80)){
+            return true;
+        }
+    }
+    return false;
+}
+
+void hpack_encode_int(std::string& out,unsigned char first,int prefix,uint32_t value){
+    uint32_t mask=(1u<<prefix)-1;
+    if(value<mask){
+        out.push_back((char)(first|value));
+        return;
+    }
+    out.push_back((char)(first|mask));
+    value-=mask;
+    while(value>=0x80){
+        out.push_back((char)((value&0x7f)|0x80));
+        value>>=7;
+    }
+    out.push_back((char)value);
+}
+
+// =================================================================
+// 2. Huffman 解码
+// =================================================================
+
+// 把码表建成一棵二叉树：从根往下，0 走左边，1 走右边，走到叶子就是一个字符
+struct huffman_node{
+    short child[2]; // 子节点下标，-1 表示没有
+    short symbol;   // 叶子上的字符，-1 表示不是叶子
+};
+
+struct huffman_tree{
+    huffman_node nodes[600];
+    int count;
+
+    huffman_tree():count(1){
+        nodes[0].child[0]=nodes[0].child[1]=-1;
+        nodes[0].symbol=-1;
+        for(int sym=0;sym<257;sym++){
+            int cur=0;
+            for(int i=HUFFMAN_TABLE[sym].bits-1;i>=0;i--){
+                int bit=(HUFFMAN_TABLE[sym].code>>i)&1;
+                if(nodes[cur].child[bit]==-1){
+                    nodes[count].child[0]=nodes[count].child[1]=-1;
+                    nodes[count].symbol=-1;
+                    nodes[cur].child[bit]=count++;
+                }
+                cur=nodes[cur].child[bit];
+            }
+            nodes[cur].symbol=sym;
+        }
+    }
+};
+
+bool hpack_huffman_decode(const unsigned char* data,size_t len,std::string& out){
+    static const huffman_tree tree; // 第一次用的时候建树 (C++11 保证线程安全)
+
+    int cur=0;
+    int depth=0;        // 从上一个字符结束到现在走了几位
+    bool all_ones=true; // 这几位是不是全是 1 (合法的填充必须是 EOS 的前缀，也就是全 1)
+    for(size_t i=0;i<len;i++){
+        for(int j=7;j>=0;j--){
+            int bit=(data[i]>>j)&1;
+            cur=tree.nodes[cur].child[bit];
+            if(cur==-1){
+                return false;
+            }
+            depth++;
+            all_ones=all_ones&&bit;
+
+            short sym=tree.nodes[cur].symbol;
+            if(sym!=-1){
+                if(sym==256){
+                    return false; // 字符串里不允许出现 EOS
+                }
+                out.push_back((char)sym);
+                cur=0;
+                depth=0;
+                all_ones=true;
+            }
+        }
+    }
+    // 最后剩下的填充位：不能超过 7 位，而且必须全是 1
+    return depth<8&&all_ones;
+}
+
+// =================================================================
+// 3. 解码器
+// =================================================================
+
+hpack_decoder::hpack_decoder():m_table_size(0),m_max_size(4096),m_max_allowed(4096){}
+
+bool hpack_decoder::lookup(uint32_t index,std::string& name,std::string& value) const{
+    if(index==0){
+        return false;
+    }
+    if(index<=STATIC_COUNT){
+        name=STATIC_TABLE[index-1][0];
+        value=STATIC_TABLE[index-1][1];
+        return true;
+    }
+    index-=STATIC_COUNT+1;
+    if(index>=m_table.size()){
+        return false;
+    }
+    name=m_table[index].first;
+    value=m_table[index].second;
+    return true;
+}
+
+void hpack_decoder::evict(size_t limit){
+    while(m_table_size>limit&&!m_table.empty()){
+        m_table_size-=m_table.back().first.size()+m_table.back().second.size()+32;
+        m_table.pop_back();
+    }
+}
+
+void hpack_decoder::add_entry(const std::string& name,const std::string& value){
+    size_t size=name.size()+value.size()+32;
+    // 比整张表还大：规定是清空整张表，而且这条也不放
+    if(size>m_max_size){
+        evict(0);
+        return;
+    }
+    evict(m_max_size-size);
+    m_table.push_front(std::make_pair(name,value));
+    m_table_size+=size;
+}
+
+// 读一个字符串：1 位 Huffman 标记 + 7 位前缀的长度 + 内容
+static bool decode_string(const unsigned char*& p,const unsigned char* end,std::string& out){
+    if(p>=end){
+        return false;
+    }
+    bool huffman=(*p&0x80)!=0;
+    uint32_t len;
+    if(!hpack_decode_int(p,end,7,len)||len>(size_t)(end-p)){
+        return false;
+    }
+    out.clear();
+    bool ok=true;
+    if(huffman){
+        ok=hpack_huffman_decode(p,len,out);
+    }else{
+        out.assign((const char*)p,len);
+    }
+    p+=len;
+    return ok;
+}
+
+bool hpack_decoder::decode(const unsigned char* data,size_t len,header_cb on_header,void* user){
+    const unsigned char* p=data;
+    const unsigned char* end=data+len;
+    std::string name,value;
+
+    while(p<end){
+        unsigned char b=*p;
+        uint32_t index;
+
+        if(b&0x80){
+            // 1xxxxxxx：整条头都在表里，直接查
+            if(!hpack_decode_int(p,end,7,index)||!lookup(index,name,value)){
+                return false;
+            }
+            on_header(name,value,user);
+        }else if((b&0xc0)==0x40){
+            // 01xxxxxx：字面量，并且加进动态表
+            if(!hpack_decode_int(p,end,6,index)){
+                return false;
+            }
+            if(index==0){
+                if(!decode_string(p,end,name)){
+                    return false;
+                }
+            }else if(!lookup(index,name,value)){
+                return false;
+            }
+            if(!decode_string(p,end,value)){
+                return false;
+            }
+            add_entry(name,value);
+            on_header(name,value,user);
+        }else if((b&0xe0)==0x20){
+            // 001xxxxx：动态表大小更新
+            if(!hpack_decode_int(p,end,5,index)||index>m_max_allowed){
+                return false;
+            }
+            m_max_size=index;
+            evict(m_max_size);
+        }else{
+            // 0000xxxx / 0001xxxx：字面量，不加进动态表
+            if(!hpack_decode_int(p,end,4,index)){
+                return false;
+            }
+            if(index==0){
+                if(!decode_string(p,end,name)){
+                    return false;
+                }
+            }else if(!lookup(index,name,value)){
+                return false;
+            }
+            if(!decode_string(p,end,value)){
+                return false;
+            }
+            on_header(name,value,user);
+        }
+    }
+    return true;
+}
+
+// =================================================================
+// 4. 编码器
+// =================================================================
+
+void hpack_encoder::encode_status(std::string& out,int status){
+    // 静态表 8~14 直接就是完整的 ":status: xxx"
+    static const int indexed[]={200,204,206,304,400,404,500};
+    for(int i=0;i<7;i++){
+        if(indexed[i]==status){
+            hpack_encode_int(out,0x80,7,8+i);
+            return;
+        }
+    }
+    char buf[8];
+    snprintf(buf,sizeof(buf),"%d",status);
+    // 0000 + 名字用静态表第 8 条 (:status)
+    hpack_encode_int(out,0x00,4,8);
+    hpack_encode_int(out,0x00,7,strlen(buf));
+    out.append(buf);
+}
+
+void hpack_encoder::encode_header(std::string& out,const char* name,const char* value){
+    // 名字在静态表里就发下标，不在就把名字也当字面量发
+    uint32_t name_index=0;
+    for(uint32_t i=0;i<STATIC_COUNT;i++){
+        if(strcmp(STATIC_TABLE[i][0],name)==0){
+            name_index=i+1;
+            break;
+        }
+    }
+    hpack_encode_int(out,0x00,4,name_index);
+    if(name_index==0){
+        hpack_encode_int(out,0x00,7,strlen(name));
+        out.append(name);
+    }
+    hpack_encode_int(out,0x00,7,strlen(value));
+    out.append(value);
+}
@@ -0,0 +1,59 @@
+#ifndef HPACK_H
+#define HPACK_H
+
+#include<stdint.h>
+#include<stddef.h>
+#include<string>
+#include<deque>
+#include<utility>
+
+// 🗜️ HPACK：HTTP/2 的头部压缩 (RFC 7541)
+// 头部不再一行一行发文本，而是：
+//   1. 常见的头 (":method: GET") 直接发静态表里的下标，一个字节搞定
+//   2. 发过一次的头放进动态表，下次也只发下标
+//   3. 字符串可以用 Huffman 编码再压一压
+
+// 📖 解码器 (解析客户端发来的请求头)
+class hpack_decoder{
+public:
+    hpack_decoder();
+
+    // 解出来的每一个头都会回调一次 on_header(name, value, user)
+    typedef void (*header_cb)(const std::string& name,const std::string& value,void* user);
+
+    // 解一整个头部块 (HEADERS + CONTINUATION 拼起来的)，格式错误返回 false
+    bool decode(const unsigned char* data,size_t len,header_cb on_header,void* user);
+
+    // 对方 SETTINGS_HEADER_TABLE_SIZE 限制的上限 (我们作为解码方，默认 4096)
+    void set_max_table_size(size_t size){m_max_allowed=size;}
+
+private:
+    bool lookup(uint32_t index,std::string& name,std::string& value) const;
+    void add_entry(const std::string& name,const std::string& value);
+    void evict(size_t limit);
+
+    // 动态表：新的在前面，超出大小从后面淘汰
+    std::deque<std::pair<std::string,std::string> > m_table;
+    size_t m_table_size;    // 当前占用 (每条 = name + value + 32)
+    size_t m_max_size;      // 当前上限 (对方可以用“动态表大小更新”指令调小)
+    size_t m_max_allowed;   // 上限的上限
+};
+
+// ✍️ 编码器 (生成响应头)
+// 响应头很少，不用动态表：能用静态表下标就用下标，不能就发“不索引的字面量”
+class hpack_encoder{
+public:
+    // :status
+    static void encode_status(std::string& out,int status);
+    // 普通头 (name 必须是小写)
+    static void encode_header(std::string& out,const char* name,const char* value);
+};
+
+// 整数编码 / 解码 (带 N 位前缀)，解码失败返回 false
+bool hpack_decode_int(const unsigned char*& p,const unsigned char* end,int prefix,uint32_t& value);
+void hpack_encode_int(std::string& out,unsigned char first,int prefix,uint32_t value);
+
+// Huffman 解码，失败返回 false
+bool hpack_huffman_decode(const unsigned char* data,size_t len,std::string& out);
+
+#endif
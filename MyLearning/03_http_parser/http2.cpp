@@ -0,0 +1,740 @@
+#include "http2.h"
+#include "http_conn.h"
+#include<sys/uio.h>
+
+const char h2_session::PREFACE[]="PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n";
+
+// SETTINGS 参数
+#define H2_SETTINGS_HEADER_TABLE_SIZE 0x1
+#define H2_SETTINGS_ENABLE_PUSH 0x2
+#define H2_SETTINGS_MAX_CONCURRENT_STREAMS 0x3
+#define H2_SETTINGS_INITIAL_WINDOW_SIZE 0x4
+#define H2_SETTINGS_MAX_FRAME_SIZE 0x5
+
+// 帧标志
+#define H2_FLAG_END_STREAM 0x1
+#define H2_FLAG_ACK 0x1
+#define H2_FLAG_END_HEADERS 0x4
+#define H2_FLAG_PADDED 0x8
+#define H2_FLAG_PRIORITY 0x20
+
+#define H2_MAX_WINDOW 0x7fffffff
+
+// 大端读写小工具
+static uint32_t get_u32(const unsigned char* p){
+    return ((uint32_t)p[0]<<24)|((uint32_t)p[1]<<16)|((uint32_t)p[2]<<8)|p[3];
+}
+
+static void put_u32(char* p,uint32_t v){
+    p[0]=(char)(v>>24);
+    p[1]=(char)(v>>16);
+    p[2]=(char)(v>>8);
+    p[3]=(char)v;
+}
+
+static void put_frame_head(char* p,uint32_t len,uint8_t type,uint8_t flags,uint32_t sid){
+    p[0]=(char)(len>>16);
+    p[1]=(char)(len>>8);
+    p[2]=(char)len;
+    p[3]=(char)type;
+    p[4]=(char)flags;
+    put_u32(p+5,sid&0x7fffffff);
+}
+
+// HTTP2-Settings 头是 base64url 编码 (没有填充) 的 SETTINGS 负载
+static bool base64url_decode(const char* in,std::string& out){
+    int val=0,bits=0;
+    for(;*in&&*in!=' '&&*in!='\t';in++){
+        int c=*in,d;
+        if(c>='A'&&c<='Z') d=c-'A';
+        else if(c>='a'&&c<='z') d=c-'a'+26;
+        else if(c>='0'&&c<='9') d=c-'0'+52;
+        else if(c=='-'||c=='+') d=62;
+        else if(c=='_'||c=='/') d=63;
+        else if(c=='=') break;
+        else return false;
+        val=(val<<6)|d;
+        bits+=6;
+        if(bits>=8){
+            bits-=8;
+            out.push_back((char)((val>>bits)&0xff));
+        }
+    }
+    return true;
+}
+
+// =================================================================
+// 1. 会话的创建 / 销毁
+// =================================================================
+
+h2_session::h2_session()
+    :m_out_bytes(0),m_rr(0),m_wait_preface(true),m_last_stream_id(0),
+    m_cont_stream(0),m_cont_end_stream(false),
+    m_conn_send_window(65535),m_peer_initial_window(65535),m_peer_max_frame(16384),
+    m_goaway_sent(false),m_peer_goaway(false),m_fatal(false){
+    for(int i=0;i<MAX_STREAMS;i++){
+        m_streams[i].id=0;
+        m_streams[i].refs=0;
+    }
+}
+
+h2_session::~h2_session(){
+    for(int i=0;i<MAX_STREAMS;i++){
+        close_static_file(m_streams[i].file);
+    }
+}
+
+void h2_session::start(){
+    // 服务端前言：一个 SETTINGS 帧
+    char payload[6];
+    payload[0]=0;
+    payload[1]=H2_SETTINGS_MAX_CONCURRENT_STREAMS;
+    put_u32(payload+2,MAX_STREAMS);
+    queue_frame(H2_SETTINGS,0,0,payload,sizeof(payload));
+}
+
+bool h2_session::start_upgrade(const char* settings_b64,const char* method,const char* path,bool accept_gzip){
+    static const char switching[]="HTTP/1.1 101 Switching Protocols\r\nConnection: Upgrade\r\nUpgrade: h2c\r\n\r\n";
+    queue_raw(switching,sizeof(switching)-1);
+    start();
+
+    // 客户端在 HTTP2-Settings 里提前给的 SETTINGS，当作收到了一个 SETTINGS 帧
+    std::string settings;
+    // (101 本身就算是确认了，不能再回 SETTINGS ACK)
+    if(settings_b64&&(!base64url_decode(settings_b64,settings)||settings.size()%6!=0
+        ||!apply_settings((const unsigned char*)settings.data(),settings.size()))){
+        return false;
+    }
+
+    // 升级前的那个请求就是 stream 1 (客户端这边已经发完了)
+    h2_stream* s=alloc_stream(1);
+    m_last_stream_id=1;
+    snprintf(s->method,sizeof(s->method),"%s",method);
+    if(strlen(path)>=sizeof(s->path)){
+        s->bad=true;
+    }else{
+        strcpy(s->path,path);
+    }
+    s->accept_gzip=accept_gzip;
+    s->end_stream=true;
+    dispatch(s);
+    return true;
+}
+
+// =================================================================
+// 2. 输入：切帧
+// =================================================================
+
+bool h2_session::on_read(const char* data,size_t len){
+    m_in.append(data,len);
+    size_t pos=0;
+
+    // 🤝 先核对客户端前言
+    if(m_wait_preface){
+        size_t n=m_in.size()<(size_t)PREFACE_LEN?m_in.size():PREFACE_LEN;
+        if(memcmp(m_in.data(),PREFACE,n)!=0){
+            return false;
+        }
+        if(n<(size_t)PREFACE_LEN){
+            return true;
+        }
+        m_wait_preface=false;
+        pos=PREFACE_LEN;
+    }
+
+    // ✂️ 一个一个切出完整的帧 (切菜刀的 HTTP/2 版本)
+    while(!m_fatal&&m_in.size()-pos>=9){
+        const unsigned char* p=(const unsigned char*)m_in.data()+pos;
+        uint32_t flen=((uint32_t)p[0]<<16)|((uint32_t)p[1]<<8)|p[2];
+        uint8_t type=p[3];
+        uint8_t flags=p[4];
+        uint32_t sid=get_u32(p+5)&0x7fffffff;
+
+        if(flen>MAX_FRAME_SIZE){
+            go_away(H2_FRAME_SIZE_ERROR);
+            break;
+        }
+        if(m_in.size()-pos<9+flen){
+            break; // 帧还没收全
+        }
+
+        handle_frame(type,flags,sid,p+9,flen);
+        pos+=9+flen;
+    }
+
+    m_in.erase(0,pos);
+    return true;
+}
+
+bool h2_session::handle_frame(uint8_t type,uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len){
+    // 头部块没收完的时候，中间只能夹 CONTINUATION
+    if(m_cont_stream&&type!=H2_CONTINUATION){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+
+    switch(type){
+        case H2_DATA:
+            return on_data(flags,sid,payload,len);
+        case H2_HEADERS:
+            return on_headers(flags,sid,payload,len);
+        case H2_CONTINUATION:
+            return on_continuation(flags,sid,payload,len);
+        case H2_SETTINGS:
+            return on_settings(flags,sid,payload,len);
+        case H2_WINDOW_UPDATE:
+            return on_window_update(sid,payload,len);
+        case H2_PING:{
+            if(sid!=0||len!=8){
+                go_away(H2_PROTOCOL_ERROR);
+                return false;
+            }
+            // 对方的 PING 原样弹回去
+            if(!(flags&H2_FLAG_ACK)){
+                queue_frame(H2_PING,H2_FLAG_ACK,0,(const char*)payload,8);
+            }
+            return true;
+        }
+        case H2_RST_STREAM:{
+            if(sid==0||len!=4){
+                go_away(H2_PROTOCOL_ERROR);
+                return false;
+            }
+            // 客户端不要这个响应了：停止发送 (已经排进队列的那几段还得等它们发完才能释放文件)
+            h2_stream* s=find_stream(sid);
+            if(s){
+                s->body_done=true;
+                s->responded=true;
+                release_stream(s);
+            }
+            return true;
+        }
+        case H2_GOAWAY:{
+            m_peer_goaway=true;
+            return true;
+        }
+        case H2_PUSH_PROMISE:{
+            // 客户端不能推送
+            go_away(H2_PROTOCOL_ERROR);
+            return false;
+        }
+        default:
+            // PRIORITY 和不认识的帧类型：直接忽略
+            return true;
+    }
+}
+
+// =================================================================
+// 3. 各种帧的处理
+// =================================================================
+
+// 去掉 PADDED / PRIORITY 带来的额外字段，剩下的就是真正的内容
+static bool strip_padding(uint8_t flags,const unsigned char*& payload,uint32_t& len,bool has_priority){
+    uint32_t pad=0;
+    if(flags&H2_FLAG_PADDED){
+        if(len<1){
+            return false;
+        }
+        pad=payload[0];
+        payload++;
+        len--;
+    }
+    if(has_priority&&(flags&H2_FLAG_PRIORITY)){
+        if(len<5){
+            return false;
+        }
+        payload+=5;
+        len-=5;
+    }
+    if(pad>len){
+        return false;
+    }
+    len-=pad;
+    return true;
+}
+
+bool h2_session::on_headers(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len){
+    // 客户端发起的 stream 必须是奇数，而且只能越来越大
+    if(sid==0||(sid&1)==0||!strip_padding(flags,payload,len,true)){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+
+    if(sid<=m_last_stream_id){
+        // 老 stream 上的 HEADERS 只能是请求体后面的 trailer
+        h2_stream* s=find_stream(sid);
+        if(!s||s->end_stream||!(flags&H2_FLAG_END_STREAM)){
+            go_away(H2_PROTOCOL_ERROR);
+            return false;
+        }
+    }else{
+        m_last_stream_id=sid;
+        // GOAWAY 之后的新 stream、或者槽位满了：拒绝 (头部块还是要解，HPACK 状态不能乱)
+        if(!m_goaway_sent&&!alloc_stream(sid)){
+            queue_frame(H2_RST_STREAM,0,sid,"\0\0\0\x07",4);
+        }
+    }
+
+    m_cont_stream=sid;
+    m_cont_end_stream=(flags&H2_FLAG_END_STREAM)!=0;
+    m_hblock.assign((const char*)payload,len);
+    if(flags&H2_FLAG_END_HEADERS){
+        return finish_headers();
+    }
+    return true;
+}
+
+bool h2_session::on_continuation(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len){
+    if(sid==0||sid!=m_cont_stream){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+    // 头部块太大 (防止对方一直发 CONTINUATION 把内存吃光)
+    if(m_hblock.size()+len>4*MAX_FRAME_SIZE){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+    m_hblock.append((const char*)payload,len);
+    if(flags&H2_FLAG_END_HEADERS){
+        return finish_headers();
+    }
+    return true;
+}
+
+// HPACK 解出每个头之后的回调：只关心我们用得上的几个
+static void on_request_header(const std::string& name,const std::string& value,void* user){
+    h2_stream* s=(h2_stream*)user;
+    if(!s){
+        return;
+    }
+    if(name==":method"){
+        if(value.size()>=sizeof(s->method)){
+            s->bad=true;
+        }else{
+            strcpy(s->method,value.c_str());
+        }
+    }else if(name==":path"){
+        if(value.size()>=sizeof(s->path)||value.empty()||value[0]!='/'){
+            s->bad=true;
+        }else{
+            strcpy(s->path,value.c_str());
+        }
+    }else if(name=="accept-encoding"){
+        if(value.find("gzip")!=std::string::npos){
+            s->accept_gzip=true;
+        }
+    }
+}
+
+bool h2_session::finish_headers(){
+    uint32_t sid=m_cont_stream;
+    m_cont_stream=0;
+
+    h2_stream* s=find_stream(sid);
+    // 被拒绝的 stream 也要解码 (user 传 NULL)，保证动态表和客户端一致
+    bool trailer=(s&&s->method[0]!='\0');
+    if(!m_decoder.decode((const unsigned char*)m_hblock.data(),m_hblock.size(),on_request_header,trailer?NULL:s)){
+        go_away(H2_COMPRESSION_ERROR);
+        return false;
+    }
+    m_hblock.clear();
+
+    if(s&&m_cont_end_stream){
+        s->end_stream=true;
+        dispatch(s);
+    }
+    return true;
+}
+
+bool h2_session::on_data(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len){
+    if(sid==0){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+
+    // 流量控制：收到多少就马上还给对方多少 (请求体我们不缓存，丢掉就行)
+    if(len>0){
+        char inc[4];
+        put_u32(inc,len);
+        queue_frame(H2_WINDOW_UPDATE,0,0,inc,4);
+    }
+
+    h2_stream* s=find_stream(sid);
+    if(!s||s->end_stream){
+        if(sid>m_last_stream_id){
+            go_away(H2_PROTOCOL_ERROR);
+            return false;
+        }
+        queue_frame(H2_RST_STREAM,0,sid,"\0\0\0\x05",4);
+        return true;
+    }
+
+    if(!strip_padding(flags,payload,len,false)){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+
+    if(flags&H2_FLAG_END_STREAM){
+        s->end_stream=true;
+        dispatch(s);
+    }else if(len>0){
+        char inc[4];
+        put_u32(inc,len);
+        queue_frame(H2_WINDOW_UPDATE,0,sid,inc,4);
+    }
+    return true;
+}
+
+bool h2_session::on_settings(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len){
+    if(sid!=0||len%6!=0){
+        go_away(H2_PROTOCOL_ERROR);
+        return false;
+    }
+    if(flags&H2_FLAG_ACK){
+        return true;
+    }
+
+    if(!apply_settings(payload,len)){
+        return false;
+    }
+
+    queue_frame(H2_SETTINGS,H2_FLAG_ACK,0,NULL,0);
+    return true;
+}
+
+// 把一组 SETTINGS 参数用到会话上 (不回 ACK)
+bool h2_session::apply_settings(const unsigned char* payload,uint32_t len){
+    for(uint32_t i=0;i<len;i+=6){
+        uint16_t id=((uint16_t)payload[i]<<8)|payload[i+1];
+        uint32_t value=get_u32(payload+i+2);
+
+        if(id==H2_SETTINGS_INITIAL_WINDOW_SIZE){
+            if(value>H2_MAX_WINDOW){
+                go_away(H2_FLOW_CONTROL_ERROR);
+                return false;
+            }
+            // 初始窗口变了：所有 stream 的窗口按差值一起调整
+            int32_t delta=(int32_t)value-m_peer_initial_window;
+            m_peer_initial_window=value;
+            for(int j=0;j<MAX_STREAMS;j++){
+                if(m_streams[j].id){
+                    m_streams[j].send_window+=delta;
+                }
+            }
+        }else if(id==H2_SETTINGS_MAX_FRAME_SIZE){
+            if(value<16384||value>16777215){
+                go_away(H2_PROTOCOL_ERROR);
+                return false;
+            }
+            m_peer_max_frame=value;
+        }else if(id==H2_SETTINGS_ENABLE_PUSH&&value>1){
+            go_away(H2_PROTOCOL_ERROR);
+            return false;
+        }
+        // HEADER_TABLE_SIZE 限制的是我们的编码器，我们不用动态表，不用管
+    }
+
+    return true;
+}
+
+bool h2_session::on_window_update(uint32_t sid,const unsigned char* payload,uint32_t len){
+    if(len!=4){
+        go_away(H2_FRAME_SIZE_ERROR);
+        return false;
+    }
+    uint32_t inc=get_u32(payload)&0x7fffffff;
+
+    if(sid==0){
+        if(inc==0||(int64_t)m_conn_send_window+inc>H2_MAX_WINDOW){
+            go_away(inc==0?H2_PROTOCOL_ERROR:H2_FLOW_CONTROL_ERROR);
+            return false;
+        }
+        m_conn_send_window+=inc;
+        return true;
+    }
+
+    h2_stream* s=find_stream(sid);
+    if(!s){
+        return true; // 已经结束的 stream，忽略
+    }
+    if(inc==0||(int64_t)s->send_window+inc>H2_MAX_WINDOW){
+        reset_stream(s,sid,inc==0?H2_PROTOCOL_ERROR:H2_FLOW_CONTROL_ERROR);
+        return true;
+    }
+    s->send_window+=inc;
+    return true;
+}
+
+// =================================================================
+// 4. stream 管理
+// =================================================================
+
+h2_stream* h2_session::find_stream(uint32_t sid){
+    for(int i=0;i<MAX_STREAMS;i++){
+        if(m_streams[i].id==sid){
+            return &m_streams[i];
+        }
+    }
+    return NULL;
+}
+
+h2_stream* h2_session::alloc_stream(uint32_t sid){
+    for(int i=0;i<MAX_STREAMS;i++){
+        h2_stream& s=m_streams[i];
+        // refs 没归零的槽位还有数据在发送队列里，不能复用
+        if(s.id==0&&s.refs==0){
+            s.id=sid;
+            s.end_stream=false;
+            s.responded=false;
+            s.body_done=false;
+            s.accept_gzip=false;
+            s.bad=false;
+            s.send_window=m_peer_initial_window;
+            s.method[0]='\0';
+            s.path[0]='\0';
+            s.body_off=0;
+            return &s;
+        }
+    }
+    return NULL;
+}
+
+// 响应发完了 (或者被取消了)：槽位空出来，文件等队列里的引用都发完再释放
+void h2_session::release_stream(h2_stream* s){
+    s->id=0;
+    if(s->refs==0){
+        close_static_file(s->file);
+    }
+}
+
+void h2_session::reset_stream(h2_stream* s,uint32_t sid,H2_ERROR error){
+    char code[4];
+    put_u32(code,error);
+    queue_frame(H2_RST_STREAM,0,sid,code,4);
+    if(s){
+        release_stream(s);
+    }
+}
+
+int h2_session::active_streams() const{
+    int n=0;
+    for(int i=0;i<MAX_STREAMS;i++){
+        if(m_streams[i].id){
+            n++;
+        }
+    }
+    return n;
+}
+
+// 🧾 请求收齐了：找文件，排响应头；响应体交给 schedule() 轮流切成 DATA 帧
+void h2_session::dispatch(h2_stream* s){
+    int status=200;
+    bool head_only=(strcmp(s->method,"HEAD")==0);
+    url_view view;
+
+    if(s->bad||s->method[0]=='\0'||s->path[0]=='\0'){
+        status=400;
+    }else if(strcmp(s->method,"GET")!=0&&strcmp(s->method,"POST")!=0&&!head_only){
+        status=405;
+    }else if(s->path[0]!='/'||!url_canonicalize(s->path,view)){
+        status=400;     // 和 HTTP/1 一样解码 + 规范化，退到根目录外面的直接 400
+    }else{
+        // "/" 和 "/dir/" 默认给 index.html (在这里补上，下面按它挑 content-type)
+        if(view.path_len+10<sizeof(s->path)&&s->path[view.path_len-1]=='/'){
+            strcpy(s->path+view.path_len,"index.html");
+        }
+
+        HTTP_CODE ret=open_static_file(s->path,s->accept_gzip,s->file);
+        if(ret==NO_RESOURCE) status=404;
+        else if(ret==FORBIDDEN_REQUEST) status=403;
+        else if(ret==BAD_REQUEST) status=400;
+        else if(ret!=FILE_REQUEST) status=500;
+    }
+
+    // HPACK 编码响应头
+    std::string block;
+    hpack_encoder::encode_status(block,status);
+    char len_buf[24];
+    size_t body_len=(status==200)?s->file.size:0;
+    snprintf(len_buf,sizeof(len_buf),"%zu",body_len);
+    hpack_encoder::encode_header(block,"content-length",len_buf);
+    if(status==200){
+        hpack_encoder::encode_header(block,"content-type",content_type_of(s->path));
+        if(s->file.gzip){
+            hpack_encoder::encode_header(block,"content-encoding","gzip");
+        }
+    }
+
+    bool has_body=(body_len>0&&!head_only);
+    queue_frame(H2_HEADERS,H2_FLAG_END_HEADERS|(has_body?0:H2_FLAG_END_STREAM),s->id,block.data(),block.size());
+    s->responded=true;
+
+    if(!has_body){
+        s->body_done=true;
+        release_stream(s);
+    }
+}
+
+// =================================================================
+// 5. 输出：发送队列 + 轮转切 DATA 帧
+// =================================================================
+
+void h2_session::queue_raw(const char* data,size_t len){
+    // 和队尾的“自己的字节”合并，少一个 iovec
+    if(m_out.empty()||m_out.back().ext){
+        out_segment seg;
+        seg.ext=NULL;
+        seg.len=0;
+        seg.off=0;
+        seg.slot=-1;
+        m_out.push_back(seg);
+    }
+    m_out.back().own.append(data,len);
+    m_out_bytes+=len;
+}
+
+void h2_session::queue_frame(uint8_t type,uint8_t flags,uint32_t sid,const char* payload,uint32_t len){
+    char head[9];
+    put_frame_head(head,len,type,flags,sid);
+    queue_raw(head,9);
+    if(len>0){
+        queue_raw(payload,len);
+    }
+}
+
+// 🔄 轮流给每个还有数据要发的 stream 切一个 DATA 帧，
+// 直到队列够多了、或者流量控制窗口用完了
+void h2_session::schedule(){
+    // 升级过来的连接：客户端前言到之前先别发响应体
+    // (有的客户端收到 101 之后、自己的 HTTP/2 还没准备好时能缓存的数据很有限)
+    if(m_wait_preface){
+        return;
+    }
+    while(m_out_bytes<OUT_WATERMARK&&m_conn_send_window>0){
+        bool progress=false;
+        for(int k=0;k<MAX_STREAMS;k++){
+            int i=(m_rr+k)%MAX_STREAMS;
+            h2_stream& s=m_streams[i];
+            if(!s.id||!s.responded||s.body_done){
+                continue;
+            }
+
+            size_t remain=s.file.size-s.body_off;
+            size_t n=remain;
+            if(n>m_peer_max_frame) n=m_peer_max_frame;
+            if(n>(size_t)m_conn_send_window) n=m_conn_send_window;
+            if(s.send_window<=0){
+                continue; // 这个 stream 的窗口用完了，等 WINDOW_UPDATE
+            }
+            if(n>(size_t)s.send_window) n=s.send_window;
+
+            bool last=(n==remain);
+            char head[9];
+            put_frame_head(head,n,H2_DATA,last?H2_FLAG_END_STREAM:0,s.id);
+            queue_raw(head,9);
+
+            // 文件内容不拷贝，直接指过去
+            out_segment seg;
+            seg.ext=s.file.address+s.body_off;
+            seg.len=n;
+            seg.off=0;
+            seg.slot=i;
+            m_out.push_back(seg);
+            m_out_bytes+=n;
+            s.refs++;
+
+            s.body_off+=n;
+            s.send_window-=n;
+            m_conn_send_window-=n;
+
+            if(last){
+                s.body_done=true;
+                release_stream(&s);
+            }
+
+            m_rr=(i+1)%MAX_STREAMS;
+            progress=true;
+            break;
+        }
+        if(!progress){
+            break;
+        }
+    }
+}
+
+int h2_session::flush(int sockfd){
+    while(true){
+        schedule();
+        if(m_out.empty()){
+            return 0;
+        }
+
+        // 一次 writev 最多带 64 段
+        struct iovec iov[64];
+        int count=0;
+        for(std::deque<out_segment>::iterator it=m_out.begin();it!=m_out.end()&&count<64;++it){
+            if(it->ext){
+                iov[count].iov_base=(void*)(it->ext+it->off);
+                iov[count].iov_len=it->len-it->off;
+            }else{
+                iov[count].iov_base=(void*)(it->own.data()+it->off);
+                iov[count].iov_len=it->own.size()-it->off;
+            }
+            count++;
+        }
+
+        ssize_t n=writev(sockfd,iov,count);
+        if(n<0){
+            if(errno==EAGAIN||errno==EWOULDBLOCK){
+                return 1;
+            }
+            return -1;
+        }
+        http_conn::m_bytes_sent+=n;
+
+        // 把发出去的段从队头弹掉，发了一半的记下偏移
+        m_out_bytes-=n;
+        while(n>0){
+            out_segment& seg=m_out.front();
+            size_t left=(seg.ext?seg.len:seg.own.size())-seg.off;
+            if((size_t)n<left){
+                seg.off+=n;
+                break;
+            }
+            n-=left;
+            if(seg.ext){
+                h2_stream& s=m_streams[seg.slot];
+                // 最后一段发完了，而且 stream 已经结束：现在才能释放文件
+                if(--s.refs==0&&s.id==0){
+                    close_static_file(s.file);
+                }
+            }
+            m_out.pop_front();
+        }
+    }
+}
+
+void h2_session::go_away(H2_ERROR error){
+    if(error!=H2_NO_ERROR){
+        m_fatal=true;
+    }
+    if(m_goaway_sent){
+        return;
+    }
+    m_goaway_sent=true;
+
+    char payload[8];
+    put_u32(payload,m_last_stream_id);
+    put_u32(payload+4,error);
+    queue_frame(H2_GOAWAY,0,0,payload,8);
+}
+
+bool h2_session::finished() const{
+    if(!m_out.empty()){
+        return false;
+    }
+    if(m_fatal){
+        return true;
+    }
+    return (m_goaway_sent||m_peer_goaway)&&active_streams()==0;
+}
@@ -0,0 +1,165 @@
+#ifndef HTTP2_H
+#define HTTP2_H
+
+#include<stdint.h>
+#include<string>
+#include<deque>
+#include "http_conn.h"
+#include "hpack.h"
+
+// 🚄 HTTP/2 (明文 h2c) 会话
+// 一个 TCP 连接上同时跑很多个请求 (stream)，每个请求的响应被切成一个个 DATA 帧，
+// 轮流塞进同一个发送队列里，所以大文件不会把小文件堵在后面。
+//
+// 帧格式 (9 字节帧头 + 负载)：
+// +-----------------------------------------------+
+// |                 Length (24)                   |
+// +---------------+---------------+---------------+
+// |   Type (8)    |   Flags (8)   |
+// +-+-------------+---------------+-------------------------------+
+// |R|                 Stream Identifier (31)                      |
+// +=+=============================================================+
+// |                   Frame Payload (0...)                      ...
+
+// 帧类型
+enum H2_FRAME_TYPE{
+    H2_DATA=0x0,
+    H2_HEADERS=0x1,
+    H2_PRIORITY=0x2,
+    H2_RST_STREAM=0x3,
+    H2_SETTINGS=0x4,
+    H2_PUSH_PROMISE=0x5,
+    H2_PING=0x6,
+    H2_GOAWAY=0x7,
+    H2_WINDOW_UPDATE=0x8,
+    H2_CONTINUATION=0x9
+};
+
+// 错误码
+enum H2_ERROR{
+    H2_NO_ERROR=0x0,
+    H2_PROTOCOL_ERROR=0x1,
+    H2_INTERNAL_ERROR=0x2,
+    H2_FLOW_CONTROL_ERROR=0x3,
+    H2_STREAM_CLOSED=0x5,
+    H2_FRAME_SIZE_ERROR=0x6,
+    H2_REFUSED_STREAM=0x7,
+    H2_COMPRESSION_ERROR=0x9
+};
+
+// 一个 stream 的状态 (放在会话里固定大小的数组里，不用每个请求 new 一次)
+struct h2_stream{
+    uint32_t id;            // 0 表示这个槽位空着
+    bool end_stream;        // 客户端已经发完了 (half-closed remote)
+    bool responded;         // 响应头已经排进发送队列
+    bool body_done;         // 响应体已经全部切成 DATA 帧
+    bool accept_gzip;
+    bool bad;               // 请求头有问题 (比如 path 太长)
+    int32_t send_window;    // 这个 stream 还能发多少字节 (流量控制)
+    char method[8];
+    char path[256];
+    static_file file;       // 要发的文件
+    size_t body_off;        // 文件已经切到哪了
+    int refs;               // 发送队列里还有几段指着 file 的内容 (归零才能释放)
+};
+
+class h2_session{
+public:
+    static const int MAX_STREAMS=32;            // 同时最多几个 stream (告诉客户端的 MAX_CONCURRENT_STREAMS)
+    static const uint32_t MAX_FRAME_SIZE=16384; // 我们能收的最大帧
+    static const size_t OUT_WATERMARK=65536;    // 发送队列攒到这么多就先不切新的 DATA 帧
+    static const int PREFACE_LEN=24;
+    static const char PREFACE[];                // 客户端连接前言 "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+
+public:
+    h2_session();
+    ~h2_session();
+
+    // 会话对象不小 (几十个 stream 槽位)，从 mem_pool 里拿，连接断了挂回去给下一个连接用
+    static void* operator new(size_t size){return mem_pool::alloc(size,MEM_H2);}
+    static void operator delete(void* p,size_t size){mem_pool::free(p,size,MEM_H2);}
+
+    // 🚀 直接以 HTTP/2 开始 (prior knowledge：客户端上来就发前言)
+    void start();
+
+    // 🚀 从 HTTP/1.1 的 "Upgrade: h2c" 升级过来：先回 101，原来那个请求变成 stream 1
+    bool start_upgrade(const char* settings_b64,const char* method,const char* path,bool accept_gzip);
+
+    // 📥 喂进来新读到的字节，解析出完整的帧并处理
+    // 返回 false 表示连接必须立刻关掉 (比如前言不对)
+    bool on_read(const char* data,size_t len);
+
+    // 📤 把发送队列写到 socket 里
+    // 返回 0: 都发完了 (或者被流量控制卡住，要等 WINDOW_UPDATE)
+    // 返回 1: 写满了 (EAGAIN)，要等 EPOLLOUT
+    // 返回 -1: 出错了
+    int flush(int sockfd);
+
+    // 📤 发送队列里还有没有东西
+    bool want_write() const{return !m_out.empty();}
+
+    // 👋 发 GOAWAY：不再接新的 stream，已有的发完就结束
+    void go_away(H2_ERROR error=H2_NO_ERROR);
+
+    // 🏁 会话可以结束了 (GOAWAY 之后所有 stream 都处理完了)
+    bool finished() const;
+
+private:
+    // 帧处理
+    bool handle_frame(uint8_t type,uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool on_headers(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool on_continuation(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool on_data(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool on_settings(uint8_t flags,uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool apply_settings(const unsigned char* payload,uint32_t len);
+    bool on_window_update(uint32_t sid,const unsigned char* payload,uint32_t len);
+    bool finish_headers();
+
+    // stream 管理
+    h2_stream* find_stream(uint32_t sid);
+    h2_stream* alloc_stream(uint32_t sid);
+    void release_stream(h2_stream* s);
+    void reset_stream(h2_stream* s,uint32_t sid,H2_ERROR error);
+    void dispatch(h2_stream* s);
+    int active_streams() const;
+
+    // 发送队列
+    void queue_frame(uint8_t type,uint8_t flags,uint32_t sid,const char* payload,uint32_t len);
+    void queue_raw(const char* data,size_t len);
+    void schedule();
+
+private:
+    // 一段要发的数据：要么是自己的字节 (帧头、控制帧)，要么指向某个 stream 的文件内容
+    struct out_segment{
+        std::string own;
+        const char* ext;    // 非 NULL 表示指向外部数据
+        size_t len;         // ext 的长度 (own 的长度就是 own.size())
+        size_t off;         // 已经发出去多少了
+        int slot;           // ext 属于哪个 stream 槽位
+    };
+
+    std::string m_in;                   // 还没凑成完整帧的输入
+    std::deque<out_segment> m_out;      // 发送队列
+    size_t m_out_bytes;                 // 发送队列里还有多少字节
+
+    h2_stream m_streams[MAX_STREAMS];   // stream 槽位 (紧凑的数组)
+    int m_rr;                           // 轮转发送用的游标
+
+    hpack_decoder m_decoder;
+
+    bool m_wait_preface;        // 还在等客户端前言
+    uint32_t m_last_stream_id;  // 见过的最大 stream id
+    uint32_t m_cont_stream;     // 正在等 CONTINUATION 的 stream (0 表示没有)
+    bool m_cont_end_stream;     // 那个 HEADERS 帧是不是带了 END_STREAM
+    std::string m_hblock;       // HEADERS + CONTINUATION 拼起来的头部块
+
+    int32_t m_conn_send_window;     // 整个连接还能发多少字节
+    int32_t m_peer_initial_window;  // 对方 SETTINGS 里的 INITIAL_WINDOW_SIZE
+    uint32_t m_peer_max_frame;      // 对方能收的最大帧
+
+    bool m_goaway_sent;
+    bool m_peer_goaway;
+    bool m_fatal;               // 出了连接级错误，发完 GOAWAY 就关
+};
+
+#endif
@@ -0,0 +1,363 @@
+// 🏋️ 吞吐基准：-c 条长连接，每条一个线程，一个响应收完马上发下一个 (闭环)，跑 -d 秒
+// 用法: ./http_bench [-h host] [-p port] [-u path] [-c conns] [-d seconds] [-w seconds] [-s] [-P server_pid]
+//   -w SEC 先热身 SEC 秒 (默认 1，不计入结果)：建连接、TLS 握手、页缓存 / 连接池都稳定下来再开始算
+//   -s     走 HTTPS (OpenSSL 客户端，不校验证书)；服务器那边有没有用上 kTLS 看服务器自己
+//   -P PID 服务器的进程号：从 /proc/PID/stat 读服务器这段时间用了多少 CPU (用户态 + 内核态)，
+//          算出“每 GB 响应花多少 CPU 秒”——发大文件时比请求数 / 秒更能看出拷贝 / 加密省没省下来
+// 结果一行：请求 / 秒、MB / 秒、p50 / p99 延迟、服务器和压测端各自的 CPU 占用和 CPU 秒 / GB。
+// 拿来对比同一个服务器的不同配置 (每次只改一项)，比如：
+//   kTLS：        同一个大文件，-s 打 https_port vs 不带 -s 打 HTTP (kTLS 用不上时就是用户态加密)
+//   分配器：      服务器前面加 LD_PRELOAD=libjemalloc.so.2 vs 不加
+//   绑核：        cpu_pinning=1 vs 0 (io_loops 相同)
+//   MSG_ZEROCOPY：zerocopy_min=65536 vs 0，看 CPU 秒 / GB
+// 编译: g++ -std=c++20 -O2 http_bench.cpp -o http_bench -lpthread -lssl -lcrypto
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<errno.h>
+#include<signal.h>
+#include<time.h>
+#include<netdb.h>
+#include<pthread.h>
+#include<sys/socket.h>
+#include<sys/resource.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include<openssl/ssl.h>
+#include<openssl/err.h>
+#include<atomic>
+#include<vector>
+#include<algorithm>
+
+// =================================================================
+// 1. 参数 / 每条连接的统计
+// =================================================================
+
+struct hb_options{
+    const char* host;
+    int port;
+    const char* path;
+    int conns;
+    int duration_s;
+    int warmup_s;
+    bool tls;
+    int server_pid;     // 0: 不看服务器 CPU
+};
+
+struct hb_worker{
+    pthread_t tid;
+    long long requests;         // 计时段内收完的响应
+    long long bytes;            // 计时段内收到的字节 (响应头 + 响应体)
+    long long errors;           // 不是 200 (比如过载保护回的 503) / 连接断了
+    std::vector<int> latency_us;
+};
+
+static hb_options g_opt;
+static struct sockaddr_in g_addr;
+static char g_request[512];
+static int g_request_len;
+static SSL_CTX* g_ssl_ctx=NULL;
+static std::atomic<long long> g_measure_start;  // 热身结束、开始计数的时刻
+static std::atomic<long long> g_measure_end;
+static std::atomic<int> g_ready(0); // 连上了 (握手完了) 的线程数
+
+static long long now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// =================================================================
+// 2. 一条连接：明文 / TLS 都走这两个函数
+// =================================================================
+
+struct hb_conn{
+    int fd;
+    SSL* ssl;
+};
+
+static bool conn_open(hb_conn& c){
+    c.fd=socket(AF_INET,SOCK_STREAM|SOCK_CLOEXEC,0);
+    c.ssl=NULL;
+    if(c.fd<0){
+        return false;
+    }
+    if(connect(c.fd,(struct sockaddr*)&g_addr,sizeof(g_addr))<0){
+        close(c.fd);
+        return false;
+    }
+    int one=1;
+    setsockopt(c.fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+    if(g_ssl_ctx){
+        c.ssl=SSL_new(g_ssl_ctx);
+        SSL_set_fd(c.ssl,c.fd);
+        if(SSL_connect(c.ssl)!=1){
+            ERR_print_errors_fp(stderr);
+            SSL_free(c.ssl);
+            close(c.fd);
+            return false;
+        }
+    }
+    return true;
+}
+
+static void conn_close(hb_conn& c){
+    if(c.ssl){
+        SSL_free(c.ssl);
+    }
+    close(c.fd);
+}
+
+static bool conn_send(hb_conn& c,const char* buf,int len){
+    while(len>0){
+        int n=c.ssl?SSL_write(c.ssl,buf,len):(int)send(c.fd,buf,len,MSG_NOSIGNAL);
+        if(n<=0){
+            return false;
+        }
+        buf+=n;
+        len-=n;
+    }
+    return true;
+}
+
+static int conn_recv(hb_conn& c,char* buf,int len){
+    return c.ssl?SSL_read(c.ssl,buf,len):(int)recv(c.fd,buf,len,0);
+}
+
+// 收一个完整的响应，返回收到的字节数 (-1: 出错 / 断了 / 不是 200)
+static long long read_response(hb_conn& c){
+    static thread_local char buf[65536];
+    char head[2048];
+    int head_len=0;
+    long long body_left=-1;
+    long long total=0;
+    while(true){
+        int n=conn_recv(c,buf,sizeof(buf));
+        if(n<=0){
+            return -1;
+        }
+        total+=n;
+        if(body_left<0){
+            int take=std::min(n,(int)sizeof(head)-1-head_len);
+            memcpy(head+head_len,buf,take);
+            head_len+=take;
+            head[head_len]='\0';
+            char* end=strstr(head,"\r\n\r\n");
+            if(!end){
+                if(head_len==(int)sizeof(head)-1){
+                    return -1;
+                }
+                continue;
+            }
+            if(head_len<12||atoi(head+9)!=200){
+                return -1;
+            }
+            long long len=0;
+            for(char* p=head;p<end;p++){
+                if((p==head||p[-1]=='\n')&&strncasecmp(p,"Content-Length:",15)==0){
+                    len=atoll(p+15);
+                    break;
+                }
+            }
+            // 这一次收到的里面，头后面的部分都是响应体
+            body_left=len-(n-(int)(end+4-head-(head_len-take)));
+        }else{
+            body_left-=n;
+        }
+        if(body_left<=0){
+            return total;
+        }
+    }
+}
+
+static void* worker_main(void* arg){
+    hb_worker* w=(hb_worker*)arg;
+    hb_conn c;
+    bool ok=conn_open(c);
+    g_ready++;
+    if(!ok){
+        w->errors++;
+        return NULL;
+    }
+    while(true){
+        long long start=now_us();
+        if(start>=g_measure_end){
+            break;
+        }
+        long long got=-1;
+        if(conn_send(c,g_request,g_request_len)){
+            got=read_response(c);
+        }
+        long long end=now_us();
+        bool counted=start>=g_measure_start&&end<=g_measure_end;
+        if(got<0){
+            if(counted){
+                w->errors++;
+            }
+            // 断了就重连 (服务器限了长连接次数之类)，连不上就不跑了
+            conn_close(c);
+            if(!conn_open(c)){
+                return NULL;
+            }
+            continue;
+        }
+        if(counted){
+            w->requests++;
+            w->bytes+=got;
+            w->latency_us.push_back((int)(end-start));
+        }
+    }
+    conn_close(c);
+    return NULL;
+}
+
+// =================================================================
+// 3. CPU 占用
+// =================================================================
+
+// /proc/PID/stat 第 14、15 个字段：utime、stime (单位 clock tick)，返回秒
+static double proc_cpu_seconds(int pid){
+    char path[64];
+    snprintf(path,sizeof(path),"/proc/%d/stat",pid);
+    FILE* fp=fopen(path,"r");
+    if(!fp){
+        return -1;
+    }
+    char line[1024];
+    char* ok=fgets(line,sizeof(line),fp);
+    fclose(fp);
+    if(!ok){
+        return -1;
+    }
+    // 第 2 个字段 (进程名) 带括号、可能有空格，从最后一个 ')' 后面开始数
+    char* p=strrchr(line,')');
+    if(!p){
+        return -1;
+    }
+    unsigned long long utime=0,stime=0;
+    if(sscanf(p+2,"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %llu %llu",&utime,&stime)!=2){
+        return -1;
+    }
+    return (double)(utime+stime)/sysconf(_SC_CLK_TCK);
+}
+
+static double self_cpu_seconds(){
+    struct rusage ru;
+    getrusage(RUSAGE_SELF,&ru);
+    return ru.ru_utime.tv_sec+ru.ru_utime.tv_usec/1e6+ru.ru_stime.tv_sec+ru.ru_stime.tv_usec/1e6;
+}
+
+static int percentile(std::vector<int>& v,double p){
+    if(v.empty()){
+        return 0;
+    }
+    size_t i=(size_t)(p*(v.size()-1));
+    std::nth_element(v.begin(),v.begin()+i,v.end());
+    return v[i];
+}
+
+// =================================================================
+// 4. 主函数
+// =================================================================
+
+int main(int argc,char* argv[]){
+    g_opt.host="127.0.0.1";
+    g_opt.port=9006;
+    g_opt.path="/";
+    g_opt.conns=16;
+    g_opt.duration_s=10;
+    g_opt.warmup_s=1;
+    g_opt.tls=false;
+    g_opt.server_pid=0;
+    int c;
+    while((c=getopt(argc,argv,"h:p:u:c:d:w:sP:"))!=-1){
+        switch(c){
+            case 'h': g_opt.host=optarg; break;
+            case 'p': g_opt.port=atoi(optarg); break;
+            case 'u': g_opt.path=optarg; break;
+            case 'c': g_opt.conns=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'd': g_opt.duration_s=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'w': g_opt.warmup_s=atoi(optarg)>=0?atoi(optarg):0; break;
+            case 's': g_opt.tls=true; break;
+            case 'P': g_opt.server_pid=atoi(optarg); break;
+            default:
+                printf("usage: %s [-h host] [-p port] [-u path] [-c conns] [-d seconds] [-w seconds] [-s] [-P server_pid]\n",argv[0]);
+                return 1;
+        }
+    }
+    signal(SIGPIPE,SIG_IGN);
+
+    struct addrinfo hints;
+    memset(&hints,0,sizeof(hints));
+    hints.ai_family=AF_INET;
+    hints.ai_socktype=SOCK_STREAM;
+    struct addrinfo* res=NULL;
+    if(getaddrinfo(g_opt.host,NULL,&hints,&res)!=0||!res){
+        printf("cannot resolve %s\n",g_opt.host);
+        return 1;
+    }
+    g_addr=*(struct sockaddr_in*)res->ai_addr;
+    g_addr.sin_port=htons(g_opt.port);
+    freeaddrinfo(res);
+    g_request_len=snprintf(g_request,sizeof(g_request),"GET %s HTTP/1.1\r\nHost: %s\r\nConnection: keep-alive\r\n\r\n",
+        g_opt.path,g_opt.host);
+
+    if(g_opt.tls){
+        g_ssl_ctx=SSL_CTX_new(TLS_client_method());
+        SSL_CTX_set_verify(g_ssl_ctx,SSL_VERIFY_NONE,NULL);
+    }
+
+    // 计时段先放到很远：所有连接都连上 (握手完) 以后再定
+    g_measure_start=now_us()+3600LL*1000000;
+    g_measure_end=g_measure_start.load();
+    std::vector<hb_worker> workers(g_opt.conns);
+    for(int i=0;i<g_opt.conns;i++){
+        workers[i].requests=workers[i].bytes=workers[i].errors=0;
+        pthread_create(&workers[i].tid,NULL,worker_main,&workers[i]);
+    }
+    while(g_ready<g_opt.conns){
+        usleep(1000);
+    }
+    long long begin=now_us();
+    g_measure_end=begin+(long long)(g_opt.warmup_s+g_opt.duration_s)*1000000;
+    g_measure_start=begin+(long long)g_opt.warmup_s*1000000;
+
+    // 热身完了开始记 CPU
+    usleep(g_opt.warmup_s*1000000);
+    double server_cpu0=g_opt.server_pid>0?proc_cpu_seconds(g_opt.server_pid):-1;
+    double self_cpu0=self_cpu_seconds();
+    usleep(g_opt.duration_s*1000000);
+    double server_cpu1=g_opt.server_pid>0?proc_cpu_seconds(g_opt.server_pid):-1;
+    double self_cpu1=self_cpu_seconds();
+
+    long long requests=0,bytes=0,errors=0;
+    std::vector<int> latency;
+    for(int i=0;i<g_opt.conns;i++){
+        pthread_join(workers[i].tid,NULL);
+        requests+=workers[i].requests;
+        bytes+=workers[i].bytes;
+        errors+=workers[i].errors;
+        latency.insert(latency.end(),workers[i].latency_us.begin(),workers[i].latency_us.end());
+    }
+
+    double secs=g_opt.duration_s;
+    double gb=bytes/1e9;
+    printf("%s%s  %d 条连接  %d 秒\n",g_opt.tls?"https":"http",g_opt.path,g_opt.conns,g_opt.duration_s);
+    printf("📊 %.0f 请求/秒  %.1f MB/秒  p50 %.2fms  p99 %.2fms  非 200 / 出错 %lld\n",
+        requests/secs,bytes/secs/1e6,percentile(latency,0.50)/1000.0,percentile(latency,0.99)/1000.0,errors);
+    double self_cpu=self_cpu1-self_cpu0;
+    if(server_cpu0>=0&&server_cpu1>=0){
+        double server_cpu=server_cpu1-server_cpu0;
+        printf("🧮 服务器 CPU %.0f%%  %.2f CPU秒/GB   压测端 CPU %.0f%%  %.2f CPU秒/GB\n",
+            100*server_cpu/secs,gb>0?server_cpu/gb:0,100*self_cpu/secs,gb>0?self_cpu/gb:0);
+    }else{
+        printf("🧮 压测端 CPU %.0f%%  %.2f CPU秒/GB (加 -P 服务器进程号 看服务器的)\n",
+            100*self_cpu/secs,gb>0?self_cpu/gb:0);
+    }
+    if(g_ssl_ctx){
+        SSL_CTX_free(g_ssl_ctx);
+    }
+    return 0;
+}
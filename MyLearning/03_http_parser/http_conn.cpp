@@ -1,4 +1,19 @@
 #include "http_conn.h"
+#include "http2.h"
+#include<limits.h>
+#include<math.h>
+#include<netinet/tcp.h>
+#include<linux/errqueue.h>
+#include<sys/sendfile.h>
+#include<sys/ioctl.h>
+#include<linux/sockios.h>
+#include<linux/openat2.h>
+#include<sys/syscall.h>
+#include "page_cache.h"
+
+// 🔬 阶段打点：USDT 探针每次都过 (没人挂上去时是 nop)，时间戳只在请求被抽中时才记
+#define PHASE_ENTER(phase,probe) do{TRACE_PROBE1(probe,m_sockfd);trace_enter(m_trace,phase);}while(0)
+#define PHASE_LEAVE(phase,probe) do{trace_leave(m_trace,phase);TRACE_PROBE1(probe,m_sockfd);}while(0)
 
 // =================================================================
 // 1. 静态成员初始化
@@ -6,8 +21,35 @@
 
 // 所有的 socket 上的事件都被注册到同一个 epoll 对象中
 // 所以 epoll 文件描述符是静态的，所有对象共享
-int http_conn::m_epollfd=-1;
-int http_conn::m_user_count=0;
+thread_local int http_conn::m_epollfd=-1;
+std::atomic<int> http_conn::m_user_count(0);
+
+// 过载保护 (CoDel) 的共享状态和计数器
+std::atomic<long long> http_conn::m_request_count(0);
+std::atomic<long long> http_conn::m_shed_count(0);
+std::atomic<long long> http_conn::m_max_sojourn_us(0);
+thread_local long long http_conn::m_bytes_sent=0;
+pthread_mutex_t http_conn::m_codel_lock=PTHREAD_MUTEX_INITIALIZER;
+std::atomic<long long> http_conn::m_codel_first_above(0);
+std::atomic<bool> http_conn::m_codel_dropping(false);
+long long http_conn::m_codel_last_update=0;
+long long http_conn::m_codel_drop_next=0;
+int http_conn::m_codel_count=0;
+int http_conn::m_codel_last_count=0;
+
+std::atomic<bool> http_conn::m_draining(false);
+
+// 零拷贝的开关和计数
+std::atomic<int> http_conn::m_zerocopy_min(0);
+std::atomic<long long> http_conn::m_zerocopy_sends(0);
+std::atomic<long long> http_conn::m_zerocopy_copied(0);
+
+// WebSocket 积压上限和被踢掉的计数
+std::atomic<int> http_conn::m_ws_max_queue(1024*1024);
+std::atomic<long long> http_conn::m_ws_evicted(0);
+
+// 用哪一份解析器
+int http_conn::m_parser=PARSER_VERBOSE;
 
 // =================================================================
 // 2. Epoll 辅助函数 (这些是给 Epoll 打下手的工具函数)
@@ -77,15 +119,53 @@ void modfd(int epollfd,int fd,int ev){
     epoll_ctl(epollfd,EPOLL_CTL_MOD,fd,&event);
 }
 
+// 🔧 连接自己重新挂回 epoll：和 modfd 一样，只是记下了这次等的事件
+// (零拷贝的完成通知会单独报一个 EPOLLERR 把 ONESHOT 摘掉，那时要按原样再挂回去)
+void http_conn::arm(int ev){
+    m_armed=ev;
+    // 大文件在等帮手线程读盘：socket 可写也发不了，先不等 EPOLLOUT (读好了 rearm 再加回来)
+    if(m_file_wait){
+        ev&=~EPOLLOUT;
+    }
+    modfd(m_epollfd,m_sockfd,ev);
+}
+
 // =================================================================
 // 3. 连接管理 (初始化与关闭)
 // =================================================================
 
 // 🏨 公有初始化：当新客户连接进来时调用
-void http_conn::init(int sockfd,const sockaddr_in& addr){
+void http_conn::init(int sockfd,const sockaddr_in& addr,bool tls){
     m_sockfd=sockfd;
     m_address=addr;
 
+    // 🔐 HTTPS 连接：先创建 SSL 对象，真正的握手等客户端发 ClientHello 过来再做
+    m_ssl=0;
+    m_h2=0;
+    m_tls_state=TLS_NONE;
+    m_tls_want_write=false;
+    m_ktls_send=false;
+    m_notsent_lowat=false;
+    m_armed=EPOLLIN;
+    m_zc=ZC_UNTRIED;
+    m_file_wait=false;
+    m_ws=false;
+    m_ws_closing=false;
+    m_ws_evict=false;
+    m_ws_channel=-1;
+    m_ws_slot=-1;
+    m_ws_fn=0;
+    m_ws_in_frame=false;
+    m_ws_frame_done=0;
+    m_ws_msg_opcode=0;
+    m_capture_id=capture_sample_conn();
+    if(tls){
+        m_ssl=tls_new(sockfd);
+        if(m_ssl){
+            m_tls_state=TLS_HANDSHAKE;
+        }
+    }
+
     // 端口复用 (调试方便，防止服务器重启报 "Address already in use")
     // 这里的 reuse = 1 表示允许复用
     int reuse=1;
@@ -94,6 +174,7 @@ void http_conn::init(int sockfd,const sockaddr_in& addr){
     // 把它加到 Epoll 监控名单里，并开启 ONESHOT
     addfd(m_epollfd,sockfd,true);
     m_user_count++;
+    mem_charge(MEM_CONN,sizeof(http_conn));
 
     // 调用私有的 init 做内部变量的大扫除
     init();
@@ -104,25 +185,83 @@ void http_conn::init(){
     // 1. 游标/指针归零 (最关键！)
     // 想象你在读一本书：
     m_check_state = CHECK_STATE_REQUESTLINE; // 从第一行标题开始读
+    m_header_count = 0;
     m_checked_idx = 0; // 读到第几个字
     m_start_line = 0;  // 这一行是从哪开始
     m_read_idx = 0;    // 读缓冲区
-    m_write_idx = 0;   // 写缓冲区
 
     // 2. HTTP 请求信息归零 (把上一个客人的菜单撕掉)
     m_method = GET;      // 默认假设是 GET 请求
     m_url = 0;           // 文件名
+    m_query = 0;         // 查询串
     m_version = 0;       // 协议版本
     m_content_length = 0;// 包体有多长
     m_linger = false;    // 默认不保持连接 (Connection: close)
+    m_accept_gzip = false;
+    m_upgrade_h2c = false;
+    m_h2_settings = 0;
+    m_upgrade_ws = false;
+    m_ws_key = 0;
+    m_ws_version_ok = false;
+    m_co_fn = 0;
+    m_co_wait = CO_WAIT_NONE;
+    m_co_writer = 0;
+    m_co_cache = 0;
+    m_co_drain_limit = 0;
+    m_co_failed = false;
+    m_co_body_left = 0;
+    m_co_body_start = 0;
     m_host = 0;          
+    m_content_type = 0;  // 上一个请求的 Content-Type / Cookie 指着的是已经还掉的读缓冲区
+    m_cookie = 0;
+
+    // 3. 发送相关归零 (上一个响应在 write() 里发完的时候链上的段就都释放了)
+    m_out.clear();
+    m_ready_time = 0;
+    m_codel_checked = false;
+
+    // 上一个请求从 arena 里切的内存一次性作废
+    // (内存紧张的时候连留着复用的第一块也还掉，长连接闲着的时候什么都不占)
+    if(mem_level()>=MEM_SOFT){
+        m_arena.release();
+        m_out.trim();
+    }else{
+        m_arena.reset();
+    }
+    m_trace.reset();
+
+    // 4. 读缓冲区还给 mem_pool (以前是把整个缓冲区刷成 0)
+    // 下一个请求的数据来了 read_once 再借一块，长连接闲着的时候不占这 2KB
+    release_read_buf();
+}
+
+bool http_conn::acquire_read_buf(){
+    // 🧮 过了硬上限：不再接新的读。明文连接回一个 503 (不用缓冲区，字符串常量直接发)，然后挂断
+    if(mem_level()==MEM_HARD){
+        mem_note_refused();
+        if(!m_ssl){
+            static const char busy[]="HTTP/1.1 503 Service Unavailable\r\nContent-Length: 0\r\nConnection: close\r\n\r\n";
+            ssize_t ret=send(m_sockfd,busy,sizeof(busy)-1,MSG_DONTWAIT|MSG_NOSIGNAL);
+            (void)ret;
+        }
+        return false;
+    }
+    m_read_buf=(char*)mem_pool::alloc(READ_BUFFER_SIZE,MEM_READ_BUF);
+    return true;
+}
 
-    // 3. 物理清空缓冲区 (把桌子擦干净)
-    // 这一步其实不是必须的（因为游标归零了，新数据会覆盖旧数据），
-    // 但为了安全和调试方便，全部刷成 0 (\0)
-    memset(m_read_buf, '\0', READ_BUFFER_SIZE);
-    memset(m_write_buf, '\0', WRITE_BUFFER_SIZE);
-    memset(m_real_file, '\0', FILENAME_LEN);
+void http_conn::release_read_buf(){
+    if(m_read_buf){
+        mem_pool::free(m_read_buf,READ_BUFFER_SIZE,MEM_READ_BUF);
+        m_read_buf=0;
+    }
+}
+
+void http_conn::trim_idle(){
+    if(is_idle()&&!m_ws){
+        m_arena.release();
+        m_out.trim();
+    }
 }
 
 // 👋 关闭连接
@@ -130,10 +269,45 @@ void http_conn::close_conn(){
     // m_sockfd != -1 说明连接还开着
     if(m_sockfd!=-1){// 这句if是起到一个保险作用！因为防止一不小心第二次调用的话m_user_count--可能会出错
         // 从 Epoll 移除，关闭句柄
+        // 🔐 HTTPS：尽量礼貌地发个 close_notify (非阻塞，发不出去也不管)，再释放 SSL 对象
+        if(m_ssl){
+            if(m_tls_state==TLS_ESTABLISHED){
+                SSL_shutdown(m_ssl);
+            }
+            SSL_free(m_ssl);
+            m_ssl=0;
+        }
+
+        // 还没发完的文件也要释放掉，不然 mmap 就泄漏了
+        // (零拷贝发出去、还没等到完成通知的也一起放掉：连接都不要了，内核发的是什么已经无所谓)
+        unmap();
+        m_out.clear();
+        m_out.release_parked();
+        m_file_wait=false;  // 帮手线程晚到的通知靠 m_co_seq 认出来扔掉
+
+        // 🧵 协程 handler 还没跑完：直接销毁 (挂起点上的局部变量都会正常析构)
+        co_cancel();
+        m_arena.release();
+        release_read_buf();
+
+        // 🔌 WebSocket：退出本循环的成员表 (之后的广播就不会再挂到它身上了)
+        if(m_ws){
+            ws_leave(this);
+            m_ws=false;
+            std::string().swap(m_ws_msg);
+        }
+
+        // 🚄 HTTP/2 会话 (里面各个 stream 的文件在析构时释放)
+        if(m_h2){
+            delete m_h2;
+            m_h2=0;
+        }
+
         removefd(m_epollfd,m_sockfd);
         m_sockfd=-1;// 标记为无效
 
         m_user_count--;
+        mem_charge(MEM_CONN,-(long long)sizeof(http_conn));
     }
 }
 
@@ -145,15 +319,46 @@ void http_conn::close_conn(){
 // 返回 true: 读取成功 (哪怕没读完，只要没出错)
 // 返回 false: 读出错了，或者对方关闭连接了 -> 需要 close_conn
 bool http_conn::read_once(){
+    // 🧮 这个请求的第一次读：先借一块读缓冲区 (借不到就是内存到了硬上限，挂断)
+    if(!m_read_buf&&!acquire_read_buf()){
+        return false;
+    }
+
     // 游标检查：如果缓冲区满了，就别读了，防止溢出
     if(m_read_idx>=READ_BUFFER_SIZE){
         return false;
     }
 
+    // 🔬 一个新请求的第一次读：决定要不要记它的时间线
+    if(!m_trace.started){
+        m_trace.started=true;
+        m_trace.active=trace_should_sample();
+        m_trace.ready=m_ready_time;
+        TRACE_PROBE1(request_start,m_sockfd);
+    }
+    PHASE_ENTER(PHASE_READ,read_start);
+    int start=m_read_idx;
+
+    // 🔐 HTTPS 连接：数据要先经过 OpenSSL 解密
+    if(m_ssl){
+        bool ok=tls_read();
+        if(ok){
+            capture_read(start);
+        }
+        PHASE_LEAVE(PHASE_READ,read_done);
+        return ok;
+    }
+
     int bytes_read=0;// 这次 recv 读到了多少字节
 
     // 🔄 开启循环
     while(true){
+        // 缓冲区满了就先停 (不能拿 0 长度去 recv，那样会返回 0 被当成对方关闭)
+        // HTTP/2 模式下 process 消费完会重新注册 EPOLLIN，剩下的数据下一轮再读
+        if(m_read_idx>=READ_BUFFER_SIZE){
+            break;
+        }
+
         // 1. m_read_buf + m_read_idx: 存到哪？(注意要接着上次写的地方往后写，不能覆盖！)
         // 2. READ_BUFFER_SIZE - m_read_idx: 还能存多少？(防止越界)
         bytes_read=recv(m_sockfd, m_read_buf+m_read_idx, READ_BUFFER_SIZE-m_read_idx,0);
@@ -178,80 +383,170 @@ bool http_conn::read_once(){
         m_read_idx+=bytes_read;
     }
 
+    capture_read(start);
+    PHASE_LEAVE(PHASE_READ,read_done);
     return true;
 }
 
+// 🎙️ 只记 HTTP/1.x 的字节流：切到 HTTP/2 / WebSocket 以后回放工具也不认了
+// 丢过一段的连接 (积压太多) 不再记：后面的字节接不上了
+void http_conn::capture_read(int start){
+    if(m_capture_id&&m_read_idx>start&&!m_h2&&!m_ws){
+        if(!capture_write(m_capture_id,m_read_buf+start,m_read_idx-start)){
+            m_capture_id=0;
+        }
+    }
+}
+
 // 📤 往 socket 里写数据
 // 返回 true: 没出错 (至于发没发完，不一定，可能要等下一轮 Epoll 通知)
 // 返回 false: 出错了 (比如对方关连接了)
 bool http_conn::write(){
-    int temp=0;
+
+    // 🚄 HTTP/2：发送队列交给会话自己去 flush
+    if(m_h2){
+        int ret=m_h2->flush(m_sockfd);
+        if(ret<0||m_h2->finished()){
+            return false;
+        }
+        arm(ret>0?(EPOLLIN|EPOLLOUT):EPOLLIN);
+        return true;
+    }
+
+    // 🔌 WebSocket：接着发积压的消息，发完了只等 EPOLLIN (不回到 init()，连接一直是 WebSocket)
+    if(m_ws){
+        ws_flush(true);
+        return true;
+    }
+
+    // 🧵 协程 handler 卡在 write 上：接着发，发完了叫醒它
+    if(m_co){
+        if(m_co_wait==CO_WAIT_WRITE){
+            m_co_writer->state=co_send(m_co_writer->iov,m_co_writer->count);
+            if(m_co_writer->state==0){
+                arm(EPOLLOUT);
+                return true;
+            }
+            co_resume();
+        }else if(m_co_wait==CO_WAIT_DRAIN){
+            // 🚰 流式发送：降到低水位以下 (或者出错了) 才叫醒 handler 接着产生数据
+            if(flush_out()<0){
+                m_co_failed=true;
+            }else if(m_out.size()>m_co_drain_limit){
+                arm(EPOLLOUT);
+                return true;
+            }
+            co_resume();
+        }
+        return true;
+    }
+
+    // 🔐 握手还没完 (上次卡在写上)：接着握手
+    if(m_ssl&&m_tls_state==TLS_HANDSHAKE){
+        if(!tls_handshake()){
+            return false;
+        }
+        arm(m_tls_want_write?EPOLLOUT:EPOLLIN);
+        return true;
+    }
 
     // 如果没啥要发的，那就算发完了
-    if(bytes_to_send==0){
+    if(m_out.empty()){
         // 既然发完了，就重新设置 Epoll 监听“读事件”，准备接收下一次请求
-        modfd(m_epollfd,m_sockfd,EPOLLIN);
+        arm(EPOLLIN);
+        init();
+        return true;
+    }
+
+    int ret=flush_out();
+
+    // 🛑 情况 A: 写缓冲区满了 (EAGAIN)
+    // 也就是 TCP 发送窗口满了，塞不进去了
+    if(ret==0){
+        // 既然现在塞不进去，那就先设为监听“写事件” (EPOLLOUT)
+        // 等缓冲区空了，Epoll 会自动叫醒我们，那时候再接着发
+        arm(EPOLLOUT);
+        return true;
+    }
+
+    // 🛑 情况 B: 真出错了 (比如发送过程中对方断开了)
+    if(ret<0){
+        return false;
+    }
+
+    // 🏁 所有的都发完了
+    trace_finish();
+
+    // 决定下一步：是保持连接还是断开？
+    // m_linger 是之前解析 HTTP 头解析出来的 Connection: keep-alive
+    if(m_linger){
+        // 如果是长连接：重置为读模式，准备读下一个请求
         init();
+        arm(EPOLLIN);
         return true;
+    }else{
+        // 如果是短连接：直接返回 false，让上层调用 close_conn
+        arm(EPOLLIN);
+        return false;
     }
+}
 
+// 📤 把 m_out 链上的数据尽量发出去 (write() 和流式发送共用)
+// 返回 1: 全发完了  0: 发不动了 (EAGAIN)，剩下的还在链上  -1: 出错了，链已经清空
+int http_conn::flush_out(){
+    if(m_out.empty()){
+        return 1;
+    }
+    PHASE_ENTER(PHASE_WRITE,write_start);
+    // 顺手把已经到了的零拷贝完成通知收掉，早点把内存还回去
+    if(m_out.zerocopy_pending()){
+        reap_zerocopy();
+    }
+    struct iovec iov[IOV_MAX];
     while(true){
         // writev (分散写)
-        // 把 m_iv 数组里记录的多个内存块，一次性发给 socket
-        temp=writev(m_sockfd,m_iv,m_iv_count);
+        // 把 m_out 链上的多段数据 (响应头、文件……) 一次性发给 socket
+        // (HTTPS 且没有 kTLS 时，send_iov 内部换成 SSL_write)
+        // (够大的话换成 sendmsg(MSG_ZEROCOPY)，内核直接拿这些页去发，不再拷一遍)
+        // (前面的内存段都发完了，轮到大文件：换成 sendfile，一次一个窗口)
+        int count=m_out.fill_iov(iov,IOV_MAX);
+        bool zerocopy=false;
+        ssize_t temp;
+        if(count==0){
+            temp=send_file();
+        }else{
+            zerocopy=want_zerocopy();
+            temp=zerocopy?send_zerocopy(iov,count):-1;
+            if(zerocopy&&temp<0&&errno==ENOBUFS){
+                zerocopy=false; // 能锁的页用完了 (optmem_max / RLIMIT_MEMLOCK)：这一次先拷贝
+            }
+            if(!zerocopy){
+                temp=send_iov(iov,count);
+            }
+        }
 
-        if(temp<-1){
-            // 🛑 情况 A: 写缓冲区满了 (EAGAIN)
-            // 也就是 TCP 发送窗口满了，塞不进去了
+        if(temp<0){
             if(errno==EAGAIN){
-                // 既然现在塞不进去，那就先设为监听“写事件” (EPOLLOUT)
-                // 等缓冲区空了，Epoll 会自动叫醒我们，那时候再接着发
-                modfd(m_epollfd,m_sockfd,EPOLLOUT);
-                return true;
+                m_trace.write_waits++;
+                TRACE_PROBE2(write_eagain,m_sockfd,m_out.size());
+                return 0;
             }
-            // 🛑 情况 B: 真出错了 (比如发送过程中对方断开了)
-            unmap(); //释放文件内存映射
-            return false;
+            m_out.clear(); // 链上的文件映射、内存块都放掉
+            return -1;
         }
 
         // ✅ 成功发送了 temp 字节
-        bytes_have_send+=temp;
-        bytes_to_send-=temp;
-
-        // 更新 iovec 指针
-        // 因为 writev 不保证一次全发完，如果发了一半被截断了，
-        // 下次必须从“断点”继续发，不能重头再来！
-
-        // 情况 1: 头部 (iv[0]) 已经发完了，现在发的是文件 (iv[1])
-        if(bytes_have_send>=m_iv[0].iov_len){
-            // 头部发完了，那就把 iv[0] 废掉 (长度设为0)
-            m_iv[0].iov_len=0;
-            // 计算文件还剩多少没发，起始位置往后移
-            // file_address + (已经发的总数 - 头部长度)
-            m_iv[1].iov_base=m_file_address+(bytes_have_send-m_write_idx);
-            m_iv[1].iov_len=bytes_to_send;
-        }else{// 情况 2: 头部都没发完 （bytes_have_send < m_write_idx）
-            // 头部起始位置往后移
-            m_iv[0].iov_base=m_write_buf+bytes_have_send;
-            m_iv[0].iov_len=m_iv[0].iov_len-temp;
-        }
-
-        // 🏁 所有的都发完了
-        if(bytes_to_send<=0){
-            unmap();// 释放文件内存
-
-            // 决定下一步：是保持连接还是断开？
-            // m_linger 是之前解析 HTTP 头解析出来的 Connection: keep-alive
-            if(m_linger){
-                // 如果是长连接：重置为读模式，准备读下一个请求
-                init();
-                modfd(m_epollfd,m_sockfd,EPOLLIN);
-                return true;
-            }else{
-                // 如果是短连接：直接返回 false，让上层调用 close_conn
-                modfd(m_epollfd,m_sockfd,EPOLLIN);
-                return false;
-            }
+        // writev 不保证一次全发完，如果发了一半被截断了，
+        // 下次必须从“断点”继续发：整段发完的从链上摘掉，发了一半的那段往后挪
+        if(zerocopy){
+            m_out.consume_zerocopy(temp);   // 发完的段先停着，等完成通知
+        }else{
+            m_out.consume(temp);
+        }
+
+        if(m_out.empty()){
+            PHASE_LEAVE(PHASE_WRITE,write_done);
+            return 1;
         }
     }
 }
@@ -263,32 +558,125 @@ bool http_conn::write(){
 // ⚙️ 处理 HTTP 请求的入口函数
 void http_conn::process(){
 
-    // 1. 【读解析】分析 HTTP 请求
-    // process_read 是接下来要写的核心大函数
-    // 它会返回一个“状态码”，告诉我们请求分析得怎么样了
-    HTTP_CODE read_ret=process_read();
+    // 🔐 HTTPS 还在握手：没有 HTTP 数据可以解析，等下一轮事件
+    if(m_ssl&&m_tls_state==TLS_HANDSHAKE){
+        arm(m_tls_want_write?EPOLLOUT:EPOLLIN);
+        return;
+    }
+
+    // 🔌 已经升级成 WebSocket 了：读到的都是帧
+    if(m_ws){
+        process_ws();
+        return;
+    }
+
+    // 🚄 已经是 HTTP/2 连接了，或者客户端一上来就发 HTTP/2 前言 (prior knowledge)
+    // (h2c 只在明文连接上做，HTTPS 上的 HTTP/2 需要 ALPN 协商)
+    if(!m_h2&&!m_ssl&&m_check_state==CHECK_STATE_REQUESTLINE&&m_start_line==0){
+        bool complete;
+        if(is_h2_preface(complete)){
+            if(!complete){
+                arm(EPOLLIN); // 前言还没收全
+                return;
+            }
+            m_h2=new h2_session();
+            m_h2->start();
+        }
+    }
+    if(m_h2){
+        process_h2();
+        return;
+    }
+
+    // 🧵 协程 handler 在等请求体：新数据到了，叫醒它
+    if(m_co&&m_co_wait==CO_WAIT_BODY){
+        co_resume();
+        return;
+    }
+
+    // 0. 【过载保护】先看看这个请求排了多久的队
+    // 如果 CoDel 判定队列已经堵死了，就别浪费时间解析了，直接回 503，
+    // 并且关掉这个长连接，把位置让出来
+    // 每个请求只在读到第一段数据时判一次：分几次才读全的请求，前面的段已经收下了，后面不能再丢
+    HTTP_CODE read_ret;
+    long long now=now_us();
+    long long sojourn=(m_ready_time>0)?(now-m_ready_time):0;
+    m_ready_time=0;
+    bool first_read=!m_co&&!m_codel_checked;
+    m_codel_checked=true;
+
+    if(first_read&&codel_should_shed(now,sojourn)){
+        m_linger=false;
+        read_ret=SERVICE_UNAVAILABLE;
+    }else{
+        // 1. 【读解析】分析 HTTP 请求
+        // process_read 是接下来要写的核心大函数
+        // 它会返回一个“状态码”，告诉我们请求分析得怎么样了
+        PHASE_ENTER(PHASE_PARSE,parse_start);
+        switch(m_parser){
+            case PARSER_GENERIC: read_ret=process_read<parse_generic>(); break;
+            case PARSER_EDGE:    read_ret=process_read<parse_edge>(); break;
+            default:             read_ret=process_read<parse_verbose>(); break;
+        }
+        PHASE_LEAVE(PHASE_PARSE,parse_done);
+    }
+
+    // 🚪 正在排空 (准备退出)：这个请求照常回复，但回完就挂断
+    if(m_draining){
+        m_linger=false;
+    }
+
+    // 🔌 WebSocket 升级：排空的时候不接新的长连接了
+    if(read_ret==WS_REQUEST){
+        if(!m_draining){
+            upgrade_ws();
+            return;
+        }
+        read_ret=SERVICE_UNAVAILABLE;
+    }
+
+    // 🚄 客户端要求 "Upgrade: h2c"：这个请求改用 HTTP/2 来回复 (带请求体的就不升级了)
+    if(m_upgrade_h2c&&!m_ssl&&!m_draining&&read_ret!=NO_REQUEST&&read_ret!=CO_REQUEST&&read_ret!=SERVICE_UNAVAILABLE
+        &&read_ret!=BAD_REQUEST&&m_content_length==0){
+        upgrade_h2c();
+        return;
+    }
 
     // 🛑 情况 A: 请求不完整 (NO_REQUEST)
     // 比如客户只发了 "GET /ind"，还没发完。
     // 这时候不能急着处理，得继续监听“读事件”，等客户把剩下的发过来。
     if(read_ret==NO_REQUEST){
-        modfd(m_epollfd,m_sockfd,EPOLLIN);
+        arm(EPOLLIN);
+        return;
+    }
+
+    // 🧵 交给协程 handler：第一次就创建，已经在等请求头的就叫醒
+    if(read_ret==CO_REQUEST){
+        if(m_co){
+            co_resume();
+        }else{
+            co_start();
+        }
         return;
     }
+    co_cancel(); // 请求头有问题，协程也不用等了，下面照常回错误页
 
     // 2. 【写准备】生成 HTTP 响应
     // 比如根据 read_ret 生成 "200 OK" 或者 "404 Not Found"
+    PHASE_ENTER(PHASE_PROCESS_WRITE,process_write_start);
     bool write_ret=process_write(read_ret);
+    PHASE_LEAVE(PHASE_PROCESS_WRITE,process_write_done);
 
     // 🛑 情况 B: 响应生成失败
     if(!write_ret){
         close_conn(); // 既然没法回复，就关掉连接
+        return;
     }
 
     // ✅ 情况 C: 响应准备好了
     // 告诉 Epoll：“我这边数据准备好了，一旦网卡空闲，就提醒我发送 (EPOLLOUT)”
     // 只要 Epoll 触发 EPOLLOUT，主线程就会去调用我们之前写的 write() 函数
-    modfd(m_epollfd,m_sockfd,EPOLLOUT);
+    arm(EPOLLOUT);
 }
 
 // =================================================================
@@ -297,70 +685,113 @@ void http_conn::process(){
 
 // 三个分析函数⬇️
 
+// 🧩 每个函数都按解析策略 P (见 parser_policy.h) 编出一份：
+// 下面所有 P::XXX 都是编译期常量，if constexpr 掉的分支在那一份里根本不存在
+
+// 🔤 请求方法 (策略里没开的方法连比较都不比)
+template<class P>
+static inline bool parse_method(const char* text,size_t len,METHOD& method){
+    if constexpr((P::METHODS&METHOD_BIT(GET))!=0){
+        if(token_eq<P::CASELESS>(text,len,"GET",3)){
+            method=GET;
+            return true;
+        }
+    }
+    if constexpr((P::METHODS&METHOD_BIT(POST))!=0){
+        if(token_eq<P::CASELESS>(text,len,"POST",4)){
+            method=POST;
+            return true;
+        }
+    }
+    // HEAD 还不能开：process_write 不会把响应体去掉
+    return false;
+}
+
+// 🔤 版本号
+template<class P>
+static inline bool parse_version(const char* version){
+    size_t len=strlen(version);
+    if(token_eq<P::CASELESS>(version,len,"HTTP/1.1",8)){
+        return true;
+    }
+    if constexpr(P::HTTP10){
+        return token_eq<P::CASELESS>(version,len,"HTTP/1.0",8);
+    }
+    return false;
+}
+
+// 宽松的策略：空格和 tab 都算分隔；严格的：只认一个空格
+template<class P>
+static inline char* find_sep(char* text){
+    return P::STRICT?strchr(text,' '):strpbrk(text," \t");
+}
+
 // (State 1)解析请求行 
 // 📝 解析 HTTP 的第一行
 // 目标格式: GET /index.html HTTP/1.1
+template<class P>
 HTTP_CODE http_conn::parse_request_line(char* text){
 
     // 1. 解析请求方法 (GET/POST)
     // m_url 此时指向字符串开头
     // strpbrk: 在 text 中寻找第一个 ' ' 或 '\t' 的位置
-    m_url=strpbrk(text,"\t");
+    m_url=find_sep<P>(text);
 
     // 如果没找到空格，说明格式不对 (HTTP 请求行里必须有空格分隔)
     if(!m_url){
         return BAD_REQUEST;
     }
 
+    // 取出前面的方法存起来 (策略里没开的方法回 400，原来的解析器只支持 GET 和 POST)
+    if(!parse_method<P>(text,m_url-text,m_method)){
+        return BAD_REQUEST;
+    }
+
     // 把找到的那个空格变成 \0，这样前面的字符串就“断开”了
     // 此时 text 变成了 "GET\0/index.html HTTP/1.1"
     *m_url++='\0';
 
-    // 取出前面的方法存起来
-    char* method=text;
-    if(strcasecmp(method,"GET")==0){
-        m_method=GET;
-    }else if(strcasecmp(method,"POST")==0){
-        m_method=POST;
-    }else{
-        return BAD_REQUEST;// 目前只支持 GET 和 POST
-    }
-
     // 2. 解析版本号 (HTTP/1.1)
     // m_url 现在指向 "/index.html HTTP/1.1" (刚才跳过了第一个空格)
     // strspn: 检索字符串中第一个不在 " \t" 中出现的字符下标 -> 也就是跳过连续的空格
-    m_url+=strspn(m_url,"\t");
+    if constexpr(!P::STRICT){
+        m_url+=strspn(m_url," \t");
+    }
 
     // 继续找下一个空格，分隔 URL 和 Version
-    m_version=strpbrk(m_url,"\t");
+    m_version=find_sep<P>(m_url);
     if(!m_version){
         return BAD_REQUEST;
     }
 
     // 同样，把空格变 \0，截断 URL
-    *m_version='\0';
+    *m_version++='\0';
 
     // m_version 现在指向 "HTTP/1.1"
-    m_version+=strspn(m_version,"\t"); // 跳过空格
+    if constexpr(!P::STRICT){
+        m_version+=strspn(m_version," \t"); // 跳过空格
+    }
 
-    // 检查版本号是不是 HTTP/1.1
-    if(strcasecmp(m_version,"HTTP/1.1")!=0){
+    // 检查版本号是不是 HTTP/1.1 (策略开了 HTTP10 的话 HTTP/1.0 也行)
+    if(!parse_version<P>(m_version)){
         return BAD_REQUEST;
     }
 
     // 3. 解析 URL (/index.html)
     // 有些客户端发的 URL 可能会带上协议头，比如 http://192.168.1.1/index.html
     // 我们需要把前面的 http:// 剔除掉，只保留 /index.html
-    if(strncasecmp(m_url,"http://",7)==0){
-        m_url+=7; // 跳过 http://
-        // 找域名的结束位置 (第一个 /)
-        m_url=strchr(m_url,'/');
-    }
+    if(m_url[0]!='/'){
+        if(strncasecmp(m_url,"http://",7)==0){
+            m_url+=7; // 跳过 http://
+            // 找域名的结束位置 (第一个 /)
+            m_url=strchr(m_url,'/');
+        }
 
-    // 同样的逻辑处理 https
-    if(strncasecmp(m_url,"https://",8)==0){
-        m_url+=8;
-        m_url=strchr(m_url,'/');
+        // 同样的逻辑处理 https
+        else if(strncasecmp(m_url,"https://",8)==0){
+            m_url+=8;
+            m_url=strchr(m_url,'/');
+        }
     }
 
     // 正常情况下，URL 应该是 / 开头的
@@ -368,10 +799,14 @@ HTTP_CODE http_conn::parse_request_line(char* text){
         return BAD_REQUEST;
     }
 
-    // ⚠️ 特殊处理：如果你直接访问 http://localhost/，默认给你看 index.html
-    if(strlen(m_url)==1){
-        strcat(m_url,"index.html");
+    // 🧭 就地解码 + 规范化，顺便切出查询串 (/a/./b、/a//b、/a/%62 都变成 /a/b)
+    // 退到根目录外面去的 (/../etc/passwd) 这里就挡掉了
+    // 以前 "/" 在这里 strcat 成 /index.html (写过了 URL 的结尾)，现在交给 open_static_file
+    url_view view;
+    if(!url_canonicalize(m_url,view)){
+        return BAD_REQUEST;
     }
+    m_query=view.query;
 
     // ✅ 解析完毕！
     // 状态转移：请求行分析完了，下一步该分析“头部字段”了
@@ -383,6 +818,9 @@ HTTP_CODE http_conn::parse_request_line(char* text){
 // 解析头部字段 (State 2)
 // 📨 解析 HTTP 头部的一行
 // 例子: "Connection: keep-alive"
+// 以前是一长串 strncasecmp(text,"Xxx:",n) 挨个试；现在先找冒号，按名字的长度分派，
+// 同样长度的最多比两次 (名字后面必须紧跟冒号，和原来一样)
+template<class P>
 HTTP_CODE http_conn::parse_headers(char* text){
 
     // 🟢 情况 1: 遇到空行 (最关键的逻辑！)
@@ -402,39 +840,169 @@ HTTP_CODE http_conn::parse_headers(char* text){
         return GET_REQUEST;
     }
 
-    // 🟢 情况 2: 处理 Connection 头部
-    // strncasecmp: 比较前 11 个字符是不是 "Connection:"
-    else if(strncasecmp(text,"Connection:",11)==0){
-        text+=11;   // 跳过 "Connection:"
-        text+=strspn(text,"\t");// 跳过冒号后面的空格
+    if constexpr(P::MAX_HEADERS>0){
+        if(++m_header_count>P::MAX_HEADERS){
+            return BAD_REQUEST;
+        }
+    }
 
-        // 看看值是不是 keep-alive
-        if(strcasecmp(text,"keep-alive")==0){
-            m_linger=true; // 记下来：这是一个长连接
+    char* colon=strchr(text,':');
+    if(!colon){
+        if constexpr(P::STRICT){
+            return BAD_REQUEST;
+        }
+        if constexpr(P::LOG){
+            printf("oop! unknown header: %s\n", text);
+        }
+        return NO_REQUEST;
+    }
+    size_t name_len=colon-text;
+    if constexpr(P::STRICT){
+        // "Host : x" (冒号前面有空白) 和续行 (空白开头) 都是 RFC 7230 要求拒掉的
+        if(name_len==0||text[0]==' '||text[0]=='\t'||colon[-1]==' '||colon[-1]=='\t'){
+            return BAD_REQUEST;
         }
     }
+    char* value=colon+1;
+    value+=strspn(value," \t");    // 跳过冒号后面的空格
+
+    switch(name_len){
+        // 🟢 情况 2: 处理 Host 头部
+        case 4:{
+            if constexpr((P::CAPTURE&CAP_HOST)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Host",4)){
+                    m_host=value;
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+
+        // 🟢 情况 3: Content-Type / Cookie (只记下位置，FastCGI 后端要用)
+        case 6:{
+            if constexpr((P::CAPTURE&CAP_COOKIE)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Cookie",6)){
+                    m_cookie=value;
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+        case 12:{
+            if constexpr((P::CAPTURE&CAP_CONTENT_TYPE)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Content-Type",12)){
+                    m_content_type=value;
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
 
-    // 🟢 情况 3: 处理 Content-Length 头部
-    else if(strncasecmp(text,"Content-Length:",15)==0){
-        text+=15;
-        text+=strspn(text,"\t");
+        // 🟢 情况 4: 处理 Connection 头部
+        case 10:{
+            if constexpr((P::CAPTURE&CAP_CONNECTION)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Connection",10)){
+                    // 看看值是不是 keep-alive
+                    if(strcasecmp(value,"keep-alive")==0){
+                        m_linger=true; // 记下来：这是一个长连接
+                    }
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
 
-        // atol: ASCII to Long (把字符串 "1024" 转换成数字 1024)
-        m_content_length=atol(text);
-    }
+        // 🟢 情况 5: 处理 Content-Length 头部 (哪个策略都认，不分大小写)
+        case 14:{
+            if(token_eq<true>(text,name_len,"Content-Length",14)){
+                // 只认纯数字，哪个策略都一样：以前用 atol，"-100000" 变成负数，拿去当下标直接写到缓冲区前面去了；
+                // "12abc" 变成 12、太长的数字溢出，请求在哪结束就和前面的代理理解得不一样 (请求走私)
+                size_t digits=strspn(value,"0123456789");
+                const char* rest=value+digits;
+                if constexpr(!P::STRICT){
+                    rest+=strspn(rest," \t");     // 宽松的策略：后面跟着空白也行
+                }
+                if(digits==0||*rest!='\0'){
+                    return BAD_REQUEST;
+                }
+                long long len=0;
+                for(size_t i=0;i<digits;i++){
+                    len=len*10+(value[i]-'0');
+                    if(len>MAX_CONTENT_LENGTH){
+                        return BAD_REQUEST;
+                    }
+                }
+                m_content_length=(int)len;
+                return NO_REQUEST;
+            }
+            if constexpr((P::CAPTURE&CAP_H2_SETTINGS)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"HTTP2-Settings",14)){
+                    m_h2_settings=value;
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+
+        // 🟢 情况 6: 处理 Accept-Encoding 头部 (打包文件里有 gzip 版本时用得上)
+        case 15:{
+            if constexpr((P::CAPTURE&CAP_ACCEPT_ENCODING)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Accept-Encoding",15)){
+                    if(strstr(value,"gzip")){
+                        m_accept_gzip=true;
+                    }
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
 
-    // 🟢 情况 4: 处理 Host 头部
-    else if(strncasecmp(text,"Host:",5)==0){
-        text+=5;
-        text+=strspn(text,"\t");
-        m_host=text;
+        // 🟢 情况 7: 处理 HTTP/2 / WebSocket 升级 (Upgrade: h2c + HTTP2-Settings)
+        case 7:{
+            if constexpr((P::CAPTURE&CAP_UPGRADE)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Upgrade",7)){
+                    if(strcasecmp(value,"h2c")==0){
+                        m_upgrade_h2c=true;
+                    }else if(strcasecmp(value,"websocket")==0){
+                        m_upgrade_ws=true;
+                    }
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+        case 17:{
+            // 严格的策略不收 chunked 的请求体：这里不会解，让它过去的话请求体会被当成下一个请求
+            if constexpr(P::STRICT){
+                if(token_eq<true>(text,name_len,"Transfer-Encoding",17)){
+                    return BAD_REQUEST;
+                }
+            }
+            if constexpr((P::CAPTURE&CAP_WS_KEY)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Sec-WebSocket-Key",17)){
+                    m_ws_key=value;
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+        case 21:{
+            if constexpr((P::CAPTURE&CAP_WS_VERSION)!=0){
+                if(token_eq<P::CASELESS>(text,name_len,"Sec-WebSocket-Version",21)){
+                    m_ws_version_ok=(strcmp(value,"13")==0);
+                    return NO_REQUEST;
+                }
+            }
+            break;
+        }
+        default:
+            break;
     }
 
-    // 🟢 情况 5: 其他头部 (User-Agent, Accept 等)
-    else{
+    // 🟢 情况 8: 其他头部 (User-Agent, Accept 等)，以及策略里没让记的
+    if constexpr(P::LOG){
         printf("oop! unknown header: %s\n", text);
     }
-
     return NO_REQUEST;
 }
 
@@ -447,6 +1015,12 @@ HTTP_CODE http_conn::parse_content(char* text){
     // m_checked_idx: 当前已经分析完的长度 (也就是 头部总长度) body开始的位置
     // m_content_length: 刚才在 Header 里读出来的，客户承诺要发的数据量
 
+    // 请求体要和头部一起放在读缓冲区里，后面还要补一个 '\0'：放不下的直接拒掉
+    // (不拒的话：刚好填满时 '\0' 写到缓冲区外面去；更大的永远收不齐，干等到缓冲区满了被挂断)
+    if(m_checked_idx+m_content_length>=READ_BUFFER_SIZE){
+        return BAD_REQUEST;
+    }
+
     // 公式：如果 (现在读到的总数) >= (头部长度 + 身体长度)
     if(m_read_idx>=(m_content_length+m_checked_idx)){
         text[m_content_length]='\0'; // 方便去打印日志
@@ -457,6 +1031,7 @@ HTTP_CODE http_conn::parse_content(char* text){
 }
 
 // 🧠 核心大脑：分析 HTTP 请求
+template<class P>
 HTTP_CODE http_conn::process_read(){
 
     // 这两个变量是用来记录“切行”的结果
@@ -472,18 +1047,29 @@ HTTP_CODE http_conn::process_read(){
         // get_line() 是一个小函数，其实就是 return m_read_buf + m_start_line;
         text=get_line();
 
+        // 📏 策略限制了一行的长度 (请求行和每个头都算，请求体不算)
+        if constexpr(P::MAX_LINE>0){
+            if(m_check_state!=CHECK_STATE_CONTENT&&m_checked_idx-m_start_line>P::MAX_LINE){
+                return BAD_REQUEST;
+            }
+        }
+
         // 既然切出了一行，为了下一次切行做准备，把 m_start_line 更新一下
         m_start_line=m_checked_idx;
 
-        // 打印日志 (可选)：看看这一行是啥
-        printf("got 1 http line: %s\n", text);
+        // 打印日志 (可选)：看看这一行是啥 (请求体不是“一行”，收齐之前后面也没有 '\0'，不打)
+        if constexpr(P::LOG){
+            if(m_check_state!=CHECK_STATE_CONTENT){
+                printf("got 1 http line: %s\n", text);
+            }
+        }
 
         // 🔀 状态机核心：根据当前状态，决定怎么处理这一行
         switch(m_check_state){
 
             // 🏷️ 状态 1: 正在分析请求行 (例: "GET /index.html HTTP/1.1")
             case CHECK_STATE_REQUESTLINE:{
-                ret=parse_request_line(text); // 调用子函数分析
+                ret=parse_request_line<P>(text); // 调用子函数分析
                 if(ret==BAD_REQUEST){
                     return BAD_REQUEST; // 格式错了，直接报错
                 }
@@ -492,14 +1078,32 @@ HTTP_CODE http_conn::process_read(){
 
             // 📨 状态 2: 正在分析头部字段 (例: "Host: localhost")
             case CHECK_STATE_HEADER:{
-                ret=parse_headers(text);
+                ret=parse_headers<P>(text);
                 if(ret==BAD_REQUEST){
                     return BAD_REQUEST;
                 }
                 // 关键点：如果 parse_headers 返回 GET_REQUEST，说明头读完了！
-                else if(ret==GET_REQUEST){
-                    // 也就是遇到了 ！！！！空行 ！！！！，意味着请求解析完毕，可以去准备响应了
-                    return do_request();
+                else if(ret==GET_REQUEST||m_check_state==CHECK_STATE_CONTENT){
+                    // 🔌 WebSocket 升级：只认没有请求体的 GET，URL 要命中 ws_route
+                    if(ret==GET_REQUEST&&m_upgrade_ws&&m_method==GET){
+                        m_ws_channel=ws_find_route(m_url);
+                        if(m_ws_channel>=0){
+                            bool valid=m_ws_key&&strlen(m_ws_key)==24&&m_ws_version_ok;
+                            return valid?WS_REQUEST:BAD_REQUEST;
+                        }
+                    }
+                    // 🧵 有协程 handler 认领这个 URL：请求体 (如果有) 交给它自己用 read_body 去读
+                    m_co_fn=co_find_route(m_url);
+                    if(m_co_fn){
+                        return CO_REQUEST;
+                    }
+                    if(ret==GET_REQUEST){
+                        // 也就是遇到了 ！！！！空行 ！！！！，意味着请求解析完毕，可以去准备响应了
+                        PHASE_ENTER(PHASE_DO_REQUEST,do_request_start);
+                        ret=do_request();
+                        PHASE_LEAVE(PHASE_DO_REQUEST,do_request_done);
+                        return ret;
+                    }
                 }
                 break;
             }
@@ -507,8 +1111,15 @@ HTTP_CODE http_conn::process_read(){
             // 📦 状态 3: 正在分析请求体 (仅 POST 请求会用到)
             case CHECK_STATE_CONTENT:{
                 ret=parse_content(text);
+                if(ret==BAD_REQUEST){
+                    return BAD_REQUEST;
+                }
                 if(ret==GET_REQUEST){
-                    return do_request(); // 体也读完了，去准备响应
+                    // 体也读完了，去准备响应
+                    PHASE_ENTER(PHASE_DO_REQUEST,do_request_start);
+                    ret=do_request();
+                    PHASE_LEAVE(PHASE_DO_REQUEST,do_request_done);
+                    return ret;
                 }
                 // 如果返回 LINE_OPEN，说明体还没传完，得跳出循环继续读 socket
                 line_status=LINE_OPEN;
@@ -522,12 +1133,29 @@ HTTP_CODE http_conn::process_read(){
         }
     }
 
+    // 🚫 切行切出了语法错误 (单独的 \n、\r 后面不是 \n)：再等多少数据这一行也好不了，直接 400
+    // (以前这里也落到下面的 NO_REQUEST，连接就挂着等超时，读缓冲区一直占着)
+    if(line_status==LINE_BAD){
+        return BAD_REQUEST;
+    }
+
     // 🛑 循环结束了，通常是因为 parse_line 返回了 LINE_OPEN (数据不完整，只有半行)
     // 或者是 buffer 读空了。
     // 告诉上层：还没处理完，继续监听 socket，等剩下的数据发过来。
     return NO_REQUEST;
 }
 
+// 🧩 每个策略显式实例化一份 (parser_bench.cpp 也要链接到这几份)
+template HTTP_CODE http_conn::process_read<parse_verbose>();
+template HTTP_CODE http_conn::process_read<parse_generic>();
+template HTTP_CODE http_conn::process_read<parse_edge>();
+template HTTP_CODE http_conn::parse_request_line<parse_verbose>(char*);
+template HTTP_CODE http_conn::parse_request_line<parse_generic>(char*);
+template HTTP_CODE http_conn::parse_request_line<parse_edge>(char*);
+template HTTP_CODE http_conn::parse_headers<parse_verbose>(char*);
+template HTTP_CODE http_conn::parse_headers<parse_generic>(char*);
+template HTTP_CODE http_conn::parse_headers<parse_edge>(char*);
+
 // =================================================================
 // 7. 从状态机：切行 (把一行数据从缓冲区切出来)
 // =================================================================
@@ -590,82 +1218,174 @@ LINE_STATUS http_conn::parse_line(){
 // 8. 业务逻辑核心：处理请求 (do_request)
 // =================================================================
 
-// 📂 网站根目录 (存放 html, 图片等资源的文件夹路径)
-const char* doc_root="/Users/neroji/Desktop/MyTinyServer/resource file";
-
 HTTP_CODE http_conn::do_request(){
+    // 用户态加密的 HTTPS 只能拿内存里的数据去 SSL_write，不能 sendfile
+    return open_static_file(m_url,m_accept_gzip,m_file,!m_ssl||m_ktls_send);
+}
+
+// 🛡️ 相对 doc_root 打开文件，保证打开的东西一定在 doc_root 下面：
+// RESOLVE_BENEATH 让内核在解析路径时就拒绝 ".."、绝对路径和指到外面去的软链接 (返回 EXDEV)，
+// 不用担心检查完路径到打开之间被人换了软链接。老内核没有 openat2 就退回 openat
+// (这时只靠 url_canonicalize 挡 ".."，挡不住指到外面的软链接)
+static int open_beneath(int dirfd,const char* rel){
+    static std::atomic<bool> no_openat2(false);
+    if(!no_openat2.load(std::memory_order_relaxed)){
+        struct open_how how;
+        memset(&how,0,sizeof(how));
+        how.flags=O_RDONLY|O_CLOEXEC|O_NONBLOCK;
+        how.resolve=RESOLVE_BENEATH;
+        int fd=(int)syscall(SYS_openat2,dirfd,rel,&how,sizeof(how));
+        if(fd>=0||errno!=ENOSYS){
+            return fd;
+        }
+        no_openat2.store(true,std::memory_order_relaxed);
+    }
+    return openat(dirfd,rel,O_RDONLY|O_CLOEXEC|O_NONBLOCK);
+}
+
+HTTP_CODE open_static_file(const char* url,bool accept_gzip,static_file& file,bool allow_sendfile){
 
-    // m_real_file: 最终的物理路径 (doc_root + m_url)
-    // 先把根目录拷进去
-    strcpy(m_real_file,doc_root);
-    int len=strlen(doc_root);
+    // 📂 网站根目录 (存放 html, 图片等资源的文件夹路径)
+    // 从当前配置里拿一份快照，SIGHUP 热更新也不会影响正在处理的这个请求
+    std::shared_ptr<const server_config> conf=current_config();
+
+    // url 已经规范化过了 (见 url.h)：'/' 开头，没有 "." ".." 段
+    // 以 '/' 结尾的 (包括 "/" 本身) 默认给这个目录下的 index.html
+    char rel[FILENAME_LEN];
+    int n=snprintf(rel,FILENAME_LEN,"%s%s",url,url[strlen(url)-1]=='/'?"index.html":"");
+    if(n>=FILENAME_LEN){
+        return NO_RESOURCE; // 路径太长，截断了就不是那个文件了
+    }
+
+    // 📦 配置了打包文件：直接在内存索引里查，一个系统调用都不用
+    if(conf->pack){
+        const pack_entry* e=conf->pack->find(rel,n);
+        if(!e){
+            return NO_RESOURCE;
+        }
+        file.pack=conf->pack;
+        file.gzip=(accept_gzip&&e->has_gzip);
+        file.variant=file.gzip?&e->gzip:&e->plain;
+        file.address=(char*)file.pack->data_at(file.variant->body_off);
+        file.size=file.variant->body_len;
+        return FILE_REQUEST;
+    }
+    if(!conf->root){
+        return NO_RESOURCE; // doc_root 打不开
+    }
 
-    // 再把 URL 拼接到后面
-    strncpy(m_real_file+len,m_url,FILENAME_LEN-len-1);
+    // 🔎 1. 相对预先打开的 doc_root 打开 (跳过开头的 '/')，不再拼完整路径
+    // 跑出 doc_root 的 (软链接指到外面) -> 403，不存在 -> 404
+    int fd=open_beneath(conf->root->fd,rel+1);
+    if(fd<0){
+        if(errno==EXDEV||errno==ELOOP||errno==EACCES){
+            return FORBIDDEN_REQUEST;
+        }
+        return NO_RESOURCE;
+    }
 
-    // 🔎 1. 获取文件状态 (stat 是 Linux 系统调用)
-    // m_file_stat 是 http_conn 类里的成员变量 (struct stat)
-    // 如果返回 -1，说明文件不存在 -> 404
-    if(stat(m_real_file,&m_file_stat)<0){
+    // 🔎 2. 获取文件状态：对着打开的 fd 看，看到的一定是要发的那个文件
+    struct stat file_stat;
+    if(fstat(fd,&file_stat)<0){
+        close(fd);
         return NO_RESOURCE;
     }
 
-    // 🔒 2. 权限检查 (S_IROTH: 其他人有读权限)
+    // 🔒 3. 权限检查 (S_IROTH: 其他人有读权限)
     // 如果没有读权限 -> 403
-    if(!(m_file_stat.st_mode&S_IROTH)){
+    if(!(file_stat.st_mode&S_IROTH)){
+        close(fd);
         return FORBIDDEN_REQUEST;
     }
 
-    // 📁 3. 检查是不是目录 (S_ISDIR)
+    // 📁 4. 检查是不是目录 (S_ISDIR)
     // 如果请求的是个文件夹 (比如 /home/xxx/resources/) -> 400
-    if(S_ISDIR(m_file_stat.st_mode)){
+    if(S_ISDIR(file_stat.st_mode)){
+        close(fd);
         return BAD_REQUEST;
     }
+    // 管道、设备文件之类的不发 (读起来会卡住或者没完没了)
+    if(!S_ISREG(file_stat.st_mode)){
+        close(fd);
+        return FORBIDDEN_REQUEST;
+    }
 
     // ✅ 文件检查通过！
     // 接下来把文件映射到内存
+    file.size=file_stat.st_size;
+    if(file.size==0){
+        close(fd);
+        return FILE_REQUEST; // 空文件不用映射
+    }
 
-    // 以只读方式打开文件
-    int fd=open(m_real_file,O_RDONLY);// O_RDONLY：只读
+    // 💽 大文件：整个映射进来的话，发送时在 writev 里一页页缺页 (磁盘慢就卡住整个 I/O 循环)
+    // 改成留着 fd，发的时候按窗口 sendfile。告诉内核这是顺序读，预读开大一点
+    if(allow_sendfile&&conf->large_file_mb>0&&file.size>=((size_t)conf->large_file_mb<<20)){
+        posix_fadvise(fd,0,0,POSIX_FADV_SEQUENTIAL);
+        file.fd=fd;
+        file.drop_behind=conf->large_file_drop_behind;
+        return FILE_REQUEST;
+    }
 
     // 调用 mmap
-    m_file_address=(char*)mmap(0,m_file_stat.st_size,PROT_READ,MAP_PRIVATE,fd,0);
+    char* address=(char*)mmap(0,file.size,PROT_READ,MAP_PRIVATE,fd,0);
 
     // 映射完就可以关掉文件句柄了，内存映射依然有效
     close(fd);
+    if(address==MAP_FAILED){
+        file.size=0;
+        return INTERNAL_ERROR;
+    }
+    file.address=address;
 
     return FILE_REQUEST;
 }
 
+void close_static_file(static_file& file){
+    // 📦 打包文件里的内容是整个包一起映射的，不能单独 munmap，放掉引用就行
+    if(file.pack){
+        file.pack.reset();
+        file.variant=0;
+        file.gzip=false;
+    }else if(file.fd>=0){
+        close(file.fd);
+        file.fd=-1;
+    }else if(file.address){
+        munmap(file.address,file.size);
+    }
+    file.address=0;
+    file.size=0;
+}
+
 // =================================================================
-// 9. 响应构造辅助函数 (专门负责往 m_write_buf 里填数据)
+// 9. 响应构造辅助函数 (专门负责往 m_out 里填数据)
 // =================================================================
 
-// 🖊️ 基础写函数：往 m_write_buf 里写入格式化字符串
+// 📋 各种状态码对应的标题和正文
+const char* ok_200_title="OK";
+const char* error_400_title="Bad Request";
+const char* error_400_form="Your request has bad syntax or is inherently impossible to staisfy.\n";
+const char* error_403_title="Forbidden";
+const char* error_403_form="You do not have permission to get file form this server.\n";
+const char* error_404_title="Not Found";
+const char* error_404_form="The requested file was not found on this server.\n";
+const char* error_500_title="Internal Error";
+const char* error_500_form="There was an unusual problem serving the request file.\n";
+const char* error_503_title="Service Unavailable";
+const char* error_503_form="The server is overloaded, please try again later.\n";
+
+// 🖊️ 基础写函数：往 m_out 的链尾写入格式化字符串 (块写满了会自动接一块新的)
 bool http_conn::add_response(const char* format,...){
 
-    // 如果写入位置超过了缓冲区大小，报错
-    if(m_write_idx>=WRITE_BUFFER_SIZE){
-        return false;
-    }
-
     // 定义可变参数列表
     va_list arg_list;
     va_start(arg_list,format);
 
-    // vsnprintf: 把参数格式化成字符串，写入 m_write_buf
-    int len=vsnprintf(m_write_buf+m_write_idx,WRITE_BUFFER_SIZE-1-m_write_idx,format,arg_list);
-
-    // 如果写入失败，或者缓冲区不够大了
-    if(len>=(WRITE_BUFFER_SIZE-1-m_write_idx)){
-        return false;
-    }
-
-    // 更新写指针
-    m_write_idx+=len;
+    // vsnprintf: 把参数格式化成字符串，写进 m_out
+    bool ok=m_out.vprintf(format,arg_list);
     va_end(arg_list);
 
-    return true;
+    return ok;
 }
 
 // 🏷️ 添加状态行 (例如: HTTP/1.1 200 OK)
@@ -703,3 +1423,994 @@ bool http_conn::add_content_type(){
     return add_response("Content-Type:%s\r\n","text/html");
 }
 
+// =================================================================
+// 10. 组装响应 (process_write)
+// =================================================================
+
+// 🧾 根据 process_read 的结果，决定往 m_out 里写什么
+bool http_conn::process_write(HTTP_CODE ret){
+    switch(ret){
+        case INTERNAL_ERROR:{
+            add_status_line(500,error_500_title);
+            add_headers(strlen(error_500_form));
+            if(!add_content(error_500_form)){
+                return false;
+            }
+            break;
+        }
+        case BAD_REQUEST:{
+            add_status_line(400,error_400_title);
+            add_headers(strlen(error_400_form));
+            if(!add_content(error_400_form)){
+                return false;
+            }
+            break;
+        }
+        case NO_RESOURCE:{
+            add_status_line(404,error_404_title);
+            add_headers(strlen(error_404_form));
+            if(!add_content(error_404_form)){
+                return false;
+            }
+            break;
+        }
+        case FORBIDDEN_REQUEST:{
+            add_status_line(403,error_403_title);
+            add_headers(strlen(error_403_form));
+            if(!add_content(error_403_form)){
+                return false;
+            }
+            break;
+        }
+        // 🚦 过载了：最便宜的回复，不碰文件，不做解析
+        case SERVICE_UNAVAILABLE:{
+            add_status_line(503,error_503_title);
+            add_headers(strlen(error_503_form));
+            if(!add_content(error_503_form)){
+                return false;
+            }
+            break;
+        }
+        case FILE_REQUEST:{
+            // 📦 打包文件里的资源：状态行 + Content-Type + Content-Length 都是打包时写好的，
+            // 直接引用包里的那一段 (不拷)，这里只补上 Connection 和空行
+            if(m_file.variant){
+                m_out.append_shared(m_file.pack->data_at(m_file.variant->head_off),m_file.variant->head_len,m_file.pack);
+                if(!add_linger()||!add_blank_line()){
+                    return false;
+                }
+                append_file();
+                return true;
+            }
+
+            add_status_line(200,ok_200_title);
+            if(m_file.size!=0){
+                add_headers(m_file.size);
+
+                // 链上两段：响应头 (池子里的块) + mmap 出来的文件
+                append_file();
+                return true;
+            }else{
+                // 空文件：回一个空页面
+                const char* ok_string="<html><body></body></html>";
+                add_headers(strlen(ok_string));
+                if(!add_content(ok_string)){
+                    return false;
+                }
+            }
+            break;
+        }
+        default:{
+            return false;
+        }
+    }
+
+    // 除了文件请求，其他情况响应头 + 短正文都已经写进 m_out 了
+    return true;
+}
+
+// 🗑️ 释放 mmap 出来的文件
+void http_conn::unmap(){
+    close_static_file(m_file);
+}
+
+// ⛓️ 文件内容接到发送链上：mmap 的发完了由链 munmap，打包文件里的由链拿着包的引用
+void http_conn::append_file(){
+    if(m_file.pack){
+        m_out.append_shared(m_file.address,m_file.size,m_file.pack);
+        m_file.pack.reset();
+    }else if(m_file.fd>=0){
+        // 大文件：链上只记 fd，发的时候 sendfile (见 send_file)
+        m_out.append_file(m_file.fd,0,m_file.size);
+        m_file_drop_behind=m_file.drop_behind;
+        m_file_warm=0;
+        m_file_dropped=0;
+        m_file.fd=-1;
+    }else{
+        m_out.append_mmap(m_file.address,m_file.size);
+    }
+    m_file.address=0;
+    m_file.size=0;
+    m_file.variant=0;
+    m_file.gzip=false;
+}
+
+// 🔬 一个请求结束了 (在 init() 清空之前调，这时 m_url 还能用)
+void http_conn::trace_finish(){
+    TRACE_PROBE2(request_done,m_sockfd,m_url);
+    if(m_trace.active){
+        trace_commit(m_trace,m_sockfd,m_method,m_url);
+        m_trace.active=false;
+    }
+}
+
+// =================================================================
+// 11. 过载保护 (CoDel 风格的负载丢弃)
+// =================================================================
+
+// ⏱️ 单调时钟，单位微秒 (不受系统改时间影响)
+long long http_conn::now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// 🚦 CoDel 的核心判断
+// 思路：偶尔排一次长队没关系 (突发流量)，
+// 但如果一整个 INTERVAL 里 *每个* 请求的排队时间都超过 TARGET，
+// 说明“最小排队时间”都降不下来了 -> 队列是真堵了 -> 进入丢弃状态。
+// 丢弃状态下也不是全丢：按 CoDel 的控制律，第 n 次丢完以后隔 INTERVAL/sqrt(n) 再丢下一个，
+// 堵得越久丢得越密，直到排队时间回到 TARGET 以下 (任何一个请求) 就退出丢弃状态。
+// 刚退出不久又堵上的，从上一轮的丢弃密度接着来，不用从头慢慢加。
+bool http_conn::codel_should_shed(long long now,long long sojourn){
+    m_request_count.fetch_add(1,std::memory_order_relaxed);
+    long long max=m_max_sojourn_us.load(std::memory_order_relaxed);
+    while(sojourn>max&&!m_max_sojourn_us.compare_exchange_weak(max,sojourn,std::memory_order_relaxed)){
+    }
+
+    // ✅ 快速路径：排队时间正常，也不在丢弃状态 (绝大多数请求走这里，不拿锁)
+    if(sojourn<CODEL_TARGET_US&&!m_codel_dropping.load(std::memory_order_relaxed)){
+        if(m_codel_first_above.load(std::memory_order_relaxed)!=0){
+            m_codel_first_above.store(0,std::memory_order_relaxed);
+        }
+        return false;
+    }
+
+    bool shed=false;
+    pthread_mutex_lock(&m_codel_lock);
+    m_codel_last_update=now;
+
+    bool ok_to_drop=false;
+    long long first_above=m_codel_first_above.load(std::memory_order_relaxed);
+    if(sojourn<CODEL_TARGET_US){
+        // 排队时间正常：重新开始计时
+        m_codel_first_above.store(0,std::memory_order_relaxed);
+    }else if(first_above==0){
+        // 第一次超标：先不急，再观察一个 INTERVAL
+        m_codel_first_above.store(now+CODEL_INTERVAL_US,std::memory_order_relaxed);
+    }else if(now>=first_above){
+        // 持续超标了一整个 INTERVAL
+        ok_to_drop=true;
+    }
+
+    if(m_codel_dropping.load(std::memory_order_relaxed)){
+        if(!ok_to_drop){
+            m_codel_dropping.store(false,std::memory_order_relaxed);
+        }else if(now>=m_codel_drop_next){
+            shed=true;
+            m_codel_count++;
+            m_codel_drop_next+=codel_control_law(m_codel_count);
+        }
+    }else if(ok_to_drop){
+        // 进入丢弃状态，先丢这一个
+        shed=true;
+        m_codel_dropping.store(true,std::memory_order_relaxed);
+        int delta=m_codel_count-m_codel_last_count;
+        m_codel_count=(delta>1&&now-m_codel_drop_next<16LL*CODEL_INTERVAL_US)?delta:1;
+        m_codel_drop_next=now+codel_control_law(m_codel_count);
+        m_codel_last_count=m_codel_count;
+    }
+    pthread_mutex_unlock(&m_codel_lock);
+
+    if(shed){
+        m_shed_count.fetch_add(1,std::memory_order_relaxed);
+    }
+    return shed;
+}
+
+// 丢了 count 个以后，隔多久丢下一个 (微秒)
+long long http_conn::codel_control_law(int count){
+    return (long long)(CODEL_INTERVAL_US/sqrt((double)count));
+}
+
+// ⏱️ 以前直接拿 epoll_wait 回来的时刻当就绪时刻：处理一大批事件的时候，后面到的请求都堆在内核里，
+// 等下一次 epoll_wait 一下就回来了，这一批里排在前面的排队时间又都算成了 0，
+// CoDel 一看“有请求没超标”就重新计时，服务器满负荷延迟几百毫秒也进不了丢弃状态。
+// 现在：事件循环先 epoll_wait(0) 看一眼，有现成的事件 (没睡就拿到了)，说明这批事件在上一批处理的时候就到了，
+// 从上一批开始算 (真正到的时刻在上一批处理期间的某一点，这里按最早的算)；
+// 不能按 epoll_wait 花了多久来猜：满负荷时一次拿回几千个事件，光这一下就要几百微秒
+long long http_conn::batch_ready_time(bool waited,long long now,long long& last_batch){
+    long long ready=now;
+    if(!waited&&last_batch>0){
+        ready=last_batch;
+    }
+    last_batch=now;
+    return ready;
+}
+
+// 🚦 主循环问：现在要不要暂停 accept？
+// 如果已经一个 INTERVAL 没有请求来更新状态了 (比如 accept 被暂停后没活干了)，
+// 就当作恢复正常，免得一直卡在过载状态出不来
+bool http_conn::is_overloaded(long long now){
+    bool overloaded;
+
+    if(!m_codel_dropping.load(std::memory_order_relaxed)){
+        return false;
+    }
+    pthread_mutex_lock(&m_codel_lock);
+    if(m_codel_dropping.load(std::memory_order_relaxed)&&now-m_codel_last_update>CODEL_INTERVAL_US){
+        m_codel_dropping.store(false,std::memory_order_relaxed);
+        m_codel_first_above.store(0,std::memory_order_relaxed);
+    }
+    overloaded=m_codel_dropping.load(std::memory_order_relaxed);
+    pthread_mutex_unlock(&m_codel_lock);
+
+    return overloaded;
+}
+
+// =================================================================
+// 12. HTTPS (OpenSSL 握手 + kTLS)
+// =================================================================
+
+// 🤝 推进一步握手
+// 非阻塞 socket 上 SSL_do_handshake 会返回 WANT_READ / WANT_WRITE，
+// 意思是“数据还没到 / 发不出去，等 epoll 通知了再叫我”
+bool http_conn::tls_handshake(){
+    m_tls_want_write=false;
+
+    int ret=SSL_do_handshake(m_ssl);
+    if(ret==1){
+        m_tls_state=TLS_ESTABLISHED;
+
+        // 看看 OpenSSL 有没有成功把发送方向交给内核
+        // 成功了：后面直接 writev 明文，内核加密，mmap 的文件页不经过用户态拷贝
+        m_ktls_send=BIO_get_ktls_send(SSL_get_wbio(m_ssl));
+        return true;
+    }
+
+    int err=SSL_get_error(m_ssl,ret);
+    if(err==SSL_ERROR_WANT_READ){
+        return true;
+    }
+    if(err==SSL_ERROR_WANT_WRITE){
+        m_tls_want_write=true;
+        return true;
+    }
+    return false;
+}
+
+// 📥 HTTPS 版本的 read_once：用 SSL_read 代替 recv
+bool http_conn::tls_read(){
+    if(m_tls_state==TLS_HANDSHAKE){
+        if(!tls_handshake()){
+            return false;
+        }
+        // 握手还没结束，这一轮没有 HTTP 数据
+        if(m_tls_state==TLS_HANDSHAKE){
+            return true;
+        }
+    }
+
+    while(m_read_idx<READ_BUFFER_SIZE){
+        int bytes_read=SSL_read(m_ssl,m_read_buf+m_read_idx,READ_BUFFER_SIZE-m_read_idx);
+        if(bytes_read>0){
+            m_read_idx+=bytes_read;
+            continue;
+        }
+
+        int err=SSL_get_error(m_ssl,bytes_read);
+        if(err==SSL_ERROR_WANT_READ){
+            break;  // 读完了 (相当于 EAGAIN)
+        }
+        // SSL_ERROR_ZERO_RETURN: 对方发了 close_notify；其他: 真出错了
+        return false;
+    }
+    return true;
+}
+
+// 📤 把 iov 里的数据发出去，返回值和 writev 一样 (出错返回 -1 并设置 errno)
+ssize_t http_conn::send_iov(const struct iovec* iov,int count){
+    // 明文连接，或者 kTLS 生效了：直接 writev，内核负责加密
+    if(!m_ssl||m_ktls_send){
+        ssize_t n=writev(m_sockfd,iov,count);
+        if(n>0){
+            m_bytes_sent+=n;
+        }
+        return n;
+    }
+
+    // 🔐 退回用户态加密：每次加密一个 TLS 记录 (最多 16KB)
+    // 响应头和小的响应体先拼成一段再加密：一段一个记录的话，响应头单独成一个小包，
+    // 响应体那个小包要等 Nagle 攒着，客户端延迟 ACK 40ms 才放出来
+    static thread_local char gather[16384];
+    const void* buf=NULL;
+    int len=0;
+    for(int i=0;i<count&&len<(int)sizeof(gather);i++){
+        if(iov[i].iov_len==0){
+            continue;
+        }
+        int take=iov[i].iov_len>sizeof(gather)-len?(int)sizeof(gather)-len:(int)iov[i].iov_len;
+        if(len==0&&take==(int)sizeof(gather)){
+            buf=iov[i].iov_base;    // 第一段就够一个整记录：不用拷
+            len=take;
+            break;
+        }
+        memcpy(gather+len,iov[i].iov_base,take);
+        len+=take;
+        buf=gather;
+    }
+    if(len==0){
+        return 0;
+    }
+    // 上次 WANT_WRITE 没写出去，这次拼出来的是同样的字节 (调用方没往前挪)，OpenSSL 允许换地址重试
+    int ret=SSL_write(m_ssl,buf,len);
+    if(ret>0){
+        m_bytes_sent+=ret;
+        return ret;
+    }
+    int err=SSL_get_error(m_ssl,ret);
+    errno=(err==SSL_ERROR_WANT_WRITE||err==SSL_ERROR_WANT_READ)?EAGAIN:EPIPE;
+    return -1;
+}
+
+// =================================================================
+// 13. HTTP/2 (h2c)
+// =================================================================
+
+// 🔎 读缓冲区开头是不是 "PRI * HTTP/2.0\r\n\r\nSM\r\n\r\n"
+// complete=false 表示目前收到的都对得上，但还没收全
+bool http_conn::is_h2_preface(bool& complete) const{
+    int n=m_read_idx<h2_session::PREFACE_LEN?m_read_idx:h2_session::PREFACE_LEN;
+    if(n==0||memcmp(m_read_buf,h2_session::PREFACE,n)!=0){
+        return false;
+    }
+    complete=(n==h2_session::PREFACE_LEN);
+    return true;
+}
+
+// 🔀 HTTP/1.1 请求里带了 "Upgrade: h2c"：
+// 回 101，然后这个请求作为 stream 1 用 HTTP/2 回复，之后整条连接都是 HTTP/2
+void http_conn::upgrade_h2c(){
+    // HTTP/1 这边已经打开的文件不要了，stream 1 会自己再打开
+    unmap();
+
+    const char* method=(m_method==POST)?"POST":"GET";
+    m_h2=new h2_session();
+    if(!m_h2->start_upgrade(m_h2_settings,method,m_url,m_accept_gzip)){
+        close_conn();
+        return;
+    }
+
+    // 请求后面如果已经跟着 HTTP/2 的前言和帧，也一起交给会话
+    int leftover=m_read_idx-m_checked_idx;
+    if(leftover>0){
+        memmove(m_read_buf,m_read_buf+m_checked_idx,leftover);
+    }
+    m_read_idx=leftover;
+    process_h2();
+}
+
+// 🚄 HTTP/2 模式的 process：把读到的字节全交给会话，然后尽量马上发
+void http_conn::process_h2(){
+    if(!m_h2->on_read(m_read_buf,m_read_idx)){
+        close_conn();
+        return;
+    }
+    m_read_idx=0;
+    m_checked_idx=0;
+    m_start_line=0;
+
+    // 🚪 排空模式：发 GOAWAY，不再接新 stream
+    if(m_draining){
+        m_h2->go_away();
+    }
+
+    int ret=m_h2->flush(m_sockfd);
+    if(ret<0||m_h2->finished()){
+        close_conn();
+        return;
+    }
+    arm(ret>0?(EPOLLIN|EPOLLOUT):EPOLLIN);
+}
+
+// =================================================================
+// 14. 协程 handler
+// =================================================================
+
+co_write http_conn::write(const struct iovec* iov,int count){
+    co_write w;
+    w.conn=this;
+    w.count=0;
+    w.state=-1;
+    if(count>co_write::MAX_IOV){
+        return w; // 段数太多：直接当作发送失败
+    }
+    for(int i=0;i<count;i++){
+        w.iov[i]=iov[i];
+    }
+    w.count=count;
+    w.state=0;
+    return w;
+}
+
+co_cache_lookup http_conn::cache_lookup(const char* vary){
+    co_cache_lookup l;
+    l.conn=this;
+    l.key.reserve(128);
+    l.key+=(m_method==GET?"GET ":m_method==HEAD?"HEAD ":"POST ");
+    l.key+=m_url;
+    if(m_query){
+        l.key+='?';
+        l.key+=m_query;
+    }
+    l.key+=m_accept_gzip?"|gz":"|id";
+    if(vary){
+        l.key+='|';
+        l.key+=vary;
+    }
+    return l;
+}
+
+co_write http_conn::write_cached(const std::shared_ptr<const cached_response>& resp){
+    // 缓存里只存到最后一个响应头为止，Connection 和空行按这个连接的情况补
+    static const char keep_alive[]="Connection: keep-alive\r\n\r\n";
+    static const char close[]="Connection: close\r\n\r\n";
+    struct iovec iov[3];
+    iov[0].iov_base=(void*)resp->head.data();
+    iov[0].iov_len=resp->head.size();
+    iov[1].iov_base=(void*)(m_linger?keep_alive:close);
+    iov[1].iov_len=m_linger?sizeof(keep_alive)-1:sizeof(close)-1;
+    iov[2].iov_base=(void*)resp->body.data();
+    iov[2].iov_len=resp->body.size();
+    return write(iov,3);
+}
+
+bool http_conn::start_chunked(int status,const char* title,const char* content_type,const char* extra){
+    // 让内核只在“还没发出去的”少于这么多时才报可写：数据留在我们自己的链上，
+    // 背压能及时传到 handler 那里，而不是先把几 MB 塞进 socket 缓冲区
+    if(!m_notsent_lowat){
+        int lowat=STREAM_NOTSENT_LOWAT;
+        setsockopt(m_sockfd,IPPROTO_TCP,TCP_NOTSENT_LOWAT,&lowat,sizeof(lowat));
+        m_notsent_lowat=true;
+    }
+    return add_status_line(status,title)
+        &&add_response("Content-Type: %s\r\n",content_type)
+        &&add_response("%s","Transfer-Encoding: chunked\r\n")
+        &&(!extra||add_response("%s",extra))
+        &&add_linger()
+        &&add_blank_line();
+}
+
+co_drain http_conn::write_chunk(const void* data,size_t len){
+    // 长度为 0 的块表示结尾，这里不能发，直接当作写完了
+    if(len>0){
+        add_response("%zx\r\n",len);
+        m_out.append_copy(data,len);
+        add_response("%s","\r\n");
+    }
+    // 没超过高水位就不用停下来，超过了就等它降到低水位
+    size_t limit=m_out.size()>STREAM_HIGH_WATERMARK?STREAM_LOW_WATERMARK:STREAM_HIGH_WATERMARK;
+    return co_drain{this,limit};
+}
+
+co_drain http_conn::end_chunked(){
+    add_response("%s","0\r\n\r\n");
+    return co_drain{this,0};
+}
+
+void http_conn::co_start(){
+    PHASE_ENTER(PHASE_HANDLER,handler_start);
+    m_co=m_co_fn(*this).release();
+    m_co_body_left=m_content_length;
+    m_co_body_start=m_checked_idx;
+    co_resume();
+}
+
+void http_conn::co_resume(){
+    m_co_wait=CO_WAIT_NONE;
+    m_co.resume();
+
+    if(m_co.done()){
+        co_finish();
+        return;
+    }
+
+    // 协程又挂起了：按它在等的东西重新注册事件 (sleep 的话由定时器叫醒，不用注册)
+    if(m_co_wait==CO_WAIT_HEADERS||m_co_wait==CO_WAIT_BODY){
+        arm(EPOLLIN);
+    }else if(m_co_wait==CO_WAIT_WRITE||m_co_wait==CO_WAIT_DRAIN){
+        arm(EPOLLOUT);
+    }
+}
+
+void http_conn::co_finish(){
+    bool ok=!m_co.promise().failed&&!m_co_failed&&m_co_body_left==0;
+    co_cancel();
+    PHASE_LEAVE(PHASE_HANDLER,handler_done);
+
+    // handler 往 m_out 里放了东西没等它发完就返回了：剩下的交给普通的 write() 去发
+    if(ok&&!m_out.empty()){
+        arm(EPOLLOUT);
+        return;
+    }
+    trace_finish();
+
+    // 和 write() 发完之后一样：长连接就重置等下一个请求，否则挂断
+    // (请求体没读完的话，剩下的字节没法和下一个请求分开，只能挂断)
+    if(ok&&m_linger&&!m_draining){
+        init();
+        arm(EPOLLIN);
+    }else{
+        close_conn();
+    }
+}
+
+void http_conn::co_cancel(){
+    if(m_co){
+        m_co.destroy(); // 帧还给 co_frame_pool
+        m_co=nullptr;
+        m_co_seq++;     // 还在排队的定时器作废
+    }
+}
+
+int http_conn::co_send(struct iovec* iov,int& count){
+    // m_out 上还有之前流式写的数据：先发它，保证顺序
+    int ret=flush_out();
+    if(ret<=0){
+        if(ret<0){
+            m_co_failed=true;
+        }
+        return ret;
+    }
+
+    PHASE_ENTER(PHASE_WRITE,write_start);
+    while(count>0){
+        ssize_t n=send_iov(iov,count);
+        if(n<0){
+            if(errno==EAGAIN){
+                m_trace.write_waits++;
+                TRACE_PROBE2(write_eagain,m_sockfd,count);
+                return 0;
+            }
+            m_co_failed=true;
+            return -1;
+        }
+
+        // 把发出去的部分从 iov 前面去掉 (和 out_chain::consume 是一个道理)
+        int i=0;
+        while(i<count&&(size_t)n>=iov[i].iov_len){
+            n-=iov[i].iov_len;
+            i++;
+        }
+        if(i<count){
+            iov[i].iov_base=(char*)iov[i].iov_base+n;
+            iov[i].iov_len-=n;
+        }
+        memmove(iov,iov+i,(count-i)*sizeof(struct iovec));
+        count-=i;
+    }
+    PHASE_LEAVE(PHASE_WRITE,write_done);
+    return 1;
+}
+
+void http_conn::co_on_wakeup(unsigned seq){
+    if(seq!=m_co_seq){
+        return; // 过期的通知 (连接已经关了 / 换人了)
+    }
+    // 💽 大文件的窗口读进页缓存了：把 EPOLLOUT 挂回去接着发
+    if(m_file_wait){
+        m_file_wait=false;
+        rearm();
+        return;
+    }
+    if(!m_co){
+        return;
+    }
+    // 🗃️ 数据库任务跑完了 (结果在 job 里) / 🐘 后端连接有动静 (协程自己再试一次读写，没好就接着等)
+    if(m_co_wait==CO_WAIT_DB||m_co_wait==CO_WAIT_UPSTREAM){
+        co_resume();
+        return;
+    }
+    if(m_co_wait!=CO_WAIT_CACHE){
+        return;
+    }
+    // 重新查一遍：还是得等 (又有别人抢先开始算了) 就接着挂着
+    if(!m_co_cache->lookup()){
+        return;
+    }
+    co_resume();
+}
+
+void http_conn::co_on_timer(unsigned seq){
+    // 连接已经关了 / 换了别的协程：这是个过期的定时器
+    if(!m_co||seq!=m_co_seq||m_co_wait!=CO_WAIT_TIMER){
+        return;
+    }
+    co_resume();
+}
+
+// =================================================================
+// 15. MSG_ZEROCOPY (大块数据不拷贝，直接让内核拿用户态的页去发)
+// =================================================================
+// 📮 流程：
+//   1. 第一次遇到够大的发送时给 socket 打开 SO_ZEROCOPY
+//   2. sendmsg(MSG_ZEROCOPY) 返回了只说明排上队了，内核还在读那些页：
+//      发出去的段从 m_out 上摘下来以后先停着 (out_chain 的 m_parked)，不能释放
+//   3. 对方 ACK 以后内核往 socket 的错误队列里放一条完成通知 (编号区间 lo..hi)，
+//      epoll 报 EPOLLERR，I/O 循环调 reap_zerocopy 收掉，停着的段这才释放
+// 小响应不值得：锁页 + 收通知的开销比拷几 KB 还大，所以只有超过 zerocopy_min 才用
+// 📏 省没省下来看“每 GB 花多少 CPU 秒”：打包文件 (asset_pack) 里的大文件走这条路，
+// zerocopy_min=65536 和 0 各起一次，用 http_bench -P 服务器进程号 打同一个 URL 对比。
+// 要从另一台机器隔着真网卡打：回环上内核每次都退回成拷贝 (完成通知带 COPIED)，连接第一次收到就不再用了
+
+bool http_conn::want_zerocopy(){
+    int min=m_zerocopy_min.load(std::memory_order_relaxed);
+    // HTTPS 不用：用户态加密本来就要拷，kTLS 的零拷贝是另一套 (只管 sendfile)
+    if(min<=0||m_ssl||m_out.size()<(size_t)min){
+        return false;
+    }
+    if(m_zc==ZC_UNTRIED){
+        int one=1;
+        if(setsockopt(m_sockfd,SOL_SOCKET,SO_ZEROCOPY,&one,sizeof(one))<0){
+            // 内核太老 (4.14 以前) 或者不支持：全局关掉，以后谁都不再试
+            perror("setsockopt SO_ZEROCOPY");
+            m_zerocopy_min=0;
+            m_zc=ZC_OFF;
+            return false;
+        }
+        m_zc=ZC_ON;
+    }
+    return m_zc==ZC_ON;
+}
+
+ssize_t http_conn::send_zerocopy(const struct iovec* iov,int count){
+    struct msghdr msg;
+    memset(&msg,0,sizeof(msg));
+    msg.msg_iov=(struct iovec*)iov;
+    msg.msg_iovlen=count;
+    ssize_t ret=sendmsg(m_sockfd,&msg,MSG_ZEROCOPY);
+    if(ret>0){
+        m_zerocopy_sends++;
+        m_bytes_sent+=ret;
+    }
+    return ret;
+}
+
+bool http_conn::reap_zerocopy(){
+    if(m_zc!=ZC_ON&&m_zc!=ZC_COPYING){
+        return false;   // 没开过零拷贝：EPOLLERR 就是真出错了
+    }
+
+    // 一次 recvmsg 拿一条通知 (内核会把连续的编号合并成一个区间)，拿到 EAGAIN 为止
+    while(true){
+        char control[128];
+        struct msghdr msg;
+        memset(&msg,0,sizeof(msg));
+        msg.msg_control=control;
+        msg.msg_controllen=sizeof(control);
+        if(recvmsg(m_sockfd,&msg,MSG_ERRQUEUE|MSG_DONTWAIT)<0){
+            break;
+        }
+        for(struct cmsghdr* cm=CMSG_FIRSTHDR(&msg);cm;cm=CMSG_NXTHDR(&msg,cm)){
+            if(!(cm->cmsg_level==SOL_IP&&cm->cmsg_type==IP_RECVERR)
+                &&!(cm->cmsg_level==SOL_IPV6&&cm->cmsg_type==IPV6_RECVERR)){
+                continue;
+            }
+            struct sock_extended_err* ee=(struct sock_extended_err*)CMSG_DATA(cm);
+            if(ee->ee_origin!=SO_EE_ORIGIN_ZEROCOPY||ee->ee_errno!=0){
+                continue;
+            }
+            m_out.zerocopy_done(ee->ee_info,ee->ee_data);
+
+            // 内核说“其实还是拷贝了” (回环、网卡不支持分散 DMA……)：
+            // 这个 socket 以后就别费这个劲了，直接走 writev
+            if(ee->ee_code&SO_EE_CODE_ZEROCOPY_COPIED){
+                m_zerocopy_copied++;
+                m_zc=ZC_COPYING;
+            }
+        }
+    }
+
+    // 错误队列里除了完成通知，socket 本身有没有真出错
+    int err=0;
+    socklen_t len=sizeof(err);
+    getsockopt(m_sockfd,SOL_SOCKET,SO_ERROR,&err,&len);
+    return err==0;
+}
+
+// =================================================================
+// 16. 大文件 (按窗口 sendfile + 页缓存感知，见 page_cache.h)
+// =================================================================
+
+ssize_t http_conn::send_file(){
+    int fd;
+    off_t off;
+    size_t len;
+    if(!m_out.head_file(fd,off,len)){
+        errno=EINVAL;
+        return -1;
+    }
+    if(m_file_wait){
+        errno=EAGAIN;   // 帮手线程还没读完
+        return -1;
+    }
+
+    // 这次最多发到当前窗口的结尾
+    off_t window_end=(off/(off_t)LARGE_FILE_WINDOW+1)*(off_t)LARGE_FILE_WINDOW;
+    size_t n=(size_t)(window_end-off)<len?(size_t)(window_end-off):len;
+
+    // 🔎 刚进入一个新窗口：先看它在不在页缓存里，不在就交给帮手线程去读，I/O 循环不等磁盘
+    // (没有叫醒队列的线程只能在这里直接 sendfile，大不了等一下磁盘)
+    if(off>=m_file_warm){
+        co_waker* waker=co_current_waker();
+        bool cold=waker&&!page_cache_resident(fd,off,n);
+        if(cold){
+            TRACE_PROBE2(file_cold,m_sockfd,off);
+            m_file_wait=true;
+            m_co_seq++;
+            page_cache_prefetch(fd,off,n,waker,this,m_co_seq);
+        }
+        m_file_warm=off+n;
+        // 下一个窗口也让帮手线程先读着，等发到那里的时候多半已经在了
+        if(len>n){
+            size_t next=len-n<LARGE_FILE_WINDOW?len-n:LARGE_FILE_WINDOW;
+            page_cache_prefetch(fd,window_end,next,NULL,NULL,0);
+        }
+        if(cold){
+            errno=EAGAIN;
+            return -1;
+        }
+    }
+
+    off_t pos=off;
+    ssize_t ret=sendfile(m_sockfd,fd,&pos,n);
+    if(ret>0){
+        m_bytes_sent+=ret;
+    }
+
+    // 🗑️ 一次性的下载：发过去的页丢掉。还在 socket 发送队列里 (没被 ACK) 的页内核还拿着，
+    // 丢了也会被跳过，所以只丢队列后面、再落后一个窗口的部分，攒够一个窗口丢一次
+    // (最后留在队列里的那一点就交给内核自己回收了)
+    if(ret>0&&m_file_drop_behind){
+        int queued=0;
+        ioctl(m_sockfd,SIOCOUTQ,&queued);
+        off_t behind=pos-queued-(off_t)LARGE_FILE_WINDOW;
+        if(behind-m_file_dropped>=(off_t)LARGE_FILE_WINDOW){
+            page_cache_drop(fd,m_file_dropped,behind-m_file_dropped);
+            m_file_dropped=behind;
+        }
+    }
+    return ret;
+}
+
+// =================================================================
+// 17. WebSocket (握手之后的帧收发，见 websocket.h)
+// =================================================================
+
+// 🤝 回 101，从此这个连接上跑的是帧
+void http_conn::upgrade_ws(){
+    char accept[32];
+    ws_accept_key(m_ws_key,accept);
+    add_status_line(101,"Switching Protocols");
+    add_response("Upgrade: websocket\r\nConnection: Upgrade\r\nSec-WebSocket-Accept: %s\r\n\r\n",accept);
+    trace_finish();
+
+    m_ws=true;
+    m_ws_fn=ws_route_handler(m_ws_channel);
+    ws_join(this);
+
+    // 请求头后面紧跟着的帧 (客户端没等 101 就发了) 挪到缓冲区开头，
+    // 指向请求头的指针都作废了
+    int left=m_read_idx-m_checked_idx;
+    memmove(m_read_buf,m_read_buf+m_checked_idx,left);
+    m_read_idx=left;
+    m_checked_idx=0;
+    m_start_line=0;
+    m_url=0;
+    m_query=0;
+    m_version=0;
+    m_host=0;
+    m_content_type=0;
+    m_cookie=0;
+    m_h2_settings=0;
+    m_ws_key=0;
+
+    process_ws();
+}
+
+// 📨 WebSocket 模式下的 process()：读缓冲区里有几个帧就处理几个，然后把要回的发出去
+void http_conn::process_ws(){
+    int close_code=0;
+    while(true){
+        close_code=ws_parse_frames();
+        if(close_code||m_ws_closing||m_ws_evict){
+            break;
+        }
+        // 🔐 HTTPS：一个 TLS 记录最大 16KB，读缓冲区装不下的那部分已经解密好了放在 OpenSSL 里，
+        // socket 上没有新数据，epoll 不会再报，得趁现在接着读
+        if(!m_ssl||SSL_pending(m_ssl)==0){
+            break;
+        }
+        if(!tls_read()){
+            close_conn();
+            return;
+        }
+    }
+
+    if(close_code){
+        ws_close(close_code);
+    }
+    if(m_ws_evict){
+        ws_evict();
+        return;
+    }
+    ws_flush(true);
+}
+
+// 负载边收边解掉掩码，整帧都在缓冲区里的消息直接交给 handler (不拷)，
+// 跨了几次读 / 分了片的先拼到 m_ws_msg 里。处理完的字节从缓冲区里挪走，剩下的最多是半个帧头
+// 返回 0 表示正常，否则是协议错误，要回的 close 状态码
+int http_conn::ws_parse_frames(){
+    int pos=0;
+    int close_code=0;
+    while(!m_ws_closing&&!m_ws_evict){
+        if(!m_ws_in_frame){
+            int n=ws_parse_header((const unsigned char*)m_read_buf+pos,m_read_idx-pos,m_ws_frame);
+            if(n==0){
+                break;
+            }
+            close_code=n<0?1002:ws_check_frame();
+            if(close_code){
+                break;
+            }
+            pos+=n;
+            m_ws_in_frame=true;
+            m_ws_frame_done=0;
+        }
+
+        uint64_t want=m_ws_frame.len-m_ws_frame_done;
+        size_t take=(size_t)(m_read_idx-pos)<want?(size_t)(m_read_idx-pos):(size_t)want;
+        char* payload=m_read_buf+pos;
+        ws_unmask(payload,take,m_ws_frame.mask,m_ws_frame_done);
+        bool control=m_ws_frame.opcode>=WS_CLOSE;
+        bool direct=!control&&m_ws_frame_done==0&&take==m_ws_frame.len&&m_ws_frame.fin&&m_ws_msg.empty();
+        if(control){
+            memcpy(m_ws_ctrl+m_ws_frame_done,payload,take);
+        }else if(!direct){
+            m_ws_msg.append(payload,take);
+        }
+        pos+=take;
+        m_ws_frame_done+=take;
+        if(m_ws_frame_done<m_ws_frame.len){
+            break;  // 负载还没收全
+        }
+        m_ws_in_frame=false;
+
+        if(control){
+            ws_on_control();
+        }else if(m_ws_frame.fin){
+            // 🎉 一条完整的消息
+            if(direct){
+                m_ws_fn(*this,m_ws_msg_opcode,payload,take);
+            }else{
+                m_ws_fn(*this,m_ws_msg_opcode,m_ws_msg.data(),m_ws_msg.size());
+                m_ws_msg.clear();
+            }
+            m_ws_msg_opcode=0;
+        }
+    }
+
+    // 没处理完的半个帧头挪到开头，等下次接着收
+    int left=m_read_idx-pos;
+    memmove(m_read_buf,m_read_buf+pos,left);
+    m_read_idx=left;
+    return close_code;
+}
+
+// 📏 帧头收全了，检查一下规矩 (RFC 6455 5.1 / 5.4 / 5.5)：
+// 客户端的帧必须带掩码；控制帧不能分片、不能超过 125 字节；分片的顺序要对；消息不能太大
+int http_conn::ws_check_frame(){
+    if(!m_ws_frame.masked){
+        return 1002;
+    }
+    if(m_ws_frame.opcode>=WS_CLOSE){
+        return (!m_ws_frame.fin||m_ws_frame.len>125)?1002:0;
+    }
+    if(m_ws_frame.opcode==WS_CONTINUATION){
+        if(m_ws_msg_opcode==0){
+            return 1002;    // 没有开头的分片
+        }
+    }else{
+        if(m_ws_msg_opcode!=0){
+            return 1002;    // 上一条消息还没拼完就开始了新的一条
+        }
+        m_ws_msg_opcode=m_ws_frame.opcode;
+    }
+    if(m_ws_msg.size()+m_ws_frame.len>WS_MAX_MESSAGE){
+        return 1009;
+    }
+    return 0;
+}
+
+// 🏓 控制帧：ping 原样回 pong，pong 不用管，close 回一个 close 然后挂断
+void http_conn::ws_on_control(){
+    size_t len=(size_t)m_ws_frame.len;
+    if(m_ws_frame.opcode==WS_PING){
+        ws_send(WS_PONG,m_ws_ctrl,len);
+    }else if(m_ws_frame.opcode==WS_CLOSE){
+        // 把对方的状态码原样带回去 (没带的话就不带)
+        ws_send(WS_CLOSE,m_ws_ctrl,len>=2?2:0);
+        m_ws_closing=true;
+    }
+}
+
+void http_conn::ws_close(int code){
+    char payload[2];
+    payload[0]=(char)(code>>8);
+    payload[1]=(char)code;
+    ws_send(WS_CLOSE,payload,2);
+    m_ws_closing=true;
+}
+
+bool http_conn::ws_send(int opcode,const void* data,size_t len){
+    if(!m_ws||m_ws_closing){
+        return false;
+    }
+    if(!m_out.empty()&&m_out.size()+len>(size_t)m_ws_max_queue){
+        m_ws_evict=true;
+        return false;
+    }
+    char head[10];
+    int n=ws_write_header(head,opcode,len);
+    m_out.append_copy(head,n);
+    m_out.append_copy(data,len);
+    return true;
+}
+
+// 📢 广播的消息：整帧 (帧头 + 负载) 都在 msg 里，链上只挂一个引用
+// 积压着东西、再挂就超过上限的，说明它收得比别人发得慢，交给调用方踢掉
+// (空着的连接总能收下一条，哪怕这一条本身就比上限大)
+bool http_conn::ws_queue(const std::shared_ptr<const ws_message>& msg){
+    if(!m_out.empty()&&m_out.size()+msg->bytes.size()>(size_t)m_ws_max_queue){
+        return false;
+    }
+    m_out.append_shared(msg->bytes.data(),msg->bytes.size(),msg);
+    return true;
+}
+
+// 🐢 收得太慢的：普通的 close 会让内核把发送缓冲区里积压的几 MB 慢慢发完 (内存照样占着)，
+// 设 SO_LINGER 0 直接回 RST，连同内核里的一起扔掉
+void http_conn::ws_evict(){
+    m_ws_evicted++;
+    struct linger lg;
+    lg.l_onoff=1;
+    lg.l_linger=0;
+    setsockopt(m_sockfd,SOL_SOCKET,SO_LINGER,&lg,sizeof(lg));
+    close_conn();
+}
+
+// rearm：是从 epoll 事件里进来的 (ONESHOT 已经摘了)，没东西要发也得重新挂上 EPOLLIN
+// 广播进来的时候连接本来就挂着，发完了不用动它
+bool http_conn::ws_flush(bool rearm){
+    int ret=flush_out();
+    if(ret<0||(ret==1&&(m_ws_closing||m_draining))){
+        close_conn();
+        return false;
+    }
+    if(ret==0){
+        arm(EPOLLIN|EPOLLOUT);
+    }else if(rearm){
+        arm(EPOLLIN);
+    }
+    return true;
+}
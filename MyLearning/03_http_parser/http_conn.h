@@ -19,6 +19,21 @@
 #include<sys/mman.h>
 #include<stdarg.h>
 #include<errno.h>
+#include<time.h>
+#include<atomic>
+#include "config.h"
+#include "asset_pack.h"
+#include "tls.h"
+#include "co_handler.h"
+#include "micro_cache.h"
+#include "req_trace.h"
+#include "capture.h"
+#include "out_chain.h"
+#include "websocket.h"
+#include "sql_pool.h"
+#include "fcgi.h"
+#include "url.h"
+#include "parser_policy.h"
 
 static const int FILENAME_LEN = 200; // 文件名最大长度
 
@@ -47,7 +62,10 @@ enum HTTP_CODE{
     FORBIDDEN_REQUEST,  // 客户没有权限 (403)
     FILE_REQUEST,       // 请求文件成功
     INTERNAL_ERROR,     // 服务器内部错误 (500)
-    CLOSED_CONNECTION   // 客户端关闭连接
+    CLOSED_CONNECTION,  // 客户端关闭连接
+    SERVICE_UNAVAILABLE,// 服务器过载，直接拒绝 (503)
+    CO_REQUEST,         // 请求头读完了，交给协程 handler 处理
+    WS_REQUEST          // 合法的 WebSocket 升级请求，回 101 切过去
 };
 
 // 4：HTTP 请求方法 (GET, POST...)
@@ -64,26 +82,125 @@ enum METHOD {
 };
 
 
+class h2_session;
+
+// 📄 一个要发出去的静态文件 (磁盘上 mmap 出来的，或者打包文件里的)
+struct static_file{
+    char* address;      // 文件内容的起始地址
+    size_t size;        // 文件大小
+
+    // 📦 从打包文件里出的资源 (这时 address 指向包里的内容，不能 munmap)
+    std::shared_ptr<const asset_pack> pack;     // 持有这份包，防止热更新时被提前释放
+    const pack_variant* variant;                // 选中的变体 (原始 / gzip)
+    bool gzip;                                  // 选中的是 gzip 变体
+
+    // 💽 大文件模式：不映射 (address 为空)，留着 fd 由 http_conn 按窗口 sendfile
+    int fd;
+    bool drop_behind;                           // 发过去的页从页缓存里丢掉 (一次性下载)
+
+    static_file():address(0),size(0),variant(0),gzip(false),fd(-1),drop_behind(false){}
+};
+
+// 🔎 根据 URL 找到文件并映射进内存 (HTTP/1 和 HTTP/2 共用)
+// allow_sendfile：调用方能用 sendfile 发 (明文或者 kTLS)，够大的文件就走大文件模式，不映射
+// 成功返回 FILE_REQUEST，否则返回 NO_RESOURCE / FORBIDDEN_REQUEST / BAD_REQUEST
+HTTP_CODE open_static_file(const char* url,bool accept_gzip,static_file& file,bool allow_sendfile=false);
+
+// 🗑️ 用完了释放 (munmap / 关掉 fd / 放掉打包文件的引用)
+void close_static_file(static_file& file);
+
+// 5：TLS 握手状态 (只有 HTTPS 连接才用)
+enum TLS_STATE{
+    TLS_NONE=0,         // 明文 HTTP 连接
+    TLS_HANDSHAKE,      // 正在握手
+    TLS_ESTABLISHED     // 握手完成，可以收发 HTTP 了
+};
+
+// 6：协程 handler 正在等什么
+enum CO_WAIT{
+    CO_WAIT_NONE=0,
+    CO_WAIT_HEADERS,    // 等请求头读完
+    CO_WAIT_BODY,       // 等请求体的数据 (EPOLLIN)
+    CO_WAIT_WRITE,      // 等 socket 可写 (EPOLLOUT)
+    CO_WAIT_TIMER,      // 在 sleep，等定时器
+    CO_WAIT_CACHE,      // 等别的请求把同一个缓存项算出来 (请求合并)
+    CO_WAIT_DRAIN,      // chunked 流式发送：没发出去的太多了，等 socket 可写
+    CO_WAIT_DB,         // 等数据库线程把任务跑完 (见 sql_pool.h)
+    CO_WAIT_UPSTREAM    // 等后端连接：池子里空出来一条 / 可读 / 可写 (见 fcgi.h)
+};
+
+
+// 📮 一个 socket 的 MSG_ZEROCOPY 状态
+enum ZC_STATE{
+    ZC_UNTRIED=0,   // 还没试过 (还没遇到够大的响应)
+    ZC_ON,          // SO_ZEROCOPY 开好了，大块数据走零拷贝
+    ZC_OFF,         // 开不了 (内核 / 协议不支持)
+    ZC_COPYING      // 开了，但内核说它还是在拷贝 (比如回环)：不再用，只等之前的通知收完
+};
+
 class http_conn{
 public:
-    // 🌍 所有的 socket 上的事件都被注册到同一个 epoll 内核事件表中
-    // 所以设置成 static 静态成员，让所有对象共享
-    static int m_epollfd;
-    static int m_user_count; // 统计现在的用户总数
+    // 🌍 一个 I/O 循环里所有的 socket 上的事件都被注册到同一个 epoll 内核事件表中
+    // 所以设置成 static 静态成员，让所有对象共享 (开了多个 I/O 线程时每个线程一份)
+    static thread_local int m_epollfd;
+    static std::atomic<int> m_user_count; // 统计现在的用户总数 (所有 I/O 线程加起来)
 
     // 📏 定义读写缓冲区的大小
-    static const int READ_BUFFER_SIZE=2048;  // 读缓冲区大小
-    static const int WRITE_BUFFER_SIZE=1024; // 写缓冲区大小
+    static const int READ_BUFFER_SIZE=2048;  // 读缓冲区大小 (写的一边是 out_chain，不限大小；正好是 mem_pool 的一档)
+    // Content-Length 最大多少：协程 handler 用 read_body 边收边读，可以比读缓冲区大；
+    // 不走协程的请求体还得整个放进读缓冲区 (见 parse_content)
+    static const int MAX_CONTENT_LENGTH=64*1024*1024;
 
     // 📏 定义文件大小
     static const int FILENAME_LEN=200;
 
+    // 🚰 chunked 流式响应的背压：没发出去的超过高水位就让 handler 停下来，
+    // 降到低水位以下再接着产生数据 (慢客户端最多也就占这么多内存)
+    static const size_t STREAM_HIGH_WATERMARK=65536;
+    static const size_t STREAM_LOW_WATERMARK=16384;
+    // 内核里“还没发出去”的数据超过这个数就不报可写 (TCP_NOTSENT_LOWAT)，免得数据都堆在内核缓冲区里
+    static const int STREAM_NOTSENT_LOWAT=16384;
+
+    // 💽 大文件一个窗口一个窗口地发：每个窗口先确认在页缓存里 (不在就交给帮手线程去读)
+    static const size_t LARGE_FILE_WINDOW=2*1024*1024;
+
+    // 🚦 过载保护 (CoDel 思路)：看请求在队列里“排了多久” (sojourn time)
+    // 如果一整个 INTERVAL 内，排队时间的最小值都超过 TARGET，说明队列已经堵死了
+    static const int CODEL_TARGET_US=5000;      // 目标排队时间 5ms
+    static const int CODEL_INTERVAL_US=100000;  // 观察窗口 100ms
+
+    // 📊 过载保护计数器 (所有连接共享)
+    // (每个请求都要加，所以是原子变量，主循环 / 多进程的统计不加锁直接读)
+    static std::atomic<long long> m_request_count;  // 过了 CoDel 判断的请求总数 (分几次读到的请求只算一次)
+    static std::atomic<long long> m_shed_count;     // 被 503 快速拒绝的请求数
+    static std::atomic<long long> m_max_sojourn_us; // 观察到的最大排队时间
+    static thread_local long long m_bytes_sent; // 这个线程发出去的字节数 (多进程模式下 worker 报给 master)
+
+    // 🚪 平滑升级时进入“排空”模式：不再保持长连接，回完这一个就挂断
+    static std::atomic<bool> m_draining;
+
+    // 📮 MSG_ZEROCOPY：链上没发的数据不少于这么多字节才用零拷贝发 (0 关掉，启动时设一次)
+    // 内核不支持 SO_ZEROCOPY 的话，第一次试的时候就被清成 0，以后都老实拷贝
+    static std::atomic<int> m_zerocopy_min;
+    static std::atomic<long long> m_zerocopy_sends;     // 用零拷贝发了几次
+    static std::atomic<long long> m_zerocopy_copied;    // 其中有几段内核说“其实还是拷贝了”
+
+    // 🔌 WebSocket：收到的一条消息 (分片拼起来) 最多这么大，超过了回 1009 挂断
+    static const size_t WS_MAX_MESSAGE=1024*1024;
+    // 每个连接积压 (还没发出去) 的上限，超过了说明它收得太慢，踢掉 (启动时设一次)
+    static std::atomic<int> m_ws_max_queue;
+    static std::atomic<long long> m_ws_evicted;         // 因为收得太慢被踢掉的连接数
+
+    // 🧩 用哪一份解析器 (PARSER_KIND，见 parser_policy.h；启动时设一次)
+    static int m_parser;
+
 public:
-    http_conn(){}
+    http_conn():m_sockfd(-1),m_read_buf(0),m_ssl(0),m_h2(0),m_ws(false),m_ws_slot(-1),m_co(nullptr),m_co_seq(0){}
     ~http_conn(){}
 
     // 🌟 初始化连接 (当 accept 拿到 connfd 后调用这个)
-    void init(int sockfd,const sockaddr_in& addr);
+    // tls: 是不是从 HTTPS 端口进来的
+    void init(int sockfd,const sockaddr_in& addr,bool tls=false);
 
     // 🔄 关闭连接
     void close_conn();
@@ -97,6 +214,82 @@ public:
     // 📤 非阻塞写 (把响应发给用户)
     bool write();
 
+    // ⏱️ 打时间戳：连接“就绪”(epoll_wait 返回) 的那一刻由主循环调用
+    void mark_ready(long long now){m_ready_time=now;}
+
+    // 💤 这个连接是不是开着但闲着 (长连接在等下一个请求)
+    // (HTTP/2 连接上可能还有别的 stream 在跑，不算闲着)
+    // (协程 handler 还没跑完的也不算)
+    // (WebSocket 连接手上没有要发的也算闲着：排空时直接挂断，客户端自己重连到新进程)
+    bool is_idle() const{return m_sockfd!=-1&&!m_h2&&!m_co&&m_read_idx==0&&m_out.empty();}
+
+    // 🧮 内存紧张 (过了软上限)：闲着的长连接把留着复用的 arena 块、发送链的容量也还回去
+    void trim_idle();
+
+    // 📬 EPOLLERR：开过零拷贝的连接，完成通知也是从 socket 的错误队列报上来的
+    // 把它们收掉，释放内核用完了的段。返回 true 表示只是通知 (socket 没出错)
+    bool reap_zerocopy();
+
+    // 🔁 ONESHOT 被一个“只是通知”的事件摘掉了：按原来的兴趣 (EPOLLIN / EPOLLOUT) 重新挂上
+    void rearm(){arm(m_armed);}
+
+    // 🚦 主循环用来决定要不要暂停 accept
+    static bool is_overloaded(long long now);
+
+    // ⏱️ 一批事件的“就绪时刻” (CoDel 从这一刻开始算排队时间)，事件循环每次 epoll_wait 回来调一次
+    // waited：这一批是睡着等来的 (先用 epoll_wait(0) 看过一眼，没有现成的才睡)；
+    // now：epoll_wait 回来的时刻；last_batch：这个循环上一批回来的时刻 (调用方留着)
+    static long long batch_ready_time(bool waited,long long now,long long& last_batch);
+
+    // ⏱️ 单调时钟 (微秒)
+    static long long now_us();
+
+    // ===============================================
+    // 🧵 给协程 handler 用的接口 (见 co_handler.h)
+    // ===============================================
+    co_read_headers read_headers(){return co_read_headers{this};}
+    co_read_body read_body(char* buf,size_t len){return co_read_body{this,buf,len};}
+    co_write write(const struct iovec* iov,int count);
+    co_sleep sleep(int ms){return co_sleep{this,ms};}
+
+    // 🚰 chunked 流式响应：先发状态行和响应头，再一块块 write_chunk，最后 end_chunked
+    // extra：另外要加的响应头 (一行一个 "Name: value\r\n")
+    bool start_chunked(int status,const char* title,const char* content_type,const char* extra=NULL);
+    co_drain write_chunk(const void* data,size_t len);
+    co_drain end_chunked();     // 发结尾的 0 块，等全部发完
+
+    // 🗄️ 查微缓存 (key = 方法 + URL + 是否接受 gzip + vary，vary 由 handler 自己决定要不要加)
+    co_cache_lookup cache_lookup(const char* vary=NULL);
+    // 把缓存里的响应原样发出去 (resp 要活到发完，放在协程的局部变量里就行)
+    co_write write_cached(const std::shared_ptr<const cached_response>& resp);
+
+    // 🗃️ 交给数据库线程去跑，跑完了回到这里 (返回 job->ok)
+    co_db run_db(const std::shared_ptr<db_job>& job){return co_db{this,job};}
+
+    const char* get_url() const{return m_url;}                     // 规范化过的路径 (不带查询串)
+    const char* get_query() const{return m_query;}                 // '?' 后面的原样查询串，没有是 NULL
+    METHOD get_method() const{return m_method;}
+    int get_content_length() const{return m_content_length;}
+    const char* get_host() const{return m_host;}                   // 没有的话是 NULL (下面两个也一样)
+    const char* get_content_type() const{return m_content_type;}
+    const char* get_cookie() const{return m_cookie;}
+    const sockaddr_in& get_peer() const{return m_address;}
+    bool is_tls() const{return m_ssl!=0;}
+    bool get_linger() const{return m_linger;}
+    void set_linger(bool linger){m_linger=linger;}
+
+    // 🧱 这个请求专用的内存 (请求结束自动清空，不用 free)
+    request_arena& arena(){return m_arena;}
+
+    // ===============================================
+    // 🔌 WebSocket (见 websocket.h)
+    // ===============================================
+    bool is_websocket() const{return m_ws;}
+    int ws_channel() const{return m_ws_channel;}
+    // 只发给这个连接 (拷一份)；在 handler 里调，handler 返回后和别的一起发出去
+    // 返回 false：连接在关了，或者积压太多 (handler 返回后会被踢掉)
+    bool ws_send(int opcode,const void* data,size_t len);
+
 
 private:
     // ⚙️ 私有初始化函数 (重置内部变量)
@@ -105,15 +298,15 @@ private:
     // ===============================================
     // 🧠 核心解析逻辑
     // ===============================================
-    // 从 m_read_buf 读取，并处理请求报文
-    HTTP_CODE process_read();
+    // 从 m_read_buf 读取，并处理请求报文 (P 是解析策略，见 parser_policy.h)
+    template<class P> HTTP_CODE process_read();
 
-    // 向 m_write_buf 写入响应报文
+    // 往 m_out 里追加响应报文
     bool process_write(HTTP_CODE ret);
 
     // 下面这一组函数被 process_read 调用以分析 HTTP 请求
-    HTTP_CODE parse_request_line(char *text);   // 分析第一行
-    HTTP_CODE parse_headers(char *text);        // 分析头部
+    template<class P> HTTP_CODE parse_request_line(char *text);   // 分析第一行
+    template<class P> HTTP_CODE parse_headers(char *text);        // 分析头部
     HTTP_CODE parse_content(char *text);        // 分析内容 eg:post
     HTTP_CODE do_request();                     // 生成响应
     LINE_STATUS parse_line();                   // ✨切菜刀：获取一行
@@ -134,14 +327,78 @@ private:
     bool add_content(const char* content);
 
     void unmap();
+    void append_file();     // 把 m_file 的内容接到 m_out 上 (所有权一起交过去)
+    int flush_out();        // 把 m_out 尽量发出去：1 发完了 0 还剩 (EAGAIN) -1 出错
+    ssize_t send_file();    // 链头是大文件：sendfile 发当前窗口 (窗口不在页缓存里就交给帮手线程，返回 EAGAIN)
+    bool want_zerocopy();   // 这一次发送要不要用 MSG_ZEROCOPY (第一次用到时才给 socket 打开 SO_ZEROCOPY)
+    ssize_t send_zerocopy(const struct iovec* iov,int count);
+    void arm(int ev);       // 重新挂回 epoll (代替 modfd)，顺便记下这次等的是什么
+
+    // 🔬 请求结束 (响应发完 / 协程跑完)：触发探针，抽中的交给 trace_commit
+    void trace_finish();
+
+    // 🧵 协程 handler 相关
+    void co_start();            // 创建协程并开始跑
+    void co_resume();           // 叫醒协程，跑到下一次挂起 (或者跑完) 为止
+    void co_finish();           // 协程跑完了：回到长连接或者关掉
+    void co_cancel();           // 直接销毁协程 (连接关掉的时候)
+    int co_send(struct iovec* iov,int& count);  // 尽量把 iov 发完：1 发完 0 EAGAIN -1 出错
+    void co_on_timer(unsigned seq);
+    void co_on_wakeup(unsigned seq);    // 别的线程叫醒 (微缓存填好了 / 大文件的窗口读进来了 / 数据库任务跑完了 / 后端连接有动静)
+
+    friend struct co_read_headers;
+    friend struct co_read_body;
+    friend struct co_write;
+    friend struct co_sleep;
+    friend void co_timer_run(long long now);
+    friend void co_waker_run();
+    friend struct co_cache_lookup;
+    friend struct co_drain;
+    friend struct co_db;
+    friend struct co_upstream_acquire;
+    friend struct co_upstream_wait;
+    friend bool fcgi_on_event(int fd,uint32_t events);
+    friend struct parser_bench;     // parser_bench.cpp 直接拿各个策略的解析函数来计时
+
+    // 🔐 HTTPS 相关
+    bool tls_handshake();   // 推进一步握手，返回 false 表示握手失败
+    bool tls_read();        // SSL_read 版本的 read_once
+    void capture_read(int start);   // 🎙️ 这次 read_once 读到的 [start, m_read_idx) 记下来 (被抽中的连接)
+    ssize_t send_iov(const struct iovec* iov,int count);   // kTLS / 明文走 writev，否则走 SSL_write
+
+    // 🚄 HTTP/2 相关
+    bool is_h2_preface(bool& complete) const;   // 读缓冲区开头是不是 HTTP/2 的连接前言
+    void upgrade_h2c();                         // 处理 "Upgrade: h2c"，切换到 HTTP/2
+    void process_h2();                          // HTTP/2 模式下的 process()
+
+    // 🔌 WebSocket 相关
+    void upgrade_ws();                          // 回 101，切成 WebSocket
+    void process_ws();                          // WebSocket 模式下的 process()：解帧、交给 handler
+    int ws_parse_frames();                      // 解读缓冲区里的帧，返回 0 或者要回的 close 状态码
+    int ws_check_frame();                       // 帧头收全了：合不合规矩，不合返回要回的 close 状态码
+    void ws_on_control();                       // ping / pong / close 收全了
+    void ws_close(int code);                    // 发 close 帧，发完就挂断
+    bool ws_queue(const std::shared_ptr<const ws_message>& msg);   // 广播的消息挂到链上 (不拷)，积压太多返回 false
+    bool ws_flush(bool rearm);                  // 尽量发出去，返回 false 表示连接已经关了
+    void ws_evict();                            // 踢掉慢客户端 (RST，内核缓冲区里积压的也一起扔掉)
+    friend void ws_join(http_conn* conn);
+    friend void ws_leave(http_conn* conn);
+    friend void ws_hub_run();
+
+    // 🚦 CoDel 判定：这次排队时间 sojourn 下，要不要把请求丢掉
+    static bool codel_should_shed(long long now,long long sojourn);
+    static long long codel_control_law(int count);
 
 private:
     // 📡 网络相关
     int m_sockfd;           // 该 HTTP 连接的 socket
     sockaddr_in m_address;  // 通信的 socket 地址
 
-    // 📦 读缓冲区
-    char m_read_buf[READ_BUFFER_SIZE];
+    // 📦 读缓冲区：要读的时候才从 mem_pool 借 (READ_BUFFER_SIZE 字节)，一个请求处理完 init() 就还
+    // 闲着的长连接不占；过了内存硬上限借不到，这个连接就回 503 挂断
+    char* m_read_buf;
+    bool acquire_read_buf();
+    void release_read_buf();
 
     // 📍 这里的三个变量至关重要！(解析时的游标)
     int m_read_idx;     // 标识读缓冲区中 已经读入的客户数据 的 最后一个字节 的下一个位置
@@ -150,30 +407,98 @@ private:
 
     // 🏷️ 状态机相关
     CHECK_STATE m_check_state;  // 主状态机当前所处的状态
-
-    // 📦 写缓冲区
-    char m_write_buf[WRITE_BUFFER_SIZE];
-    int m_write_idx;    // 写缓冲区中待发送的字节数
+    int m_header_count;         // 已经读了几个请求头 (策略的 MAX_HEADERS 用)
 
     // 📂 文件相关 (处理请求的文件)
-    char* m_url;            // 客户请求的目标文件名
+    char* m_url;            // 客户请求的路径 (解码 + 规范化过，见 url.h)
+    char* m_query;          // 查询串 (原样，没有是 NULL)
     char* m_version;        // HTTP 协议版本
     char* m_host;           // 主机名
+    char* m_content_type;   // Content-Type 头的值 (转给 FastCGI 后端)
+    char* m_cookie;         // Cookie 头的值 (同上)
     int m_content_length;   // HTTP 请求的消息体长度
     bool m_linger;          // HTTP 请求是否要求保持连接 (Keep-Alive)
+    bool m_accept_gzip;     // 客户端是否接受 gzip (Accept-Encoding)
+    bool m_upgrade_h2c;     // 客户端要求升级到 HTTP/2 (Upgrade: h2c)
+    char* m_h2_settings;    // HTTP2-Settings 头的值 (base64url)
+    bool m_upgrade_ws;      // 客户端要求升级到 WebSocket (Upgrade: websocket)
+    char* m_ws_key;         // Sec-WebSocket-Key 头的值
+    bool m_ws_version_ok;   // Sec-WebSocket-Version: 13
 
     // 请求方法 (GET, POST 等)
     METHOD m_method;
 
-    char m_real_file[FILENAME_LEN]; // 拼接后的完整路径
-    char* m_file_address;   // 客户请求的目标文件被 mmap 到内存中的起始位置
-    struct stat m_file_stat;// 目标文件的状态 (判断文件是否存在、是否可读)
-
-    // WriteV 相关 
-    struct iovec m_iv[2]; // io vector: 两个盘子（头 + 体）
-    int m_iv_count;       // 这一次发送我们要用几个盘子？(1个还是2个)
-    int bytes_to_send;    // 还有多少字节没发完？
-    int bytes_have_send;  // 已经发了多少字节？
+    static_file m_file;     // 客户请求的目标文件 (mmap 到内存里的内容 + 大小)
+
+    // 📦 待发送的数据 (响应头、文件、共享的缓存……一段段串起来，write() 用 writev 一次发多段)
+    out_chain m_out;
+
+    // 🔐 HTTPS 相关 (这几个跨请求保留，私有 init() 不会重置它们)
+    SSL* m_ssl;             // NULL 表示明文连接
+    TLS_STATE m_tls_state;
+    bool m_tls_want_write;  // 握手卡在“写不出去”上，要等 EPOLLOUT
+    bool m_ktls_send;       // 内核 TLS 发送是否生效 (生效了就能直接 writev)
+
+    // 🚄 切换到 HTTP/2 之后的会话 (NULL 表示还是 HTTP/1.x)
+    h2_session* m_h2;
+
+    // 🔌 升级成 WebSocket 之后 (连接关掉之前一直有效，不再走 init())
+    bool m_ws;                  // 已经是 WebSocket 连接了
+    bool m_ws_closing;          // 发了 close 帧 (或者准备发)，发完就挂断，不再收发消息
+    bool m_ws_evict;            // handler 往自己身上 ws_send 积压超了，处理完就踢掉
+    int m_ws_channel;           // 升级时命中的路由 (频道)
+    int m_ws_slot;              // 在本循环成员表里的下标 (-1 表示不在)
+    ws_handler_fn m_ws_fn;
+    ws_frame m_ws_frame;        // 正在收的帧
+    bool m_ws_in_frame;         // 帧头已经解析了，负载还没收完
+    uint64_t m_ws_frame_done;   // 这一帧的负载已经收了多少
+    int m_ws_msg_opcode;        // 正在拼的消息的类型 (0 表示没有在拼的)
+    std::string m_ws_msg;       // 跨读 / 分片的消息先拼在这里
+    char m_ws_ctrl[125];        // 控制帧的负载 (最多 125 字节)
+
+    // 🧵 正在处理这个请求的协程 (nullptr 表示走普通的静态文件流程)
+    co_task::handle m_co;
+    co_handler_fn m_co_fn;      // 路由匹配到的 handler
+    CO_WAIT m_co_wait;          // 协程挂起在等什么
+    co_write* m_co_writer;      // 挂起在 write 上时，还没发完的 iov
+    co_cache_lookup* m_co_cache;// 挂起在 cache_lookup 上时，被叫醒后要重新查一遍
+    size_t m_co_drain_limit;    // 挂起在 write_chunk 上时，m_out 降到多少以下叫醒它
+    bool m_notsent_lowat;       // 这个 socket 已经设过 TCP_NOTSENT_LOWAT (跨请求保留)
+    int m_armed;                // 最近一次挂回 epoll 时等的事件
+    ZC_STATE m_zc;              // 这个 socket 的零拷贝状态 (跨请求保留)
+
+    // 💽 正在发的大文件 (链上的文件段) 的页缓存状态
+    bool m_file_wait;           // 在等帮手线程把当前窗口读进页缓存 (这时不等 EPOLLOUT)
+    bool m_file_drop_behind;    // 发过去的页要丢掉
+    off_t m_file_warm;          // 这个位置之前的窗口都确认过 (或者已经交给帮手线程去读了)
+    off_t m_file_dropped;       // 这个位置之前的页已经丢掉了
+    bool m_co_failed;           // 发送出错了，协程结束后直接关连接
+    int m_co_body_left;         // 请求体还有多少字节没交给协程
+    int m_co_body_start;        // 请求体从读缓冲区的哪里开始 (前面的请求头要留着，m_url 还指着它)
+    unsigned m_co_seq;          // 每换一个协程加一，过期的定时器 / 叫醒通知靠它认出来
+
+    // 🧱 请求级的内存 (init 时清空，close_conn 时还给 mem_pool)
+    request_arena m_arena;
+
+    // 🔬 这个请求各阶段的时间戳 (被抽中才记，见 req_trace.h)
+    req_trace m_trace;
+
+    // 🎙️ 被抽中抓流量的连接编号 (0 表示不抓，跨请求保留，见 capture.h)
+    uint32_t m_capture_id;
+
+    // ⏱️ 过载保护相关
+    long long m_ready_time; // 连接就绪的时间戳 (0 表示还没打过)
+    bool m_codel_checked;   // 这个请求已经判过要不要丢了 (后面几段数据不再判、不再计数)
+
+    // 🚦 CoDel 共享状态 (多个工作线程都会改)
+    // 排队时间正常、又不在丢弃状态的请求只碰两个原子变量；超标了 / 正在丢弃才拿锁
+    static pthread_mutex_t m_codel_lock;
+    static std::atomic<long long> m_codel_first_above;  // 排队时间第一次超标后，再过一个 INTERVAL 的时刻 (0: 没超标)
+    static std::atomic<bool> m_codel_dropping;          // 当前是否处于丢弃 (过载) 状态
+    static long long m_codel_last_update;   // 最近一次更新状态的时刻 (下面几个都要拿着锁改)
+    static long long m_codel_drop_next;     // 丢弃状态下，到了这个时刻才丢下一个
+    static int m_codel_count;               // 这一轮丢弃状态里丢了几个 (决定丢的间隔)
+    static int m_codel_last_count;          // 上一轮丢弃状态结束时的 count
 
 };
 
@@ -0,0 +1,423 @@
+#include "io_loop.h"
+#include "busy_poll.h"
+#include<stdio.h>
+#include<stdlib.h>
+#include<assert.h>
+#include<string.h>
+#include<errno.h>
+#include<dirent.h>
+#include<sched.h>
+#include<unistd.h>
+#include<new>
+#include<signal.h>
+#include<sys/mman.h>
+#include<sys/eventfd.h>
+
+#define LOOP_EVENT_NUMBER 1024  // 每个 I/O 线程 epoll 一次最多拿回来多少个事件
+
+// =================================================================
+// 1. CPU 拓扑
+// =================================================================
+
+// 解析 "0-3,8-11" 这种 CPU 列表
+static void parse_cpulist(const char* text,std::vector<int>& out){
+    const char* p=text;
+    while(*p){
+        char* end;
+        long lo=strtol(p,&end,10);
+        if(end==p){
+            break;
+        }
+        long hi=lo;
+        p=end;
+        if(*p=='-'){
+            hi=strtol(p+1,&end,10);
+            p=end;
+        }
+        for(long c=lo;c<=hi;c++){
+            out.push_back((int)c);
+        }
+        if(*p==','){
+            p++;
+        }else{
+            break;
+        }
+    }
+}
+
+void load_topology(cpu_topology& topo){
+    topo.cpus.clear();
+    topo.node_of.clear();
+    topo.node_count=1;
+
+    // 只用这个进程被允许跑的 CPU (taskset / cgroup 限制过的话要尊重)
+    cpu_set_t allowed;
+    CPU_ZERO(&allowed);
+    sched_getaffinity(0,sizeof(allowed),&allowed);
+    for(int c=0;c<CPU_SETSIZE;c++){
+        if(CPU_ISSET(c,&allowed)){
+            topo.cpus.push_back(c);
+        }
+    }
+    topo.node_of.assign(CPU_SETSIZE,0);
+
+    // 每个 NUMA 节点有哪些 CPU (没有这个目录就当只有一个节点)
+    DIR* dir=opendir("/sys/devices/system/node");
+    if(!dir){
+        return;
+    }
+    int max_node=0;
+    struct dirent* ent;
+    while((ent=readdir(dir))!=NULL){
+        if(strncmp(ent->d_name,"node",4)!=0||ent->d_name[4]<'0'||ent->d_name[4]>'9'){
+            continue;
+        }
+        int node=atoi(ent->d_name+4);
+        char path[sizeof(ent->d_name)+64];
+        snprintf(path,sizeof(path),"/sys/devices/system/node/%s/cpulist",ent->d_name);
+        FILE* fp=fopen(path,"r");
+        if(!fp){
+            continue;
+        }
+        char line[1024];
+        if(fgets(line,sizeof(line),fp)){
+            std::vector<int> cpus;
+            parse_cpulist(line,cpus);
+            for(size_t i=0;i<cpus.size();i++){
+                if(cpus[i]>=0&&cpus[i]<CPU_SETSIZE){
+                    topo.node_of[cpus[i]]=node;
+                }
+            }
+        }
+        fclose(fp);
+        if(node>max_node){
+            max_node=node;
+        }
+    }
+    closedir(dir);
+    topo.node_count=max_node+1;
+}
+
+std::vector<int> spread_cpus(const cpu_topology& topo){
+    // 先按节点分组
+    std::vector<std::vector<int> > by_node(topo.node_count);
+    for(size_t i=0;i<topo.cpus.size();i++){
+        by_node[topo.node_of[topo.cpus[i]]].push_back(topo.cpus[i]);
+    }
+
+    // 再一个节点拿一个，轮流拿
+    std::vector<int> order;
+    for(size_t round=0;order.size()<topo.cpus.size();round++){
+        for(int n=0;n<topo.node_count;n++){
+            if(round<by_node[n].size()){
+                order.push_back(by_node[n][round]);
+            }
+        }
+    }
+    return order;
+}
+
+bool pin_current_thread(int cpu){
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu,&set);
+    int ret=pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+    if(ret!=0){
+        errno=ret;
+        perror("pthread_setaffinity_np");
+        return false;
+    }
+    return true;
+}
+
+// =================================================================
+// 2. 连接槽位
+// =================================================================
+
+bool conn_slab::init(int max_fd){
+    // MAP_NORESERVE：只占虚拟地址，真正用到的页才会分配物理内存
+    void* p=mmap(0,(size_t)max_fd*sizeof(http_conn),PROT_READ|PROT_WRITE,
+        MAP_PRIVATE|MAP_ANONYMOUS|MAP_NORESERVE,-1,0);
+    if(p==MAP_FAILED){
+        perror("conn_slab mmap");
+        return false;
+    }
+    m_conns=(http_conn*)p;
+    m_ready=(unsigned char*)calloc(max_fd,1);
+    m_owner=(short*)malloc(max_fd*sizeof(short));
+    if(!m_ready||!m_owner){
+        return false;
+    }
+    for(int i=0;i<max_fd;i++){
+        m_owner[i]=-1;
+    }
+    m_size=max_fd;
+    return true;
+}
+
+http_conn& conn_slab::at(int fd){
+    assert(fd>=0&&fd<m_size);
+    if(!m_ready[fd]){
+        // 在当前线程里构造 -> 这几页第一次被写，分配在当前线程所在的 NUMA 节点上
+        new(&m_conns[fd]) http_conn();
+        m_ready[fd]=1;
+    }
+    return m_conns[fd];
+}
+
+// =================================================================
+// 3. 连接上的事件 (原来写在 main 的事件循环里)
+// =================================================================
+
+void handle_conn_event(conn_slab& slab,const epoll_event& ev,long long ready_time){
+    int sockfd=ev.data.fd;
+
+    // 🐘 到 FastCGI 后端的连接 (不是客户端)：交给等着它的协程
+    if(fcgi_on_event(sockfd,ev.events)){
+        return;
+    }
+    http_conn& conn=slab.at(sockfd);
+
+    // 先看：是不是零拷贝的完成通知 (走 socket 的错误队列，所以报上来的是 EPOLLERR)
+    // 收掉以后 socket 没出错的话就不算错；只有这一个事件的话 ONESHOT 已经把它摘了，按原样挂回去
+    uint32_t events=ev.events;
+    if((events&EPOLLERR)&&conn.reap_zerocopy()){
+        events&=~EPOLLERR;
+        if(!(events&(EPOLLRDHUP|EPOLLHUP|EPOLLIN|EPOLLOUT))){
+            conn.rearm();
+            return;
+        }
+    }
+
+    // 情况二：对方断开 / 出错
+    if(events&(EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
+        conn.close_conn();
+    }
+
+    // 情况三：客人发数据来了
+    else if(events&EPOLLIN){
+        conn.mark_ready(ready_time);
+        if(conn.read_once()){
+            conn.process();
+        }else{
+            conn.close_conn();
+        }
+    }
+
+    // 情况四：可以往客人那边写了
+    else if(events&EPOLLOUT){
+        if(!conn.write()){
+            conn.close_conn();
+        }
+    }
+}
+
+void trim_idle_conns(conn_slab& slab,int owner){
+    for(int fd=0;fd<slab.size();fd++){
+        http_conn* conn=slab.find(fd);
+        if(conn&&slab.owner(fd)==owner){
+            conn->trim_idle();
+        }
+    }
+    mem_pool::trim();
+    mem_budget_shrink_shared();
+}
+
+// =================================================================
+// 4. I/O 线程
+// =================================================================
+
+io_loop::io_loop()
+    :m_id(-1),m_cpu(-1),m_epollfd(-1),m_notify_fd(-1),m_started(false),m_slab(0),m_stop(false){
+    pthread_mutex_init(&m_lock,NULL);
+}
+
+io_loop::~io_loop(){
+    if(m_epollfd!=-1){
+        close(m_epollfd);
+    }
+    if(m_notify_fd!=-1){
+        close(m_notify_fd);
+    }
+    pthread_mutex_destroy(&m_lock);
+}
+
+bool io_loop::start(int id,int cpu,conn_slab* slab){
+    m_id=id;
+    m_cpu=cpu;
+    m_slab=slab;
+
+    m_epollfd=epoll_create1(EPOLL_CLOEXEC);
+    m_notify_fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    if(m_epollfd==-1||m_notify_fd==-1){
+        perror("io_loop start");
+        return false;
+    }
+
+    // eventfd 用默认的 LT 模式，不用 ONESHOT
+    struct epoll_event event;
+    event.data.fd=m_notify_fd;
+    event.events=EPOLLIN;
+    epoll_ctl(m_epollfd,EPOLL_CTL_ADD,m_notify_fd,&event);
+
+    // 新线程屏蔽所有信号 (线程会继承创建者的信号掩码)：
+    // SIGHUP / SIGUSR2 只让主线程收到，它的 epoll_wait 才会被打断
+    sigset_t all,old;
+    sigfillset(&all);
+    pthread_sigmask(SIG_BLOCK,&all,&old);
+    int ret=pthread_create(&m_thread,NULL,worker,this);
+    pthread_sigmask(SIG_SETMASK,&old,NULL);
+    if(ret!=0){
+        perror("io_loop pthread_create");
+        return false;
+    }
+    m_started=true;
+    return true;
+}
+
+void io_loop::post(int connfd,const sockaddr_in& addr,bool tls){
+    pending_conn c;
+    c.fd=connfd;
+    c.addr=addr;
+    c.tls=tls;
+
+    pthread_mutex_lock(&m_lock);
+    m_pending.push_back(c);
+    pthread_mutex_unlock(&m_lock);
+    wake();
+}
+
+void io_loop::wake(){
+    uint64_t one=1;
+    ssize_t ret=::write(m_notify_fd,&one,sizeof(one));
+    (void)ret; // 计数器满了也没关系，反正它会被叫醒
+}
+
+void io_loop::stop(){
+    pthread_mutex_lock(&m_lock);
+    m_stop=true;
+    pthread_mutex_unlock(&m_lock);
+    wake();
+}
+
+void io_loop::join(){
+    if(m_started){
+        pthread_join(m_thread,NULL);
+        m_started=false;
+    }
+}
+
+void* io_loop::worker(void* arg){
+    ((io_loop*)arg)->run();
+    return NULL;
+}
+
+void io_loop::accept_pending(){
+    std::vector<pending_conn> batch;
+    pthread_mutex_lock(&m_lock);
+    batch.swap(m_pending);
+    pthread_mutex_unlock(&m_lock);
+
+    for(size_t i=0;i<batch.size();i++){
+        m_slab->at(batch[i].fd).init(batch[i].fd,batch[i].addr,batch[i].tls);
+    }
+}
+
+void io_loop::close_idle(){
+    for(int fd=0;fd<m_slab->size();fd++){
+        http_conn* conn=m_slab->find(fd);
+        if(conn&&m_slab->owner(fd)==m_id&&conn->is_idle()){
+            conn->close_conn();
+        }
+    }
+}
+
+void io_loop::close_all(){
+    for(int fd=0;fd<m_slab->size();fd++){
+        http_conn* conn=m_slab->find(fd);
+        if(conn&&m_slab->owner(fd)==m_id){
+            conn->close_conn();
+        }
+    }
+}
+
+void io_loop::run(){
+    // 这个线程里的 http_conn 都注册到自己的 epoll 上
+    http_conn::m_epollfd=m_epollfd;
+    // 别的线程要叫醒这里的协程 (比如缓存算好了)，也走这个 eventfd
+    co_waker_bind(m_notify_fd);
+    ws_hub_bind(m_notify_fd);   // 广播也走这个 eventfd
+    if(m_cpu>=0){
+        pin_current_thread(m_cpu);
+    }
+
+    struct epoll_event events[LOOP_EVENT_NUMBER];
+    bool drain_started=false;
+
+    // 🏎️ 空转还是睡 (见 busy_poll.h)
+    event_waiter waiter;
+    long long last_batch=0;     // 上一批事件回来的时刻 (CoDel 算排队时间用)
+    {
+        std::shared_ptr<const server_config> conf=current_config();
+        waiter.init(m_epollfd,conf->poll_mode,conf->busy_poll_us);
+    }
+
+    while(true){
+        // 有协程在 sleep：最晚在最近的定时器到期时醒来；排空的时候也要定时看看
+        int timeout=co_timer_next_ms(http_conn::now_us());
+        if(http_conn::m_draining&&(timeout<0||timeout>1000)){
+            timeout=1000;
+        }
+        int number=epoll_wait(m_epollfd,events,LOOP_EVENT_NUMBER,0);
+        bool waited=number==0;
+        if(waited){
+            number=waiter.wait(m_epollfd,events,LOOP_EVENT_NUMBER,timeout);
+        }
+        if(number<0&&errno!=EINTR){
+            perror("io_loop epoll_wait");
+            break;
+        }
+
+        long long ready_time=http_conn::batch_ready_time(waited,http_conn::now_us(),last_batch);
+        for(int i=0;i<number;i++){
+            if(events[i].data.fd==m_notify_fd){
+                uint64_t count;
+                ssize_t ret=read(m_notify_fd,&count,sizeof(count));
+                (void)ret;
+                accept_pending();
+                co_waker_run();
+                ws_hub_run();
+                continue;
+            }
+            handle_conn_event(*m_slab,events[i],ready_time);
+        }
+
+        co_timer_run(http_conn::now_us());
+
+        // 🧮 交内存账；过了软上限就瘦身
+        if(mem_budget_poll()){
+            trim_idle_conns(*m_slab,m_id);
+        }
+
+        // 🚪 开始排空了：闲着的长连接直接挂掉，正在处理的等它回完
+        if(http_conn::m_draining&&!drain_started){
+            drain_started=true;
+            close_idle();
+        }
+
+        pthread_mutex_lock(&m_lock);
+        bool stop=m_stop;
+        pthread_mutex_unlock(&m_lock);
+        if(stop){
+            close_all();
+            break;
+        }
+    }
+
+    trace_flush();
+
+#ifndef NDEBUG
+    printf("I/O 线程 %d (cpu %d) 退出: ",m_id,m_cpu);
+    mem_pool::dump_stats();
+#endif
+}
@@ -0,0 +1,119 @@
+#ifndef IOLOOP_H
+#define IOLOOP_H
+
+#include<pthread.h>
+#include<netinet/in.h>
+#include<sys/epoll.h>
+#include<vector>
+#include "http_conn.h"
+
+// 🧭 多个 I/O 循环 + CPU 亲和性 / NUMA 感知
+// 主线程只管 accept，然后把连接交给某个 I/O 线程；每个 I/O 线程有自己的 epoll，
+// 绑在一个固定的核上，连接从头到尾都在这个核上处理，不会在核之间 / NUMA 节点之间跳来跳去。
+//
+// 内存放置靠 Linux 默认的 “first touch” 策略：页面第一次被谁写，就分配在谁所在的节点上。
+// 所以 http_conn 的槽位 (连同里面的读写缓冲区) 不在启动时统一构造，
+// 而是等连接第一次交给某个 I/O 线程时，由那个线程自己构造 -> 落在它本地的节点上。
+// mem_pool 本来就是每线程一份，绑核之后池子里的块也都是本地的。
+//
+// 📏 绑核有没有用要在多核 (最好是多 NUMA 节点) 的机器上量：io_loops 不变，cpu_pinning=1 和 0 各起一次服务器，
+// 用 http_bench (见 http_bench.cpp) 带 -P 服务器进程号 各打一遍，比请求 / 秒、p99 和 CPU 秒 / GB。
+// 压测端最好用 taskset 绑到 I/O 线程以外的核上，不然它和服务器抢核，量出来的是调度噪声。
+
+// 🗺️ CPU 拓扑 (读 /sys/devices/system/node，不依赖 libnuma)
+struct cpu_topology{
+    std::vector<int> cpus;      // 可以用的 CPU 编号
+    std::vector<int> node_of;   // node_of[cpu]: 这个 CPU 属于哪个 NUMA 节点
+    int node_count;
+};
+void load_topology(cpu_topology& topo);
+
+// 按 NUMA 节点轮流排好的 CPU 顺序：node0 的第 1 个核, node1 的第 1 个核, node0 的第 2 个核 ...
+// 这样开 N 个 I/O 线程时，它们会均匀地分到各个节点上
+std::vector<int> spread_cpus(const cpu_topology& topo);
+
+// 📌 把当前线程绑到一个核上
+bool pin_current_thread(int cpu);
+
+// 🧱 http_conn 槽位 (还是用 fd 当下标)
+// 整块用 mmap 占一段虚拟地址，不预先构造：用到哪个槽位才在当前线程里构造它
+class conn_slab{
+public:
+    conn_slab():m_conns(0),m_ready(0),m_owner(0),m_size(0){}
+    bool init(int max_fd);
+
+    // 拿一个槽位，还没构造过就现在构造 (只能在负责这个 fd 的线程里调用)
+    // fd 直接当下标用：accept 那边已经把 >= size() 的 fd 挂掉了，这里只断言
+    http_conn& at(int fd);
+
+    // 构造过的才返回，否则 NULL (用来遍历；超出范围的 fd 也是 NULL)
+    http_conn* find(int fd){return (fd>=0&&fd<m_size&&m_ready[fd])?&m_conns[fd]:0;}
+
+    int size() const{return m_size;}
+
+    // 这个 fd 现在归哪个 I/O 线程管 (-1 表示主线程自己，超出范围的也算 -1)
+    int owner(int fd) const{return (fd>=0&&fd<m_size)?m_owner[fd]:-1;}
+    void set_owner(int fd,int loop){m_owner[fd]=loop;}
+
+private:
+    http_conn* m_conns;
+    unsigned char* m_ready;
+    short* m_owner;
+    int m_size;
+};
+
+// 🔁 处理一个连接 fd 上的事件 (主线程单循环模式和 I/O 线程共用)
+void handle_conn_event(conn_slab& slab,const epoll_event& ev,long long ready_time);
+
+// 🧮 过了内存软上限时每个事件循环自己调 (见 mem_budget.h)：
+// 归 owner 管的闲连接瘦身，本线程的 mem_pool 空闲块还给系统，微缓存砍一半
+void trim_idle_conns(conn_slab& slab,int owner);
+
+// 🔁 一个 I/O 线程
+class io_loop{
+public:
+    io_loop();
+    ~io_loop();
+
+    // 创建 epoll 和通知用的 eventfd，启动线程 (cpu<0 表示不绑核)
+    bool start(int id,int cpu,conn_slab* slab);
+
+    // 📨 主线程把一个新连接交过来
+    void post(int connfd,const sockaddr_in& addr,bool tls);
+
+    // 🔔 叫醒它看一眼全局状态 (比如开始排空了)
+    void wake();
+
+    // 🛑 让它关掉自己所有的连接然后退出，等它结束
+    void stop();
+    void join();
+
+    int cpu() const{return m_cpu;}
+
+private:
+    static void* worker(void* arg);
+    void run();
+    void accept_pending();
+    void close_idle();
+    void close_all();
+
+    struct pending_conn{
+        int fd;
+        sockaddr_in addr;
+        bool tls;
+    };
+
+    int m_id;
+    int m_cpu;
+    int m_epollfd;
+    int m_notify_fd;                        // eventfd：主线程写它来叫醒这个线程
+    pthread_t m_thread;
+    bool m_started;
+    conn_slab* m_slab;
+
+    pthread_mutex_t m_lock;                 // 保护下面两个 (主线程写，I/O 线程读)
+    std::vector<pending_conn> m_pending;    // 还没接手的新连接
+    bool m_stop;
+};
+
+#endif
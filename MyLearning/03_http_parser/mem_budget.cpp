@@ -0,0 +1,170 @@
+#include "mem_budget.h"
+#include "micro_cache.h"
+#include<stdio.h>
+#include<time.h>
+#include<unistd.h>
+#include<atomic>
+
+// =================================================================
+// 1. 全局账本
+// =================================================================
+
+static const long long MEM_FLUSH_BYTES=64*1024;     // 本线程攒够这么多才交一次账
+static const long long MEM_TRIM_INTERVAL_US=100000; // 每个线程最多 100ms 瘦身一次
+
+static const char* const MEM_NAMES[MEM_CATEGORY_COUNT]={
+    "连接对象","读缓冲区","arena","发送链","协程帧","HTTP/2 会话","池里空闲","微缓存"
+};
+
+static std::atomic<long long> g_used[MEM_CATEGORY_COUNT];
+static std::atomic<long long> g_peak(0);
+static std::atomic<int> g_level(MEM_OK);
+static std::atomic<long long> g_soft_hits(0);       // 进软上限的次数
+static std::atomic<long long> g_refused(0);         // 硬上限拒掉的连接
+static std::atomic<long long> g_last_shared_trim(0);
+static std::atomic<long long> g_soft(0);     // 热更新会改，记账的线程随时在读
+static std::atomic<long long> g_hard(0);
+
+static thread_local long long t_delta[MEM_CATEGORY_COUNT];
+static thread_local long long t_last_trim=0;
+
+static long long mem_now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static void update_level();
+
+void mem_budget_set_limits(size_t soft,size_t hard){
+    long long s=(long long)soft;
+    long long h=(long long)hard;
+    if(h>0&&s>h){
+        s=h;
+    }
+    if(s==g_soft.load(std::memory_order_relaxed)&&h==g_hard.load(std::memory_order_relaxed)){
+        return;     // 热更新没动这两项
+    }
+    g_soft.store(s,std::memory_order_relaxed);
+    g_hard.store(h,std::memory_order_relaxed);
+    if(s==0&&h==0){
+        g_level.store(MEM_OK,std::memory_order_relaxed);    // 不设上限了：update_level 不再算档位，别卡在老的档位上
+        printf("🧮 内存预算: 不设上限\n");
+        return;
+    }
+    printf("🧮 内存预算: 软上限 %lld MB, 硬上限 %lld MB\n",s>>20,h>>20);
+    update_level();
+}
+
+// =================================================================
+// 2. 记账 / 算档位
+// =================================================================
+
+// 离开一档要降到这一档的线下面 10%，不然在线附近来回跳，accept 一会停一会开
+static MEM_LEVEL level_of(long long total,int cur){
+    long long hard=g_hard.load(std::memory_order_relaxed);
+    long long soft=g_soft.load(std::memory_order_relaxed);
+    if(hard>0&&(total>=hard||(cur==MEM_HARD&&total>=hard-hard/10))){
+        return MEM_HARD;
+    }
+    if(soft>0&&(total>=soft||(cur>=MEM_SOFT&&total>=soft-soft/10))){
+        return MEM_SOFT;
+    }
+    return MEM_OK;
+}
+
+static void update_level(){
+    long long total=mem_used_total();
+    long long peak=g_peak.load(std::memory_order_relaxed);
+    while(total>peak&&!g_peak.compare_exchange_weak(peak,total,std::memory_order_relaxed)){
+    }
+    if(g_soft.load(std::memory_order_relaxed)==0&&g_hard.load(std::memory_order_relaxed)==0){
+        return;
+    }
+    int cur=g_level.load(std::memory_order_relaxed);
+    MEM_LEVEL next=level_of(total,cur);
+    if(next!=cur&&g_level.compare_exchange_strong(cur,next,std::memory_order_relaxed)){
+        if(next>cur&&cur==MEM_OK){
+            g_soft_hits.fetch_add(1,std::memory_order_relaxed);
+        }
+        static const char* const names[]={"正常","软上限","硬上限"};
+        printf("🧮 内存 %.1f MB: %s -> %s\n",total/1048576.0,names[cur],names[next]);
+    }
+}
+
+static void flush_one(int cat){
+    g_used[cat].fetch_add(t_delta[cat],std::memory_order_relaxed);
+    t_delta[cat]=0;
+}
+
+void mem_charge(MEM_CATEGORY cat,long long delta){
+    long long d=t_delta[cat]+delta;
+    t_delta[cat]=d;
+    if(d>=MEM_FLUSH_BYTES||d<=-MEM_FLUSH_BYTES){
+        flush_one(cat);
+        update_level();
+    }
+}
+
+MEM_LEVEL mem_level(){
+    return (MEM_LEVEL)g_level.load(std::memory_order_relaxed);
+}
+
+long long mem_used_total(){
+    long long total=0;
+    for(int i=0;i<MEM_CATEGORY_COUNT;i++){
+        total+=g_used[i].load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+bool mem_budget_poll(){
+    bool dirty=false;
+    for(int i=0;i<MEM_CATEGORY_COUNT;i++){
+        if(t_delta[i]!=0){
+            flush_one(i);
+            dirty=true;
+        }
+    }
+    if(dirty){
+        update_level();
+    }
+    if(mem_level()<MEM_SOFT){
+        return false;
+    }
+    long long now=mem_now_us();
+    if(now-t_last_trim<MEM_TRIM_INTERVAL_US){
+        return false;
+    }
+    t_last_trim=now;
+    return true;
+}
+
+// =================================================================
+// 3. 瘦身 / 统计
+// =================================================================
+
+void mem_budget_shrink_shared(){
+    long long now=mem_now_us();
+    long long last=g_last_shared_trim.load(std::memory_order_relaxed);
+    if(now-last<MEM_TRIM_INTERVAL_US||!g_last_shared_trim.compare_exchange_strong(last,now)){
+        return; // 别的线程刚砍过
+    }
+    response_cache().shrink();
+}
+
+void mem_note_refused(){
+    g_refused.fetch_add(1,std::memory_order_relaxed);
+}
+
+void mem_budget_dump(){
+    for(int i=0;i<MEM_CATEGORY_COUNT;i++){
+        flush_one(i);   // 至少本线程的账是最新的
+    }
+    printf("🧮 内存 (pid %d): 合计 %.1f MB (峰值 %.1f MB)",getpid(),mem_used_total()/1048576.0,g_peak.load()/1048576.0);
+    for(int i=0;i<MEM_CATEGORY_COUNT;i++){
+        printf(", %s %.1f",MEM_NAMES[i],g_used[i].load(std::memory_order_relaxed)/1048576.0);
+    }
+    printf(" | 进软上限 %lld 次, 硬上限拒绝 %lld 个连接\n",g_soft_hits.load(),g_refused.load());
+    fflush(stdout);
+}
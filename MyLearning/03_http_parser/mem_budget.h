@@ -0,0 +1,61 @@
+#ifndef MEMBUDGET_H
+#define MEMBUDGET_H
+
+#include<stddef.h>
+
+// 🧮 全进程的内存预算：连接、缓冲区、缓存用了多少内存都记在这里，按类别分开记
+// 原来什么都不封顶：连接一多 (哪怕都是闲着的长连接)，内存就一路涨到被 OOM killer 干掉。
+// 现在有两条线 (配置 mem_soft_mb / mem_hard_mb，0 表示不设，只记账；SIGHUP 热更新马上生效)：
+//   - 软上限：开始“瘦身”——微缓存砍掉一半、容量也先减半；闲着的长连接把 arena / 发送链的块还回去；
+//     各个线程 mem_pool 空闲链表里囤的块全部还给系统
+//   - 硬上限：不再借新的读缓冲区 -> 还没开始读请求的连接直接回 503 挂断，
+//     主线程也暂停 accept (和过载时一样)；已经在处理的请求照常做完，做完内存就降下来了
+// 读缓冲区也不再是每个连接固定带 2KB：要读的时候才从 mem_pool 借，请求处理完就还，
+// 闲着的长连接什么缓冲区都不占。
+//
+// 记账是每个线程先攒在自己的 thread_local 里，攒够 MEM_FLUSH_BYTES 或者事件循环转一圈时
+// 才加到全局的原子计数上 (热路径上没有共享的缓存行)，所以全局的数最多差 线程数 x 类别数 x 64KB。
+// 多进程模式下每个 worker 各记各的，上限也是每个 worker 一份。
+// kill -USR1 <pid> 打印各类别现在用了多少 (多进程模式下 master 打印每个 worker 的合计)。
+
+enum MEM_CATEGORY{
+    MEM_CONN=0,         // http_conn 本身 (每个连接固定的那部分)
+    MEM_READ_BUF,       // 借出去的读缓冲区
+    MEM_ARENA,          // request_arena 的块
+    MEM_OUT,            // out_chain 的块 (响应头这种现拼的文本)
+    MEM_CORO,           // 协程 handler 的帧
+    MEM_H2,             // HTTP/2 会话 (连同里面的 stream 槽位)
+    MEM_POOL_IDLE,      // mem_pool 空闲链表里囤着、还没还给系统的块
+    MEM_CACHE,          // 微缓存里的响应
+    MEM_CATEGORY_COUNT
+};
+
+enum MEM_LEVEL{
+    MEM_OK=0,
+    MEM_SOFT,           // 过了软上限：该瘦身了
+    MEM_HARD            // 过了硬上限：不再接新的读
+};
+
+// 设上限 (字节，0 表示不设)：启动时和每次热更新配置后调，改了的下一次记账就按新的线算
+void mem_budget_set_limits(size_t soft,size_t hard);
+
+// ➕➖ 记一笔 (delta 可以是负的)，任何线程都能调
+void mem_charge(MEM_CATEGORY cat,long long delta);
+
+// 现在在哪一档 (只读一个原子变量，随便调)
+MEM_LEVEL mem_level();
+
+// 🔁 每个事件循环每转一圈调一次：把本线程攒的账交上去，重新算档位
+// 返回 true 表示过了软上限，该本线程瘦身了 (每个线程最多 100ms 一次)
+bool mem_budget_poll();
+
+// 瘦身时本线程之外的那部分 (微缓存)：多个线程同时叫也只有一个真的去做
+void mem_budget_shrink_shared();
+
+// 硬上限拒绝了一个连接
+void mem_note_refused();
+
+long long mem_used_total();
+void mem_budget_dump();     // 📊 每个类别一行
+
+#endif
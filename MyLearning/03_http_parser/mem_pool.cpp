@@ -0,0 +1,179 @@
+#include "mem_pool.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdint.h>
+#include<new>
+
+// =================================================================
+// 1. mem_pool：每线程的分档空闲链表
+// =================================================================
+
+struct free_node{
+    free_node* next;
+};
+
+// 每个线程自己的链表，不用加锁
+static thread_local free_node* t_free[mem_pool::CLASS_COUNT];
+static thread_local size_t t_free_count[mem_pool::CLASS_COUNT];
+
+#ifndef NDEBUG
+static thread_local mem_pool::stats t_stats;
+#define POOL_STAT(field,n) (t_stats.field+=(n))
+#else
+#define POOL_STAT(field,n) ((void)0)
+#endif
+
+// 每档最多囤多少个空闲块：小块多囤一些，大块少囤 (每档大约 1MB 封顶)
+static size_t max_free_of(int cls){
+    size_t size=mem_pool::MIN_CLASS<<cls;
+    size_t n=(1<<20)/size;
+    return n<4?4:n;
+}
+
+// 向上取到 2 的幂以后是第几档：64 以下都是第 0 档；其他的看 size-1 最高位在哪 (64 = 2^6 是第 0 档)
+int mem_pool::class_of(size_t size){
+    if(size<=MIN_CLASS){
+        return 0;
+    }
+    return (int)(sizeof(unsigned long)*8)-__builtin_clzl(size-1)-6;
+}
+
+size_t mem_pool::block_size(size_t size){
+    if(size>MAX_POOLED){
+        return size;
+    }
+    return MIN_CLASS<<class_of(size);
+}
+
+void* mem_pool::alloc(size_t size,MEM_CATEGORY cat){
+    if(size>MAX_POOLED){
+        POOL_STAT(pool_misses,1);
+        mem_charge(cat,size);
+        return ::operator new(size);
+    }
+    int cls=class_of(size);
+    size_t block=MIN_CLASS<<cls;
+    mem_charge(cat,block);
+    free_node* n=t_free[cls];
+    if(n){
+        t_free[cls]=n->next;
+        t_free_count[cls]--;
+        mem_charge(MEM_POOL_IDLE,-(long long)block);
+        POOL_STAT(pool_hits,1);
+        return n;
+    }
+    POOL_STAT(pool_misses,1);
+    return ::operator new(block);
+}
+
+void mem_pool::free(void* p,size_t size,MEM_CATEGORY cat){
+    if(!p){
+        return;
+    }
+    if(size>MAX_POOLED){
+        POOL_STAT(global_frees,1);
+        mem_charge(cat,-(long long)size);
+        ::operator delete(p);
+        return;
+    }
+    int cls=class_of(size);
+    size_t block=MIN_CLASS<<cls;
+    mem_charge(cat,-(long long)block);
+    // 空闲块太多了 (突发流量过后)：还给系统，不无限囤着
+    if(t_free_count[cls]>=max_free_of(cls)){
+        POOL_STAT(global_frees,1);
+        ::operator delete(p);
+        return;
+    }
+    free_node* n=(free_node*)p;
+    n->next=t_free[cls];
+    t_free[cls]=n;
+    t_free_count[cls]++;
+    mem_charge(MEM_POOL_IDLE,block);
+}
+
+void mem_pool::trim(){
+    for(int cls=0;cls<CLASS_COUNT;cls++){
+        size_t block=MIN_CLASS<<cls;
+        while(t_free[cls]){
+            free_node* next=t_free[cls]->next;
+            ::operator delete(t_free[cls]);
+            t_free[cls]=next;
+            POOL_STAT(global_frees,1);
+        }
+        mem_charge(MEM_POOL_IDLE,-(long long)(block*t_free_count[cls]));
+        t_free_count[cls]=0;
+    }
+}
+
+#ifndef NDEBUG
+mem_pool::stats& mem_pool::get_stats(){
+    return t_stats;
+}
+
+void mem_pool::dump_stats(){
+    printf("📊 mem_pool: 链表命中 %zu, 找全局要 %zu, 还给全局 %zu | arena: 切了 %zu 次 / %zu 字节, 新块 %zu\n",
+        t_stats.pool_hits,t_stats.pool_misses,t_stats.global_frees,
+        t_stats.arena_allocs,t_stats.arena_bytes,t_stats.arena_chunks);
+}
+#endif
+
+// =================================================================
+// 2. request_arena：每个请求一个碰指针分配器
+// =================================================================
+
+void* request_arena::alloc(size_t size,size_t align){
+    uintptr_t p=((uintptr_t)m_ptr+align-1)&~(uintptr_t)(align-1);
+    if(!m_ptr||p+size>(uintptr_t)m_end){
+        // 当前块不够了：再要一块 (特别大的请求单独要一块刚好够的)
+        size_t need=sizeof(chunk)+size+align;
+        size_t want=mem_pool::block_size(need>CHUNK_SIZE?need:CHUNK_SIZE);
+        chunk* c=(chunk*)mem_pool::alloc(want,MEM_ARENA);
+        c->size=want;
+        c->next=m_head;
+        m_head=c;
+        if(!m_first){
+            m_first=c;
+        }
+        m_ptr=(char*)(c+1);
+        m_end=(char*)c+want;
+        POOL_STAT(arena_chunks,1);
+        p=((uintptr_t)m_ptr+align-1)&~(uintptr_t)(align-1);
+    }
+    m_ptr=(char*)(p+size);
+    POOL_STAT(arena_allocs,1);
+    POOL_STAT(arena_bytes,size);
+    return (void*)p;
+}
+
+char* request_arena::strdup(const char* s,size_t len){
+    char* p=(char*)alloc(len+1,1);
+    memcpy(p,s,len);
+    p[len]='\0';
+    return p;
+}
+
+void request_arena::reset(){
+    if(!m_first){
+        return; // 这个请求压根没用过 arena (比如普通的静态文件)
+    }
+    // 后来加的块还回去，只留第一块
+    while(m_head!=m_first){
+        chunk* next=m_head->next;
+        mem_pool::free(m_head,m_head->size,MEM_ARENA);
+        m_head=next;
+    }
+    m_ptr=(char*)(m_first+1);
+    m_end=(char*)m_first+m_first->size;
+}
+
+void request_arena::release(){
+    while(m_head){
+        chunk* next=m_head->next;
+        mem_pool::free(m_head,m_head->size,MEM_ARENA);
+        m_head=next;
+    }
+    m_first=0;
+    m_ptr=0;
+    m_end=0;
+}
@@ -0,0 +1,82 @@
+#ifndef MEMPOOL_H
+#define MEMPOOL_H
+
+#include<stddef.h>
+#include "mem_budget.h"
+
+// 🧱 请求路径上的内存管理
+// 1. mem_pool：每个线程一份、按 2 的幂分档的空闲链表。
+//    块用完挂回链表，下次直接拿，稳定之后请求路径上不再调用全局 malloc / free。
+//    (哪个线程 free 的就挂到哪个线程的链表上，块本身都来自 operator new，跨线程也不会出错)
+// 2. request_arena：挂在每个连接上的“碰指针”分配器。
+//    一个请求里要的零碎内存 (协程 handler 的缓冲区、解析出来的字符串……) 都从这里切，
+//    不用一个个释放，请求结束 init() 时一次性清空。
+// 借出去的块记在调用方给的类别上，空闲链表里囤着的记在 MEM_POOL_IDLE 上 (见 mem_budget.h)
+
+class mem_pool{
+public:
+    static const size_t MIN_CLASS=64;       // 最小一档 64 字节
+    static const size_t MAX_POOLED=65536;   // 比这大的直接走 operator new
+    static const int CLASS_COUNT=11;        // 64, 128, ..., 65536
+
+    static void* alloc(size_t size,MEM_CATEGORY cat);
+    static void free(void* p,size_t size,MEM_CATEGORY cat);
+
+    // 🧹 本线程空闲链表里的块全部还给系统 (内存紧张时，每个线程在自己的事件循环里调)
+    static void trim();
+
+    // 实际分到的块有多大 (按档向上取整)，调用者可以把多出来的部分也用上
+    static size_t block_size(size_t size);
+
+#ifndef NDEBUG
+    // 📊 调试用计数器 (本线程)，Release 编译 (-DNDEBUG) 时整个去掉
+    struct stats{
+        size_t pool_hits;       // 从空闲链表直接拿到
+        size_t pool_misses;     // 链表空了，找全局分配器要
+        size_t global_frees;    // 链表满了 / 块太大，还给全局分配器
+        size_t arena_allocs;    // 从 arena 切出去的次数
+        size_t arena_bytes;     // 从 arena 切出去的字节数
+        size_t arena_chunks;    // arena 新要的块数
+    };
+    static stats& get_stats();
+    static void dump_stats();
+#endif
+
+private:
+    static int class_of(size_t size);
+};
+
+class request_arena{
+public:
+    static const size_t CHUNK_SIZE=4096;    // 每次找 mem_pool 要一块 4KB
+
+    request_arena():m_head(0),m_first(0),m_ptr(0),m_end(0){}
+    ~request_arena(){release();}
+
+    // 🔪 切一块内存 (不用释放，跟着请求一起走)
+    void* alloc(size_t size,size_t align=sizeof(void*));
+
+    // 📝 拷一份字符串 (带 \0)
+    char* strdup(const char* s,size_t len);
+
+    // 🔄 请求结束：只留第一块，指针拨回开头。大多数请求只用到一块，这就是 O(1)
+    void reset();
+
+    // 🗑️ 连接关闭：所有块都还给 mem_pool
+    void release();
+
+private:
+    request_arena(const request_arena&)=delete;
+    request_arena& operator=(const request_arena&)=delete;
+
+    struct chunk{
+        chunk* next;
+        size_t size;    // 整块的大小 (包括这个头)
+    };
+    chunk* m_head;      // 最新的一块 (正在切的)
+    chunk* m_first;     // 最早的那一块 (reset 时留着)
+    char* m_ptr;        // 当前块里下一次从哪切
+    char* m_end;        // 当前块的结尾
+};
+
+#endif
@@ -0,0 +1,250 @@
+#include "micro_cache.h"
+#include "http_conn.h"
+#include "mem_budget.h"
+#include<functional>
+
+// =================================================================
+// 1. 填缓存的凭证
+// =================================================================
+
+cache_fill& cache_fill::operator=(cache_fill&& other){
+    if(this!=&other){
+        abandon();
+        m_shard=other.m_shard;
+        m_key=std::move(other.m_key);
+        other.m_shard=0;
+    }
+    return *this;
+}
+
+std::shared_ptr<const cached_response> cache_fill::store(const char* head,size_t head_len,const char* body,size_t body_len,int ttl_ms,int stale_ms){
+    if(!m_shard){
+        return std::shared_ptr<const cached_response>();
+    }
+    // 在锁外面把整份响应拷好，锁里只换指针
+    std::shared_ptr<cached_response> resp=std::make_shared<cached_response>();
+    resp->head.assign(head,head_len);
+    resp->body.assign(body,body_len);
+    long long now=http_conn::now_us();
+    resp->fresh_until=now+(long long)ttl_ms*1000;
+    resp->stale_until=resp->fresh_until+(long long)stale_ms*1000;
+
+    cache_shard* shard=m_shard;
+    m_shard=0;
+    shard->store(m_key,resp);
+    return resp;
+}
+
+void cache_fill::abandon(){
+    if(m_shard){
+        cache_shard* shard=m_shard;
+        m_shard=0;
+        shard->abandon(m_key);
+    }
+}
+
+// =================================================================
+// 2. 分片：查 / 填 / 放弃 / CLOCK 淘汰
+// =================================================================
+
+cache_shard::cache_shard():m_bytes(0),m_capacity(0){
+    pthread_mutex_init(&m_lock,NULL);
+    m_hand=m_ring.end();
+}
+
+cache_shard::~cache_shard(){
+    pthread_mutex_destroy(&m_lock);
+}
+
+CACHE_STATE cache_shard::lookup(const std::string& key,long long now,const cache_waiter& waiter,cache_result& out){
+    pthread_mutex_lock(&m_lock);
+
+    std::unordered_map<std::string,entry_iter>::iterator it=m_index.find(key);
+    if(it==m_index.end()){
+        // 第一次见：占个位置，标记成“有人在算”，后来的都等它
+        entry e;
+        e.key=key;
+        e.bytes=0;
+        e.filling=true;
+        e.referenced=true;
+        entry_iter pos=m_ring.insert(m_hand,e);
+        m_index[key]=pos;
+        pthread_mutex_unlock(&m_lock);
+        out.state=CACHE_MISS;
+        out.fill=cache_fill(this,key);
+        return CACHE_MISS;
+    }
+
+    entry& e=*it->second;
+    if(e.resp&&now<e.resp->fresh_until){
+        e.referenced=true;
+        out.resp=e.resp;
+        pthread_mutex_unlock(&m_lock);
+        out.state=CACHE_HIT;
+        return CACHE_HIT;
+    }
+
+    if(e.resp&&now<e.resp->stale_until){
+        // 先拿旧的顶着；还没人在刷新的话，就由这个请求来刷新
+        e.referenced=true;
+        out.resp=e.resp;
+        bool refresh=!e.filling;
+        e.filling=true;
+        pthread_mutex_unlock(&m_lock);
+        out.state=CACHE_STALE;
+        if(refresh){
+            out.fill=cache_fill(this,key);
+        }
+        return CACHE_STALE;
+    }
+
+    // 彻底过期了 (或者第一次还没算出来)
+    if(e.filling){
+        e.waiters.push_back(waiter);
+        pthread_mutex_unlock(&m_lock);
+        out.state=CACHE_WAIT;
+        return CACHE_WAIT;
+    }
+    e.filling=true;
+    pthread_mutex_unlock(&m_lock);
+    out.state=CACHE_MISS;
+    out.fill=cache_fill(this,key);
+    return CACHE_MISS;
+}
+
+void cache_shard::store(const std::string& key,std::shared_ptr<const cached_response> resp){
+    std::vector<cache_waiter> waiters;
+    std::shared_ptr<const cached_response> old;    // 老的那份放到锁外面再释放
+
+    pthread_mutex_lock(&m_lock);
+    std::unordered_map<std::string,entry_iter>::iterator it=m_index.find(key);
+    if(it!=m_index.end()){
+        entry& e=*it->second;
+        size_t bytes=resp->head.size()+resp->body.size()+key.size()+sizeof(entry);
+        mem_charge(MEM_CACHE,(long long)bytes-(long long)e.bytes);
+        m_bytes-=e.bytes;
+        m_bytes+=bytes;
+        e.bytes=bytes;
+        old.swap(e.resp);
+        e.resp=resp;
+        e.filling=false;
+        e.referenced=true;
+        waiters.swap(e.waiters);
+        evict(mem_level()>=MEM_SOFT?m_capacity/2:m_capacity);
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    wake_all(waiters);
+}
+
+void cache_shard::abandon(const std::string& key){
+    std::vector<cache_waiter> waiters;
+
+    pthread_mutex_lock(&m_lock);
+    std::unordered_map<std::string,entry_iter>::iterator it=m_index.find(key);
+    if(it!=m_index.end()){
+        entry& e=*it->second;
+        e.filling=false;
+        waiters.swap(e.waiters);
+        // 一次都没算出来过：位置也不占了
+        if(!e.resp){
+            if(m_hand==it->second){
+                ++m_hand;
+            }
+            m_ring.erase(it->second);
+            m_index.erase(it);
+        }
+    }
+    pthread_mutex_unlock(&m_lock);
+
+    // 叫醒等着的人：他们会重新查一遍，其中一个接着算
+    wake_all(waiters);
+}
+
+void cache_shard::evict(size_t limit){
+    // 🕰️ CLOCK：指针转一圈，访问位是 1 的清成 0 放过，是 0 的踢掉
+    // 正在算的 (filling) 不踢，不然等着它的人就永远等不到了
+    size_t budget=m_ring.size()*2;
+    while(m_bytes>limit&&budget-->0){
+        if(m_hand==m_ring.end()){
+            m_hand=m_ring.begin();
+            if(m_hand==m_ring.end()){
+                break;
+            }
+        }
+        entry& e=*m_hand;
+        if(e.filling||e.referenced){
+            e.referenced=false;
+            ++m_hand;
+            continue;
+        }
+        m_bytes-=e.bytes;
+        mem_charge(MEM_CACHE,-(long long)e.bytes);
+        m_index.erase(e.key);
+        m_hand=m_ring.erase(m_hand);
+    }
+}
+
+void cache_shard::set_capacity(size_t bytes){
+    pthread_mutex_lock(&m_lock);
+    m_capacity=bytes;
+    evict(m_capacity);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void cache_shard::shrink(){
+    pthread_mutex_lock(&m_lock);
+    evict(m_bytes/2);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void cache_shard::wake_all(std::vector<cache_waiter>& waiters){
+    for(size_t i=0;i<waiters.size();i++){
+        co_wake(waiters[i].waker,waiters[i].conn,waiters[i].seq);
+    }
+}
+
+// =================================================================
+// 3. 整个缓存
+// =================================================================
+
+void micro_cache::set_capacity(size_t bytes){
+    for(int i=0;i<SHARD_COUNT;i++){
+        m_shards[i].set_capacity(bytes/SHARD_COUNT);
+    }
+}
+
+void micro_cache::shrink(){
+    for(int i=0;i<SHARD_COUNT;i++){
+        m_shards[i].shrink();
+    }
+}
+
+cache_shard& micro_cache::shard_of(const std::string& key){
+    return m_shards[std::hash<std::string>()(key)%SHARD_COUNT];
+}
+
+micro_cache& response_cache(){
+    static micro_cache cache;
+    return cache;
+}
+
+// =================================================================
+// 4. co_await conn.cache_lookup()
+// =================================================================
+
+bool co_cache_lookup::lookup(){
+    cache_waiter w;
+    w.waker=co_current_waker();
+    w.conn=conn;
+    w.seq=conn->m_co_seq;
+    result.resp.reset();
+    CACHE_STATE state=response_cache().shard_of(key).lookup(key,http_conn::now_us(),w,result);
+    return state!=CACHE_WAIT;
+}
+
+void co_cache_lookup::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_cache=this;
+    conn->m_co_wait=CO_WAIT_CACHE;
+}
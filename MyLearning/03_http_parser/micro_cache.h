@@ -0,0 +1,155 @@
+#ifndef MICROCACHE_H
+#define MICROCACHE_H
+
+#include<stddef.h>
+#include<pthread.h>
+#include<string>
+#include<vector>
+#include<list>
+#include<memory>
+#include<unordered_map>
+#include "co_handler.h"
+
+// 🗄️ 动态响应的微缓存 (给协程 handler 用)
+// 一大波一模一样的 GET 同时打过来时，贵的 handler 只算一次：
+//   - 缓存的是序列化好的完整响应 (响应头 + 响应体)，命中了直接 writev 出去，不重新拼
+//   - TTL 内算“新鲜”；过了 TTL 但还在 stale 窗口里，先把旧的回给客户端，由这一个请求顺手重新算
+//     (stale-while-revalidate)
+//   - 同一个 key 同时只有一个请求在算 (single-flight)，其他没命中的挂起等它，算好了一起叫醒
+//   - 总字节数有上限，超了按 CLOCK 淘汰；过了内存软上限 (见 mem_budget.h) 上限先减半
+// 按 key 的哈希分成若干个分片，每个分片一把锁 (多个 I/O 线程会同时查)。
+//
+//     co_task page(http_conn& conn){
+//         if(!co_await conn.read_headers()) co_return;
+//         cache_result r=co_await conn.cache_lookup();
+//         if(r.resp){ co_await conn.write_cached(r.resp); }      // 命中 (可能是旧的)
+//         if(r.fill){ ... 算 ...; resp=r.fill.store(head,body,ttl,stale); }  // 轮到我来算
+//     }
+
+// 📦 一份缓存好的响应 (只读，靠引用计数在多个连接之间共享)
+struct cached_response{
+    std::string head;           // 状态行 + 响应头 (不含 Connection 和最后的空行，发的时候补上)
+    std::string body;
+    long long fresh_until;      // 在这之前都是新鲜的 (now_us 的时间)
+    long long stale_until;      // 在这之前还能先拿旧的顶一下
+};
+
+// 🔔 一个挂起等结果的协程
+struct cache_waiter{
+    co_waker* waker;            // 它所在的 I/O 循环
+    http_conn* conn;
+    unsigned seq;               // 防止叫醒已经换了协程的连接
+};
+
+class cache_shard;
+
+// 🎫 “这个 key 轮到你来算” 的凭证
+// store() 交结果；没交就被销毁 (handler 出错、连接断了)，自动放弃，叫醒等着的人让他们重新抢
+class cache_fill{
+public:
+    cache_fill():m_shard(0){}
+    cache_fill(cache_shard* shard,const std::string& key):m_shard(shard),m_key(key){}
+    cache_fill(cache_fill&& other):m_shard(other.m_shard),m_key(std::move(other.m_key)){other.m_shard=0;}
+    cache_fill& operator=(cache_fill&& other);
+    ~cache_fill(){abandon();}
+
+    explicit operator bool() const{return m_shard!=0;}
+
+    // ttl_ms: 新鲜多久；stale_ms: 过期以后还能顶多久
+    // 返回刚存进去的那份 (没命中的请求自己也要用它回复)
+    std::shared_ptr<const cached_response> store(const char* head,size_t head_len,const char* body,size_t body_len,int ttl_ms,int stale_ms);
+    void abandon();
+
+private:
+    cache_fill(const cache_fill&)=delete;
+    cache_fill& operator=(const cache_fill&)=delete;
+
+    cache_shard* m_shard;
+    std::string m_key;
+};
+
+// 查缓存的结果
+enum CACHE_STATE{
+    CACHE_HIT=0,    // 新鲜的
+    CACHE_STALE,    // 过期了但还在 stale 窗口里
+    CACHE_MISS,     // 没有，得自己算
+    CACHE_WAIT      // 别人正在算 (只在内部用，co_await 返回时不会是这个)
+};
+
+struct cache_result{
+    CACHE_STATE state;
+    std::shared_ptr<const cached_response> resp;    // HIT / STALE 时有
+    cache_fill fill;                                // 轮到这个请求来算 (MISS，或者 STALE 时负责刷新)
+};
+
+class cache_shard{
+public:
+    cache_shard();
+    ~cache_shard();
+
+    CACHE_STATE lookup(const std::string& key,long long now,const cache_waiter& waiter,cache_result& out);
+    void store(const std::string& key,std::shared_ptr<const cached_response> resp);
+    void abandon(const std::string& key);
+
+    // 热更新可能在别的线程查 / 填的时候改，所以要拿锁；改小了马上踢到新容量以下
+    void set_capacity(size_t bytes);
+
+    // 🧮 内存紧张：踢到只剩一半 (被引用着 / 正在算的不踢)
+    void shrink();
+
+private:
+    struct entry{
+        std::string key;
+        std::shared_ptr<const cached_response> resp;    // 还没算出来过就是空的
+        size_t bytes;
+        bool filling;                                   // 有人拿着 cache_fill 在算
+        bool referenced;                                // CLOCK 的访问位
+        std::vector<cache_waiter> waiters;
+    };
+    typedef std::list<entry>::iterator entry_iter;
+
+    void evict(size_t limit);
+    void wake_all(std::vector<cache_waiter>& waiters);
+
+    pthread_mutex_t m_lock;
+    std::list<entry> m_ring;                            // CLOCK 的“表盘”，新来的插在指针后面
+    std::unordered_map<std::string,entry_iter> m_index;
+    entry_iter m_hand;                                  // CLOCK 的指针
+    size_t m_bytes;
+    size_t m_capacity;
+};
+
+class micro_cache{
+public:
+    static const int SHARD_COUNT=16;
+
+    // 总字节上限 (平均分给每个分片)，启动时和每次热更新配置后调
+    void set_capacity(size_t bytes);
+
+    cache_shard& shard_of(const std::string& key);
+
+    // 🧮 内存紧张时 mem_budget 叫的：每个分片都砍一半
+    void shrink();
+
+private:
+    cache_shard m_shards[SHARD_COUNT];
+};
+
+// 🌍 全进程共用的那一份
+micro_cache& response_cache();
+
+// ⏳ co_await conn.cache_lookup() 创建出来的东西
+// 别人正在算同一个 key 时挂起；被叫醒后由 http_conn 重新查一遍 (retry)，
+// 查到结果再恢复协程，还是得等就接着挂着
+struct co_cache_lookup{
+    http_conn* conn;
+    std::string key;
+    cache_result result;
+    bool await_ready(){return lookup();}
+    void await_suspend(std::coroutine_handle<> h);
+    cache_result await_resume(){return std::move(result);}
+
+    bool lookup();  // false: 得等 (已经排进等待队列了)
+};
+
+#endif
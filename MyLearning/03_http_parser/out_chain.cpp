@@ -0,0 +1,263 @@
+#include "out_chain.h"
+#include "mem_pool.h"
+#include<stdio.h>
+#include<string.h>
+#include<sys/mman.h>
+#include<unistd.h>
+
+// =================================================================
+// 1. 往链尾接东西
+// =================================================================
+
+out_chain::segment& out_chain::push(SEG_KIND kind,const void* data,size_t len){
+    m_segs.push_back(segment());
+    segment& s=m_segs.back();
+    s.kind=kind;
+    s.base=0;
+    s.cap=0;
+    s.data=(const char*)data;
+    s.len=len;
+    s.fd=-1;
+    s.off=0;
+    s.zc=false;
+    s.zc_id=0;
+    m_bytes+=len;
+    return s;
+}
+
+char* out_chain::reserve(size_t want,size_t& room){
+    // 链尾正好是一个块，而且后面还有空位：接着往里写
+    if(m_segs.size()>m_head){
+        segment& tail=m_segs.back();
+        if(tail.kind==SEG_CHUNK){
+            char* end=(char*)tail.data+tail.len;
+            room=tail.base+tail.cap-end;
+            if(room>=want){
+                return end;
+            }
+        }
+    }
+
+    // 再要一块 (特别长的一次要一块刚好够的)
+    size_t cap=mem_pool::block_size(want>CHUNK_SIZE?want:CHUNK_SIZE);
+    char* chunk=(char*)mem_pool::alloc(cap,MEM_OUT);
+    segment& s=push(SEG_CHUNK,chunk,0);
+    s.base=chunk;
+    s.cap=cap;
+    room=cap;
+    return chunk;
+}
+
+bool out_chain::vprintf(const char* format,va_list args){
+    va_list copy;
+    va_copy(copy,args);
+
+    size_t room;
+    char* p=reserve(1,room);
+    int len=vsnprintf(p,room,format,args);
+    if(len<0){
+        va_end(copy);
+        return false;
+    }
+    if((size_t)len>=room){
+        // 当前块放不下：换一块够大的重新写 (vsnprintf 要给 \0 留一个位置)
+        p=reserve(len+1,room);
+        vsnprintf(p,room,format,copy);
+    }
+    va_end(copy);
+
+    segment& tail=m_segs.back();
+    tail.len+=len;
+    m_bytes+=len;
+    return true;
+}
+
+void out_chain::append_copy(const void* data,size_t len){
+    const char* src=(const char*)data;
+    while(len>0){
+        size_t room;
+        char* p=reserve(1,room);
+        size_t n=len<room?len:room;
+        memcpy(p,src,n);
+        m_segs.back().len+=n;
+        m_bytes+=n;
+        src+=n;
+        len-=n;
+    }
+}
+
+void out_chain::append_mmap(char* addr,size_t len){
+    segment& s=push(SEG_MMAP,addr,len);
+    s.base=addr;
+    s.cap=len;
+}
+
+void out_chain::append_shared(const void* data,size_t len,std::shared_ptr<const void> keep){
+    segment& s=push(SEG_SHARED,data,len);
+    s.keep=std::move(keep);
+}
+
+void out_chain::append_static(const void* data,size_t len){
+    push(SEG_STATIC,data,len);
+}
+
+void out_chain::append_file(int fd,off_t off,size_t len){
+    segment& s=push(SEG_FILE,0,len);
+    s.fd=fd;
+    s.off=off;
+}
+
+// =================================================================
+// 2. 发送：填 iov / 往前推
+// =================================================================
+
+int out_chain::fill_iov(struct iovec* iov,int max) const{
+    int count=0;
+    for(size_t i=m_head;i<m_segs.size()&&count<max;i++){
+        if(m_segs[i].len==0){
+            continue;
+        }
+        if(m_segs[i].kind==SEG_FILE){
+            break;
+        }
+        iov[count].iov_base=(void*)m_segs[i].data;
+        iov[count].iov_len=m_segs[i].len;
+        count++;
+    }
+    return count;
+}
+
+bool out_chain::head_file(int& fd,off_t& off,size_t& len) const{
+    for(size_t i=m_head;i<m_segs.size();i++){
+        if(m_segs[i].len==0){
+            continue;
+        }
+        if(m_segs[i].kind!=SEG_FILE){
+            return false;
+        }
+        fd=m_segs[i].fd;
+        off=m_segs[i].off;
+        len=m_segs[i].len;
+        return true;
+    }
+    return false;
+}
+
+void out_chain::consume(size_t n){
+    advance(n,false);
+}
+
+void out_chain::consume_zerocopy(size_t n){
+    advance(n,true);
+    m_zc_sent++;
+}
+
+void out_chain::advance(size_t n,bool zerocopy){
+    m_bytes-=n;
+    while(m_head<m_segs.size()&&(n>0||m_segs[m_head].len==0)){
+        segment& s=m_segs[m_head];
+        if(zerocopy){
+            s.zc=true;
+            s.zc_id=m_zc_sent;
+        }
+        if(n<s.len){
+            // 这一段只发了一部分：下次从断点接着发
+            if(s.kind==SEG_FILE){
+                s.off+=n;
+            }else{
+                s.data+=n;
+            }
+            s.len-=n;
+            break;
+        }
+        n-=s.len;
+        // 零拷贝发过的，内核可能还在读，先停着
+        if(s.zc&&!zc_completed(s.zc_id)){
+            park(s);
+        }else{
+            release(s);
+        }
+        m_head++;
+    }
+
+    // 全发完了：下标拨回开头，vector 的容量留着给下一个响应
+    if(m_head==m_segs.size()){
+        m_segs.clear();
+        m_head=0;
+    }
+}
+
+void out_chain::park(segment& s){
+    m_parked.push_back(segment());
+    segment& p=m_parked.back();
+    p.kind=s.kind;
+    p.base=s.base;
+    p.cap=s.cap;
+    p.data=s.data;
+    p.len=0;
+    p.keep=std::move(s.keep);
+    p.fd=s.fd;
+    p.off=s.off;
+    p.zc=true;
+    p.zc_id=s.zc_id;
+    s.kind=SEG_STATIC;  // 所有权已经转走了
+    s.len=0;
+}
+
+void out_chain::zerocopy_done(uint32_t lo,uint32_t hi){
+    (void)lo;
+    if(!zc_completed(hi)){
+        m_zc_completed=hi+1;
+    }
+    // 停着的段也是按编号顺序进来的，从前往后放到第一个还没完成的为止
+    size_t i=0;
+    while(i<m_parked.size()&&zc_completed(m_parked[i].zc_id)){
+        release(m_parked[i]);
+        i++;
+    }
+    m_parked.erase(m_parked.begin(),m_parked.begin()+i);
+}
+
+void out_chain::release_parked(){
+    for(size_t i=0;i<m_parked.size();i++){
+        release(m_parked[i]);
+    }
+    m_parked.clear();
+    m_zc_sent=0;
+    m_zc_completed=0;
+}
+
+void out_chain::release(segment& s){
+    if(s.kind==SEG_CHUNK){
+        mem_pool::free(s.base,s.cap,MEM_OUT);
+    }else if(s.kind==SEG_MMAP){
+        munmap(s.base,s.cap);
+    }else if(s.kind==SEG_FILE){
+        close(s.fd);
+        s.fd=-1;
+    }
+    s.keep.reset();
+    s.base=0;
+    s.len=0;
+}
+
+void out_chain::clear(){
+    for(size_t i=m_head;i<m_segs.size();i++){
+        // 发了一半的零拷贝段：内核手里还有它的前半截
+        if(m_segs[i].zc&&!zc_completed(m_segs[i].zc_id)){
+            park(m_segs[i]);
+        }else{
+            release(m_segs[i]);
+        }
+    }
+    m_segs.clear();
+    m_head=0;
+    m_bytes=0;
+}
+
+void out_chain::trim(){
+    if(m_bytes==0&&m_parked.empty()){
+        clear();
+        std::vector<segment>().swap(m_segs);
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef OUTCHAIN_H
+#define OUTCHAIN_H
+
+#include<stddef.h>
+#include<stdint.h>
+#include<stdarg.h>
+#include<sys/uio.h>
+#include<sys/types.h>
+#include<vector>
+#include<memory>
+
+// ⛓️ 待发送数据的链表 (代替原来固定的 m_write_buf[1024] + m_iv[2])
+// 一个响应由好几段拼起来，每段各管各的内存：
+//   - 池子里的块：响应头这种现拼的文本，放不下就再接一块，不再有 1KB 的上限
+//   - mmap 的文件：发完了 munmap
+//   - 共享的只读数据 (打包文件、微缓存里的响应……)：拿着 shared_ptr，发完了放掉引用
+//   - 静态数据：活得比连接还长，什么都不用管
+//   - 文件 (大文件模式)：只记着 fd 和偏移，不进内存，由 http_conn 用 sendfile 一个窗口一个窗口地发
+// write() 每次把链上的段一次性交给 writev (最多 IOV_MAX 段)，
+// 发了多少就从链头往后推多少，整段发完的当场释放。
+// 以后的流水线响应、chunked 编码、大的动态响应体都只是往链上接新的段，不用拷成一整块。
+//
+// 📮 MSG_ZEROCOPY：用零拷贝发出去的段，writev 返回了内核也还在读它的内存，
+// 所以发完了先“停”在 m_parked 里，等 socket 错误队列里的完成通知说这一次发送结束了才真正释放。
+class out_chain{
+public:
+    static const size_t CHUNK_SIZE=4096;    // 每次找 mem_pool 要一块 4KB
+
+    out_chain():m_head(0),m_bytes(0),m_zc_sent(0),m_zc_completed(0){}
+    ~out_chain(){clear();release_parked();}
+
+    // 🖊️ 追加格式化文本 (写进链尾的块，不够就再要一块)
+    bool vprintf(const char* format,va_list args);
+
+    // 🖊️ 追加一段数据 (拷一份)
+    void append_copy(const void* data,size_t len);
+
+    // 📎 引用一段 mmap 出来的内存，发完了 munmap(addr,len) (所有权交给链)
+    void append_mmap(char* addr,size_t len);
+
+    // 📎 引用一段共享的只读数据，keep 拿着它的引用
+    void append_shared(const void* data,size_t len,std::shared_ptr<const void> keep);
+
+    // 📎 引用一段一直都在的数据 (字符串常量之类)
+    void append_static(const void* data,size_t len);
+
+    // 📎 文件的 [off, off+len)，发完了 close(fd) (所有权交给链)
+    void append_file(int fd,off_t off,size_t len);
+
+    // 📤 把还没发的部分填进 iov，返回用了几个 (遇到文件段就停，文件段不能 writev)
+    int fill_iov(struct iovec* iov,int max) const;
+
+    // 📄 链头 (第一个还没发完的段) 是不是文件段，是的话给出 fd / 现在发到哪了 / 还剩多少
+    bool head_file(int& fd,off_t& off,size_t& len) const;
+
+    // ✂️ 前 n 个字节已经发出去了
+    void consume(size_t n);
+
+    // ✂️ 前 n 个字节是用 MSG_ZEROCOPY 发出去的 (这次发送的编号按内核的规矩从 0 开始一次加一)
+    void consume_zerocopy(size_t n);
+
+    // 📬 完成通知：编号 lo..hi 的零拷贝发送内核都用完了
+    void zerocopy_done(uint32_t lo,uint32_t hi);
+
+    // 还有零拷贝的段在等完成通知
+    bool zerocopy_pending() const{return !m_parked.empty();}
+
+    // 🗑️ 连接关了：等通知的段也都放掉，编号从头开始 (下一个 socket 又从 0 数)
+    void release_parked();
+
+    size_t size() const{return m_bytes;}
+    bool empty() const{return m_bytes==0;}
+
+    // 🗑️ 还没发的全部放掉 (出错了 / 连接关了)；零拷贝发过一部分的也先停着等通知
+    void clear();
+
+    // 🧹 链是空的话，连 m_segs 的容量也还掉 (内存紧张时闲着的长连接调)
+    void trim();
+
+private:
+    out_chain(const out_chain&)=delete;
+    out_chain& operator=(const out_chain&)=delete;
+
+    enum SEG_KIND{
+        SEG_CHUNK,      // mem_pool 的块
+        SEG_MMAP,       // mmap 出来的文件
+        SEG_SHARED,     // 别人共享的只读数据
+        SEG_STATIC,     // 不用管的数据
+        SEG_FILE        // 文件 (fd + 偏移)，走 sendfile
+    };
+    struct segment{
+        SEG_KIND kind;
+        char* base;         // CHUNK / MMAP：块 (映射) 的起点，释放的时候用
+        size_t cap;         // CHUNK / MMAP：块 (映射) 有多大
+        const char* data;   // 还没发的部分从这开始
+        size_t len;         // 还剩多少没发
+        std::shared_ptr<const void> keep;
+        int fd;             // FILE：文件，off：下一个要发的字节在文件里的位置
+        off_t off;
+        bool zc;            // 被零拷贝发送碰过 (至少有一部分)
+        uint32_t zc_id;     // 最后一次碰它的零拷贝发送的编号
+    };
+
+    void advance(size_t n,bool zerocopy);
+    void park(segment& s);
+    bool zc_completed(uint32_t id) const{return (int32_t)(id-m_zc_completed)<0;}
+
+    segment& push(SEG_KIND kind,const void* data,size_t len);
+    char* reserve(size_t want,size_t& room);   // 链尾的块里还有多少空位 (不够就新接一块)
+    void release(segment& s);
+
+    std::vector<segment> m_segs;    // 连接关闭前一直留着 (容量不还)，稳定以后不再分配
+    size_t m_head;                  // 第一个还没发完的段
+    size_t m_bytes;                 // 一共还有多少字节没发
+
+    std::vector<segment> m_parked;  // 已经发完、等零拷贝完成通知的段
+    uint32_t m_zc_sent;             // 下一次零拷贝发送的编号
+    uint32_t m_zc_completed;        // 编号比它小的都完成了 (TCP 的完成通知是按顺序来的)
+};
+
+#endif
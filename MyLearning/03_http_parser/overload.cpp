@@ -0,0 +1,471 @@
+// 🌊 过载测试：先测出服务器的容量，再按容量的 X 倍 (默认 2 倍) 匀速打过去，看过载保护 (CoDel) 有没有起作用
+// 用法: ./overload [-h host] [-p port] [-u path] [-c conns] [-m seconds] [-x factor] [-r rate] [-d seconds] [-i max] [-t ms] [-n]
+//   第一步 (闭环)：-c 个并发 (默认 64)，一个回来了再发下一个，跑 -m 秒 (默认 3)，算出每秒能回多少 = 容量
+//   第二步 (开环)：每秒 容量 x -x 个请求匀速发 (-r 直接给速率就跳过第一步)，不管前面的回没回来，跑 -d 秒 (默认 10)
+//   -i MAX 开环阶段同时最多 MAX 个请求在路上 (默认 4096)，满了还到点的记成 skipped
+//   -t MS  一个请求 MS 毫秒还没回完就算超时 (默认 5000)
+//   -n     每个请求一条新连接 (默认是长连接，空闲的连接复用，不够了再开)：
+//          这样 listen 的 backlog 满了也看得出来——内核丢掉的 SYN 要等 1 秒 / 3 秒重传，
+//          表现为延迟跳到 1000ms 以上或者超时。注意开连接本身很费 CPU，压测机和服务器在同一台上时慎用
+// 开环的延迟从“该发的时刻”算起，客户端自己发不出去也记一笔，不会因为服务器慢了就少发。
+// 每秒打一行：发了几个、200 / 503 / 其他状态码 / 连接出错 / 超时各几个，200 的 p50 / p99 延迟。
+// 过载保护正常的话：开环阶段 200 的数量应该接近容量，多出来的是 503，而且 200 的延迟不会一直涨。
+// 编译: g++ -std=c++20 -O2 overload.cpp -o overload
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<signal.h>
+#include<time.h>
+#include<netdb.h>
+#include<sys/socket.h>
+#include<sys/epoll.h>
+#include<sys/resource.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include<vector>
+#include<algorithm>
+
+// =================================================================
+// 1. 连接 / 统计
+// =================================================================
+
+struct ov_options{
+    const char* host;
+    int port;
+    const char* path;
+    int conns;          // 闭环的并发数
+    int measure_s;      // 闭环测多久
+    double factor;      // 开环速率 = 容量 x factor
+    double rate;        // 直接给开环速率 (>0 就不测容量)
+    int duration_s;     // 开环跑多久
+    int max_inflight;   // 开环同时最多多少个在路上
+    int timeout_ms;
+    bool new_conn;      // 每个请求一条新连接
+};
+
+struct ov_conn{
+    int fd;
+    bool connected;
+    bool busy;              // 有请求在路上
+    long long start_us;     // 开环：该发的时刻；闭环：真正开始发的时刻
+    size_t sent;
+    char head[1024];        // 响应头 (找 "\r\n\r\n" 和 Content-Length 用)
+    int head_len;
+    long long body_left;    // 响应头收完以后，响应体还差多少 (-1: 响应头还没收完)
+    int status;
+};
+
+// 一秒的统计
+struct ov_stats{
+    long long sent;
+    long long ok;           // 200
+    long long shed;         // 503
+    long long other;        // 其他状态码
+    long long errors;       // 连接被拒 / 被重置 / 没回完就断了
+    long long timeouts;
+    long long skipped;      // 开环：并发到上限了，客户端自己发不出去
+    std::vector<int> latency_us;    // 200 的延迟
+};
+
+static long long now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static struct sockaddr_in g_addr;
+static char g_request[512];
+static int g_request_len;
+static int g_epollfd;
+static bool g_new_conn=false;
+static std::vector<ov_conn*> g_by_fd;       // fd -> 连接
+static std::vector<ov_conn*> g_idle;        // 空闲的长连接
+static int g_inflight=0;
+static int g_open=0;
+
+// =================================================================
+// 2. 发 / 收
+// =================================================================
+
+static void watch(ov_conn* c,uint32_t events,int op){
+    epoll_event ev;
+    ev.events=events|EPOLLRDHUP;
+    ev.data.fd=c->fd;
+    epoll_ctl(g_epollfd,op,c->fd,&ev);
+}
+
+static ov_conn* open_conn(){
+    int fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK|SOCK_CLOEXEC,0);
+    if(fd<0){
+        return NULL;
+    }
+    int ret=connect(fd,(struct sockaddr*)&g_addr,sizeof(g_addr));
+    if(ret<0&&errno!=EINPROGRESS){
+        close(fd);
+        return NULL;
+    }
+    int one=1;
+    setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+    if((size_t)fd>=g_by_fd.size()){
+        g_by_fd.resize(fd*2+1,NULL);
+    }
+    ov_conn* c=new ov_conn();
+    c->fd=fd;
+    c->connected=false;
+    c->busy=false;
+    g_by_fd[fd]=c;
+    g_open++;
+    watch(c,EPOLLOUT|EPOLLIN,EPOLL_CTL_ADD);
+    return c;
+}
+
+static void close_conn(ov_conn* c){
+    if(!c->busy){
+        g_idle.erase(std::remove(g_idle.begin(),g_idle.end(),c),g_idle.end());
+    }else{
+        g_inflight--;
+    }
+    g_by_fd[c->fd]=NULL;
+    close(c->fd);
+    delete c;
+    g_open--;
+}
+
+static void try_send(ov_conn* c){
+    ssize_t n=send(c->fd,g_request+c->sent,g_request_len-c->sent,MSG_NOSIGNAL);
+    if(n>0){
+        c->sent+=n;
+    }
+    watch(c,c->sent<(size_t)g_request_len?EPOLLOUT|EPOLLIN:EPOLLIN,EPOLL_CTL_MOD);
+}
+
+// 发一个请求 (有空闲的长连接就用，没有就开一条)
+static bool start_request(long long start){
+    ov_conn* c=NULL;
+    if(!g_new_conn&&!g_idle.empty()){
+        c=g_idle.back();
+        g_idle.pop_back();
+    }else{
+        c=open_conn();
+        if(!c){
+            return false;
+        }
+    }
+    c->busy=true;
+    c->start_us=start;
+    c->sent=0;
+    c->head_len=0;
+    c->body_left=-1;
+    c->status=0;
+    g_inflight++;
+    if(c->connected){
+        try_send(c);
+    }
+    return true;
+}
+
+// 一个响应收完了 (或者出错了)：记一笔；长连接还能用就放回空闲的里
+static void finish_request(ov_conn* c,bool failed,ov_stats& st,long long now){
+    if(failed||c->status==0){
+        st.errors++;
+    }else if(c->status==200){
+        st.ok++;
+        st.latency_us.push_back((int)(now-c->start_us));
+    }else if(c->status==503){
+        st.shed++;
+    }else{
+        st.other++;
+    }
+    if(failed||g_new_conn){
+        close_conn(c);
+        return;
+    }
+    c->busy=false;
+    g_inflight--;
+    g_idle.push_back(c);
+}
+
+// 响应头收完了：拿状态码和 Content-Length
+static bool parse_head(ov_conn* c){
+    c->head[c->head_len<(int)sizeof(c->head)?c->head_len:(int)sizeof(c->head)-1]='\0';
+    char* end=strstr(c->head,"\r\n\r\n");
+    if(!end){
+        return false;
+    }
+    c->status=c->head_len>=12?atoi(c->head+9):0;
+    long long len=0;
+    for(char* p=c->head;p<end;p++){
+        if((p==c->head||p[-1]=='\n')&&strncasecmp(p,"Content-Length:",15)==0){
+            len=atoll(p+15);
+            break;
+        }
+    }
+    int extra=c->head_len-(int)(end+4-c->head);     // 已经收进来的响应体
+    c->body_left=len-extra;
+    return true;
+}
+
+static void on_event(ov_conn* c,uint32_t events,ov_stats& st,long long now){
+    if(!c->connected&&(events&(EPOLLOUT|EPOLLERR|EPOLLHUP))){
+        int err=0;
+        socklen_t len=sizeof(err);
+        getsockopt(c->fd,SOL_SOCKET,SO_ERROR,&err,&len);
+        if(err!=0){
+            if(c->busy){
+                finish_request(c,true,st,now);
+            }else{
+                close_conn(c);
+            }
+            return;
+        }
+        c->connected=true;
+    }
+    if(!c->busy){
+        // 空闲的长连接上有动静：只可能是服务器把它关了
+        if(events&(EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR)){
+            close_conn(c);
+        }else{
+            watch(c,EPOLLIN,EPOLL_CTL_MOD);
+        }
+        return;
+    }
+    if(c->connected&&c->sent<(size_t)g_request_len&&(events&EPOLLOUT)){
+        try_send(c);
+    }
+    if(!(events&(EPOLLIN|EPOLLRDHUP|EPOLLHUP|EPOLLERR))){
+        return;
+    }
+    char buf[16384];
+    while(true){
+        ssize_t n=recv(c->fd,buf,sizeof(buf),0);
+        if(n>0){
+            if(c->body_left<0){
+                int take=std::min((int)n,(int)sizeof(c->head)-1-c->head_len);
+                memcpy(c->head+c->head_len,buf,take);
+                c->head_len+=take;
+                if(!parse_head(c)){
+                    continue;
+                }
+                n-=take;    // 头里顺带收进来的那截已经算过了
+            }
+            c->body_left-=n;
+            if(c->body_left<=0){
+                finish_request(c,false,st,now);
+                return;
+            }
+            continue;
+        }
+        if(n==0||errno!=EAGAIN){
+            finish_request(c,true,st,now);     // 没回完就断了
+        }
+        return;
+    }
+}
+
+static void reap_timeouts(ov_stats& st,long long now,int timeout_ms){
+    for(size_t fd=0;fd<g_by_fd.size();fd++){
+        ov_conn* c=g_by_fd[fd];
+        if(c&&c->busy&&now-c->start_us>(long long)timeout_ms*1000){
+            close_conn(c);
+            st.timeouts++;
+        }
+    }
+}
+
+// =================================================================
+// 3. 统计
+// =================================================================
+
+static int percentile(std::vector<int>& v,double p){
+    if(v.empty()){
+        return 0;
+    }
+    size_t i=(size_t)(p*(v.size()-1));
+    std::nth_element(v.begin(),v.begin()+i,v.end());
+    return v[i];
+}
+
+static void print_line(const char* tag,ov_stats& st){
+    int p50=percentile(st.latency_us,0.50);
+    int p99=percentile(st.latency_us,0.99);
+    printf("%-8s sent %6lld  200 %6lld  503 %6lld  other %4lld  err %4lld  timeout %4lld  skipped %5lld  p50 %7.1fms  p99 %7.1fms\n",
+        tag,st.sent,st.ok,st.shed,st.other,st.errors,st.timeouts,st.skipped,p50/1000.0,p99/1000.0);
+    fflush(stdout);
+}
+
+static void add_stats(ov_stats& total,const ov_stats& st){
+    total.sent+=st.sent;
+    total.ok+=st.ok;
+    total.shed+=st.shed;
+    total.other+=st.other;
+    total.errors+=st.errors;
+    total.timeouts+=st.timeouts;
+    total.skipped+=st.skipped;
+    total.latency_us.insert(total.latency_us.end(),st.latency_us.begin(),st.latency_us.end());
+}
+
+// =================================================================
+// 4. 两个阶段
+// =================================================================
+
+// rate<=0：闭环 (conns 个并发)；否则开环按 rate 匀速发，最多同时 max_inflight 个
+// 返回这一段的合计
+static ov_stats run_phase(const char* name,double rate,int conns,int max_inflight,int seconds,int timeout_ms){
+    ov_stats total=ov_stats();
+    ov_stats sec=ov_stats();
+    long long begin=now_us();
+    long long end=begin+(long long)seconds*1000000;
+    long long next_tick=begin+1000000;
+    double next_send=(double)begin;
+    double interval=rate>0?1000000.0/rate:0;
+    int tick=0;
+    epoll_event events[1024];
+
+    while(true){
+        long long now=now_us();
+        if(now>=end){
+            break;
+        }
+        if(rate>0){
+            // 🌊 开环：到点就发，发不出去也算“该发的”
+            while(next_send<=now){
+                sec.sent++;
+                if(g_inflight>=max_inflight||!start_request((long long)next_send)){
+                    sec.skipped++;
+                }
+                next_send+=interval;
+            }
+        }else{
+            // 🔁 闭环：始终保持 conns 个在路上
+            while(g_inflight<conns){
+                sec.sent++;
+                if(!start_request(now)){
+                    sec.errors++;
+                    break;
+                }
+            }
+        }
+
+        int n=epoll_wait(g_epollfd,events,1024,rate>0?0:1);
+        now=now_us();
+        for(int i=0;i<n;i++){
+            int fd=events[i].data.fd;
+            if((size_t)fd<g_by_fd.size()&&g_by_fd[fd]){
+                on_event(g_by_fd[fd],events[i].events,sec,now);
+            }
+        }
+
+        if(now>=next_tick){
+            reap_timeouts(sec,now,timeout_ms);
+            char tag[32];
+            snprintf(tag,sizeof(tag),"%s%d",name,++tick);
+            print_line(tag,sec);
+            add_stats(total,sec);
+            sec=ov_stats();
+            next_tick+=1000000;
+        }
+    }
+
+    // 还在路上的不等了 (算超时)，空闲的长连接也关掉，下一段从头开
+    for(size_t fd=0;fd<g_by_fd.size();fd++){
+        ov_conn* c=g_by_fd[fd];
+        if(c){
+            if(c->busy){
+                sec.timeouts++;
+            }
+            close_conn(c);
+        }
+    }
+    add_stats(total,sec);
+    return total;
+}
+
+int main(int argc,char* argv[]){
+    ov_options opt;
+    opt.host="127.0.0.1";
+    opt.port=9006;
+    opt.path="/";
+    opt.conns=64;
+    opt.measure_s=3;
+    opt.factor=2;
+    opt.rate=0;
+    opt.duration_s=10;
+    opt.max_inflight=4096;
+    opt.timeout_ms=5000;
+    opt.new_conn=false;
+    int c;
+    while((c=getopt(argc,argv,"h:p:u:c:m:x:r:d:i:t:n"))!=-1){
+        switch(c){
+            case 'h': opt.host=optarg; break;
+            case 'p': opt.port=atoi(optarg); break;
+            case 'u': opt.path=optarg; break;
+            case 'c': opt.conns=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'm': opt.measure_s=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'x': opt.factor=atof(optarg); break;
+            case 'r': opt.rate=atof(optarg); break;
+            case 'd': opt.duration_s=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'i': opt.max_inflight=atoi(optarg)>0?atoi(optarg):1; break;
+            case 't': opt.timeout_ms=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'n': opt.new_conn=true; break;
+            default:
+                printf("usage: %s [-h host] [-p port] [-u path] [-c conns] [-m seconds] [-x factor] [-r rate] [-d seconds] [-i max] [-t ms] [-n]\n",argv[0]);
+                return 1;
+        }
+    }
+    signal(SIGPIPE,SIG_IGN);
+    g_new_conn=opt.new_conn;
+
+    // 同时在路上的连接可能很多：fd 上限开到最大
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE,&rl)==0){
+        rl.rlim_cur=rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+        if((rlim_t)opt.max_inflight+64>rl.rlim_cur){
+            opt.max_inflight=(int)rl.rlim_cur-64;
+        }
+    }
+
+    struct addrinfo hints;
+    memset(&hints,0,sizeof(hints));
+    hints.ai_family=AF_INET;
+    hints.ai_socktype=SOCK_STREAM;
+    struct addrinfo* res=NULL;
+    if(getaddrinfo(opt.host,NULL,&hints,&res)!=0||!res){
+        printf("cannot resolve %s\n",opt.host);
+        return 1;
+    }
+    g_addr=*(struct sockaddr_in*)res->ai_addr;
+    g_addr.sin_port=htons(opt.port);
+    freeaddrinfo(res);
+    g_request_len=snprintf(g_request,sizeof(g_request),"GET %s HTTP/1.1\r\nHost: %s\r\n%s\r\n",
+        opt.path,opt.host,opt.new_conn?"":"Connection: keep-alive\r\n");
+    g_epollfd=epoll_create1(EPOLL_CLOEXEC);
+
+    double rate=opt.rate;
+    if(rate<=0){
+        printf("📏 测容量：%d 个并发，闭环跑 %d 秒\n",opt.conns,opt.measure_s);
+        ov_stats cap=run_phase("cap",0,opt.conns,opt.conns,opt.measure_s,opt.timeout_ms);
+        double capacity=(double)cap.ok/opt.measure_s;
+        if(capacity<=0){
+            printf("容量测出来是 0 (服务器没起来？)\n");
+            return 1;
+        }
+        rate=capacity*opt.factor;
+        printf("📏 容量 %.0f 请求/秒 -> 开环按 %.0f 请求/秒 (%.1f 倍)\n",capacity,rate,opt.factor);
+        sleep(1);   // 让服务器把闭环阶段的尾巴处理完
+    }
+
+    printf("🌊 开环：%.0f 请求/秒，跑 %d 秒 (同时最多 %d 个在路上%s)\n",rate,opt.duration_s,opt.max_inflight,opt.new_conn?"，每个请求一条新连接":"");
+    ov_stats total=run_phase("load",rate,0,opt.max_inflight,opt.duration_s,opt.timeout_ms);
+    print_line("total",total);
+    printf("📊 成功 %.0f 请求/秒 (%.1f%%)，503 快速拒绝 %.1f%%，出错 + 超时 + 发不出去 %.1f%%\n",
+        (double)total.ok/opt.duration_s,
+        total.sent?100.0*total.ok/total.sent:0,
+        total.sent?100.0*total.shed/total.sent:0,
+        total.sent?100.0*(total.errors+total.timeouts+total.skipped)/total.sent:0);
+    return 0;
+}
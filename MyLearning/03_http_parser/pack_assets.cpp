@@ -0,0 +1,171 @@
+// 📦 打包工具：把 doc_root 下面所有文件打成一个 .pack 文件
+// 用法: ./pack_assets <doc_root> <out.pack> [-z]
+//   -z: 额外生成 gzip 压缩版本 (压缩后更小才保留)
+// 编译: g++ -std=c++20 -O2 pack_assets.cpp asset_pack.cpp -o pack_assets -lz  (content_type_of 在 asset_pack.cpp 里)
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<ftw.h>
+#include<zlib.h>
+#include<string>
+#include<vector>
+#include<algorithm>
+#include "asset_pack.h"
+
+struct asset_file{
+    std::string path;   // URL 路径 (以 / 开头)
+    std::string full;   // 磁盘上的完整路径
+};
+
+static std::string g_root;
+static std::vector<asset_file> g_files;
+
+// nftw 的回调：每遇到一个普通文件就记下来
+static int collect(const char* fpath,const struct stat* sb,int typeflag,struct FTW* ftwbuf){
+    (void)sb;
+    (void)ftwbuf;
+    if(typeflag!=FTW_F){
+        return 0;
+    }
+    asset_file f;
+    f.full=fpath;
+    f.path=f.full.substr(g_root.size());
+    if(f.path.empty()||f.path[0]!='/'){
+        f.path="/"+f.path;
+    }
+    g_files.push_back(f);
+    return 0;
+}
+
+static bool read_file(const std::string& path,std::string& out){
+    FILE* fp=fopen(path.c_str(),"rb");
+    if(!fp){
+        perror(path.c_str());
+        return false;
+    }
+    char buf[65536];
+    size_t n;
+    while((n=fread(buf,1,sizeof(buf),fp))>0){
+        out.append(buf,n);
+    }
+    fclose(fp);
+    return true;
+}
+
+// gzip 压缩 (windowBits=15+16 表示输出 gzip 格式而不是裸 deflate)
+static bool gzip_compress(const std::string& in,std::string& out){
+    z_stream zs;
+    memset(&zs,'\0',sizeof(zs));
+    if(deflateInit2(&zs,Z_BEST_COMPRESSION,Z_DEFLATED,15+16,8,Z_DEFAULT_STRATEGY)!=Z_OK){
+        return false;
+    }
+    out.resize(deflateBound(&zs,in.size()));
+    zs.next_in=(Bytef*)in.data();
+    zs.avail_in=in.size();
+    zs.next_out=(Bytef*)&out[0];
+    zs.avail_out=out.size();
+    int ret=deflate(&zs,Z_FINISH);
+    out.resize(zs.total_out);
+    deflateEnd(&zs);
+    return ret==Z_STREAM_END;
+}
+
+// 8 字节对齐，让每段数据的起始地址都整齐一点
+static void align8(std::string& blob){
+    while(blob.size()%8!=0){
+        blob.push_back('\0');
+    }
+}
+
+static pack_variant append_variant(std::string& blob,const char* type,const std::string& body,bool gzip){
+    char head[512];
+    int head_len=snprintf(head,sizeof(head),
+        "HTTP/1.1 200 OK\r\nContent-Type: %s\r\nContent-Length: %zu\r\n%s",
+        type,body.size(),gzip?"Content-Encoding: gzip\r\nVary: Accept-Encoding\r\n":"");
+
+    pack_variant v;
+    memset(&v,'\0',sizeof(v));
+    align8(blob);
+    v.head_off=blob.size();
+    v.head_len=head_len;
+    blob.append(head,head_len);
+
+    align8(blob);
+    v.body_off=blob.size();
+    v.body_len=body.size();
+    blob.append(body);
+    return v;
+}
+
+int main(int argc,char* argv[]){
+    if(argc<3){
+        printf("usage: %s <doc_root> <out.pack> [-z]\n",argv[0]);
+        return 1;
+    }
+    g_root=argv[1];
+    while(g_root.size()>1&&g_root[g_root.size()-1]=='/'){
+        g_root.erase(g_root.size()-1);
+    }
+    bool with_gzip=(argc>3&&strcmp(argv[3],"-z")==0);
+
+    // 1. 收集所有文件，按 URL 路径排序 (服务器那边靠二分查找)
+    if(nftw(g_root.c_str(),collect,64,FTW_PHYS)!=0){
+        perror("nftw");
+        return 1;
+    }
+    std::sort(g_files.begin(),g_files.end(),[](const asset_file& a,const asset_file& b){
+        return a.path<b.path;
+    });
+
+    // 2. 先排好 [header][entries][路径字符串]，文件内容跟在后面
+    std::vector<pack_entry> entries(g_files.size());
+    std::string blob(sizeof(pack_header)+entries.size()*sizeof(pack_entry),'\0');
+
+    for(size_t i=0;i<g_files.size();i++){
+        memset(&entries[i],'\0',sizeof(pack_entry));
+        entries[i].path_off=blob.size();
+        entries[i].path_len=g_files[i].path.size();
+        blob.append(g_files[i].path);
+    }
+
+    size_t raw_bytes=0,gzip_count=0;
+    for(size_t i=0;i<g_files.size();i++){
+        std::string body;
+        if(!read_file(g_files[i].full,body)){
+            return 1;
+        }
+        raw_bytes+=body.size();
+
+        const char* type=content_type_of(g_files[i].path.c_str());
+        entries[i].plain=append_variant(blob,type,body,false);
+
+        std::string zipped;
+        if(with_gzip&&gzip_compress(body,zipped)&&zipped.size()<body.size()){
+            entries[i].gzip=append_variant(blob,type,zipped,true);
+            entries[i].has_gzip=1;
+            gzip_count++;
+        }
+    }
+
+    // 3. 回填文件头和索引
+    pack_header head;
+    memset(&head,'\0',sizeof(head));
+    memcpy(head.magic,PACK_MAGIC,4);
+    head.version=PACK_VERSION;
+    head.count=entries.size();
+    memcpy(&blob[0],&head,sizeof(head));
+    if(!entries.empty()){
+        memcpy(&blob[sizeof(head)],&entries[0],entries.size()*sizeof(pack_entry));
+    }
+
+    FILE* fp=fopen(argv[2],"wb");
+    if(!fp||fwrite(blob.data(),1,blob.size(),fp)!=blob.size()){
+        perror(argv[2]);
+        return 1;
+    }
+    fclose(fp);
+
+    printf("packed %zu files (%zu bytes, %zu gzip variants) into %s (%zu bytes)\n",
+        g_files.size(),raw_bytes,gzip_count,argv[2],blob.size());
+    return 0;
+}
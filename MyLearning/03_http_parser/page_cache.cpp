@@ -0,0 +1,159 @@
+#include "page_cache.h"
+#include "co_handler.h"
+#include<stdio.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<errno.h>
+#include<pthread.h>
+#include<sys/uio.h>
+#include<sys/mman.h>
+#include<deque>
+
+// =================================================================
+// 1. 在不在页缓存里
+// =================================================================
+
+static long page_size(){
+    static long size=sysconf(_SC_PAGESIZE);
+    return size;
+}
+
+// RWF_NOWAIT：数据不在页缓存里就不读了，直接返回 EAGAIN (4.14+)
+// 返回 1 在，0 不在，-1 这个文件 (文件系统) 不支持
+static int probe_nowait(int fd,off_t off){
+    char c;
+    struct iovec iov;
+    iov.iov_base=&c;
+    iov.iov_len=1;
+    ssize_t ret=preadv2(fd,&iov,1,off,RWF_NOWAIT);
+    if(ret>=0){
+        return 1;
+    }
+    return errno==EAGAIN?0:-1;
+}
+
+// mincore：要先映射一下才能问 (只建映射不碰内存，不会缺页)
+static bool probe_mincore(int fd,off_t off,size_t len){
+    off_t base=off&~(off_t)(page_size()-1);
+    size_t map_len=len+(off-base);
+    void* addr=mmap(0,map_len,PROT_READ,MAP_SHARED,fd,base);
+    if(addr==MAP_FAILED){
+        return false;   // 问不了就当它不在，交给帮手线程去读，反正不会卡住 I/O 循环
+    }
+    size_t pages=(map_len+page_size()-1)/page_size();
+    unsigned char vec[1024];
+    bool resident=false;
+    if(pages<=sizeof(vec)&&mincore(addr,map_len,vec)==0){
+        resident=true;
+        for(size_t i=0;i<pages;i++){
+            if(!(vec[i]&1)){
+                resident=false;
+                break;
+            }
+        }
+    }
+    munmap(addr,map_len);
+    return resident;
+}
+
+bool page_cache_resident(int fd,off_t off,size_t len){
+    if(len==0){
+        return true;
+    }
+    // 顺序读的预读是一整段一整段进来的，开头和结尾都在，中间基本也在
+    int first=probe_nowait(fd,off);
+    if(first==0){
+        return false;
+    }
+    if(first>0){
+        return probe_nowait(fd,off+len-1)!=0;
+    }
+    return probe_mincore(fd,off,len);
+}
+
+// =================================================================
+// 2. 帮手线程：替 I/O 循环等磁盘
+// =================================================================
+
+struct prefetch_job{
+    int fd;             // dup 出来的，读完了帮手线程自己关
+    off_t off;
+    size_t len;
+    co_waker* waker;    // NULL 表示不用通知
+    http_conn* conn;
+    unsigned seq;
+};
+
+static pthread_mutex_t g_job_lock=PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t g_job_cond=PTHREAD_COND_INITIALIZER;
+static std::deque<prefetch_job> g_jobs;
+static pthread_once_t g_helper_once=PTHREAD_ONCE_INIT;
+
+static void* prefetch_worker(void* arg){
+    (void)arg;
+    char scratch[1];
+    while(true){
+        pthread_mutex_lock(&g_job_lock);
+        while(g_jobs.empty()){
+            pthread_cond_wait(&g_job_cond,&g_job_lock);
+        }
+        prefetch_job job=g_jobs.front();
+        g_jobs.pop_front();
+        pthread_mutex_unlock(&g_job_lock);
+
+        // readahead 只负责把读请求发出去；再同步读一下最后一个字节，保证等到数据真的进来了
+        readahead(job.fd,job.off,job.len);
+        if(job.waker){
+            ssize_t ret=pread(job.fd,scratch,1,job.off+job.len-1);
+            (void)ret;
+        }
+        close(job.fd);
+
+        if(job.waker){
+            co_wake(job.waker,job.conn,job.seq);
+        }
+    }
+    return NULL;
+}
+
+// 第一次用到大文件模式才起线程 (跟进程同生共死，不用 join)
+static void start_helper(){
+    pthread_t tid;
+    if(pthread_create(&tid,NULL,prefetch_worker,NULL)!=0){
+        perror("page_cache pthread_create");
+        return;
+    }
+    pthread_detach(tid);
+}
+
+void page_cache_prefetch(int fd,off_t off,size_t len,co_waker* waker,http_conn* conn,unsigned seq){
+    pthread_once(&g_helper_once,start_helper);
+
+    prefetch_job job;
+    job.fd=dup(fd);
+    job.off=off;
+    job.len=len;
+    job.waker=waker;
+    job.conn=conn;
+    job.seq=seq;
+    if(job.fd<0){
+        // dup 失败 (fd 用完了)：直接叫醒，让它自己 sendfile (大不了在 I/O 循环里等一下磁盘)
+        if(waker){
+            co_wake(waker,conn,seq);
+        }
+        return;
+    }
+
+    pthread_mutex_lock(&g_job_lock);
+    g_jobs.push_back(job);
+    pthread_cond_signal(&g_job_cond);
+    pthread_mutex_unlock(&g_job_lock);
+}
+
+// =================================================================
+// 3. 发过去的页不要了
+// =================================================================
+
+void page_cache_drop(int fd,off_t off,size_t len){
+    posix_fadvise(fd,off,len,POSIX_FADV_DONTNEED);
+}
@@ -0,0 +1,29 @@
+#ifndef PAGECACHE_H
+#define PAGECACHE_H
+
+#include<sys/types.h>
+#include<stddef.h>
+
+struct co_waker;
+class http_conn;
+
+// 💽 大文件和页缓存打交道的几个工具 (大文件模式用，见 http_conn::send_file)
+// 原来的做法是整个文件 mmap 进来交给 writev：几个 GB 的文件在 writev 里一页页缺页，
+// 磁盘慢的时候整个 I/O 循环都跟着卡住，发完以后这些页还把页缓存占满了。
+// 大文件模式改成留着 fd 按窗口 sendfile：
+//   1. 发一个窗口之前先看看它在不在页缓存里 (preadv2 RWF_NOWAIT 探一下，不支持就用 mincore)
+//   2. 不在：交给帮手线程去读 (readahead)，读好了通过 co_waker 叫醒那个连接接着发，I/O 循环不等磁盘
+//   3. 在：直接 sendfile，顺便让帮手线程把下一个窗口先读进来
+//   4. 一次性的下载：发过去的页 POSIX_FADV_DONTNEED 丢掉，别把热门小文件挤出页缓存
+
+// 🔎 [off, off+len) 是不是都在页缓存里 (只探开头和结尾两页，不会阻塞)
+bool page_cache_resident(int fd,off_t off,size_t len);
+
+// 📥 让帮手线程把 [off, off+len) 读进页缓存 (fd 会 dup 一份，调用方随时可以关掉自己的)
+// waker 不为 NULL 的话，读完了 co_wake(waker,conn,seq)；为 NULL 就是顺手预读，读完不通知
+void page_cache_prefetch(int fd,off_t off,size_t len,co_waker* waker,http_conn* conn,unsigned seq);
+
+// 🗑️ [off, off+len) 已经发出去了，不再需要 (还在 socket 缓冲区里的页内核会自己跳过)
+void page_cache_drop(int fd,off_t off,size_t len);
+
+#endif
@@ -0,0 +1,248 @@
+// ⏱️ 解析器基准：同一批请求分别交给各个解析策略 (见 parser_policy.h) 解析，看每个请求花多少纳秒
+// 用法: ./parser_bench [次数]   (每个请求 x 每个策略跑这么多次，默认 1000000，取 5 轮里最快的一轮)
+//       ./parser_bench check   只跑自检：几个坏的请求 (负的 / 溢出的 Content-Length、单独的 LF / CR……) 每个策略都得回 400，
+//                              对的请求都不能回 400；不过的话退出码是 1 (跑基准之前也会先跑一遍)
+// 只计 parse_line + parse_request_line + parse_headers (和 process_read 里走的一样)，不开文件、不发响应；
+// 每次都要先 init() 再把请求拷回读缓冲区 (解析是就地改的)，这部分单独量一遍 ("空跑")，从结果里减掉。
+// verbose 会打印每个不认识的头，跑的时候 stdout 转到 /dev/null，它的数字里是 printf 的开销。
+// 编译: g++ -std=c++20 -O2 parser_bench.cpp \
+//         http_conn.cpp config.cpp tls.cpp url.cpp out_chain.cpp mem_pool.cpp co_handler.cpp io_loop.cpp \
+//         micro_cache.cpp req_trace.cpp hpack.cpp http2.cpp busy_poll.cpp page_cache.cpp websocket.cpp form.cpp \
+//         sql_pool.cpp user_store.cpp fcgi.cpp prefork.cpp capture.cpp mem_budget.cpp asset_pack.cpp \
+//         -o parser_bench -lpthread -lssl -lcrypto -lsqlite3
+//       (只列服务器的库文件：server.cpp 和其它工具 / 测试各有自己的 main，加进来就链接不上)
+#include "http_conn.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<fcntl.h>
+#include<time.h>
+#include<type_traits>
+
+// =================================================================
+// 1. 测试用的请求
+// =================================================================
+
+struct bench_request{
+    const char* name;
+    const char* text;
+};
+
+static const bench_request REQUESTS[]={
+    {"curl",
+     "GET /index.html HTTP/1.1\r\n"
+     "Host: 127.0.0.1:9006\r\n"
+     "User-Agent: curl/8.5.0\r\n"
+     "Accept: */*\r\n"
+     "\r\n"},
+    {"keep-alive",
+     "GET / HTTP/1.1\r\n"
+     "Host: 127.0.0.1:9006\r\n"
+     "Connection: keep-alive\r\n"
+     "\r\n"},
+    {"browser",
+     "GET /css/site.css?v=3 HTTP/1.1\r\n"
+     "Host: www.example.com\r\n"
+     "Connection: keep-alive\r\n"
+     "sec-ch-ua: \"Chromium\";v=\"124\", \"Not-A.Brand\";v=\"99\"\r\n"
+     "sec-ch-ua-mobile: ?0\r\n"
+     "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/124.0.0.0 Safari/537.36\r\n"
+     "sec-ch-ua-platform: \"Linux\"\r\n"
+     "Accept: text/css,*/*;q=0.1\r\n"
+     "Sec-Fetch-Site: same-origin\r\n"
+     "Sec-Fetch-Mode: no-cors\r\n"
+     "Sec-Fetch-Dest: style\r\n"
+     "Referer: https://www.example.com/\r\n"
+     "Accept-Encoding: gzip, deflate, br, zstd\r\n"
+     "Accept-Language: en-US,en;q=0.9\r\n"
+     "Cookie: session=8f14e45fceea167a5a36dedd4bea2543; theme=dark\r\n"
+     "\r\n"},
+};
+static const int REQUEST_COUNT=sizeof(REQUESTS)/sizeof(REQUESTS[0]);
+
+// 自检用：每个策略都必须回 400 的 (都是 GET，免得 edge 因为方法不对就先拒了，测不到 Content-Length)
+static const bench_request BAD_REQUESTS[]={
+    {"负数",      "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: -100000\r\n\r\n"},
+    {"带正号",    "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: +5\r\n\r\n"},
+    {"后面有垃圾", "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 12abc\r\n\r\n"},
+    {"空的",      "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: \r\n\r\n"},
+    {"溢出",      "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 18446744073709551621\r\n\r\n"},
+    {"超过上限",  "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 67108865\r\n\r\n"},
+    {"单独的 LF", "GET / HTTP/1.1\nHost: a\n\n"},
+    {"单独的 CR", "GET / HTTP/1.1\rHost: a\r\r\n"},
+};
+static const int BAD_COUNT=sizeof(BAD_REQUESTS)/sizeof(BAD_REQUESTS[0]);
+
+// 自检用：每个策略都不能回 400 的
+static const bench_request GOOD_REQUESTS[]={
+    {"有请求体",  "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 5\r\n\r\n"},
+    {"前导 0",    "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 0000\r\n\r\n"},
+    {"正好上限",  "GET / HTTP/1.1\r\nHost: x\r\nContent-Length: 67108864\r\n\r\n"},
+};
+static const int GOOD_COUNT=sizeof(GOOD_REQUESTS)/sizeof(GOOD_REQUESTS[0]);
+
+static long long now_ns(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000000+ts.tv_nsec;
+}
+
+// =================================================================
+// 2. 直接调 http_conn 的私有解析函数 (http_conn.h 里把它声明成了 friend)
+// =================================================================
+
+struct parser_bench{
+    // 一个请求从头解析到空行；P 为空 (void) 的时候只做准备工作，量“空跑”
+    template<class P>
+    static HTTP_CODE parse_once(http_conn* c,const char* text,int len){
+        c->init();
+        if(!c->acquire_read_buf()){
+            return INTERNAL_ERROR;
+        }
+        memcpy(c->m_read_buf,text,len);
+        c->m_read_idx=len;
+        if constexpr(std::is_void_v<P>){
+            return NO_REQUEST;
+        }else{
+            HTTP_CODE ret=NO_REQUEST;
+            while(c->parse_line()==LINE_OK){
+                char* line=c->get_line();
+                c->m_start_line=c->m_checked_idx;
+                if(c->m_check_state==CHECK_STATE_REQUESTLINE){
+                    ret=c->parse_request_line<P>(line);
+                }else{
+                    ret=c->parse_headers<P>(line);
+                }
+                if(ret!=NO_REQUEST){
+                    return ret;
+                }
+                if(c->m_check_state==CHECK_STATE_CONTENT){
+                    break;
+                }
+            }
+            return ret;
+        }
+    }
+
+    // 坏请求走真正的 process_read (切行出错之后怎么办也得测到)；坏请求到不了 do_request，不会去开文件
+    template<class P>
+    static HTTP_CODE read_once(http_conn* c,const char* text,int len){
+        c->init();
+        if(!c->acquire_read_buf()){
+            return INTERNAL_ERROR;
+        }
+        memcpy(c->m_read_buf,text,len);
+        c->m_read_idx=len;
+        return c->process_read<P>();
+    }
+
+    // ✅ 自检：一个请求的结果对不对 (bad: 应该回 400)
+    template<class P>
+    static bool expect(http_conn* c,const char* policy,const bench_request& req,bool bad){
+        int len=strlen(req.text);
+        HTTP_CODE ret=bad?read_once<P>(c,req.text,len):parse_once<P>(c,req.text,len);
+        if((ret==BAD_REQUEST)==bad){
+            return true;
+        }
+        fprintf(stderr,"❌ %s: %s 应该%s 400，实际返回 %d\n",policy,req.name,bad?"":"不",ret);
+        return false;
+    }
+
+    template<class P>
+    static bool check(http_conn* c,const char* policy){
+        bool ok=true;
+        for(int i=0;i<BAD_COUNT;i++){
+            ok=expect<P>(c,policy,BAD_REQUESTS[i],true)&&ok;
+        }
+        for(int i=0;i<GOOD_COUNT;i++){
+            ok=expect<P>(c,policy,GOOD_REQUESTS[i],false)&&ok;
+        }
+        return ok;
+    }
+
+    // 读缓冲区还回去
+    static void finish(http_conn* c){
+        c->init();
+    }
+
+    // 返回每个请求的纳秒数 (5 轮里最快的)
+    template<class P>
+    static double run(http_conn* c,const bench_request& req,int iters,HTTP_CODE& ret){
+        int len=strlen(req.text);
+        double best=0;
+        for(int round=0;round<5;round++){
+            long long start=now_ns();
+            for(int i=0;i<iters;i++){
+                ret=parse_once<P>(c,req.text,len);
+            }
+            double ns=(double)(now_ns()-start)/iters;
+            if(round==0||ns<best){
+                best=ns;
+            }
+        }
+        return best;
+    }
+};
+
+// =================================================================
+// 3. 主函数
+// =================================================================
+
+// verbose 的打印扔掉 (stdout 先转到 /dev/null，返回原来的，用完交给 quiet_end)
+static int quiet_begin(){
+    fflush(stdout);
+    int saved=dup(1);
+    int devnull=open("/dev/null",O_WRONLY);
+    dup2(devnull,1);
+    close(devnull);
+    return saved;
+}
+
+static void quiet_end(int saved){
+    fflush(stdout);
+    dup2(saved,1);
+    close(saved);
+}
+
+int main(int argc,char* argv[]){
+    bool check_only=argc>1&&strcmp(argv[1],"check")==0;
+    int iters=(argc>1&&!check_only)?atoi(argv[1]):1000000;
+    if(iters<=0){
+        printf("usage: %s [iterations | check]\n",argv[0]);
+        return 1;
+    }
+    http_conn* c=new http_conn();
+
+    int saved=quiet_begin();
+    bool ok=parser_bench::check<parse_verbose>(c,"verbose");
+    quiet_end(saved);
+    ok=parser_bench::check<parse_generic>(c,"generic")&&ok;
+    ok=parser_bench::check<parse_edge>(c,"edge")&&ok;
+    if(!ok||check_only){
+        printf("自检%s (%d 个坏请求 + %d 个好请求 x 3 个策略)\n",ok?"通过":"没通过",BAD_COUNT,GOOD_COUNT);
+        parser_bench::finish(c);
+        delete c;
+        return ok?0:1;
+    }
+
+    printf("%-12s %10s %10s %10s %10s   (ns / 请求，已减掉空跑；括号里是解析结果)\n","request","verbose","generic","edge","空跑");
+    for(int i=0;i<REQUEST_COUNT;i++){
+        const bench_request& req=REQUESTS[i];
+        HTTP_CODE r_null,r_verbose,r_generic,r_edge;
+        double base=parser_bench::run<void>(c,req,iters,r_null);
+
+        // verbose 的打印扔掉
+        int saved=quiet_begin();
+        double verbose=parser_bench::run<parse_verbose>(c,req,iters,r_verbose);
+        quiet_end(saved);
+
+        double generic=parser_bench::run<parse_generic>(c,req,iters,r_generic);
+        double edge=parser_bench::run<parse_edge>(c,req,iters,r_edge);
+        printf("%-12s %7.1f(%d) %7.1f(%d) %7.1f(%d) %10.1f\n",req.name,
+            verbose-base,r_verbose,generic-base,r_generic,edge-base,r_edge,base);
+    }
+    parser_bench::finish(c);
+    delete c;
+    return 0;
+}
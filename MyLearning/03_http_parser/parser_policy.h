@@ -0,0 +1,100 @@
+#ifndef PARSER_POLICY_H
+#define PARSER_POLICY_H
+
+#include<string.h>
+#include<strings.h>
+
+// 🧩 HTTP/1 请求解析的“策略”：解析哪些方法、大小写认不认、收不收 HTTP/1.0、
+// 一行 / 头部最多多少、哪些请求头要记下来……全部是编译期常量
+// http_conn 的 process_read / parse_request_line / parse_headers 是按策略实例化的模板，
+// 一个策略编出一份解析代码：用不到的方法、用不到的请求头，比较的代码直接不生成，
+// 大小写敏感的版本用 memcmp 代替 strncasecmp。
+// 运行时只在 process() 里按配置 (parser=verbose|generic|edge，只在启动时读一次) 选一次走哪一份。
+//
+//   - parse_verbose：原来的解析器，一个字都没改 (默认)，每一行、每个不认识的头都打印出来
+//   - parse_generic：规则和 verbose 一样，只是不打印 (打印一行比解析一行贵得多)
+//   - parse_edge：只出静态文件的边缘节点用：只收 GET，方法 / 版本 / 头名字只认标准写法，
+//     格式不对的一律 400，只记 Connection / Host / Accept-Encoding；
+//     POST、WebSocket、h2c 升级、登录、FastCGI 这些都用不了
+//
+// 要加新策略：照着下面写一个 struct，在下面的 PARSER_KIND 里加一项，
+// 再到 http_conn.cpp 的 process_read 后面显式实例化一份 (模板定义在 http_conn.cpp 里)
+
+// 📌 要记下来的请求头 (CAPTURE 里的位)
+enum{
+    CAP_CONNECTION      =1<<0,  // Connection: keep-alive
+    CAP_HOST            =1<<1,
+    CAP_CONTENT_TYPE    =1<<2,
+    CAP_COOKIE          =1<<3,
+    CAP_ACCEPT_ENCODING =1<<4,  // 只看有没有 gzip
+    CAP_UPGRADE         =1<<5,  // Upgrade: h2c / websocket
+    CAP_H2_SETTINGS     =1<<6,
+    CAP_WS_KEY          =1<<7,  // Sec-WebSocket-Key
+    CAP_WS_VERSION      =1<<8,  // Sec-WebSocket-Version
+    CAP_ALL             =(1<<9)-1
+};
+// Content-Length 不在里面：它决定请求在哪里结束，哪个策略都得认 (而且不分大小写)，
+// 认漏了请求体就会被当成下一个请求来解析；值也是哪个策略都只收纯数字 (不超过 MAX_CONTENT_LENGTH)，不然回 400
+
+#define METHOD_BIT(m) (1u<<(m))
+
+// 📜 原来的解析器
+struct parse_verbose{
+    static constexpr unsigned METHODS=METHOD_BIT(0)|METHOD_BIT(1);  // GET | POST (见 http_conn.h 的 METHOD)
+    static constexpr bool CASELESS=true;        // 方法、版本、头名字不分大小写
+    static constexpr bool STRICT=false;         // 宽松：多个空格 / tab 也行，没有冒号的头当成不认识的跳过
+    static constexpr bool HTTP10=false;         // 只收 HTTP/1.1
+    static constexpr int MAX_HEADERS=0;         // 最多多少个请求头，0 不限 (反正读缓冲区只有 2KB)
+    static constexpr int MAX_LINE=0;            // 一行 (请求行 / 一个头) 最长多少字节，0 不限
+    static constexpr unsigned CAPTURE=CAP_ALL;
+    static constexpr bool LOG=true;             // 打印每一行和不认识的头
+};
+
+// 🤫 同样的规则，不打印
+struct parse_generic:parse_verbose{
+    static constexpr bool LOG=false;
+};
+
+// 🏎️ 静态文件边缘节点
+struct parse_edge{
+    static constexpr unsigned METHODS=METHOD_BIT(0);                // 只有 GET
+    static constexpr bool CASELESS=false;       // "get"、"host:" 这种不标准的写法：方法 / 版本回 400，头名字当成不认识的
+    static constexpr bool STRICT=true;          // 请求行只能用一个空格分开；头没有冒号、冒号前面有空白、
+                                                // 续行 (空白开头)、Transfer-Encoding、Content-Length 后面跟着空白 -> 400
+    static constexpr bool HTTP10=true;          // 老的探活 / 压测工具还在发 HTTP/1.0
+    static constexpr int MAX_HEADERS=32;
+    static constexpr int MAX_LINE=1024;
+    static constexpr unsigned CAPTURE=CAP_CONNECTION|CAP_HOST|CAP_ACCEPT_ENCODING;
+    static constexpr bool LOG=false;
+};
+
+enum PARSER_KIND{
+    PARSER_VERBOSE=0,
+    PARSER_GENERIC,
+    PARSER_EDGE
+};
+
+// "verbose" / "generic" / "edge" -> PARSER_KIND，认不出来返回 -1
+inline int parse_parser_kind(const char* s){
+    if(strcmp(s,"verbose")==0){
+        return PARSER_VERBOSE;
+    }
+    if(strcmp(s,"generic")==0){
+        return PARSER_GENERIC;
+    }
+    if(strcmp(s,"edge")==0){
+        return PARSER_EDGE;
+    }
+    return -1;
+}
+
+// 🔤 比较一个已知长度的记号 (方法名 / 头名字)，按策略决定分不分大小写
+template<bool CASELESS>
+inline bool token_eq(const char* s,size_t len,const char* lit,size_t lit_len){
+    if(len!=lit_len){
+        return false;
+    }
+    return CASELESS?strncasecmp(s,lit,len)==0:memcmp(s,lit,len)==0;
+}
+
+#endif
@@ -0,0 +1,144 @@
+#include "prefork.h"
+#include<stdio.h>
+#include<string.h>
+#include<unistd.h>
+#include<time.h>
+#include<new>
+#include<sys/mman.h>
+#include<sys/prctl.h>
+
+// 这个进程自己那一格 (master 里一直是 NULL)
+static worker_stats* g_my_slot=NULL;
+
+static long long mono_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+bool prefork_master::init(int workers){
+    if(workers<=0||workers>MAX_WORKERS){
+        printf("workers 要在 1~%d 之间\n",MAX_WORKERS);
+        return false;
+    }
+    void* p=mmap(NULL,sizeof(worker_stats)*workers,PROT_READ|PROT_WRITE,MAP_SHARED|MAP_ANONYMOUS,-1,0);
+    if(p==MAP_FAILED){
+        perror("mmap worker stats");
+        return false;
+    }
+    m_stats=new(p) worker_stats[workers]();
+    m_count=workers;
+    return true;
+}
+
+pid_t prefork_master::spawn(int id,const sigset_t* child_mask){
+    worker_stats& s=m_stats[id];
+    s.users.store(0,std::memory_order_relaxed);
+    s.requests.store(0,std::memory_order_relaxed);
+    s.bytes_out.store(0,std::memory_order_relaxed);
+
+    fflush(stdout);     // 缓冲区里还没打出去的，别让子进程再打一遍
+    pid_t parent=getpid();
+    pid_t pid=fork();
+    if(pid<0){
+        perror("fork worker");
+        return -1;
+    }
+    if(pid==0){
+        // 👶 worker：master 被 kill -9 了也跟着退，别留一群没人管的进程占着端口
+        prctl(PR_SET_PDEATHSIG,SIGTERM);
+        // fork 完 prctl 之前 master 就没了：父进程换人了 (不能比 1，容器里 master 自己就是 PID 1)
+        if(getppid()!=parent){
+            _exit(0);
+        }
+        sigprocmask(SIG_SETMASK,child_mask,NULL);
+        g_my_slot=&s;
+        s.pid.store(getpid(),std::memory_order_relaxed);
+        return 0;
+    }
+    s.pid.store(pid,std::memory_order_relaxed);
+    m_spawn_us[id]=mono_us();
+    return pid;
+}
+
+int prefork_master::reap(pid_t pid){
+    for(int i=0;i<m_count;i++){
+        worker_stats& s=m_stats[i];
+        if(s.pid.load(std::memory_order_relaxed)!=pid){
+            continue;
+        }
+        // 它不会再写了，把最后的计数收过来
+        m_retired_requests+=s.requests.load(std::memory_order_relaxed);
+        m_retired_bytes+=s.bytes_out.load(std::memory_order_relaxed);
+        s.requests.store(0,std::memory_order_relaxed);
+        s.bytes_out.store(0,std::memory_order_relaxed);
+        s.users.store(0,std::memory_order_relaxed);
+        s.mem.store(0,std::memory_order_relaxed);
+        s.pid.store(0,std::memory_order_relaxed);
+        return i;
+    }
+    return -1;
+}
+
+pid_t prefork_master::pid_of(int id) const{
+    return m_stats[id].pid.load(std::memory_order_relaxed);
+}
+
+int prefork_master::alive() const{
+    int n=0;
+    for(int i=0;i<m_count;i++){
+        if(m_stats[i].pid.load(std::memory_order_relaxed)!=0){
+            n++;
+        }
+    }
+    return n;
+}
+
+void prefork_master::signal_all(int sig) const{
+    for(int i=0;i<m_count;i++){
+        pid_t pid=m_stats[i].pid.load(std::memory_order_relaxed);
+        if(pid>0){
+            kill(pid,sig);
+        }
+    }
+}
+
+long long prefork_master::uptime_us(int id) const{
+    return mono_us()-m_spawn_us[id];
+}
+
+void prefork_master::print_stats() const{
+    int users=0;
+    long long requests=m_retired_requests;
+    long long bytes=m_retired_bytes;
+    for(int i=0;i<m_count;i++){
+        const worker_stats& s=m_stats[i];
+        pid_t pid=s.pid.load(std::memory_order_relaxed);
+        if(pid==0){
+            continue;
+        }
+        int u=s.users.load(std::memory_order_relaxed);
+        long long r=s.requests.load(std::memory_order_relaxed);
+        long long b=s.bytes_out.load(std::memory_order_relaxed);
+        long long m=s.mem.load(std::memory_order_relaxed);
+        printf("  worker %d (pid %d): 连接 %d, 请求 %lld, 发送 %.1f MB, 内存 %.1f MB\n",i,pid,u,r,b/1048576.0,m/1048576.0);
+        users+=u;
+        requests+=r;
+        bytes+=b;
+    }
+    printf("📊 合计: 连接 %d, 请求 %lld, 发送 %.1f MB (含已退出的 worker), 重启过 %d 次\n",
+        users,requests,bytes/1048576.0,m_restarts);
+    fflush(stdout);
+}
+
+void worker_publish(int users,long long requests,long long bytes,long long mem){
+    worker_stats* s=g_my_slot;
+    if(!s){
+        return;
+    }
+    // 只有自己写这条缓存行，普通的 store 就够了 (master 读到稍旧一点的值也无所谓)
+    s->users.store(users,std::memory_order_relaxed);
+    s->requests.store(requests,std::memory_order_relaxed);
+    s->bytes_out.store(bytes,std::memory_order_relaxed);
+    s->mem.store(mem,std::memory_order_relaxed);
+}
@@ -0,0 +1,68 @@
+#ifndef PREFORK_H
+#define PREFORK_H
+
+#include<atomic>
+#include<signal.h>
+#include<sys/types.h>
+
+// 👨‍👧‍👦 多进程模式 (prefork)：和 io_loops 的多线程二选一
+// master 建好监听 socket 以后 fork 出 workers 个 worker 进程，每个 worker 就是一个完整的单循环服务器：
+//   - 监听 socket 是同一个 (fork 继承来的)，每个 worker 用 EPOLLEXCLUSIVE 挂到自己的 epoll 上，
+//     来了新连接只叫醒一个 worker，不会所有进程一起惊醒 (惊群)
+//   - 进程之间什么都不共享：连接表、mem_pool、微缓存、协程定时器……都是各自一份，热路径上没有锁，
+//     一个 worker 崩了也带不走别人，master 马上拉一个新的顶上
+//   - 每个 worker 把自己的计数写进共享内存里属于自己的那一格 (独占一条缓存行，谁也不抢谁)，
+//     master 汇总：kill -USR1 <master> 打印一次，退出时也打印一次
+//   - SIGHUP / SIGUSR2 发给 master：热更新转发给每个 worker；平滑升级由 master 把监听 socket
+//     交给新进程，然后让 worker 们排空退出
+// 注意：微缓存、WebSocket 广播、登录用户表这些本来在进程内共享的东西，多进程下是各管各的
+// (广播只能发给连在同一个 worker 上的客户端)
+
+// 📊 一个 worker 的计数 (worker 只写，master 只读)
+struct worker_stats{
+    std::atomic<int> pid;               // 0 表示这一格现在没人
+    std::atomic<int> users;             // 当前连接数 (http_conn::m_user_count)
+    std::atomic<long long> requests;    // 处理过的请求数
+    std::atomic<long long> bytes_out;   // 发出去的字节数
+    std::atomic<long long> mem;         // 记在内存预算上的字节数 (mem_used_total)
+} __attribute__((aligned(64)));
+
+class prefork_master{
+public:
+    static const int MAX_WORKERS=256;
+
+    prefork_master():m_stats(0),m_count(0),m_restarts(0),m_retired_requests(0),m_retired_bytes(0),m_spawn_us(){}
+
+    // fork 之前调：MAP_SHARED 的匿名映射，fork 出来的 worker 和 master 看到的是同一块内存
+    bool init(int workers);
+    int count() const{return m_count;}
+
+    // 🍴 拉起第 id 号 worker：子进程里返回 0 (信号掩码恢复成 child_mask)，父进程返回子进程 pid，失败 -1
+    pid_t spawn(int id,const sigset_t* child_mask);
+
+    // ⚰️ 收尸：pid 是我们的 worker 就返回它的编号，计数并进“已退出”的合计，格子腾出来；不是返回 -1
+    // (平滑升级拉起来的新版本也是 master 的子进程，它不在格子里)
+    int reap(pid_t pid);
+
+    pid_t pid_of(int id) const;         // 0 表示这一格空着 (还没拉起来 / 刚死)
+    int alive() const;                  // 还活着的 worker 个数
+    void signal_all(int sig) const;     // 转发信号给每个 worker
+    void print_stats() const;           // 📊 每个 worker 一行，最后一行合计
+    void note_restart(){m_restarts++;}  // 不是排空时退出的，算一次重启
+
+    // 这个 worker 刚拉起来多久了 (微秒)，拉起来马上就死的要歇一会再拉，别一直空转
+    long long uptime_us(int id) const;
+
+private:
+    worker_stats* m_stats;
+    int m_count;
+    int m_restarts;
+    long long m_retired_requests;       // 已经退出的 worker 留下的计数
+    long long m_retired_bytes;
+    long long m_spawn_us[MAX_WORKERS];
+};
+
+// 👷 worker 这边：每轮事件循环结束时把计数写进自己那一格 (不是 worker 就什么都不做)
+void worker_publish(int users,long long requests,long long bytes,long long mem);
+
+#endif
@@ -0,0 +1,716 @@
+// 🔁 流量回放：把 capture_file 抓下来的请求 (见 capture.h) 原样打回服务器，做性能回归测试
+// 用法: ./replay <capture_file> [-h host] [-p port] [-s speed] [-x copies] [-c conns] [-t ms] [-w fingerprints] [-e fingerprints]
+//   -s 1     按抓的时候的节奏发 (默认)；-s 10 快 10 倍；-s 0 不等，能多快就多快
+//   -x N     每条抓到的连接同时回放 N 份 (放大压力)
+//   -c N     同时最多开 N 条连接 (默认 256)，到点了但连接数满了的排队等
+//   -t MS    一个请求 MS 毫秒还没收到完整响应就算出错 (默认 10000)
+//   -w FILE  把每个响应的状态码 / 长度 / 内容哈希存下来 (拿老版本跑一遍当基准)
+//   -e FILE  和存下来的对比，报告不一致的响应 (拿新版本跑，看解析 / I/O 的改动有没有改坏结果)
+// 每条抓到的连接用自己的一条 TCP 连接回放：一个请求的响应收完了才发下一个 (不 pipeline)，
+// 服务器回了 Connection: close 就重连。开头是 HTTP/2 前言的连接跳过，遇到 Upgrade 的请求就停在它前面。
+// 编译: g++ -std=c++20 -O2 replay.cpp -o replay
+#include "capture.h"
+#include<stdio.h>
+#include<string.h>
+#include<stdlib.h>
+#include<unistd.h>
+#include<errno.h>
+#include<fcntl.h>
+#include<signal.h>
+#include<time.h>
+#include<netdb.h>
+#include<sys/socket.h>
+#include<sys/epoll.h>
+#include<sys/resource.h>
+#include<netinet/in.h>
+#include<netinet/tcp.h>
+#include<arpa/inet.h>
+#include<string>
+#include<vector>
+#include<map>
+#include<queue>
+#include<deque>
+#include<algorithm>
+
+// =================================================================
+// 1. 读抓包文件，按连接拼好，切成一个个请求
+// =================================================================
+
+struct replay_request{
+    size_t off;         // 在这条连接字节流里的位置
+    size_t len;
+    uint64_t ts_us;     // 第一个字节当时是什么时候到的
+    bool head;          // HEAD 请求的响应没有响应体
+};
+
+struct replay_script{
+    uint32_t conn;
+    bool dropped;                                       // 抓的时候丢过数据 (见 CAPTURE_DROPPED)，整条不回放
+    std::string bytes;                                  // 这条连接上收到的所有字节
+    std::vector<std::pair<size_t,uint64_t> > arrivals;  // 每一段从哪里开始、什么时候到的
+    std::vector<replay_request> reqs;
+};
+
+static long long now_us(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+static bool load_capture(const char* path,std::vector<replay_script>& scripts){
+    FILE* fp=fopen(path,"rb");
+    if(!fp){
+        perror(path);
+        return false;
+    }
+    char magic[8];
+    if(fread(magic,1,8,fp)!=8||memcmp(magic,CAPTURE_MAGIC,8)!=0){
+        printf("%s: 不是抓包文件\n",path);
+        fclose(fp);
+        return false;
+    }
+    std::map<uint32_t,size_t> index;
+    capture_record_head head;
+    std::string data;
+    while(fread(&head,sizeof(head),1,fp)==1){
+        bool dropped=(head.len==CAPTURE_DROPPED);
+        data.resize(dropped?0:head.len);
+        if(!dropped&&head.len>0&&fread(&data[0],1,head.len,fp)!=head.len){
+            break;  // 最后一条没写完 (服务器被 kill -9 了)
+        }
+        std::map<uint32_t,size_t>::iterator it=index.find(head.conn);
+        if(it==index.end()){
+            it=index.insert(std::make_pair(head.conn,scripts.size())).first;
+            scripts.push_back(replay_script());
+            scripts.back().conn=head.conn;
+            scripts.back().dropped=false;
+        }
+        replay_script& s=scripts[it->second];
+        if(dropped){
+            s.dropped=true;     // 中间少了一截，后面的字节接不上前面的
+            continue;
+        }
+        s.arrivals.push_back(std::make_pair(s.bytes.size(),head.ts_us));
+        s.bytes+=data;
+    }
+    fclose(fp);
+    return true;
+}
+
+static uint64_t arrival_of(const replay_script& s,size_t off){
+    size_t i=0;
+    while(i+1<s.arrivals.size()&&s.arrivals[i+1].first<=off){
+        i++;
+    }
+    return s.arrivals[i].second;
+}
+
+// 请求头里找一个字段的值 (不区分大小写)，找到了 value 指向值的开头
+static bool find_header(const char* head,size_t len,const char* name,std::string& value){
+    size_t name_len=strlen(name);
+    const char* p=head;
+    const char* end=head+len;
+    while(p<end){
+        const char* eol=(const char*)memmem(p,end-p,"\r\n",2);
+        if(!eol){
+            eol=end;
+        }
+        if((size_t)(eol-p)>name_len&&strncasecmp(p,name,name_len)==0&&p[name_len]==':'){
+            const char* v=p+name_len+1;
+            while(v<eol&&(*v==' '||*v=='\t')){
+                v++;
+            }
+            value.assign(v,eol-v);
+            return true;
+        }
+        p=eol+2;
+    }
+    return false;
+}
+
+// chunked 的正文从 p 开始，返回整个正文 (连同结尾的 0 块和 trailer) 有多长，没收全返回 0
+static size_t chunked_length(const char* p,size_t avail,std::string* body){
+    size_t at=0;
+    while(true){
+        const char* eol=(const char*)memmem(p+at,avail-at,"\r\n",2);
+        if(!eol){
+            return 0;
+        }
+        size_t size=strtoul(p+at,NULL,16);
+        at=eol+2-p;
+        if(size==0){
+            // trailer 一直到空行
+            while(true){
+                const char* end=(const char*)memmem(p+at,avail-at,"\r\n",2);
+                if(!end){
+                    return 0;
+                }
+                bool empty=(end==p+at);
+                at=end+2-p;
+                if(empty){
+                    return at;
+                }
+            }
+        }
+        if(avail-at<size+2){
+            return 0;
+        }
+        if(body){
+            body->append(p+at,size);
+        }
+        at+=size+2;
+    }
+}
+
+// ✂️ 把一条连接的字节流切成请求；切不下去 (没收全 / 要升级协议) 就停
+static void split_requests(replay_script& s){
+    const char* base=s.bytes.data();
+    size_t total=s.bytes.size();
+    size_t off=0;
+    while(off<total){
+        const char* end=(const char*)memmem(base+off,total-off,"\r\n\r\n",4);
+        if(!end){
+            break;
+        }
+        size_t head_len=end+4-(base+off);
+        std::string value;
+        if(find_header(base+off,head_len,"Upgrade",value)){
+            break;
+        }
+        size_t body_len=0;
+        if(find_header(base+off,head_len,"Transfer-Encoding",value)&&strcasestr(value.c_str(),"chunked")){
+            body_len=chunked_length(base+off+head_len,total-off-head_len,NULL);
+            if(body_len==0){
+                break;
+            }
+        }else if(find_header(base+off,head_len,"Content-Length",value)){
+            body_len=strtoul(value.c_str(),NULL,10);
+        }
+        if(total-off-head_len<body_len){
+            break;
+        }
+
+        replay_request r;
+        r.off=off;
+        r.len=head_len+body_len;
+        r.ts_us=arrival_of(s,off);
+        r.head=(strncmp(base+off,"HEAD ",5)==0);
+        s.reqs.push_back(r);
+        off+=r.len;
+    }
+}
+
+// =================================================================
+// 2. 响应：收全了没有，指纹是什么
+// =================================================================
+
+struct fingerprint{
+    int status;
+    size_t body_len;
+    uint64_t hash;      // 响应体的 FNV-1a (chunked 的是拼回去以后的)
+};
+
+static uint64_t fnv1a(const char* p,size_t len){
+    uint64_t h=1469598103934665603ULL;
+    for(size_t i=0;i<len;i++){
+        h^=(unsigned char)p[i];
+        h*=1099511628211ULL;
+    }
+    return h;
+}
+
+// 返回这个响应占了多少字节 (0: 还没收全，-1: 不是 HTTP 响应)；eof 表示对面已经关了
+static long parse_response(const std::string& buf,bool head_req,bool eof,fingerprint& fp,bool& close_after){
+    size_t at=0;
+    while(true){
+        const char* base=buf.data()+at;
+        size_t avail=buf.size()-at;
+        if(avail<12){
+            return 0;
+        }
+        if(strncmp(base,"HTTP/1.",7)!=0){
+            return -1;
+        }
+        const char* end=(const char*)memmem(base,avail,"\r\n\r\n",4);
+        if(!end){
+            return 0;
+        }
+        size_t head_len=end+4-base;
+        int status=atoi(base+9);
+        if(status>=100&&status<200&&status!=101){
+            at+=head_len;   // 100 Continue 之类的中间响应，跳过
+            continue;
+        }
+
+        std::string value;
+        close_after=find_header(base,head_len,"Connection",value)&&strcasecmp(value.c_str(),"close")==0;
+        fp.status=status;
+        const char* body=base+head_len;
+        size_t body_avail=avail-head_len;
+        if(head_req||status==204||status==304){
+            fp.body_len=0;
+            fp.hash=fnv1a("",0);
+            return at+head_len;
+        }
+        if(find_header(base,head_len,"Transfer-Encoding",value)&&strcasestr(value.c_str(),"chunked")){
+            std::string decoded;
+            size_t len=chunked_length(body,body_avail,&decoded);
+            if(len==0){
+                return 0;
+            }
+            fp.body_len=decoded.size();
+            fp.hash=fnv1a(decoded.data(),decoded.size());
+            return at+head_len+len;
+        }
+        size_t len;
+        if(find_header(base,head_len,"Content-Length",value)){
+            len=strtoul(value.c_str(),NULL,10);
+            if(body_avail<len){
+                return 0;
+            }
+        }else{
+            // 没有长度：一直到对面关连接
+            if(!eof){
+                return 0;
+            }
+            len=body_avail;
+            close_after=true;
+        }
+        fp.body_len=len;
+        fp.hash=fnv1a(body,len);
+        return at+head_len+len;
+    }
+}
+
+// =================================================================
+// 3. 回放
+// =================================================================
+
+enum SESSION_STATE{S_WAIT_DUE,S_CONNECTING,S_SENDING,S_RECEIVING,S_DONE};
+
+struct session{
+    const replay_script* script;
+    int copy;
+    size_t next;            // 下一个 (或者正在发的) 请求
+    int fd;
+    SESSION_STATE state;
+    size_t sent;            // 当前请求发出去多少了
+    long long send_start;   // 当前请求开始发的时刻
+    std::string rbuf;
+};
+
+struct replay_stats{
+    long long ok;
+    long long errors;
+    long long mismatches;
+    std::vector<long long> latency_us;
+    std::map<int,long long> status_count;
+};
+
+struct replay_options{
+    const char* host;
+    int port;
+    double speed;
+    int copies;
+    const char* save_path;
+    const char* expect_path;
+    int max_conns;
+    int timeout_ms;
+};
+
+static std::map<uint64_t,fingerprint> g_expect;
+static FILE* g_save_fp=NULL;
+static int g_open_conns=0;
+
+static uint64_t fp_key(uint32_t conn,size_t idx){
+    return ((uint64_t)conn<<32)|idx;
+}
+
+static void close_fd(int epollfd,session& s){
+    if(s.fd>=0){
+        epoll_ctl(epollfd,EPOLL_CTL_DEL,s.fd,0);
+        close(s.fd);
+        s.fd=-1;
+        g_open_conns--;
+    }
+}
+
+static bool open_conn(int epollfd,session& s,int idx,const struct sockaddr_in& addr){
+    s.fd=socket(AF_INET,SOCK_STREAM|SOCK_NONBLOCK,0);
+    if(s.fd<0){
+        return false;
+    }
+    int one=1;
+    setsockopt(s.fd,IPPROTO_TCP,TCP_NODELAY,&one,sizeof(one));
+    if(connect(s.fd,(const struct sockaddr*)&addr,sizeof(addr))<0&&errno!=EINPROGRESS){
+        close(s.fd);
+        s.fd=-1;
+        return false;
+    }
+    struct epoll_event ev;
+    ev.events=EPOLLOUT;
+    ev.data.u32=idx;
+    epoll_ctl(epollfd,EPOLL_CTL_ADD,s.fd,&ev);
+    s.state=S_CONNECTING;
+    g_open_conns++;
+    return true;
+}
+
+static void want(int epollfd,session& s,int idx,uint32_t events){
+    struct epoll_event ev;
+    ev.events=events;
+    ev.data.u32=idx;
+    epoll_ctl(epollfd,EPOLL_CTL_MOD,s.fd,&ev);
+}
+
+static void record_response(session& s,const fingerprint& fp,replay_stats& st){
+    st.ok++;
+    st.latency_us.push_back(now_us()-s.send_start);
+    st.status_count[fp.status]++;
+    uint64_t key=fp_key(s.script->conn,s.next);
+    if(g_save_fp&&s.copy==0){
+        fprintf(g_save_fp,"%u %zu %d %zu %016llx\n",s.script->conn,s.next,fp.status,fp.body_len,(unsigned long long)fp.hash);
+    }
+    if(!g_expect.empty()){
+        std::map<uint64_t,fingerprint>::const_iterator it=g_expect.find(key);
+        if(it==g_expect.end()){
+            return;
+        }
+        const fingerprint& want=it->second;
+        if(want.status!=fp.status||want.body_len!=fp.body_len||want.hash!=fp.hash){
+            st.mismatches++;
+            if(st.mismatches<=10){
+                const replay_request& r=s.script->reqs[s.next];
+                const char* line=s.script->bytes.data()+r.off;
+                const char* eol=(const char*)memchr(line,'\r',r.len);
+                int line_len=eol?(int)(eol-line):(int)r.len;
+                printf("❗ 不一致 conn %u #%zu %.*s: 期望 %d/%zu 字节，实际 %d/%zu 字节%s\n",
+                    s.script->conn,s.next,line_len,line,want.status,want.body_len,fp.status,fp.body_len,
+                    (want.status==fp.status&&want.body_len==fp.body_len)?" (内容不同)":"");
+            }
+        }
+    }
+}
+
+static bool load_expect(const char* path){
+    FILE* fp=fopen(path,"r");
+    if(!fp){
+        perror(path);
+        return false;
+    }
+    unsigned conn;
+    size_t idx;
+    fingerprint f;
+    unsigned long long hash;
+    while(fscanf(fp,"%u %zu %d %zu %llx",&conn,&idx,&f.status,&f.body_len,&hash)==5){
+        f.hash=hash;
+        g_expect[fp_key(conn,idx)]=f;
+    }
+    fclose(fp);
+    return true;
+}
+
+static long long percentile(const std::vector<long long>& sorted,double p){
+    if(sorted.empty()){
+        return 0;
+    }
+    size_t i=(size_t)(p*(sorted.size()-1)+0.5);
+    return sorted[i];
+}
+
+int main(int argc,char* argv[]){
+    if(argc<2){
+        printf("usage: %s <capture_file> [-h host] [-p port] [-s speed] [-x copies] [-c conns] [-t ms] [-w save] [-e expect]\n",argv[0]);
+        return 1;
+    }
+    replay_options opt;
+    opt.host="127.0.0.1";
+    opt.port=9006;
+    opt.speed=1;
+    opt.copies=1;
+    opt.save_path=NULL;
+    opt.expect_path=NULL;
+    opt.max_conns=256;
+    opt.timeout_ms=10000;
+    int c;
+    optind=2;
+    while((c=getopt(argc,argv,"h:p:s:x:c:t:w:e:"))!=-1){
+        switch(c){
+            case 'h': opt.host=optarg; break;
+            case 'p': opt.port=atoi(optarg); break;
+            case 's': opt.speed=atof(optarg); break;
+            case 'x': opt.copies=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'c': opt.max_conns=atoi(optarg)>0?atoi(optarg):1; break;
+            case 't': opt.timeout_ms=atoi(optarg)>0?atoi(optarg):1; break;
+            case 'w': opt.save_path=optarg; break;
+            case 'e': opt.expect_path=optarg; break;
+            default: return 1;
+        }
+    }
+    signal(SIGPIPE,SIG_IGN);
+
+    struct sockaddr_in addr;
+    memset(&addr,0,sizeof(addr));
+    addr.sin_family=AF_INET;
+    addr.sin_port=htons(opt.port);
+    if(inet_pton(AF_INET,opt.host,&addr.sin_addr)!=1){
+        struct hostent* h=gethostbyname(opt.host);
+        if(!h){
+            printf("找不到 %s\n",opt.host);
+            return 1;
+        }
+        memcpy(&addr.sin_addr,h->h_addr,sizeof(addr.sin_addr));
+    }
+
+    std::vector<replay_script> scripts;
+    if(!load_capture(argv[1],scripts)){
+        return 1;
+    }
+    int skipped=0;
+    int dropped=0;
+    size_t request_count=0;
+    uint64_t first_ts=UINT64_MAX;
+    std::vector<const replay_script*> usable;
+    for(size_t i=0;i<scripts.size();i++){
+        replay_script& s=scripts[i];
+        if(s.dropped){
+            dropped++;
+            continue;
+        }
+        if(s.bytes.compare(0,14,"PRI * HTTP/2.0")==0){
+            skipped++;
+            continue;
+        }
+        split_requests(s);
+        if(s.reqs.empty()){
+            skipped++;
+            continue;
+        }
+        usable.push_back(&s);
+        request_count+=s.reqs.size();
+        first_ts=std::min(first_ts,s.reqs[0].ts_us);
+    }
+    char speed[32];
+    snprintf(speed,sizeof(speed),opt.speed>0?"%gx":"全速",opt.speed);
+    printf("🔁 抓到 %zu 条连接，能回放的 %zu 条 (跳过 %d 条 HTTP/2 / 没有完整请求的，%d 条抓的时候丢过数据的)，共 %zu 个请求 x %d 份，速度 %s\n",
+        scripts.size(),usable.size(),skipped,dropped,request_count,opt.copies,speed);
+    if(usable.empty()){
+        return 0;
+    }
+    if(opt.expect_path&&!load_expect(opt.expect_path)){
+        return 1;
+    }
+    if(opt.save_path){
+        g_save_fp=fopen(opt.save_path,"w");
+        if(!g_save_fp){
+            perror(opt.save_path);
+            return 1;
+        }
+    }
+
+    // 连接多的时候 fd 不够用
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE,&rl)==0){
+        rl.rlim_cur=rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+    }
+
+    std::vector<session> sessions;
+    for(int copy=0;copy<opt.copies;copy++){
+        for(size_t i=0;i<usable.size();i++){
+            session s;
+            s.script=usable[i];
+            s.copy=copy;
+            s.next=0;
+            s.fd=-1;
+            s.state=S_WAIT_DUE;
+            s.sent=0;
+            s.send_start=0;
+            sessions.push_back(s);
+        }
+    }
+
+    // ⏰ 按“该发的时刻”排队：(时刻, 第几个会话)，时刻小的先出来
+    typedef std::pair<long long,int> due_item;
+    std::priority_queue<due_item,std::vector<due_item>,std::greater<due_item> > due;
+    long long t0=now_us();
+    for(size_t i=0;i<sessions.size();i++){
+        const replay_request& r=sessions[i].script->reqs[0];
+        long long at=opt.speed>0?t0+(long long)((r.ts_us-first_ts)/opt.speed):t0;
+        due.push(std::make_pair(at,(int)i));
+    }
+
+    int epollfd=epoll_create1(0);
+    replay_stats st;
+    st.ok=0;
+    st.errors=0;
+    st.mismatches=0;
+    size_t done=0;
+    std::vector<struct epoll_event> events(1024);
+
+    // 这个会话的当前请求处理完了 (成功或失败)：排下一个，或者收工
+    auto advance=[&](int idx){
+        session& s=sessions[idx];
+        s.next++;
+        s.sent=0;
+        s.rbuf.clear();
+        if(s.next>=s.script->reqs.size()){
+            close_fd(epollfd,s);
+            s.state=S_DONE;
+            done++;
+            return;
+        }
+        const replay_request& r=s.script->reqs[s.next];
+        long long at=opt.speed>0?t0+(long long)((r.ts_us-first_ts)/opt.speed):0;
+        s.state=S_WAIT_DUE;
+        due.push(std::make_pair(std::max(at,now_us()),idx));
+    };
+    auto fail=[&](int idx){
+        st.errors++;
+        close_fd(epollfd,sessions[idx]);
+        advance(idx);
+    };
+    auto start_send=[&](int idx){
+        session& s=sessions[idx];
+        s.send_start=now_us();
+        s.sent=0;
+        s.state=S_SENDING;
+        want(epollfd,s,idx,EPOLLOUT);
+    };
+
+    std::deque<int> blocked;    // 到点了但连接数满了，等别的会话关了连接再连
+    long long last_scan=t0;
+    while(done<sessions.size()){
+        // 到点了的会话：连接还在就直接发，不在就先连
+        long long now=now_us();
+        while(!due.empty()&&due.top().first<=now){
+            int idx=due.top().second;
+            due.pop();
+            if(sessions[idx].fd>=0){
+                start_send(idx);
+            }else{
+                blocked.push_back(idx);
+            }
+        }
+        while(!blocked.empty()&&g_open_conns<opt.max_conns){
+            int idx=blocked.front();
+            blocked.pop_front();
+            session& s=sessions[idx];
+            if(!open_conn(epollfd,s,idx,addr)){
+                fail(idx);
+            }else{
+                s.send_start=now_us();
+            }
+        }
+
+        // ⌛ 隔 100ms 查一遍超时的请求
+        if(now-last_scan>=100000){
+            last_scan=now;
+            for(size_t i=0;i<sessions.size();i++){
+                session& s=sessions[i];
+                bool busy=(s.state==S_CONNECTING||s.state==S_SENDING||s.state==S_RECEIVING);
+                if(busy&&now-s.send_start>(long long)opt.timeout_ms*1000){
+                    fail((int)i);
+                }
+            }
+        }
+
+        int timeout=100;
+        if(!due.empty()){
+            long long wait=due.top().first-now_us();
+            timeout=wait<=0?0:std::min(100,(int)((wait+999)/1000));
+        }
+        int n=epoll_wait(epollfd,events.data(),(int)events.size(),timeout);
+        for(int i=0;i<n;i++){
+            int idx=events[i].data.u32;
+            session& s=sessions[idx];
+            if(s.fd<0){
+                continue;
+            }
+            if(s.state==S_CONNECTING){
+                int err=0;
+                socklen_t len=sizeof(err);
+                getsockopt(s.fd,SOL_SOCKET,SO_ERROR,&err,&len);
+                if(err!=0){
+                    fail(idx);
+                    continue;
+                }
+                s.state=S_SENDING;  // send_start 从开始连的时候算 (新连接的握手也是延迟的一部分)
+            }
+            if(s.state==S_SENDING){
+                const replay_request& r=s.script->reqs[s.next];
+                ssize_t m=send(s.fd,s.script->bytes.data()+r.off+s.sent,r.len-s.sent,0);
+                if(m<0){
+                    if(errno!=EAGAIN){
+                        fail(idx);
+                    }
+                    continue;
+                }
+                s.sent+=m;
+                if(s.sent==r.len){
+                    s.state=S_RECEIVING;
+                    want(epollfd,s,idx,EPOLLIN);
+                }
+                continue;
+            }
+            if(s.state!=S_RECEIVING){
+                // 两个请求之间 (排着队等该发的时刻) 服务器把空闲连接关了：关掉，到时候重连
+                char tmp[256];
+                if(recv(s.fd,tmp,sizeof(tmp),0)<=0){
+                    close_fd(epollfd,s);
+                }
+                continue;
+            }
+
+            char buf[65536];
+            bool eof=false;
+            while(true){
+                ssize_t m=recv(s.fd,buf,sizeof(buf),0);
+                if(m>0){
+                    s.rbuf.append(buf,m);
+                    continue;
+                }
+                if(m==0||errno!=EAGAIN){
+                    eof=true;
+                }
+                break;
+            }
+            fingerprint fp={0,0,0};
+            bool close_after=false;
+            long used=parse_response(s.rbuf,s.script->reqs[s.next].head,eof,fp,close_after);
+            if(used>0){
+                record_response(s,fp,st);
+                if(close_after||eof){
+                    close_fd(epollfd,s);
+                }else{
+                    // 空闲时也要能发现服务器关连接
+                    want(epollfd,s,idx,EPOLLIN|EPOLLRDHUP);
+                }
+                advance(idx);
+            }else if(used<0||eof){
+                fail(idx);
+            }
+        }
+    }
+    double elapsed=(now_us()-t0)/1e6;
+    if(g_save_fp){
+        fclose(g_save_fp);
+    }
+
+    std::sort(st.latency_us.begin(),st.latency_us.end());
+    printf("✅ 完成 %lld 个，出错 %lld 个",st.ok,st.errors);
+    if(!g_expect.empty()){
+        printf("，和期望不一致 %lld 个",st.mismatches);
+    }
+    printf("\n⏱️ 用时 %.2fs，吞吐 %.0f req/s\n",elapsed,elapsed>0?st.ok/elapsed:0);
+    printf("📈 延迟 (ms): p50 %.2f  p90 %.2f  p99 %.2f  p99.9 %.2f  max %.2f\n",
+        percentile(st.latency_us,0.5)/1000.0,percentile(st.latency_us,0.9)/1000.0,
+        percentile(st.latency_us,0.99)/1000.0,percentile(st.latency_us,0.999)/1000.0,
+        st.latency_us.empty()?0:st.latency_us.back()/1000.0);
+    printf("📊 状态码:");
+    for(std::map<int,long long>::const_iterator it=st.status_count.begin();it!=st.status_count.end();++it){
+        printf(" %d x %lld",it->first,it->second);
+    }
+    printf("\n");
+    return (st.errors>0||st.mismatches>0)?2:0;
+}
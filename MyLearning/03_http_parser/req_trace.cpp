@@ -0,0 +1,171 @@
+#include "req_trace.h"
+#include<stdio.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<sys/syscall.h>
+
+// =================================================================
+// 1. 全局：输出文件和抽样频率 (启动时设好，之后只读)
+// =================================================================
+
+static FILE* g_trace_fp=NULL;
+static int g_trace_sample=0;
+static pthread_mutex_t g_trace_lock=PTHREAD_MUTEX_INITIALIZER;  // 几个线程往同一个文件里写
+
+static const char* phase_names[PHASE_COUNT]={
+    "read","parse","do_request","handler","process_write","write"
+};
+
+// 和 http_conn.h 里的 METHOD 顺序一致
+static const char* method_names[]={
+    "GET","POST","HEAD","PUT","DELETE","TRACE","OPTIONS","CONNECT","PATCH"
+};
+
+bool trace_open(const char* path,int sample){
+    if(sample<=0||!path||!path[0]){
+        return true; // 没开
+    }
+    // 文件名后面带上 pid：平滑升级时新老进程同时在跑，不能互相覆盖
+    char name[512];
+    snprintf(name,sizeof(name),"%s.%d",path,getpid());
+    g_trace_fp=fopen(name,"w");
+    if(!g_trace_fp){
+        perror("trace_open");
+        return false;
+    }
+    g_trace_sample=sample;
+
+    // Chrome trace 的 JSON 数组格式：先放一个元数据事件，后面每个事件前面都带逗号
+    fprintf(g_trace_fp,"[\n{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"args\":{\"name\":\"tinyserver\"}}",getpid());
+    return true;
+}
+
+// =================================================================
+// 2. 每个线程：抽样计数 + 环形缓冲区
+// =================================================================
+
+// 存一条记录要的东西 (紧凑的二进制格式，写文件时才转成 JSON)
+struct trace_record{
+    req_trace t;
+    int fd;
+    int method;
+    int tid;
+    char url[64];
+};
+
+static const int TRACE_RING_SIZE=1024;
+
+static thread_local unsigned t_sample_counter=0;
+static thread_local trace_record* t_ring=NULL;  // 第一次用到才分配，没开抽样的线程不占内存
+static thread_local int t_ring_count=0;
+
+bool trace_should_sample(){
+    if(g_trace_sample==0){
+        return false;
+    }
+    if(++t_sample_counter<(unsigned)g_trace_sample){
+        return false;
+    }
+    t_sample_counter=0;
+    return true;
+}
+
+void trace_commit(const req_trace& t,int fd,int method,const char* url){
+    if(!g_trace_fp){
+        return;
+    }
+    if(!t_ring){
+        t_ring=new trace_record[TRACE_RING_SIZE];
+    }
+    trace_record& r=t_ring[t_ring_count++];
+    r.t=t;
+    r.fd=fd;
+    r.method=method;
+    r.tid=(int)syscall(SYS_gettid);
+    snprintf(r.url,sizeof(r.url),"%s",url?url:"");
+
+    // 攒满了就写一次 (抽样以后这个频率很低，在 I/O 线程里写一下文件可以接受)
+    if(t_ring_count==TRACE_RING_SIZE){
+        trace_flush();
+    }
+}
+
+// =================================================================
+// 3. 转成 Chrome trace JSON
+// =================================================================
+
+// URL 里的引号、反斜杠、控制字符不能原样放进 JSON 字符串
+static void json_escape(const char* in,char* out,size_t out_len){
+    size_t j=0;
+    for(size_t i=0;in[i]&&j+7<out_len;i++){
+        unsigned char c=(unsigned char)in[i];
+        if(c=='"'||c=='\\'){
+            out[j++]='\\';
+            out[j++]=c;
+        }else if(c<0x20){
+            j+=snprintf(out+j,out_len-j,"\\u%04x",c);
+        }else{
+            out[j++]=c;
+        }
+    }
+    out[j]='\0';
+}
+
+// 一个阶段一个 "X" (完整持续) 事件。tid 用连接的 fd：同一个连接上的请求是一个接一个的，
+// 这样每个连接一条泳道，阶段之间的嵌套关系也不会乱
+static void emit_span(int pid,const trace_record& r,const char* name,long long begin,long long end){
+    fprintf(g_trace_fp,",\n{\"name\":\"%s\",\"cat\":\"phase\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d}",
+        name,begin,end>begin?end-begin:0,pid,r.fd);
+}
+
+void trace_flush(){
+    if(!g_trace_fp||t_ring_count==0){
+        return;
+    }
+    int pid=getpid();
+
+    pthread_mutex_lock(&g_trace_lock);
+    for(int i=0;i<t_ring_count;i++){
+        const trace_record& r=t_ring[i];
+        const req_trace& t=r.t;
+
+        // 整个请求：从就绪 (没有就从开始读) 到最后一个阶段结束
+        long long first=t.ready>0?t.ready:t.begin[PHASE_READ];
+        long long last=first;
+        for(int p=0;p<PHASE_COUNT;p++){
+            if(t.begin[p]&&t.end[p]>last){
+                last=t.end[p];
+            }
+        }
+        char url[sizeof(r.url)*6+1];
+        json_escape(r.url,url,sizeof(url));
+        const char* method=(r.method>=0&&r.method<(int)(sizeof(method_names)/sizeof(method_names[0])))?method_names[r.method]:"?";
+        fprintf(g_trace_fp,",\n{\"name\":\"%s %s\",\"cat\":\"request\",\"ph\":\"X\",\"ts\":%lld,\"dur\":%lld,\"pid\":%d,\"tid\":%d,"
+            "\"args\":{\"thread\":%d,\"write_waits\":%d}}",
+            method,url,first,last-first,pid,r.fd,r.tid,t.write_waits);
+
+        // 排队：epoll 说就绪了，但前面还有别的连接在处理
+        if(t.ready>0&&t.begin[PHASE_READ]>t.ready){
+            emit_span(pid,r,"queue",t.ready,t.begin[PHASE_READ]);
+        }
+        for(int p=0;p<PHASE_COUNT;p++){
+            if(t.begin[p]){
+                emit_span(pid,r,phase_names[p],t.begin[p],t.end[p]);
+            }
+        }
+    }
+    fflush(g_trace_fp);
+    pthread_mutex_unlock(&g_trace_lock);
+
+    t_ring_count=0;
+}
+
+void trace_close(){
+    if(!g_trace_fp){
+        return;
+    }
+    trace_flush();
+    fprintf(g_trace_fp,"\n]\n");
+    fclose(g_trace_fp);
+    g_trace_fp=NULL;
+}
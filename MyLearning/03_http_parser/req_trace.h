@@ -0,0 +1,95 @@
+#ifndef REQTRACE_H
+#define REQTRACE_H
+
+#include<time.h>
+#include<string.h>
+
+// 🔬 请求分阶段计时 + USDT 静态探针
+// 一个请求的时间到底花在哪：read_once? 解析? do_request 里的 stat / mmap? 拼响应头? 还是 write 在等 EAGAIN?
+//
+// 1. 时间戳：每个阶段进入 / 离开时记一下单调时钟，存在连接自己身上 (http_conn::m_trace)。
+//    按 trace_sample 抽样，没抽中的请求只多一次判断。
+//    抽中的请求结束时放进本线程的环形缓冲区，攒满了 (或者退出时) 写成 Chrome trace JSON，
+//    用 chrome://tracing 或 https://ui.perfetto.dev 打开就能看到每个连接上一段段的时间线。
+// 2. USDT 探针：每个阶段的进出都有一个 tinyserver:xxx 探针，不管抽没抽中都会经过。
+//    没人挂上去的时候只是一条 nop，挂上去以后 perf / bpftrace 直接就能用：
+//        bpftrace -e 'usdt:./server:tinyserver:write_eagain { @[arg0] = count(); }'
+//    编译机上没有 <sys/sdt.h> (systemtap-sdt-dev) 时，探针整个编译成空的。
+
+#if defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include<sys/sdt.h>
+#define HAVE_USDT 1
+#endif
+#endif
+
+#ifdef HAVE_USDT
+#define TRACE_PROBE1(name,a) DTRACE_PROBE1(tinyserver,name,a)
+#define TRACE_PROBE2(name,a,b) DTRACE_PROBE2(tinyserver,name,a,b)
+#define TRACE_PROBE3(name,a,b,c) DTRACE_PROBE3(tinyserver,name,a,b,c)
+#else
+#define TRACE_PROBE1(name,a) ((void)0)
+#define TRACE_PROBE2(name,a,b) ((void)0)
+#define TRACE_PROBE3(name,a,b,c) ((void)0)
+#endif
+
+// 📍 请求经过的阶段
+enum TRACE_PHASE{
+    PHASE_READ=0,       // read_once：从第一次读到最后一次读
+    PHASE_PARSE,        // process_read：切行 + 解析 (包含下面的 do_request)
+    PHASE_DO_REQUEST,   // do_request：找文件、stat、open、mmap
+    PHASE_HANDLER,      // 协程 handler：从开始跑到跑完
+    PHASE_PROCESS_WRITE,// process_write：拼响应头
+    PHASE_WRITE,        // 发送：从第一次 writev 到发完 (中间等 EAGAIN 的时间也算在里面)
+    PHASE_COUNT
+};
+
+// ⏱️ 一个请求的时间线 (挂在 http_conn 上，init() 时清空)
+struct req_trace{
+    bool started;                   // 这个请求已经开始了 (抽样只在开始时决定一次)
+    bool active;                    // 被抽中了，要记时间戳
+    int write_waits;                // 发送时遇到了几次 EAGAIN
+    long long ready;                // epoll 说它就绪的时刻 (到开始读之间就是排队时间)
+    long long begin[PHASE_COUNT];   // 0 表示没经过这个阶段
+    long long end[PHASE_COUNT];
+
+    void reset(){memset(this,0,sizeof(*this));}
+};
+
+// 和 http_conn::now_us 一样的单调时钟 (微秒)
+inline long long trace_now(){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC,&ts);
+    return (long long)ts.tv_sec*1000000+ts.tv_nsec/1000;
+}
+
+// 进入一个阶段：只记第一次 (比如 read_once 会被调好几次)
+inline void trace_enter(req_trace& t,TRACE_PHASE phase){
+    if(t.active&&t.begin[phase]==0){
+        t.begin[phase]=trace_now();
+    }
+}
+
+// 离开一个阶段：每次都更新，最后一次为准
+inline void trace_leave(req_trace& t,TRACE_PHASE phase){
+    if(t.active){
+        t.end[phase]=trace_now();
+    }
+}
+
+// 🎲 启动时调一次：sample=N 表示每 N 个请求抽一个 (0 关掉)，结果写到 path.<pid>
+bool trace_open(const char* path,int sample);
+
+// 这个新请求要不要记 (每个线程自己数，不用加锁)
+bool trace_should_sample();
+
+// 📥 一个被抽中的请求结束了：存进本线程的环形缓冲区
+void trace_commit(const req_trace& t,int fd,int method,const char* url);
+
+// 📤 把本线程攒着的记录写进文件 (I/O 线程退出前各自调一次)
+void trace_flush();
+
+// 🔚 所有线程都 flush 完以后，把 JSON 收个尾
+void trace_close();
+
+#endif
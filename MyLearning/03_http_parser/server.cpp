@@ -0,0 +1,878 @@
+#include<sys/socket.h>
+#include<netinet/in.h>
+#include<arpa/inet.h>
+#include<unistd.h>
+#include<stdio.h>
+#include<errno.h>
+#include<string.h>
+#include<stdlib.h>
+#include<sys/epoll.h>
+#include<sys/eventfd.h>
+#include<sys/wait.h>
+#include<atomic>
+#include "http_conn.h"
+#include "io_loop.h"
+#include "busy_poll.h"
+#include "user_store.h"
+#include "prefork.h"
+
+#define MAX_FD 65536            // 最大文件描述符个数 (也就是最多能同时服务多少客人)
+#define MAX_EVENT_NUMBER 10000  // epoll 一次最多拿回来多少个事件
+#define DRAIN_TIMEOUT_MS 30000  // 平滑升级时，老进程最多再等老连接 30 秒
+#define RESPAWN_DELAY_US 1000000    // 多进程模式下，worker 拉起来不到 1 秒就死了的，隔 1 秒再拉
+
+// 新进程通过这个环境变量知道：“我是被升级拉起来的，监听 socket 找老进程要”
+#define INHERIT_ENV "TINYSERVER_UPGRADE_FD"
+
+// 监听 socket 数组的下标：HTTP 一定有，HTTPS 配置了 https_port 才有 (没有就是 -1)
+#define LISTEN_HTTP 0
+#define LISTEN_HTTPS 1
+#define LISTEN_COUNT 2
+
+// 这几个工具函数写在 http_conn.cpp 里，这里借来用
+extern void addfd(int epollfd,int fd,bool one_shot);
+extern void removefd(int epollfd,int fd);
+
+// 🧵 协程 handler 示例：把请求体原样回给客户端 (请求体多大都行，边收边发)
+static co_task echo_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+
+    char head[128];
+    int head_len=snprintf(head,sizeof(head),"HTTP/1.1 200 OK\r\nContent-Length: %d\r\nConnection: %s\r\n\r\n",
+        conn.get_content_length(),conn.get_linger()?"keep-alive":"close");
+    struct iovec iov[1];
+    iov[0].iov_base=head;
+    iov[0].iov_len=head_len;
+    if(!co_await conn.write(iov,1)){
+        co_return;
+    }
+
+    // 缓冲区从请求的 arena 里切，协程帧本身就能小一点
+    const size_t BUF_SIZE=4096;
+    char* buf=(char*)conn.arena().alloc(BUF_SIZE);
+    ssize_t n;
+    while((n=co_await conn.read_body(buf,BUF_SIZE))>0){
+        iov[0].iov_base=buf;
+        iov[0].iov_len=n;
+        if(!co_await conn.write(iov,1)){
+            co_return;
+        }
+    }
+}
+
+// 🧵 协程 handler 示例：睡 100ms 再回复 (睡的时候主循环照常服务别的连接)
+static co_task sleep_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+    co_await conn.sleep(100);
+
+    static const char body[]="slept 100ms\n";
+    char head[128];
+    int head_len=snprintf(head,sizeof(head),"HTTP/1.1 200 OK\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+        sizeof(body)-1,conn.get_linger()?"keep-alive":"close");
+    struct iovec iov[2];
+    iov[0].iov_base=head;
+    iov[0].iov_len=head_len;
+    iov[1].iov_base=(void*)body;
+    iov[1].iov_len=sizeof(body)-1;
+    co_await conn.write(iov,2);
+}
+
+// 🚰 协程 handler 示例：边生成边发 16MB (chunked)，不用先攒在内存里
+// 客户端收得慢的时候，write_chunk 会让 handler 停下来等 (背压)，这个连接最多只占几十 KB
+static co_task stream_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+    if(!conn.start_chunked(200,"OK","text/plain")){
+        co_return;
+    }
+
+    const size_t CHUNK_SIZE=16384;
+    char* buf=(char*)conn.arena().alloc(CHUNK_SIZE);
+    for(int i=0;i<1024;i++){
+        int n=snprintf(buf,CHUNK_SIZE,"chunk %d ",i);
+        memset(buf+n,'.',CHUNK_SIZE-n-1);
+        buf[CHUNK_SIZE-1]='\n';
+        if(!co_await conn.write_chunk(buf,CHUNK_SIZE)){
+            co_return;
+        }
+    }
+    co_await conn.end_chunked();
+}
+
+// 🗄️ 协程 handler 示例：一个“很贵”的页面 (算一次要 200ms)，用微缓存兜着
+// 新鲜 1 秒，过期后 5 秒内先回旧的、顺手刷新；同时来的一大波请求只算一次
+static std::atomic<int> expensive_runs(0);
+
+static co_task cached_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+    cache_result r=co_await conn.cache_lookup();
+    if(r.resp&&!co_await conn.write_cached(r.resp)){
+        co_return;
+    }
+    if(!r.fill){
+        co_return;
+    }
+
+    // 轮到这个请求来算 (没命中，或者命中的是旧的、由它负责刷新)
+    co_await conn.sleep(200);
+    char body[64];
+    int body_len=snprintf(body,sizeof(body),"expensive result #%d\n",++expensive_runs);
+    char head[128];
+    int head_len=snprintf(head,sizeof(head),"HTTP/1.1 200 OK\r\nContent-Type: text/plain\r\nContent-Length: %d\r\n",body_len);
+    std::shared_ptr<const cached_response> fresh=r.fill.store(head,head_len,body,body_len,1000,5000);
+
+    // 刚才没东西可回的话，现在回刚算出来的这份
+    if(!r.resp){
+        co_await conn.write_cached(fresh);
+    }
+}
+
+// 🔌 WebSocket 示例：聊天室，谁发的消息都广播给 /ws/chat 上的所有人 (包括自己)
+// 消息只序列化一次，所有收件人 (不管在哪个 I/O 线程) 共用同一份
+static void chat_handler(http_conn& conn,int opcode,const char* data,size_t len){
+    ws_broadcast(conn.ws_channel(),opcode,data,len);
+}
+
+// 监听 socket 挂到 epoll 上用的事件 (多进程模式下每个 worker 加上 EPOLLEXCLUSIVE)
+static uint32_t listen_events=EPOLLIN;
+
+// 🚦 暂停 / 恢复 监听 listenfd (过载时不再接新客人)
+// 直接从 epoll 里摘掉 / 加回去：带 EPOLLEXCLUSIVE 的 fd 不许 EPOLL_CTL_MOD
+void set_accept_paused(int epollfd,int listenfd,bool paused){
+    if(paused){
+        epoll_ctl(epollfd,EPOLL_CTL_DEL,listenfd,0);
+        return;
+    }
+    epoll_event event;
+    event.data.fd=listenfd;
+    event.events=listen_events;
+    epoll_ctl(epollfd,EPOLL_CTL_ADD,listenfd,&event);
+}
+
+// =================================================================
+// 🔄 平滑升级：通过 Unix socket 把监听 fd 交给新进程 (SCM_RIGHTS)
+// =================================================================
+
+// 信号处理函数里只打标记，真正的活在主循环里干 (信号处理函数里能干的事很少)
+static volatile sig_atomic_t upgrade_requested=0;
+static volatile sig_atomic_t reload_requested=0;
+static volatile sig_atomic_t stats_requested=0;
+
+void sig_handler(int sig){
+    if(sig==SIGUSR2){
+        upgrade_requested=1;
+    }else if(sig==SIGHUP){
+        reload_requested=1;
+    }else if(sig==SIGUSR1){
+        stats_requested=1;
+    }
+}
+
+void addsig(int sig){
+    struct sigaction sa;
+    memset(&sa,'\0',sizeof(sa));
+    sa.sa_handler=sig_handler;
+    sigfillset(&sa.sa_mask);
+    sigaction(sig,&sa,NULL); // 不加 SA_RESTART：让 epoll_wait 被打断，主循环马上能看到标记
+}
+
+// 🔄 缓存容量和各种上限：启动时和每次热更新成功后，从新配置推给用到它们的地方
+// (它们在热路径上读的是自己的原子变量 / 带锁的字段，不用每次都去 atomic_load 一份配置)
+// 线程数、连接池里的数据库连接、监听端口、抓包 / 计时文件这些建好了就不动，还是只在启动时读一次
+static void apply_limits(const server_config& conf){
+    http_conn::m_ws_max_queue=conf.ws_max_queue_kb<<10;
+    response_cache().set_capacity((size_t)conf.micro_cache_mb<<20);
+    mem_budget_set_limits((size_t)conf.mem_soft_mb<<20,(size_t)conf.mem_hard_mb<<20);
+    http_conn::m_zerocopy_min=conf.zerocopy_min;
+    fcgi_set_pool_size(conf.fcgi_pool_size);
+}
+
+// 📦 把监听 fd “快递”给 Unix socket 对面的进程
+// 普通数据只能传字节，fd 要放在控制消息 (cmsg) 里，内核会在对面进程里造一个等价的 fd
+// 数据字节里放一个掩码，告诉对面这几个 fd 分别是 HTTP 还是 HTTPS 的
+bool send_fds(int channel,const int* listenfds){
+    char mask=0;
+    int fds[LISTEN_COUNT];
+    int n=0;
+    for(int i=0;i<LISTEN_COUNT;i++){
+        if(listenfds[i]!=-1){
+            mask|=(1<<i);
+            fds[n++]=listenfds[i];
+        }
+    }
+
+    struct iovec iov;
+    iov.iov_base=&mask;
+    iov.iov_len=1;
+
+    char ctrl[CMSG_SPACE(sizeof(int)*LISTEN_COUNT)];
+    memset(ctrl,'\0',sizeof(ctrl));
+
+    struct msghdr msg;
+    memset(&msg,'\0',sizeof(msg));
+    msg.msg_iov=&iov;
+    msg.msg_iovlen=1;
+    msg.msg_control=ctrl;
+    msg.msg_controllen=CMSG_SPACE(sizeof(int)*n);
+
+    struct cmsghdr* cmsg=CMSG_FIRSTHDR(&msg);
+    cmsg->cmsg_level=SOL_SOCKET;
+    cmsg->cmsg_type=SCM_RIGHTS;
+    cmsg->cmsg_len=CMSG_LEN(sizeof(int)*n);
+    memcpy(CMSG_DATA(cmsg),fds,sizeof(int)*n);
+
+    return sendmsg(channel,&msg,0)==1;
+}
+
+// 📦 收快递：按掩码把收到的 fd 放回 listenfds 对应的位置
+bool recv_fds(int channel,int* listenfds){
+    char mask;
+    struct iovec iov;
+    iov.iov_base=&mask;
+    iov.iov_len=1;
+
+    char ctrl[CMSG_SPACE(sizeof(int)*LISTEN_COUNT)];
+    struct msghdr msg;
+    memset(&msg,'\0',sizeof(msg));
+    msg.msg_iov=&iov;
+    msg.msg_iovlen=1;
+    msg.msg_control=ctrl;
+    msg.msg_controllen=sizeof(ctrl);
+
+    if(recvmsg(channel,&msg,MSG_CMSG_CLOEXEC)!=1){
+        return false;
+    }
+
+    struct cmsghdr* cmsg=CMSG_FIRSTHDR(&msg);
+    if(!cmsg||cmsg->cmsg_level!=SOL_SOCKET||cmsg->cmsg_type!=SCM_RIGHTS){
+        return false;
+    }
+
+    int fds[LISTEN_COUNT];
+    int n=(cmsg->cmsg_len-CMSG_LEN(0))/sizeof(int);
+    memcpy(fds,CMSG_DATA(cmsg),sizeof(int)*n);
+
+    int used=0;
+    for(int i=0;i<LISTEN_COUNT;i++){
+        listenfds[i]=-1;
+        if((mask&(1<<i))&&used<n){
+            listenfds[i]=fds[used++];
+        }
+    }
+    return listenfds[LISTEN_HTTP]!=-1;
+}
+
+// 🚀 拉起新版本的自己，把监听 fd 交过去，等它回一声“收到”
+// 返回 true 表示新进程已经接手，老进程可以开始排空了
+bool start_upgrade(const int* listenfds,char* argv[]){
+    int channel[2];
+    if(socketpair(AF_UNIX,SOCK_STREAM|SOCK_CLOEXEC,0,channel)==-1){
+        perror("socketpair error");
+        return false;
+    }
+
+    pid_t pid=fork();
+    if(pid<0){
+        perror("fork error");
+        close(channel[0]);
+        close(channel[1]);
+        return false;
+    }
+
+    if(pid==0){
+        // 👶 子进程：只留 channel[1] 穿过 exec，其他 fd 都是 CLOEXEC 的，exec 时自动关掉
+        close(channel[0]);
+        // 信号掩码会穿过 exec (多进程模式的 master 屏蔽着一堆信号)，新进程从干净的掩码开始
+        sigset_t none;
+        sigemptyset(&none);
+        sigprocmask(SIG_SETMASK,&none,NULL);
+        int flags=fcntl(channel[1],F_GETFD);
+        fcntl(channel[1],F_SETFD,flags&~FD_CLOEXEC);
+
+        char buf[16];
+        snprintf(buf,sizeof(buf),"%d",channel[1]);
+        setenv(INHERIT_ENV,buf,1);
+
+        // 按启动时的路径重新 exec：磁盘上的二进制已经被换成新版本了
+        execvp(argv[0],argv);
+        perror("execv error");
+        _exit(1);
+    }
+
+    // 👴 父进程：把监听 fd 发过去
+    close(channel[1]);
+    bool ok=send_fds(channel[0],listenfds);
+
+    // 最多等新进程 5 秒，它没回话就当升级失败，老进程接着干
+    struct timeval tv;
+    tv.tv_sec=5;
+    tv.tv_usec=0;
+    setsockopt(channel[0],SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+
+    char ack=0;
+    if(ok&&recv(channel[0],&ack,1,0)!=1){
+        ok=false;
+    }
+    close(channel[0]);
+
+    if(!ok||ack!='A'){
+        printf("❌ 升级失败，新进程 %d 没有接手\n",pid);
+        return false;
+    }
+    printf("✅ 新进程 %d 已经接手监听 socket，开始排空老连接\n",pid);
+    return true;
+}
+
+// 🏗️ 正常启动：自己 socket + bind + listen
+// backlog：内核里排队等 accept 的连接最多多少个 (还会被 net.core.somaxconn 截一下)
+// 以前写死 5：稍微一忙，连接在内核里就被丢了 (客户端看到的是 SYN 重传、1 秒 3 秒地卡)，
+// CoDel 根本看不到这些请求，也就没法用 503 快速告诉客户端“忙”
+int create_listenfd(int port,int backlog){
+    int listenfd=socket(PF_INET,SOCK_STREAM|SOCK_CLOEXEC,0);
+    if(listenfd==-1){
+        perror("socket error");
+        return -1;
+    }
+
+    struct sockaddr_in address;
+    bzero(&address,sizeof(address));
+    address.sin_family=AF_INET;
+    address.sin_addr.s_addr=htonl(INADDR_ANY);
+    address.sin_port=htons(port);
+
+    int reuse=1;
+    setsockopt(listenfd,SOL_SOCKET,SO_REUSEADDR,&reuse,sizeof(reuse));
+
+    int ret=bind(listenfd,(struct sockaddr*)&address,sizeof(address));
+    if(ret==-1){
+        perror("bind error");
+        return -1;
+    }
+
+    ret=listen(listenfd,backlog);
+    if(ret==-1){
+        perror("listen error");
+        return -1;
+    }
+    return listenfd;
+}
+
+// =================================================================
+// 👨‍👧‍👦 多进程模式：master 只管拉起 worker、看着它们、转发信号 (见 prefork.h)
+// =================================================================
+
+// 返回值 >=0：我是这个编号的 worker，回 main 接着跑事件循环；-1：master 正常退出；-2：启动失败
+static int run_master(int workers,int* listenfds,char* argv[]){
+    prefork_master master;
+    if(!master.init(workers)){
+        return -2;
+    }
+
+    // 共享的监听 socket 设成非阻塞：偶尔一个连接会叫醒两个 worker，抢输的那个 accept 拿到 EAGAIN 就算了
+    for(int i=0;i<LISTEN_COUNT;i++){
+        if(listenfds[i]!=-1){
+            fcntl(listenfds[i],F_SETFL,fcntl(listenfds[i],F_GETFL)|O_NONBLOCK);
+        }
+    }
+
+    // master 不跑事件循环，信号都在这里同步地等 (sigtimedwait)，不走 sig_handler；
+    // worker 出生时恢复成原来的掩码，照旧用 sig_handler
+    sigset_t wait_set,old_mask;
+    sigemptyset(&wait_set);
+    sigaddset(&wait_set,SIGCHLD);
+    sigaddset(&wait_set,SIGHUP);
+    sigaddset(&wait_set,SIGUSR1);
+    sigaddset(&wait_set,SIGUSR2);
+    sigprocmask(SIG_BLOCK,&wait_set,&old_mask);
+
+    printf("👨‍👧‍👦 master %d: 拉起 %d 个 worker (kill -USR1 %d 看统计)\n",getpid(),workers,getpid());
+    bool draining=false;
+    while(true){
+        // ⚰️ 收尸：崩了的、排空完退出的
+        int status;
+        pid_t pid;
+        while((pid=waitpid(-1,&status,WNOHANG))>0){
+            int id=master.reap(pid);
+            if(id<0||draining){
+                continue;
+            }
+            master.note_restart();
+            if(WIFSIGNALED(status)){
+                printf("💥 worker %d (pid %d) 被信号 %d 杀掉了，重新拉起\n",id,pid,WTERMSIG(status));
+            }else{
+                printf("💥 worker %d (pid %d) 退出了 (状态 %d)，重新拉起\n",id,pid,WEXITSTATUS(status));
+            }
+        }
+        if(draining&&master.alive()==0){
+            break;
+        }
+
+        // 🍴 空着的格子补上 (刚拉起来就死的先歇着，下一轮再说)
+        if(!draining){
+            for(int i=0;i<workers;i++){
+                if(master.pid_of(i)==0&&master.uptime_us(i)>=RESPAWN_DELAY_US){
+                    if(master.spawn(i,&old_mask)==0){
+                        return i;
+                    }
+                }
+            }
+        }
+
+        // 等信号，最多 1 秒 (顺便定时回来看看有没有要补的 worker)
+        struct timespec ts;
+        ts.tv_sec=1;
+        ts.tv_nsec=0;
+        int sig=sigtimedwait(&wait_set,NULL,&ts);
+        if(sig==SIGHUP){
+            // 🔄 每个 worker 自己重新读配置文件
+            master.signal_all(SIGHUP);
+        }else if(sig==SIGUSR1){
+            master.print_stats();
+            master.signal_all(SIGUSR1);     // 每个 worker 再各自打印内存分类明细
+        }else if(sig==SIGUSR2&&!draining&&start_upgrade(listenfds,argv)){
+            // 🚀 新进程已经在 accept 了：master 放手，worker 们各自排空 (SIGUSR2 在 worker 里就是“排空退出”)
+            for(int i=0;i<LISTEN_COUNT;i++){
+                if(listenfds[i]!=-1){
+                    close(listenfds[i]);
+                    listenfds[i]=-1;
+                }
+            }
+            draining=true;
+            master.signal_all(SIGUSR2);
+        }
+    }
+    master.print_stats();
+    return -1;
+}
+
+// 用法: ./server [port] [config_file]
+// 发 SIGHUP 重新读 config_file，发 SIGUSR2 平滑升级
+// 配置文件里写了 https_port / tls_cert / tls_key 就同时开一个 HTTPS 端口
+int main(int argc,char* argv[]){
+    int port=9006;
+    if(argc>1){
+        port=atoi(argv[1]);
+    }
+    const char* config_path=(argc>2)?argv[2]:NULL;
+    if(config_path){
+        reload_config(config_path);
+    }
+
+    // 对端关闭后再写会触发 SIGPIPE，默认会把整个进程干掉，忽略它
+    signal(SIGPIPE,SIG_IGN);
+    addsig(SIGUSR2);
+    addsig(SIGHUP);
+    addsig(SIGUSR1);
+
+    // 每个 fd 对应一个 http_conn，直接用 fd 当下标 (空间换时间)
+    // 槽位用到时才构造，没来过的 fd 不占物理内存
+    conn_slab users;
+    if(!users.init(MAX_FD)){
+        return -1;
+    }
+
+    // 1. 拿到监听 socket：要么自己建 (和 02 一样)，要么从老进程手里接过来
+    // 所有 fd 都带 CLOEXEC，这样升级 exec 新进程时不会把老连接漏过去
+    std::shared_ptr<const server_config> conf=current_config();
+    int listenfds[LISTEN_COUNT]={-1,-1};
+    const char* inherit=getenv(INHERIT_ENV);
+    int channel=-1;
+    if(inherit){
+        channel=atoi(inherit);
+        unsetenv(INHERIT_ENV); // 别再传给下一代
+        if(!recv_fds(channel,listenfds)){
+            perror("recv_fds error");
+            return -1;
+        }
+        // 老进程传过来的 socket 已经在 listen 了；再 listen 一次只是换成新配置的 backlog
+        for(int i=0;i<LISTEN_COUNT;i++){
+            if(listenfds[i]!=-1){
+                listen(listenfds[i],conf->listen_backlog);
+            }
+        }
+    }else{
+        listenfds[LISTEN_HTTP]=create_listenfd(port,conf->listen_backlog);
+        if(listenfds[LISTEN_HTTP]==-1){
+            return -1;
+        }
+        if(conf->https_port>0){
+            listenfds[LISTEN_HTTPS]=create_listenfd(conf->https_port,conf->listen_backlog);
+            if(listenfds[LISTEN_HTTPS]==-1){
+                return -1;
+            }
+        }
+    }
+
+    // 🔐 有 HTTPS 端口就加载证书
+    if(listenfds[LISTEN_HTTPS]!=-1&&!tls_init(conf->tls_cert,conf->tls_key)){
+        return -1;
+    }
+
+    // 👶 升级启动：所有东西都准备好了，才回老进程一声 'A'，让它放手
+    if(channel!=-1){
+        char ack='A';
+        send(channel,&ack,1,0);
+        close(channel);
+    }
+
+    // 👨‍👧‍👦 多进程模式：master 到这里就分出 worker，自己只管看着它们 (不建 epoll、不碰连接)；
+    // worker 从这里接着往下走，和单循环模式一模一样，只是监听 socket 是大家一起 accept 的
+    int worker_id=-1;
+    if(conf->workers>0){
+        if(conf->user_db[0]!='\0'){
+            printf("⚠️ 多进程模式下每个 worker 各有一份内存里的用户表，在一个 worker 上注册的用户，别的 worker 重启之前不认识\n");
+        }
+        worker_id=run_master(conf->workers,listenfds,argv);
+        if(worker_id<0){
+            return worker_id==-1?0:-1;
+        }
+        listen_events=EPOLLIN|EPOLLEXCLUSIVE;
+    }
+
+    // 2. 创建 epoll，listenfd 用默认的 LT 模式
+    int epollfd=epoll_create1(EPOLL_CLOEXEC);
+    if(epollfd==-1){
+        perror("epoll_create error");
+        return -1;
+    }
+
+    for(int i=0;i<LISTEN_COUNT;i++){
+        if(listenfds[i]==-1){
+            continue;
+        }
+        struct epoll_event event;
+        event.data.fd=listenfds[i];
+        event.events=listen_events;
+        epoll_ctl(epollfd,EPOLL_CTL_ADD,listenfds[i],&event);
+    }
+
+    // 单循环模式下所有 http_conn 共用这一个 epoll (I/O 线程各有各的)
+    http_conn::m_epollfd=epollfd;
+
+    // 🔔 别的线程叫醒这个循环里的协程用的 eventfd (LT 模式)
+    int wake_fd=eventfd(0,EFD_NONBLOCK|EFD_CLOEXEC);
+    if(wake_fd==-1){
+        perror("eventfd");
+        return -1;
+    }
+    struct epoll_event wake_event;
+    wake_event.data.fd=wake_fd;
+    wake_event.events=EPOLLIN;
+    epoll_ctl(epollfd,EPOLL_CTL_ADD,wake_fd,&wake_event);
+    co_waker_bind(wake_fd);
+    ws_hub_bind(wake_fd);
+
+    // 🧵 协程 handler 的路由 (其他 URL 照旧走静态文件)
+    // 要在 I/O 线程启动之前注册好，之后只读
+    co_route("/co/echo",echo_handler);
+    co_route("/co/sleep",sleep_handler);
+    co_route("/co/cached",cached_handler);
+    co_route("/co/stream",stream_handler);
+    ws_route("/ws/chat",chat_handler);
+    if(conf->user_db[0]!='\0'){
+        // 👤 登录 / 注册：先把数据库里的用户全读进内存
+        if(!user_store_open(conf->user_db,conf->db_pool_size)){
+            printf("cannot open user db %s\n",conf->user_db);
+            return -1;
+        }
+        co_route("/user/login",login_handler);
+        co_route("/user/register",register_handler);
+    }
+    if(conf->fcgi_pass[0]!='\0'){
+        // 🐘 动态页面转给 FastCGI 后端
+        const char* root=conf->fcgi_root[0]!='\0'?conf->fcgi_root:conf->doc_root;
+        if(!fcgi_init(conf->fcgi_prefix,conf->fcgi_pass,root,conf->fcgi_pool_size)){
+            printf("bad fcgi_pass / fcgi_prefix\n");
+            return -1;
+        }
+        co_route(fcgi_prefix(),fcgi_handler);
+    }
+    apply_limits(*conf);
+    http_conn::m_parser=conf->parser;
+    if(!trace_open(conf->trace_file,conf->trace_sample)){
+        return -1;
+    }
+    if(!capture_open(conf->capture_file,conf->capture_sample)){
+        return -1;
+    }
+
+    // 🧭 多个 I/O 线程：主线程只管 accept，连接交给绑了核的 I/O 线程 (多进程模式下不开)
+    int loop_count=(worker_id<0&&conf->io_loops>0)?conf->io_loops:0;
+    bool steer=conf->steer_incoming_cpu;
+    io_loop* loops=NULL;
+    std::vector<int> loop_of_cpu(CPU_SETSIZE,-1);  // 绑在这个核上的 I/O 线程
+    if(loop_count>0){
+        cpu_topology topo;
+        load_topology(topo);
+        std::vector<int> cpus=spread_cpus(topo);
+
+        loops=new io_loop[loop_count];
+        for(int i=0;i<loop_count;i++){
+            int cpu=(conf->cpu_pinning&&!cpus.empty())?cpus[i%cpus.size()]:-1;
+            if(!loops[i].start(i,cpu,&users)){
+                return -1;
+            }
+            if(cpu>=0&&loop_of_cpu[cpu]==-1){
+                loop_of_cpu[cpu]=i;
+            }
+            printf("I/O 线程 %d 启动%s (cpu %d, node %d)\n",i,cpu>=0?"并绑核":"",cpu,cpu>=0?topo.node_of[cpu]:-1);
+        }
+    }
+    int next_loop=0;
+
+    if(worker_id>=0){
+        printf("worker %d 启动 (pid %d)\n",worker_id,getpid());
+    }else{
+        printf("服务器启动成功！正在监听 %d 端口... (pid %d)\n",port,getpid());
+    }
+    if(worker_id<=0&&listenfds[LISTEN_HTTPS]!=-1){
+        printf("HTTPS 已开启，端口 %d\n",conf->https_port);
+    }
+    // 🏎️ 低延迟轮询：监听 socket 上开内核 busy poll (新连接继承)；
+    // 主线程自己处理连接 (单循环) 时才空转，多循环模式下空转的是各个 I/O 线程
+    event_waiter waiter;
+    long long last_batch=0;     // 上一批事件回来的时刻 (CoDel 算排队时间用)
+    if(conf->poll_mode!=POLL_SLEEP){
+        for(int j=0;j<LISTEN_COUNT;j++){
+            if(listenfds[j]!=-1){
+                busy_poll_tune_socket(listenfds[j],conf->busy_poll_us);
+            }
+        }
+        if(loop_count==0){
+            waiter.init(epollfd,conf->poll_mode,conf->busy_poll_us);
+        }
+    }
+
+    conf.reset(); // 启动配置用完了，别一直占着 (热更新后老配置要能释放)
+
+    struct epoll_event events[MAX_EVENT_NUMBER];
+    bool accept_paused=false;
+    bool draining=false;
+    long long drain_deadline=0;
+
+    // 3. 事件循环
+    while(true){
+        // 🔄 SIGHUP：热更新配置，工作线程不用停
+        if(reload_requested){
+            reload_requested=0;
+            if(config_path&&reload_config(config_path)){
+                std::shared_ptr<const server_config> fresh=current_config();
+                apply_limits(*fresh);
+                printf("🔄 配置已重新加载: doc_root=%s\n",fresh->doc_root);
+            }
+        }
+
+        // 🚀 SIGUSR2：平滑升级 (worker 收到的是 master 转来的：新进程已经接手了，直接排空)
+        if(upgrade_requested){
+            upgrade_requested=0;
+            if(!draining&&(worker_id>=0||start_upgrade(listenfds,argv))){
+                // 新进程已经在 accept 了，老进程不再接客
+                for(int j=0;j<LISTEN_COUNT;j++){
+                    if(listenfds[j]!=-1){
+                        epoll_ctl(epollfd,EPOLL_CTL_DEL,listenfds[j],0);
+                        close(listenfds[j]);
+                        listenfds[j]=-1;
+                    }
+                }
+
+                draining=true;
+                http_conn::m_draining=true;
+                drain_deadline=http_conn::now_us()+(long long)DRAIN_TIMEOUT_MS*1000;
+
+                // 闲着的长连接直接挂掉 (客户端会自己重连到新进程)，
+                // 正在处理的请求等它回复完再挂 (I/O 线程里的连接由它们自己处理)
+                for(int fd=0;fd<MAX_FD;fd++){
+                    http_conn* conn=users.find(fd);
+                    if(conn&&users.owner(fd)==-1&&conn->is_idle()){
+                        conn->close_conn();
+                    }
+                }
+                for(int j=0;j<loop_count;j++){
+                    loops[j].wake();
+                }
+            }
+        }
+
+        // 🚪 排空结束：老连接都走了，或者超时了
+        if(draining){
+            if(http_conn::m_user_count==0){
+                break;
+            }
+            if(http_conn::now_us()>=drain_deadline){
+                printf("⏰ 排空超时，强制关闭剩下的 %d 个连接\n",http_conn::m_user_count.load());
+                for(int fd=0;fd<MAX_FD;fd++){
+                    http_conn* conn=users.find(fd);
+                    if(conn&&users.owner(fd)==-1){
+                        conn->close_conn();
+                    }
+                }
+                break;
+            }
+        }
+
+        // 暂停 accept / 排空的时候要定时醒来看看
+        int timeout=-1;
+        if(draining){
+            timeout=1000;
+        }else if(accept_paused){
+            timeout=http_conn::CODEL_INTERVAL_US/1000;
+        }
+        // 有协程在 sleep：最晚在最近的那个定时器到期时醒来
+        int timer_ms=co_timer_next_ms(http_conn::now_us());
+        if(timer_ms>=0&&(timeout<0||timer_ms<timeout)){
+            timeout=timer_ms;
+        }
+        // 先看一眼有没有现成的事件 (忙的时候总有，省得进 waiter 里空转 / 睡)，没有才等
+        int number=epoll_wait(epollfd,events,MAX_EVENT_NUMBER,0);
+        bool waited=number==0;
+        if(waited){
+            number=waiter.wait(epollfd,events,MAX_EVENT_NUMBER,timeout);
+        }
+
+        if(number<0&&errno!=EINTR){
+            perror("epoll_wait failure");
+            break;
+        }
+
+        // ⏱️ 这一批事件都是在这一刻“就绪”的 (没等就回来的，从上一批开始算)，
+        // 后面的连接要等前面的处理完，这段等待就是排队时间
+        long long ready_time=http_conn::batch_ready_time(waited,http_conn::now_us(),last_batch);
+
+        for(int i=0;i<number;i++){
+            int sockfd=events[i].data.fd;
+
+            // 情况一：新用户连接 (HTTP 或 HTTPS 端口)
+            if(sockfd==listenfds[LISTEN_HTTP]||sockfd==listenfds[LISTEN_HTTPS]){
+                struct sockaddr_in client_address;
+                socklen_t client_addrlength=sizeof(client_address);
+                int connfd=accept4(sockfd,(struct sockaddr*)&client_address,&client_addrlength,SOCK_CLOEXEC);
+                if(connfd<0){
+                    if(errno!=EAGAIN){
+                        perror("accept error");     // EAGAIN: 多进程模式下被别的 worker 抢先了
+                    }
+                    continue;
+                }
+
+                // 满员了，直接挂断
+                // fd 本身就是连接槽位的下标：RLIMIT_NOFILE 开得比 MAX_FD 大时，fd 可能超出槽位 (哪怕连接数没满)
+                if(connfd>=MAX_FD||http_conn::m_user_count>=MAX_FD){
+                    close(connfd);
+                    continue;
+                }
+
+                bool tls=(sockfd==listenfds[LISTEN_HTTPS]);
+                if(loop_count==0){
+                    users.set_owner(connfd,-1);
+                    users.at(connfd).init(connfd,client_address,tls);
+                    continue;
+                }
+
+                // 🧭 选一个 I/O 线程：优先交给绑在“处理这个连接软中断的那个核”上的线程，
+                // 这样收包和处理请求在同一个核上，缓存是热的；否则轮流分
+                int target=-1;
+                if(steer){
+                    int cpu=-1;
+                    socklen_t len=sizeof(cpu);
+                    if(getsockopt(connfd,SOL_SOCKET,SO_INCOMING_CPU,&cpu,&len)==0&&cpu>=0&&cpu<CPU_SETSIZE){
+                        target=loop_of_cpu[cpu];
+                    }
+                }
+                if(target<0){
+                    target=next_loop;
+                    next_loop=(next_loop+1)%loop_count;
+                }
+                users.set_owner(connfd,target);
+                loops[target].post(connfd,client_address,tls);
+            }
+
+            // 别的线程叫醒了这个循环里的协程
+            else if(sockfd==wake_fd){
+                uint64_t count;
+                ssize_t ret=read(wake_fd,&count,sizeof(count));
+                (void)ret;
+                co_waker_run();
+                ws_hub_run();
+            }
+
+            // 情况二~四：连接上的读写事件 (只有单循环模式会走到这里)
+            else{
+                handle_conn_event(users,events[i],ready_time);
+            }
+        }
+
+        // ⏰ 叫醒 sleep 到期的协程
+        co_timer_run(http_conn::now_us());
+
+        // 🧮 交内存账；过了软上限就瘦身 (I/O 线程管的连接由它们自己瘦)
+        if(mem_budget_poll()){
+            trim_idle_conns(users,-1);
+        }
+        if(stats_requested){
+            stats_requested=0;
+            mem_budget_dump();
+        }
+
+        // 🚦 过载了 (或者内存到了硬上限) 就先别接新客人，让已经在排队的先消化掉
+        bool overloaded=http_conn::is_overloaded(http_conn::now_us())||mem_level()==MEM_HARD;
+        if(!draining&&overloaded!=accept_paused){
+            for(int j=0;j<LISTEN_COUNT;j++){
+                if(listenfds[j]!=-1){
+                    set_accept_paused(epollfd,listenfds[j],overloaded);
+                }
+            }
+            accept_paused=overloaded;
+            printf("%s accept (已处理 %lld 个请求, 503 拒绝 %lld 个)\n",
+                overloaded?"⏸️ 暂停":"▶️ 恢复",http_conn::m_request_count.load(),http_conn::m_shed_count.load());
+        }
+
+        // 📊 多进程模式：计数写进共享内存里自己那一格，master 汇总
+        worker_publish(http_conn::m_user_count.load(std::memory_order_relaxed),http_conn::m_request_count.load(std::memory_order_relaxed),http_conn::m_bytes_sent,mem_used_total());
+    }
+
+#ifndef NDEBUG
+    mem_pool::dump_stats();
+#endif
+
+    // I/O 线程：关掉各自剩下的连接，然后退出
+    for(int j=0;j<loop_count;j++){
+        loops[j].stop();
+    }
+    for(int j=0;j<loop_count;j++){
+        loops[j].join();
+    }
+    delete[] loops;
+
+    // 🔬 各个 I/O 线程已经把自己的记录写进去了，主线程最后收尾
+    trace_close();
+    capture_close();
+
+    // 📮 零拷贝用得怎么样 (copied 多说明这条路径上内核其实在拷贝，比如回环)
+    if(http_conn::m_zerocopy_sends>0){
+        printf("📮 MSG_ZEROCOPY: 零拷贝发送 %lld 次, 内核退回成拷贝 %lld 次\n",
+            http_conn::m_zerocopy_sends.load(),http_conn::m_zerocopy_copied.load());
+    }
+
+    // 🧮 内存用到过多少、限流触发过几次
+    mem_budget_dump();
+
+    // 🔌 被踢掉的慢客户端 (多说明 ws_max_queue_kb 太小，或者广播得太快)
+    if(http_conn::m_ws_evicted>0){
+        printf("🐢 WebSocket: 踢掉收得太慢的连接 %lld 个\n",http_conn::m_ws_evicted.load());
+    }
+
+    close(wake_fd);
+    close(epollfd);
+    for(int i=0;i<LISTEN_COUNT;i++){
+        if(listenfds[i]!=-1){
+            close(listenfds[i]);
+        }
+    }
+    return 0;
+}
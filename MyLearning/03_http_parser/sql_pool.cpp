@@ -0,0 +1,116 @@
+#include "sql_pool.h"
+#include "http_conn.h"
+#include<stdio.h>
+#include<sqlite3.h>
+
+// =================================================================
+// 1. 连接
+// =================================================================
+
+sql_pool::sql_pool(){
+    pthread_mutex_init(&m_lock,NULL);
+    pthread_cond_init(&m_conn_cond,NULL);
+    pthread_cond_init(&m_job_cond,NULL);
+}
+
+sql_pool& sql_pool::instance(){
+    static sql_pool pool;
+    return pool;
+}
+
+bool sql_pool::init(const char* path,int size){
+    if(size<1){
+        size=1;
+    }
+    for(int i=0;i<size;i++){
+        // 一个连接同一时刻只有一个线程在用，不用 SQLite 自己再加一层锁
+        sqlite3* db=0;
+        if(sqlite3_open_v2(path,&db,SQLITE_OPEN_READWRITE|SQLITE_OPEN_CREATE|SQLITE_OPEN_NOMUTEX,NULL)!=SQLITE_OK){
+            printf("sql_pool: cannot open %s: %s\n",path,db?sqlite3_errmsg(db):"out of memory");
+            sqlite3_close(db);
+            return false;
+        }
+        // WAL：读的时候不挡写；几个连接同时写的时候排队等一会，而不是马上报 SQLITE_BUSY
+        sqlite3_exec(db,"PRAGMA journal_mode=WAL",NULL,NULL,NULL);
+        sqlite3_busy_timeout(db,5000);
+        m_all.push_back(db);
+        m_free.push_back(db);
+    }
+
+    // 线程和连接一样多：多了也是在 acquire 上干等
+    for(int i=0;i<size;i++){
+        pthread_t tid;
+        if(pthread_create(&tid,NULL,worker,this)!=0){
+            perror("sql_pool pthread_create");
+            return false;
+        }
+        pthread_detach(tid);    // 跟进程同生共死
+    }
+    return true;
+}
+
+sqlite3* sql_pool::acquire(){
+    pthread_mutex_lock(&m_lock);
+    while(m_free.empty()){
+        pthread_cond_wait(&m_conn_cond,&m_lock);
+    }
+    sqlite3* db=m_free.back();
+    m_free.pop_back();
+    pthread_mutex_unlock(&m_lock);
+    return db;
+}
+
+void sql_pool::release(sqlite3* db){
+    pthread_mutex_lock(&m_lock);
+    m_free.push_back(db);
+    pthread_cond_signal(&m_conn_cond);
+    pthread_mutex_unlock(&m_lock);
+}
+
+// =================================================================
+// 2. 任务
+// =================================================================
+
+void sql_pool::submit(const std::shared_ptr<db_job>& job,co_waker* waker,http_conn* conn,unsigned seq){
+    pending p;
+    p.job=job;
+    p.waker=waker;
+    p.conn=conn;
+    p.seq=seq;
+    pthread_mutex_lock(&m_lock);
+    m_jobs.push_back(p);
+    pthread_cond_signal(&m_job_cond);
+    pthread_mutex_unlock(&m_lock);
+}
+
+void* sql_pool::worker(void* arg){
+    sql_pool* pool=(sql_pool*)arg;
+    while(true){
+        pthread_mutex_lock(&pool->m_lock);
+        while(pool->m_jobs.empty()){
+            pthread_cond_wait(&pool->m_job_cond,&pool->m_lock);
+        }
+        pending p=pool->m_jobs.front();
+        pool->m_jobs.pop_front();
+        pthread_mutex_unlock(&pool->m_lock);
+
+        {
+            sql_conn_guard db;
+            p.job->ok=p.job->run(db.get());
+        }
+        if(p.waker){
+            co_wake(p.waker,p.conn,p.seq);
+        }
+    }
+    return NULL;
+}
+
+// =================================================================
+// 3. co_await
+// =================================================================
+
+void co_db::await_suspend(std::coroutine_handle<> h){
+    (void)h;
+    conn->m_co_wait=CO_WAIT_DB;
+    sql_pool::instance().submit(job,co_current_waker(),conn,conn->m_co_seq);
+}
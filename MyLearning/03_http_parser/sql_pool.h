@@ -0,0 +1,88 @@
+#ifndef SQLPOOL_H
+#define SQLPOOL_H
+
+#include<pthread.h>
+#include<coroutine>
+#include<memory>
+#include<vector>
+#include<deque>
+
+struct sqlite3;
+struct co_waker;
+class http_conn;
+
+// 🗃️ 数据库连接池 (SQLite，本地文件)
+// I/O 循环里绝对不能等数据库 (一次写盘就是几毫秒，整个循环的连接都跟着卡)，
+// 所以查询 / 写入都包成 db_job，交给池子里的线程去跑：
+//   - 连接数有上限 (db_pool_size)，线程拿不到连接就等 (sql_conn_guard 出作用域自动还回去)
+//   - 协程 handler 用 co_await conn.run_db(job) 把任务交出去，自己挂起；
+//     线程跑完了通过 co_waker 叫醒它，回到它自己的 I/O 循环里接着跑
+//   - job 用 shared_ptr 管：协程等的时候连接断了 (协程被销毁)，job 照样跑完，结果没人要而已
+
+// 📋 一个要在数据库线程上跑的任务 (继承它，把参数和结果放成员里)
+class db_job{
+public:
+    db_job():ok(false){}
+    virtual ~db_job(){}
+    virtual bool run(sqlite3* db)=0;    // 在数据库线程上跑，返回值放进 ok
+    bool ok;
+};
+
+class sql_pool{
+public:
+    // 🌍 整个进程一个
+    static sql_pool& instance();
+
+    // 打开 size 个连接、起 size 个线程 (启动时调一次)
+    bool init(const char* path,int size);
+
+    // 🔒 借一个连接，都借出去了就等 (只能在数据库线程或者启动时用，I/O 循环里不行)
+    sqlite3* acquire();
+    void release(sqlite3* db);
+
+    // 📮 排队交给数据库线程；waker 不为 NULL 的话，跑完了 co_wake(waker,conn,seq)
+    void submit(const std::shared_ptr<db_job>& job,co_waker* waker,http_conn* conn,unsigned seq);
+
+    int size() const{return (int)m_all.size();}
+
+private:
+    sql_pool();
+    static void* worker(void* arg);
+
+    struct pending{
+        std::shared_ptr<db_job> job;
+        co_waker* waker;
+        http_conn* conn;
+        unsigned seq;
+    };
+
+    std::vector<sqlite3*> m_all;    // 开着的所有连接
+    std::vector<sqlite3*> m_free;   // 现在没人用的
+    pthread_mutex_t m_lock;
+    pthread_cond_t m_conn_cond;     // 有连接还回来了
+    pthread_cond_t m_job_cond;      // 有新任务了
+    std::deque<pending> m_jobs;
+};
+
+// 🪝 RAII：构造时借，析构时还
+class sql_conn_guard{
+public:
+    sql_conn_guard():m_db(sql_pool::instance().acquire()){}
+    ~sql_conn_guard(){sql_pool::instance().release(m_db);}
+    sqlite3* get() const{return m_db;}
+    sql_conn_guard(const sql_conn_guard&)=delete;
+    sql_conn_guard& operator=(const sql_conn_guard&)=delete;
+private:
+    sqlite3* m_db;
+};
+
+// ⏳ co_await conn.run_db(job)：交给数据库线程，跑完了被叫醒，返回 job->ok
+struct co_db{
+    http_conn* conn;
+    std::shared_ptr<db_job> job;
+    bool await_ready(){return false;}
+    void await_suspend(std::coroutine_handle<> h);
+    bool await_resume(){return job->ok;}
+};
+
+#endif
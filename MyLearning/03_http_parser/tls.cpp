@@ -0,0 +1,51 @@
+#include "tls.h"
+#include<stdio.h>
+#include<openssl/err.h>
+
+// 所有 HTTPS 连接共享同一个 SSL_CTX (证书、配置都在里面)
+static SSL_CTX* g_tls_ctx=NULL;
+
+bool tls_init(const char* cert_file,const char* key_file){
+    SSL_CTX* ctx=SSL_CTX_new(TLS_server_method());
+    if(!ctx){
+        ERR_print_errors_fp(stderr);
+        return false;
+    }
+
+    // kTLS 只支持 TLS1.2 / 1.3 的 AES-GCM、ChaCha20 这些套件，老协议直接不要了
+    SSL_CTX_set_min_proto_version(ctx,TLS1_2_VERSION);
+
+    // SSL_OP_ENABLE_KTLS: 握手完成后尝试把加解密交给内核
+    SSL_CTX_set_options(ctx,SSL_OP_ENABLE_KTLS);
+
+    // 非阻塞写需要的两个模式：
+    // ENABLE_PARTIAL_WRITE: SSL_write 可以只写一部分就返回 (和 writev 的语义一样)
+    // ACCEPT_MOVING_WRITE_BUFFER: EAGAIN 之后重试时 buffer 地址可以变
+    // RELEASE_BUFFERS: 连接闲着的时候把 OpenSSL 内部的读写缓冲释放掉，省内存
+    SSL_CTX_set_mode(ctx,SSL_MODE_ENABLE_PARTIAL_WRITE|SSL_MODE_ACCEPT_MOVING_WRITE_BUFFER|SSL_MODE_RELEASE_BUFFERS);
+
+    if(SSL_CTX_use_certificate_chain_file(ctx,cert_file)!=1
+        ||SSL_CTX_use_PrivateKey_file(ctx,key_file,SSL_FILETYPE_PEM)!=1
+        ||SSL_CTX_check_private_key(ctx)!=1){
+        printf("tls_init: cannot load %s / %s\n",cert_file,key_file);
+        ERR_print_errors_fp(stderr);
+        SSL_CTX_free(ctx);
+        return false;
+    }
+
+    g_tls_ctx=ctx;
+    return true;
+}
+
+SSL* tls_new(int sockfd){
+    if(!g_tls_ctx){
+        return NULL;
+    }
+    SSL* ssl=SSL_new(g_tls_ctx);
+    if(!ssl){
+        return NULL;
+    }
+    SSL_set_fd(ssl,sockfd);
+    SSL_set_accept_state(ssl);
+    return ssl;
+}
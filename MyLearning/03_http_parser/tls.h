@@ -0,0 +1,18 @@
+#ifndef TLSCONTEXT_H
+#define TLSCONTEXT_H
+
+#include<openssl/ssl.h>
+
+// 🔐 HTTPS 支持 (OpenSSL 握手 + 内核 TLS)
+// 握手在用户态由 OpenSSL 完成 (非阻塞，嵌在 http_conn 的状态机里)，
+// 握手结束后 OpenSSL 会通过 setsockopt(TCP_ULP, "tls") 把对称密钥交给内核 (kTLS)，
+// 之后 writev / sendfile 发出去的明文由内核负责加密，零拷贝路径保持不变。
+// 内核不支持 kTLS 时自动退回到 SSL_write 用户态加密。
+
+// 🏗️ 全局初始化：加载证书和私钥，只需要调用一次
+bool tls_init(const char* cert_file,const char* key_file);
+
+// 🆕 为一个新连接创建 SSL 对象 (服务端模式)，失败返回 NULL
+SSL* tls_new(int sockfd);
+
+#endif
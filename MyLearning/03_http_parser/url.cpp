@@ -0,0 +1,172 @@
+#include "url.h"
+#include<string.h>
+#if defined(__SSE2__)
+#include<immintrin.h>
+#endif
+
+// =================================================================
+// 1. 快速路径：找第一个要特殊处理的位置
+// =================================================================
+
+static inline bool is_ctrl(unsigned char c){
+    return c<0x20||c==0x7F;
+}
+
+// 这个位置要不要停下来：'%'、'?'、'#'、控制字符，或者 "//"、"/." (可能是 . / .. 段)
+// 非 ASCII 的字节 (比如没编码的 UTF-8) 放过去
+static inline bool is_special(const char* s,size_t i,size_t len){
+    unsigned char c=(unsigned char)s[i];
+    if(c=='%'||c=='?'||c=='#'||is_ctrl(c)){
+        return true;
+    }
+    return c=='/'&&i+1<len&&(s[i+1]=='/'||s[i+1]=='.');
+}
+
+// 返回第一个要停下来的位置，都没有返回 len
+static size_t scan_special(const char* s,size_t len){
+    size_t i=0;
+#if defined(__SSE2__)
+    const __m128i pct=_mm_set1_epi8('%');
+    const __m128i qmark=_mm_set1_epi8('?');
+    const __m128i hash=_mm_set1_epi8('#');
+    const __m128i slash=_mm_set1_epi8('/');
+    const __m128i dot=_mm_set1_epi8('.');
+    const __m128i del=_mm_set1_epi8(0x7F);
+    const __m128i ctrl_max=_mm_set1_epi8(0x1F);
+    // 每次看 s[i..i+15]，顺便错一位再读一次 s[i+1..i+16] 看 '/' 后面跟的是什么
+    // (i+16 < len，第二次读也不会越过结尾的 '\0')
+    for(;i+17<=len;i+=16){
+        __m128i v=_mm_loadu_si128((const __m128i*)(s+i));
+        __m128i next=_mm_loadu_si128((const __m128i*)(s+i+1));
+        __m128i hit=_mm_or_si128(_mm_cmpeq_epi8(v,pct),_mm_cmpeq_epi8(v,qmark));
+        hit=_mm_or_si128(hit,_mm_cmpeq_epi8(v,hash));
+        hit=_mm_or_si128(hit,_mm_cmpeq_epi8(v,del));
+        hit=_mm_or_si128(hit,_mm_cmpeq_epi8(_mm_min_epu8(v,ctrl_max),v));    // 无符号 v<=0x1F
+        __m128i seg=_mm_or_si128(_mm_cmpeq_epi8(next,slash),_mm_cmpeq_epi8(next,dot));
+        hit=_mm_or_si128(hit,_mm_and_si128(_mm_cmpeq_epi8(v,slash),seg));
+        int mask=_mm_movemask_epi8(hit);
+        if(mask){
+            return i+__builtin_ctz(mask);
+        }
+    }
+#endif
+    for(;i<len;i++){
+        if(is_special(s,i,len)){
+            return i;
+        }
+    }
+    return len;
+}
+
+// =================================================================
+// 2. 慢速路径：解码 + 去掉 . / .. 段，就地往前写
+// =================================================================
+
+static inline int hex_val(unsigned char c){
+    if(c>='0'&&c<='9'){
+        return c-'0';
+    }
+    c|=0x20;
+    if(c>='a'&&c<='f'){
+        return c-'a'+10;
+    }
+    return -1;
+}
+
+// 刚写完的那一段 (url[seg..w)) 是 "." 就去掉，是 ".." 就连上一段一起退掉
+// 返回 false 表示退到根目录外面去了
+static bool finish_segment(char* url,size_t seg,size_t& w){
+    size_t n=w-seg;
+    if(n==1&&url[seg]=='.'){
+        w=seg;
+        return true;
+    }
+    if(n==2&&url[seg]=='.'&&url[seg+1]=='.'){
+        if(seg<=1){
+            return false;   // "/.."
+        }
+        // url[seg-1] 是这一段前面的 '/'，再往前找上一段开头的 '/'
+        size_t p=seg-1;
+        while(p>0&&url[p-1]!='/'){
+            p--;
+        }
+        w=p;
+    }
+    return true;
+}
+
+bool url_canonicalize(char* url,url_view& out){
+    size_t len=strlen(url);
+    out.path=url;
+    out.query=NULL;
+
+    size_t i=scan_special(url,len);
+    if(i==len||url[i]=='?'){
+        // ✅ 快速路径：路径本来就是规范的
+        if(i<len){
+            url[i]='\0';
+            out.query=url+i+1;
+            char* frag=strchr(out.query,'#');
+            if(frag){
+                *frag='\0';
+            }
+        }
+        out.path_len=i;
+        return true;
+    }
+
+    // 前面 url[0..i) 已经是规范的了，从 i 开始边读边写 (w 永远不超过 r)
+    size_t r=i;
+    size_t w=i;
+    size_t seg=i;   // 当前这一段从哪里开始 (上一个 '/' 后面)
+    while(seg>0&&url[seg-1]!='/'){
+        seg--;
+    }
+    while(r<len){
+        unsigned char c=(unsigned char)url[r];
+        if(c=='?'){
+            out.query=url+r+1;
+            char* frag=strchr(out.query,'#');
+            if(frag){
+                *frag='\0';
+            }
+            break;
+        }
+        if(c=='#'){
+            break;
+        }
+        if(c=='%'){
+            int hi=r+2<len?hex_val(url[r+1]):-1;
+            int lo=hi>=0?hex_val(url[r+2]):-1;
+            if(lo<0){
+                return false;
+            }
+            c=(unsigned char)(hi<<4|lo);
+            r+=3;
+        }else{
+            r++;
+        }
+        if(is_ctrl(c)){
+            return false;
+        }
+
+        if(c=='/'){
+            if(!finish_segment(url,seg,w)){
+                return false;
+            }
+            if(w==0||url[w-1]!='/'){
+                url[w++]='/';
+            }
+            seg=w;
+            continue;
+        }
+        url[w++]=(char)c;
+    }
+    // 最后一段后面没有 '/'：一样看看是不是 . / ..
+    if(!finish_segment(url,seg,w)){
+        return false;
+    }
+    url[w]='\0';
+    out.path_len=w;
+    return true;
+}
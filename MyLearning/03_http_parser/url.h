@@ -0,0 +1,26 @@
+#ifndef URL_H
+#define URL_H
+
+#include<stddef.h>
+
+// 🧭 URL 规范化：一遍扫过去，就地把请求目标改成“规范的路径” + 原样的查询串
+//   - 按第一个 '?' 切开路径和查询串 ('#' 后面的片段客户端本来就不该发，有的话丢掉)
+//   - 路径里的 %XX 就地解码 (解出来只会变短，往前写踩不到还没读的部分)；
+//     % 后面不是两位十六进制、或者解出 NUL / 控制字符的，整个请求不合法
+//   - "//" 并成一个，"/./" 去掉，"/../" 退回上一级 (解码以后再做，"%2e%2e%2f" 一样挡得住)；
+//     退到根目录外面去的不合法
+//   - 查询串不解码，原样交给 FastCGI 的 QUERY_STRING / 微缓存的键
+// 绝大多数 URL 里根本没有 %、"//"、"/."：先用 SIMD 一次看 16 字节确认这一点，
+// 确认了就只是找到 '?' 切一刀，不用逐字节往回写。
+// 规范化以后的路径直接拿来当路由 / 微缓存的键：/a/./b、/a//b、/a/%62 都是 /a/b
+
+struct url_view{
+    char* path;         // 规范化后的路径，'/' 开头，'\0' 结尾 (就在原来的缓冲区里)
+    size_t path_len;
+    char* query;        // '?' 后面的查询串 ('\0' 结尾)，没有就是 NULL
+};
+
+// url 必须以 '/' 开头；返回 false 表示 URL 不合法 (回 400)
+bool url_canonicalize(char* url,url_view& out);
+
+#endif
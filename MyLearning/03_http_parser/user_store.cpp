@@ -0,0 +1,394 @@
+#include "user_store.h"
+#include "http_conn.h"
+#include "sql_pool.h"
+#include "form.h"
+#include<stdio.h>
+#include<string.h>
+#include<pthread.h>
+#include<string>
+#include<unordered_map>
+#include<sqlite3.h>
+#include<openssl/sha.h>
+#include<openssl/evp.h>
+#include<openssl/rand.h>
+#include<openssl/crypto.h>
+
+// =================================================================
+// 1. 内存里的用户表
+// =================================================================
+
+static const size_t SALT_LEN=16;
+static const size_t MAX_NAME_LEN=32;
+static const size_t MAX_PASSWD_LEN=128;
+static const size_t MAX_FORM_LEN=1024;      // 表单就两个字段，比这大的不是正常的登录请求
+static const int MAX_FORM_FIELDS=8;
+
+// 🐢 PBKDF2-HMAC-SHA256 的迭代次数 (OWASP 2023 的建议值)：故意慢，库被拖走了也没法一秒试几十亿个密码
+// 一次要几百毫秒的 CPU，所以只在数据库线程上算 (run_db)，不占 I/O 循环
+// 次数和盐一起存在每个用户的行里：以后调大了，老用户下次登录成功时按新的次数重算
+static const int PBKDF2_ITERATIONS=600000;
+static const size_t HASH_LEN=32;
+
+struct user_entry{
+    std::string salt;       // 十六进制
+    std::string hash;       // 十六进制的 PBKDF2 结果；注册还没写完库的时候是空的 (谁都登录不上)
+    int iterations;         // 0: 老的一轮 SHA-256(盐 + 密码)，登录成功时顺手升级
+    user_entry():iterations(0){}
+};
+
+static pthread_rwlock_t g_users_lock=PTHREAD_RWLOCK_INITIALIZER;
+static std::unordered_map<std::string,user_entry> g_users;
+
+static void to_hex(const unsigned char* p,size_t len,std::string& out){
+    static const char digits[]="0123456789abcdef";
+    out.resize(len*2);
+    for(size_t i=0;i<len;i++){
+        out[i*2]=digits[p[i]>>4];
+        out[i*2+1]=digits[p[i]&15];
+    }
+}
+
+// 🐢 按 e 的盐和迭代次数算密码哈希 (只在数据库线程上调)
+static bool hash_password(const user_entry& e,const std::string& passwd,std::string& out){
+    unsigned char digest[HASH_LEN];
+    if(e.iterations==0){
+        // 老格式：盐和密码都有长度上限，拼在栈上一次算完
+        unsigned char buf[SALT_LEN*2+MAX_PASSWD_LEN];
+        size_t n=e.salt.size()<SALT_LEN*2?e.salt.size():SALT_LEN*2;
+        memcpy(buf,e.salt.data(),n);
+        memcpy(buf+n,passwd.data(),passwd.size());
+        SHA256(buf,n+passwd.size(),digest);
+    }else if(PKCS5_PBKDF2_HMAC(passwd.data(),(int)passwd.size(),(const unsigned char*)e.salt.data(),(int)e.salt.size(),
+        e.iterations,EVP_sha256(),HASH_LEN,digest)!=1){
+        return false;
+    }
+    to_hex(digest,sizeof(digest),out);
+    return true;
+}
+
+// 🧂 新盐 + 现在的迭代次数算一份 (注册、老格式升级用)
+static bool make_entry(const std::string& passwd,user_entry& e){
+    unsigned char salt[SALT_LEN];
+    if(RAND_bytes(salt,sizeof(salt))!=1){
+        return false;
+    }
+    to_hex(salt,sizeof(salt),e.salt);
+    e.iterations=PBKDF2_ITERATIONS;
+    return hash_password(e,passwd,e.hash);
+}
+
+static bool find_user(const std::string& name,user_entry& e){
+    pthread_rwlock_rdlock(&g_users_lock);
+    std::unordered_map<std::string,user_entry>::const_iterator it=g_users.find(name);
+    bool found=(it!=g_users.end());
+    if(found){
+        e=it->second;
+    }
+    pthread_rwlock_unlock(&g_users_lock);
+    return found;
+}
+
+static void set_user(const std::string& name,const user_entry& e){
+    pthread_rwlock_wrlock(&g_users_lock);
+    g_users[name]=e;
+    pthread_rwlock_unlock(&g_users_lock);
+}
+
+// 📝 占住用户名，已经有人用了返回 false
+static bool reserve_user(const std::string& name,const user_entry& e){
+    pthread_rwlock_wrlock(&g_users_lock);
+    bool inserted=g_users.emplace(name,e).second;
+    pthread_rwlock_unlock(&g_users_lock);
+    return inserted;
+}
+
+static void forget_user(const std::string& name){
+    pthread_rwlock_wrlock(&g_users_lock);
+    g_users.erase(name);
+    pthread_rwlock_unlock(&g_users_lock);
+}
+
+// =================================================================
+// 2. 数据库
+// =================================================================
+
+static bool exec_sql(sqlite3* db,const char* sql){
+    char* err=0;
+    if(sqlite3_exec(db,sql,NULL,NULL,&err)!=SQLITE_OK){
+        printf("user_store: %s\n",err);
+        sqlite3_free(err);
+        return false;
+    }
+    return true;
+}
+
+// 老的库没有 iterations 这一列：补上，老的行都是 0 (一轮 SHA-256)
+static bool upgrade_schema(sqlite3* db){
+    sqlite3_stmt* stmt=0;
+    if(sqlite3_prepare_v2(db,"SELECT COUNT(*) FROM pragma_table_info('user') WHERE name='iterations'",-1,&stmt,NULL)!=SQLITE_OK){
+        printf("user_store: %s\n",sqlite3_errmsg(db));
+        return false;
+    }
+    bool has=sqlite3_step(stmt)==SQLITE_ROW&&sqlite3_column_int(stmt,0)>0;
+    sqlite3_finalize(stmt);
+    return has||exec_sql(db,"ALTER TABLE user ADD COLUMN iterations INTEGER NOT NULL DEFAULT 0");
+}
+
+static bool load_users(sqlite3* db){
+    if(!exec_sql(db,"CREATE TABLE IF NOT EXISTS user("
+        "username TEXT PRIMARY KEY,salt TEXT NOT NULL,passwd_hash TEXT NOT NULL,iterations INTEGER NOT NULL DEFAULT 0)")){
+        return false;
+    }
+    if(!upgrade_schema(db)){
+        return false;
+    }
+
+    sqlite3_stmt* stmt=0;
+    if(sqlite3_prepare_v2(db,"SELECT username,salt,passwd_hash,iterations FROM user",-1,&stmt,NULL)!=SQLITE_OK){
+        printf("user_store: %s\n",sqlite3_errmsg(db));
+        return false;
+    }
+    pthread_rwlock_wrlock(&g_users_lock);
+    while(sqlite3_step(stmt)==SQLITE_ROW){
+        user_entry e;
+        e.salt=(const char*)sqlite3_column_text(stmt,1);
+        e.hash=(const char*)sqlite3_column_text(stmt,2);
+        e.iterations=sqlite3_column_int(stmt,3);
+        g_users[(const char*)sqlite3_column_text(stmt,0)]=e;
+    }
+    size_t count=g_users.size();
+    pthread_rwlock_unlock(&g_users_lock);
+    sqlite3_finalize(stmt);
+    printf("user_store: %zu users loaded\n",count);
+    return true;
+}
+
+// 💾 INSERT (注册) 或者 UPDATE (老格式升级) 一行
+static bool save_user(sqlite3* db,const char* sql,const std::string& name,const user_entry& e){
+    sqlite3_stmt* stmt=0;
+    if(sqlite3_prepare_v2(db,sql,-1,&stmt,NULL)!=SQLITE_OK){
+        printf("user_store: %s\n",sqlite3_errmsg(db));
+        return false;
+    }
+    sqlite3_bind_text(stmt,1,e.salt.data(),(int)e.salt.size(),SQLITE_STATIC);
+    sqlite3_bind_text(stmt,2,e.hash.data(),(int)e.hash.size(),SQLITE_STATIC);
+    sqlite3_bind_int(stmt,3,e.iterations);
+    sqlite3_bind_text(stmt,4,name.data(),(int)name.size(),SQLITE_STATIC);
+    int rc=sqlite3_step(stmt);
+    if(rc!=SQLITE_DONE){
+        printf("user_store: save %s: %s\n",name.c_str(),sqlite3_errmsg(db));
+    }
+    sqlite3_finalize(stmt);
+    return rc==SQLITE_DONE;
+}
+
+// 🗃️ 注册：在数据库线程上算哈希、INSERT，再把哈希填进内存表 (名字已经在 handler 里占住了)
+// 内存表也在这里改：等着的协程被销毁了 (连接断了)，注册照样完整地成功或者退掉
+class insert_user_job:public db_job{
+public:
+    insert_user_job(const std::string& name,const str_view& passwd):m_name(name),m_passwd(passwd.data,passwd.len){}
+
+    bool run(sqlite3* db){
+        user_entry e;
+        bool ok=make_entry(m_passwd,e)
+            &&save_user(db,"INSERT INTO user(salt,passwd_hash,iterations,username) VALUES(?,?,?,?)",m_name,e);
+        OPENSSL_cleanse(&m_passwd[0],m_passwd.size());
+        if(ok){
+            set_user(m_name,e);
+        }else{
+            forget_user(m_name);
+        }
+        return ok;
+    }
+
+private:
+    std::string m_name;
+    std::string m_passwd;   // 拷一份：协程那边的请求体在 arena 里，连接断了就没了
+};
+
+// 🔑 登录：在数据库线程上算哈希比对，不碰数据库 (除非要把老格式升级)
+// 没有这个用户也照样算一遍，不然看回得快不快就知道哪些用户名存在
+class check_user_job:public db_job{
+public:
+    check_user_job(const std::string& name,const str_view& passwd):m_name(name),m_passwd(passwd.data,passwd.len){}
+
+    bool run(sqlite3* db){
+        user_entry e;
+        bool found=find_user(m_name,e);
+        if(!found){
+            e.salt.assign(SALT_LEN*2,'0');
+            e.iterations=PBKDF2_ITERATIONS;
+        }
+        std::string hash;
+        bool ok=hash_password(e,m_passwd,hash)&&found
+            &&hash.size()==e.hash.size()&&CRYPTO_memcmp(hash.data(),e.hash.data(),hash.size())==0;
+        if(ok&&e.iterations<PBKDF2_ITERATIONS){
+            // ⬆️ 密码对了，手里正好有明文：按现在的次数重算一份存回去 (失败了也不影响这次登录)
+            user_entry fresh;
+            if(make_entry(m_passwd,fresh)
+                &&save_user(db,"UPDATE user SET salt=?,passwd_hash=?,iterations=? WHERE username=?",m_name,fresh)){
+                set_user(m_name,fresh);
+            }
+        }
+        OPENSSL_cleanse(&m_passwd[0],m_passwd.size());
+        return ok;
+    }
+
+private:
+    std::string m_name;
+    std::string m_passwd;
+};
+
+bool user_store_open(const char* path,int pool_size){
+    if(!sql_pool::instance().init(path,pool_size)){
+        return false;
+    }
+    sql_conn_guard db;
+    return load_users(db.get());
+}
+
+// =================================================================
+// 3. handler
+// =================================================================
+
+// 📤 回一个短的纯文本响应
+static co_write reply(http_conn& conn,int status,const char* title,const char* body){
+    const size_t HEAD_SIZE=192;
+    char* head=(char*)conn.arena().alloc(HEAD_SIZE);
+    int head_len=snprintf(head,HEAD_SIZE,"HTTP/1.1 %d %s\r\nContent-Type: text/plain\r\nContent-Length: %zu\r\nConnection: %s\r\n\r\n",
+        status,title,strlen(body),conn.get_linger()?"keep-alive":"close");
+    struct iovec iov[2];
+    iov[0].iov_base=head;
+    iov[0].iov_len=head_len;
+    iov[1].iov_base=(void*)body;
+    iov[1].iov_len=strlen(body);
+    return conn.write(iov,2);
+}
+
+struct login_form{
+    str_view user;
+    str_view passwd;
+};
+
+static bool valid_name(const str_view& name){
+    if(name.len==0||name.len>MAX_NAME_LEN){
+        return false;
+    }
+    for(size_t i=0;i<name.len;i++){
+        char c=name.data[i];
+        bool ok=(c>='a'&&c<='z')||(c>='A'&&c<='Z')||(c>='0'&&c<='9')||c=='_'||c=='-'||c=='.';
+        if(!ok){
+            return false;
+        }
+    }
+    return true;
+}
+
+// 📋 请求头看完了：这个请求能不能当成登录表单来读，能的话返回 0，否则是要回的状态码
+// (请求体太大的不读了，直接回错误；没读完的请求体没法和下一个请求分开，回完就挂断)
+static int check_form_request(http_conn& conn){
+    if(conn.get_method()!=POST){
+        return 405;
+    }
+    if(conn.get_content_length()<=0||(size_t)conn.get_content_length()>MAX_FORM_LEN){
+        conn.set_linger(false);
+        return 413;
+    }
+    return 0;
+}
+
+static bool parse_login_form(char* body,size_t len,login_form& form){
+    form_field fields[MAX_FORM_FIELDS];
+    int count=form_parse(body,len,fields,MAX_FORM_FIELDS);
+    if(!form_find(fields,count,"user",form.user)||!form_find(fields,count,"passwd",form.passwd)){
+        return false;
+    }
+    return valid_name(form.user)&&form.passwd.len>0&&form.passwd.len<=MAX_PASSWD_LEN;
+}
+
+static const char* status_title(int status){
+    switch(status){
+        case 405: return "Method Not Allowed";
+        case 413: return "Payload Too Large";
+        default: return "Bad Request";
+    }
+}
+
+co_task login_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+    int bad=check_form_request(conn);
+    if(bad){
+        co_await reply(conn,bad,status_title(bad),"bad form\n");
+        co_return;
+    }
+
+    // 表单不大，整个读进 arena (请求结束自动释放)
+    size_t len=conn.get_content_length();
+    char* body=(char*)conn.arena().alloc(len);
+    size_t got=0;
+    ssize_t n;
+    while(got<len&&(n=co_await conn.read_body(body+got,len-got))>0){
+        got+=n;
+    }
+    if(got<len){
+        co_return;  // 连接断了
+    }
+
+    login_form form;
+    if(!parse_login_form(body,len,form)){
+        co_await reply(conn,400,"Bad Request","bad form\n");
+        co_return;
+    }
+    // 🔑 算哈希要几百毫秒，交给数据库线程，协程挂起等结果 (I/O 循环接着服务别的连接)
+    std::shared_ptr<db_job> job=std::make_shared<check_user_job>(std::string(form.user.data,form.user.len),form.passwd);
+    if(co_await conn.run_db(job)){
+        co_await reply(conn,200,"OK","login ok\n");
+    }else{
+        co_await reply(conn,401,"Unauthorized","wrong user or password\n");
+    }
+}
+
+co_task register_handler(http_conn& conn){
+    if(!co_await conn.read_headers()){
+        co_return;
+    }
+    int bad=check_form_request(conn);
+    if(bad){
+        co_await reply(conn,bad,status_title(bad),"bad form\n");
+        co_return;
+    }
+
+    size_t len=conn.get_content_length();
+    char* body=(char*)conn.arena().alloc(len);
+    size_t got=0;
+    ssize_t n;
+    while(got<len&&(n=co_await conn.read_body(body+got,len-got))>0){
+        got+=n;
+    }
+    if(got<len){
+        co_return;
+    }
+
+    login_form form;
+    if(!parse_login_form(body,len,form)){
+        co_await reply(conn,400,"Bad Request","bad user name or password\n");
+        co_return;
+    }
+
+    // 先在内存里占住名字 (哈希还是空的，谁都登录不上)：同名的并发注册只有一个能走到这里后面
+    std::string name(form.user.data,form.user.len);
+    if(!reserve_user(name,user_entry())){
+        co_await reply(conn,409,"Conflict","user already exists\n");
+        co_return;
+    }
+
+    // 🗃️ 算哈希、写库都交给数据库线程，协程挂起等它做完再回复 (失败了占的名字由 job 退掉)
+    std::shared_ptr<db_job> job=std::make_shared<insert_user_job>(name,form.passwd);
+    if(!co_await conn.run_db(job)){
+        co_await reply(conn,500,"Internal Error","cannot register now\n");
+        co_return;
+    }
+    co_await reply(conn,201,"Created","registered\n");
+}
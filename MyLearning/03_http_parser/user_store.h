@@ -0,0 +1,24 @@
+#ifndef USERSTORE_H
+#define USERSTORE_H
+
+#include "co_handler.h"
+
+// 👤 登录 / 注册 (表单 POST，见 form.h)
+//   POST /user/login      user=xxx&passwd=yyy   -> 200 / 401
+//   POST /user/register   user=xxx&passwd=yyy   -> 201 / 409 (用户名已经有了) / 400
+//
+// 用户表在启动时整个读进内存 (用户名 -> 盐 + 迭代次数 + 密码哈希)，登录只查这张哈希表，不读数据库；
+// 这张表读多写少，用读写锁，各个 I/O 线程同时登录互不影响。
+// 注册先在内存表里占住用户名 (同时注册同一个名字只有一个能成功，注册完马上就能登录)，
+// 再交给数据库线程算哈希、写进去 (co_await conn.run_db)，I/O 循环不等磁盘；写失败了把占的名字退掉，回 500。
+// 密码不存明文：每个用户一个随机盐，存 PBKDF2-HMAC-SHA256(密码, 盐, 60 万次)。
+// 这个算法故意慢 (一次几百毫秒)，所以登录的比对也在数据库线程上算，不占 I/O 循环；
+// 以前存的一轮 SHA-256 还认，登录成功时换成 PBKDF2
+
+// 📂 打开 (没有就建) 用户库，起连接池，把用户表读进内存 (启动时调一次)
+bool user_store_open(const char* path,int pool_size);
+
+co_task login_handler(http_conn& conn);
+co_task register_handler(http_conn& conn);
+
+#endif
@@ -0,0 +1,317 @@
+#include "websocket.h"
+#include "http_conn.h"
+#include<stdio.h>
+#include<string.h>
+#include<unistd.h>
+#include<pthread.h>
+#include<vector>
+#include<openssl/sha.h>
+#include<openssl/evp.h>
+#if defined(__SSE2__)
+#include<immintrin.h>
+#elif defined(__ARM_NEON)
+#include<arm_neon.h>
+#endif
+
+// =================================================================
+// 1. 路由 (和 co_route 一样，启动时注册好，之后只读)
+// =================================================================
+
+struct ws_route_entry{
+    const char* prefix;
+    size_t len;
+    ws_handler_fn fn;
+};
+
+static const int MAX_WS_ROUTES=16;
+static ws_route_entry g_ws_routes[MAX_WS_ROUTES];
+static int g_ws_route_count=0;
+
+bool ws_route(const char* prefix,ws_handler_fn fn){
+    if(g_ws_route_count>=MAX_WS_ROUTES){
+        return false;
+    }
+    g_ws_routes[g_ws_route_count].prefix=prefix;
+    g_ws_routes[g_ws_route_count].len=strlen(prefix);
+    g_ws_routes[g_ws_route_count].fn=fn;
+    g_ws_route_count++;
+    return true;
+}
+
+int ws_find_route(const char* url){
+    if(!url){
+        return -1;
+    }
+    for(int i=0;i<g_ws_route_count;i++){
+        if(strncmp(url,g_ws_routes[i].prefix,g_ws_routes[i].len)==0){
+            return i;
+        }
+    }
+    return -1;
+}
+
+ws_handler_fn ws_route_handler(int channel){
+    if(channel<0||channel>=g_ws_route_count){
+        return 0;
+    }
+    return g_ws_routes[channel].fn;
+}
+
+// =================================================================
+// 2. 握手 / 帧
+// =================================================================
+
+static const char WS_GUID[]="258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+bool ws_accept_key(const char* key,char* out){
+    char buf[128];
+    int n=snprintf(buf,sizeof(buf),"%s%s",key,WS_GUID);
+    if(n<0||n>=(int)sizeof(buf)){
+        return false;
+    }
+    unsigned char digest[SHA_DIGEST_LENGTH];
+    SHA1((const unsigned char*)buf,n,digest);
+    EVP_EncodeBlock((unsigned char*)out,digest,SHA_DIGEST_LENGTH);  // 20 字节 -> 28 个字符 + '\0'
+    return true;
+}
+
+// +-+-+-+-+-------+-+-------------+-------------------------------+
+// |F|R|R|R| opcode|M| Payload len |    Extended payload length    |
+// |I|S|S|S|  (4)  |A|     (7)     |             (16/64)           |
+// |N|V|V|V|       |S|             |   (if payload len==126/127)   |
+// | |1|2|3|       |K|             |                               |
+// +-+-+-+-+-------+-+-------------+ - - - - - - - - - - - - - - - +
+// |     Masking-key (0 or 4 bytes, 客户端发的一定有)               |
+// +---------------------------------------------------------------+
+int ws_parse_header(const unsigned char* p,size_t avail,ws_frame& frame){
+    if(avail<2){
+        return 0;
+    }
+    // 没协商过扩展 (比如 permessage-deflate)，RSV 位必须是 0
+    if(p[0]&0x70){
+        return -1;
+    }
+    frame.fin=(p[0]&0x80)!=0;
+    frame.opcode=p[0]&0x0F;
+    if(frame.opcode!=WS_CONTINUATION&&frame.opcode!=WS_TEXT&&frame.opcode!=WS_BINARY
+        &&frame.opcode!=WS_CLOSE&&frame.opcode!=WS_PING&&frame.opcode!=WS_PONG){
+        return -1;
+    }
+    frame.masked=(p[1]&0x80)!=0;
+
+    uint64_t len=p[1]&0x7F;
+    size_t n=2;
+    if(len==126){
+        if(avail<4){
+            return 0;
+        }
+        len=((uint64_t)p[2]<<8)|p[3];
+        n=4;
+    }else if(len==127){
+        if(avail<10){
+            return 0;
+        }
+        len=0;
+        for(int i=0;i<8;i++){
+            len=(len<<8)|p[2+i];
+        }
+        if(len>>63){
+            return -1;  // 最高位必须是 0
+        }
+        n=10;
+    }
+    if(frame.masked){
+        if(avail<n+4){
+            return 0;
+        }
+        memcpy(frame.mask,p+n,4);
+        n+=4;
+    }
+    frame.len=len;
+    return (int)n;
+}
+
+int ws_write_header(char* out,int opcode,size_t len,bool fin){
+    unsigned char* p=(unsigned char*)out;
+    p[0]=(fin?0x80:0)|(opcode&0x0F);
+    if(len<126){
+        p[1]=(unsigned char)len;
+        return 2;
+    }
+    if(len<=0xFFFF){
+        p[1]=126;
+        p[2]=(unsigned char)(len>>8);
+        p[3]=(unsigned char)len;
+        return 4;
+    }
+    p[1]=127;
+    for(int i=0;i<8;i++){
+        p[2+i]=(unsigned char)((uint64_t)len>>(56-8*i));
+    }
+    return 10;
+}
+
+// 🎭 第 i 个字节异或 mask[i%4]：先把 4 字节的掩码转到和 data[0] 对齐，
+// 再铺成 32 / 16 / 8 字节宽，一次异或一整块 (每一段的起点都是 4 的倍数，铺开的掩码一直是对齐的)
+void ws_unmask(char* data,size_t len,const unsigned char mask[4],uint64_t offset){
+    unsigned char m[4];
+    for(int i=0;i<4;i++){
+        m[i]=mask[(offset+i)&3];
+    }
+    uint32_t key32;
+    memcpy(&key32,m,4);
+    size_t i=0;
+
+#if defined(__AVX2__)
+    __m256i key256=_mm256_set1_epi32((int)key32);
+    for(;i+32<=len;i+=32){
+        __m256i v=_mm256_loadu_si256((const __m256i*)(data+i));
+        _mm256_storeu_si256((__m256i*)(data+i),_mm256_xor_si256(v,key256));
+    }
+#endif
+#if defined(__SSE2__)
+    __m128i key128=_mm_set1_epi32((int)key32);
+    for(;i+16<=len;i+=16){
+        __m128i v=_mm_loadu_si128((const __m128i*)(data+i));
+        _mm_storeu_si128((__m128i*)(data+i),_mm_xor_si128(v,key128));
+    }
+#elif defined(__ARM_NEON)
+    uint8x16_t key128=vreinterpretq_u8_u32(vdupq_n_u32(key32));
+    for(;i+16<=len;i+=16){
+        uint8_t* q=(uint8_t*)data+i;
+        vst1q_u8(q,veorq_u8(vld1q_u8(q),key128));
+    }
+#endif
+
+    uint64_t key64=((uint64_t)key32<<32)|key32;
+    for(;i+8<=len;i+=8){
+        uint64_t v;
+        memcpy(&v,data+i,8);
+        v^=key64;
+        memcpy(data+i,&v,8);
+    }
+    for(;i<len;i++){
+        data[i]^=m[i&3];
+    }
+}
+
+std::shared_ptr<const ws_message> ws_make_message(int channel,int opcode,const void* data,size_t len){
+    std::shared_ptr<ws_message> msg=std::make_shared<ws_message>();
+    msg->channel=channel;
+    char head[10];
+    int n=ws_write_header(head,opcode,len);
+    msg->bytes.reserve(n+len);
+    msg->bytes.append(head,n);
+    msg->bytes.append((const char*)data,len);
+    return msg;
+}
+
+// =================================================================
+// 3. 广播：每个 I/O 循环一个收件箱
+// =================================================================
+
+struct ws_hub{
+    int notify_fd;
+    pthread_mutex_t lock;
+    std::vector<std::shared_ptr<const ws_message> > inbox;  // 别的线程塞进来的 (加锁)
+    std::vector<http_conn*> members;    // 这个循环里的 WebSocket 连接 (只有本线程碰)
+};
+
+static thread_local ws_hub* t_hub=NULL;
+
+// 所有循环的收件箱 (启动时登记，跟进程同生共死)
+static pthread_mutex_t g_hubs_lock=PTHREAD_MUTEX_INITIALIZER;
+static std::vector<ws_hub*> g_hubs;
+
+void ws_hub_bind(int notify_fd){
+    ws_hub* hub=new ws_hub;
+    hub->notify_fd=notify_fd;
+    pthread_mutex_init(&hub->lock,NULL);
+    t_hub=hub;
+
+    pthread_mutex_lock(&g_hubs_lock);
+    g_hubs.push_back(hub);
+    pthread_mutex_unlock(&g_hubs_lock);
+}
+
+void ws_join(http_conn* conn){
+    if(!t_hub){
+        return;
+    }
+    conn->m_ws_slot=(int)t_hub->members.size();
+    t_hub->members.push_back(conn);
+}
+
+void ws_leave(http_conn* conn){
+    int slot=conn->m_ws_slot;
+    if(!t_hub||slot<0){
+        return;
+    }
+    // 拿最后一个填上这个空位
+    std::vector<http_conn*>& members=t_hub->members;
+    members[slot]=members.back();
+    members[slot]->m_ws_slot=slot;
+    members.pop_back();
+    conn->m_ws_slot=-1;
+}
+
+void ws_broadcast(int channel,int opcode,const void* data,size_t len){
+    ws_broadcast(ws_make_message(channel,opcode,data,len));
+}
+
+void ws_broadcast(const std::shared_ptr<const ws_message>& msg){
+    pthread_mutex_lock(&g_hubs_lock);
+    for(size_t i=0;i<g_hubs.size();i++){
+        ws_hub* hub=g_hubs[i];
+        pthread_mutex_lock(&hub->lock);
+        hub->inbox.push_back(msg);
+        pthread_mutex_unlock(&hub->lock);
+
+        uint64_t one=1;
+        ssize_t ret=write(hub->notify_fd,&one,sizeof(one));
+        (void)ret;
+    }
+    pthread_mutex_unlock(&g_hubs_lock);
+}
+
+void ws_hub_run(){
+    ws_hub* hub=t_hub;
+    if(!hub){
+        return;
+    }
+    std::vector<std::shared_ptr<const ws_message> > batch;
+    pthread_mutex_lock(&hub->lock);
+    batch.swap(hub->inbox);
+    pthread_mutex_unlock(&hub->lock);
+    if(batch.empty()){
+        return;
+    }
+
+    // 先把这一批消息挂到每个收件人的链上 (只是引用，不拷)，再每个连接发一次，
+    // 一个连接攒了好几条的话一次 writev 出去
+    std::vector<http_conn*> dirty;
+    std::vector<http_conn*>& members=hub->members;
+    for(size_t m=0;m<batch.size();m++){
+        // 倒着走：踢掉一个连接时是拿最后一个填它的位置，那个已经处理过了
+        for(int i=(int)members.size()-1;i>=0;i--){
+            http_conn* conn=members[i];
+            if(conn->m_ws_channel!=batch[m]->channel||conn->m_ws_closing){
+                continue;
+            }
+            bool was_empty=conn->m_out.empty();
+            if(!conn->ws_queue(batch[m])){
+                // 🐢 收得太慢，积压超过上限：踢掉
+                conn->ws_evict();
+                continue;
+            }
+            if(was_empty){
+                dirty.push_back(conn);
+            }
+        }
+    }
+    for(size_t i=0;i<dirty.size();i++){
+        if(dirty[i]->m_ws){     // 后面的消息把它踢掉了就不用发了
+            dirty[i]->ws_flush(false);
+        }
+    }
+}
@@ -0,0 +1,85 @@
+#ifndef WEBSOCKET_H
+#define WEBSOCKET_H
+
+#include<stdint.h>
+#include<stddef.h>
+#include<memory>
+#include<string>
+
+class http_conn;
+
+// 🔌 WebSocket (RFC 6455)
+// 客户端发 "Upgrade: websocket" 的 GET，URL 命中 ws_route 注册的前缀，就回 101，
+// 这个连接从此不再是一问一答，而是双向的消息流：
+//   - 收：按帧解析，客户端发来的负载都带掩码，原地解掉 (SIMD 一次 16/32 字节)，
+//     整条消息 (分片的拼好) 交给 handler
+//   - 发：服务器发的帧不带掩码，所以同一条消息发给谁都是同样的字节。
+//     ws_broadcast 只序列化一次，放进一个带引用计数的 ws_message，
+//     挂到每个收件人的 m_out 上 (append_shared，不拷)，所有 I/O 线程共用这一份
+//   - 每个连接没发出去的数据有上限 (ws_max_queue_kb)，收得太慢的直接踢掉，不让它拖住内存
+//
+//     static void chat(http_conn& conn,int opcode,const char* data,size_t len){
+//         ws_broadcast(conn.ws_channel(),opcode,data,len);
+//     }
+//     ws_route("/ws/chat",chat);
+
+// 帧类型
+enum WS_OPCODE{
+    WS_CONTINUATION=0x0,
+    WS_TEXT=0x1,
+    WS_BINARY=0x2,
+    WS_CLOSE=0x8,
+    WS_PING=0x9,
+    WS_PONG=0xA
+};
+
+// 📨 收到一条完整的消息 (WS_TEXT / WS_BINARY)，data 只在调用期间有效
+typedef void (*ws_handler_fn)(http_conn& conn,int opcode,const char* data,size_t len);
+
+// 🗺️ 路由：和 co_route 一样按 URL 前缀匹配，要在 I/O 线程启动之前注册好
+// 每个路由就是一个频道，ws_broadcast 按频道发
+bool ws_route(const char* prefix,ws_handler_fn fn);
+int ws_find_route(const char* url);     // 频道号，没有返回 -1
+ws_handler_fn ws_route_handler(int channel);
+
+// 🤝 握手：Sec-WebSocket-Accept = base64(SHA1(key + 固定的 GUID))，out 至少 29 字节
+bool ws_accept_key(const char* key,char* out);
+
+// 📦 解析出来的帧头
+struct ws_frame{
+    bool fin;
+    int opcode;
+    bool masked;
+    unsigned char mask[4];
+    uint64_t len;       // 负载长度
+};
+
+// 从 p 开始解析一个帧头：返回帧头长度，0 表示还没收全，-1 表示格式不对
+int ws_parse_header(const unsigned char* p,size_t avail,ws_frame& frame);
+
+// 写一个服务器发的帧头 (不带掩码)，out 至少 10 字节，返回帧头长度
+int ws_write_header(char* out,int opcode,size_t len,bool fin=true);
+
+// 🎭 解掉掩码 (原地)：offset 是 data[0] 在这一帧负载里的位置 (一帧分几次收到的时候接着解)
+void ws_unmask(char* data,size_t len,const unsigned char mask[4],uint64_t offset);
+
+// 📮 序列化好的一帧 (帧头 + 负载)，发给多少个连接都是这一份
+struct ws_message{
+    int channel;
+    std::string bytes;
+};
+std::shared_ptr<const ws_message> ws_make_message(int channel,int opcode,const void* data,size_t len);
+
+// 📢 发给一个频道里的所有连接 (任意线程都能调，各个 I/O 线程收到通知后自己发)
+void ws_broadcast(int channel,int opcode,const void* data,size_t len);
+void ws_broadcast(const std::shared_ptr<const ws_message>& msg);
+
+// 🚪 http_conn 升级成功 / 关掉的时候进出本循环的成员表
+void ws_join(http_conn* conn);
+void ws_leave(http_conn* conn);
+
+// 🔁 每个 I/O 循环一个广播收件箱，和 co_waker 共用同一个 eventfd
+void ws_hub_bind(int notify_fd);
+void ws_hub_run();      // I/O 循环收到 eventfd 通知后调：把收件箱里的消息发给本循环的连接
+
+#endif